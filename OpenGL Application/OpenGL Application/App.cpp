@@ -8,18 +8,94 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <algorithm>
 #include "GLSLProgram.h"
+#include "BVH.h"
+#include "TransformHierarchy.h"
+#include "EntityStore.h"
+#include "RenderComponents.h"
+#include "MeshImport.h"
+#include "AssetStreamer.h"
+#include "BlockCompress.h"
+#include "FrameCapture.h"
+#include "GoldenImages.h"
+#include "OcclusionCuller.h"
+#include "GpuCuller.h"
+#include "LodSelection.h"
+#include "ClusteredLighting.h"
+#include "CascadedShadowMaps.h"
+#include "RenderGraphExecutor.h"
+#include "PostProcessing.h"
+#include "FramePacer.h"
+#include "ResolutionController.h"
+#include "InputQueue.h"
+#include "SkinningPalette.h"
+#include "DualQuatSkinning.h"
+#include "Benchmarks.h"
 
 glm::vec3 camera_position = glm::vec3(0.0f, 0.0f, 5.0f);
 
-glm::mat4 triangle_model_matrix;
 glm::mat4 view_matrix;
 glm::mat4 projection_matrix;
 
 const GLuint DEFAULT_WINDOW_WIDTH = 800, DEFAULT_WINDOW_HEIGHT = 800;
 const GLfloat CAMERA_MOVEMENT_SPEED = 0.02f;
+const size_t ASSET_STAGING_BYTES = 32 * 1024 * 1024, ASSET_FRAME_BUDGET = 4 * 1024 * 1024;
+const GLuint OCCLUSION_WIDTH = 256, OCCLUSION_HEIGHT = 256;
+const GLuint GPU_CULL_TEST_WIDTH = 256, GPU_CULL_TEST_HEIGHT = 256;
+const unsigned int DEFAULT_MESH_LODS = 6;
+const GLfloat LOD_PIXEL_ERROR = 1.0f, LOD_HYSTERESIS = 0.25f;
+const GLuint LIGHT_TILES_X = 16, LIGHT_TILES_Y = 9, LIGHT_SLICES = 24, LIGHT_TEXTURE_UNIT = 1;
+const GLfloat LIGHT_NEAR = 0.1f, LIGHT_FAR = 100.0f;
+const GLuint SHADOW_CASCADES = 4, SHADOW_RESOLUTION = 1024, SHADOW_TEXTURE_UNIT = 4;
+const GLfloat SHADOW_NEAR = 0.1f, SHADOW_FAR = 20.0f, SHADOW_SPLIT_BLEND = 0.75f, SHADOW_CASTER_DISTANCE = 10.0f;
+const GLuint POST_TEXTURE_UNIT = 5;
+const GLuint SCENE_TEXTURE_UNIT = 0;
+const unsigned int INPUT_QUEUE_CAPACITY = 1024;
+const GLfloat DYNAMIC_MIN_SCALE = 0.5f, DYNAMIC_SCALE_STEP = 0.05f;
+const GLuint SKINNING_PALETTE_BINDING = 0;
+const unsigned int SKINNED_RINGS = 17, SKINNED_SIDES = 8, SKINNING_TEST_JOINTS = 64, SKINNING_TEST_VERTICES = 4096;
+const GLfloat SKINNING_TOLERANCE = 1e-4f;
+const glm::vec3 SUN_DIRECTION = glm::normalize(glm::vec3(0.3f, -1.0f, -0.4f));
+const GLuint GOLDEN_WIDTH = 256, GOLDEN_HEIGHT = 256, GOLDEN_TOLERANCE = 2;
+const size_t TEXTURE_STAGING_BYTES = 16 * 1024 * 1024, TEXTURE_UPLOAD_BUDGET = 4 * 1024 * 1024, TEXTURE_MEMORY_BUDGET = 256 * 1024 * 1024;
 
 GLSLProgram* shaderProgram;
+BVH triangle_bvh;
+TransformHierarchy scene_transforms;
+unsigned int triangle_node;
+EntityStore scene_entities;
+OcclusionCuller occlusion_culler;
+TextureManager* texture_manager;
+AssetStreamer* asset_streamer;
+AssetHandle scene_mesh;
+AssetHandle scene_texture;
+FrameCapture* frame_capture;
+GpuCuller* gpu_culler;
+GLSLProgram* culled_program;
+GLuint cube_vao, cube_vertices, cube_indices;
+ClusteredLighting* clustered_lighting;
+std::vector<PointLight> scene_lights;
+std::vector<glm::vec3> light_orbits;
+CascadedShadowMaps* shadow_maps;
+GLuint ground_vao, ground_vertices;
+GLSLProgram* skinned_program;
+SkinningPalette* skinning_palette;
+GLuint skinned_vao, skinned_vertices, skinned_indices;
+GLsizei skinned_index_count;
+RenderGraph frame_graph;
+RenderGraphExecutor* frame_executor;
+PostProcessChain* post_chain;
+FramePacer* frame_pacer;
+ResolutionController resolution_controller;
+GLfloat render_scale = 1.0f;
+InputQueue input_queue;
+double input_time = -1.0; // arrival of the oldest input not yet presented
+double input_latency_total = 0.0, input_latency_worst = 0.0;
+unsigned int input_latency_frames = 0;
+unsigned int screenshot_count = 0;
+Entity scene_mesh_entity = EntityStore::INVALID_ENTITY;
+bool scene_mesh_placed = false;
 
 double ypos_old = -1;
 
@@ -29,36 +105,847 @@ void framebuffer_size_callback(GLFWwindow* window, int new_screen_width, int new
 	projection_matrix = glm::perspective(45.0f, (GLfloat)new_screen_width / (GLfloat)new_screen_height, 0.1f, 10.0f);
 }
 
-void cursor_pos_callback(GLFWwindow* window, double xpos, double ypos) {
+// The input callbacks only queue timestamped events; apply_input() acts on
+// them as late as possible, just before the frame that shows their effect
+void queue_input(InputEventType type, double x, double y, int code, int action)
+{
+	InputEvent event = { type, glfwGetTime(), x, y, code, action };
+	input_queue.push(event);
+}
+
+void cursor_pos_callback(GLFWwindow* window, double xpos, double ypos)
+{
+	queue_input(INPUT_CURSOR, xpos, ypos, 0, 0);
+}
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	queue_input(INPUT_KEY, 0.0, 0.0, key, action);
+}
+
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+	double xpos, ypos;
+	glfwGetCursorPos(window, &xpos, &ypos);
+	queue_input(INPUT_BUTTON, xpos, ypos, button, action);
+}
+
+// Dragging with the left button moves the camera in and out
+void drag_camera(double ypos)
+{
+	if (ypos_old == -1)
+		return;
+
+	camera_position.z += CAMERA_MOVEMENT_SPEED * (GLfloat)(ypos_old - ypos);
+	camera_position.z = glm::clamp(camera_position.z, 0.0f, 10.0f);
+	ypos_old = ypos;
+}
 
-	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
+// F12 saves a screenshot, F11 starts and stops recording a video
+void handle_key(int key, int action)
+{
+	if (action != GLFW_PRESS)
+		return;
+
+	if (key == GLFW_KEY_F12)
 	{
-		if(ypos_old != -1)
-		{
-			camera_position.z += CAMERA_MOVEMENT_SPEED * (ypos_old - ypos);
-			camera_position.z = glm::clamp(camera_position.z, 0.0f, 10.0f);	
-		}
+		string file_name = "screenshot" + std::to_string(screenshot_count++) + ".png";
+		frame_capture->screenshot(file_name.c_str(), CAPTURE_PNG);
+	}
+	else if (key == GLFW_KEY_F11 && frame_capture->isRecording())
+		frame_capture->stopRecording();
+	else if (key == GLFW_KEY_F11)
+		frame_capture->startRecording("capture.y4m", 60);
+}
+
+// Right clicking picks a triangle
+void pick(GLFWwindow* window, double xpos, double ypos)
+{
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+
+	// Unproject the cursor into a model space ray so the BVH never needs rebuilding as the model rotates
+	glm::vec4 viewport(0.0f, 0.0f, width, height);
+	glm::vec3 window_near((float)xpos, height - (float)ypos, 0.0f);
+	glm::vec3 window_far((float)xpos, height - (float)ypos, 1.0f);
+	glm::mat4 model_view_matrix = view_matrix * scene_transforms.getWorldMatrix(triangle_node);
+	glm::vec3 ray_near = glm::unProject(window_near, model_view_matrix, projection_matrix, viewport);
+	glm::vec3 ray_far = glm::unProject(window_far, model_view_matrix, projection_matrix, viewport);
+
+	RayHit hit;
+	if (triangle_bvh.intersectClosest(ray_near, glm::normalize(ray_far - ray_near), hit))
+		printf("Picked triangle %u at barycentric (%f, %f)\n", hit.triangle, hit.u, hit.v);
+}
 
-		ypos_old = ypos;
+// Applies the queued input, remembering when the oldest event that moved the
+// camera arrived so its latency is measured once the frame is presented
+void apply_input(GLFWwindow* window)
+{
+	InputEvent event;
+	while (input_queue.pop(event))
+	{
+		glm::vec3 camera_before = camera_position;
+		if (event.type == INPUT_CURSOR)
+			drag_camera(event.y);
+		else if (event.type == INPUT_BUTTON && event.code == GLFW_MOUSE_BUTTON_LEFT)
+			ypos_old = event.action == GLFW_PRESS ? event.y : -1;
+		else if (event.type == INPUT_BUTTON && event.code == GLFW_MOUSE_BUTTON_RIGHT && event.action == GLFW_PRESS)
+			pick(window, event.x, event.y);
+		else if (event.type == INPUT_KEY)
+			handle_key(event.code, event.action);
+
+		if (camera_position != camera_before && input_time < 0.0)
+			input_time = event.timestamp;
 	}
-	else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_RELEASE) {
-		ypos_old = -1;
+}
+
+// Lights on rings around the y axis, each orbit being ring radius, height
+// and starting angle
+void create_lights(unsigned int count)
+{
+	srand(1);
+	scene_lights.resize(count);
+	light_orbits.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float hue = 6.0f * i / count;
+		scene_lights[i].color = glm::clamp(glm::vec3(fabsf(hue - 3.0f) - 1.0f, 2.0f - fabsf(hue - 2.0f), 2.0f - fabsf(hue - 4.0f)), 0.0f, 1.0f);
+		scene_lights[i].radius = 0.5f + (float)rand() / RAND_MAX;
+		scene_lights[i].intensity = 2.0f;
+		light_orbits[i] = glm::vec3(0.5f + 2.5f * rand() / RAND_MAX, 2.0f * rand() / RAND_MAX - 1.0f, 6.2831853f * rand() / RAND_MAX);
 	}
+}
 
+// Outer rings turn slower
+void update_lights(float time)
+{
+	for (size_t i = 0; i < scene_lights.size(); i++)
+	{
+		float angle = light_orbits[i].z + time / (1.0f + light_orbits[i].x);
+		scene_lights[i].position = glm::vec3(light_orbits[i].x * cosf(angle), light_orbits[i].y, light_orbits[i].x * sinf(angle));
+	}
 }
 
 void cleanUp()
 {
 	delete shaderProgram;
+	delete frame_capture;
+	delete gpu_culler;
+	delete culled_program;
+	delete frame_executor;
+	delete post_chain;
+	delete frame_pacer;
+	delete clustered_lighting;
+	delete shadow_maps;
+	delete skinned_program;
+	delete skinning_palette;
+	if (skinned_vao)
+	{
+		glDeleteVertexArrays(1, &skinned_vao);
+		glDeleteBuffers(1, &skinned_vertices);
+		glDeleteBuffers(1, &skinned_indices);
+	}
+	if (ground_vao)
+	{
+		glDeleteVertexArrays(1, &ground_vao);
+		glDeleteBuffers(1, &ground_vertices);
+	}
+	if (cube_vao)
+	{
+		glDeleteVertexArrays(1, &cube_vao);
+		glDeleteBuffers(1, &cube_vertices);
+		glDeleteBuffers(1, &cube_indices);
+	}
+	scene_mesh.reset();
+	scene_texture.reset();
+	delete asset_streamer;
+	delete texture_manager;
+}
+
+// Draws the streamed mesh once it is uploaded, scaled to fit a unit cube
+// next to the triangle. Until then the entity shows the placeholder.
+void updateStreamedMesh()
+{
+	if (!scene_entities.isAlive(scene_mesh_entity))
+		return;
+
+	*scene_entities.get<MeshDraw>(scene_mesh_entity) = asset_streamer->getMesh(scene_mesh);
+
+	glm::vec3 bounds_min, bounds_max;
+	if (scene_mesh_placed || !asset_streamer->getMeshBounds(scene_mesh, bounds_min, bounds_max))
+		return;
+
+	glm::vec3 extent = bounds_max - bounds_min;
+	float scale = 1.0f / glm::max(glm::max(extent.x, extent.y), glm::max(extent.z, 1e-6f));
+	glm::vec3 center = 0.5f * (bounds_min + bounds_max);
+
+	unsigned int node = scene_entities.get<TransformNode>(scene_mesh_entity)->node;
+	scene_entities.get<LocalBounds>(scene_mesh_entity)->min = bounds_min;
+	scene_entities.get<LocalBounds>(scene_mesh_entity)->max = bounds_max;
+	asset_streamer->getMeshLods(scene_mesh, *scene_entities.get<MeshLods>(scene_mesh_entity));
+	scene_transforms.setScale(node, glm::vec3(scale));
+	scene_transforms.setTranslation(node, glm::vec3(1.0f, 0.0f, 0.0f) - center * scale);
+	scene_mesh_placed = true;
+}
+
+void draw_mesh(const MeshDraw & mesh)
+{
+	glBindVertexArray(mesh.vertexArray);
+	if (mesh.indexType)
+		glDrawElements(GL_TRIANGLES, mesh.count, mesh.indexType, (const void*)(size_t)(mesh.first * (mesh.indexType == GL_UNSIGNED_SHORT ? 2 : 4)));
+	else
+		glDrawArrays(GL_TRIANGLES, mesh.first, mesh.count);
+}
+
+// Shadow casters into the cascades they overlap, the static ones only when
+// their cached depth is out of date
+void draw_shadows()
+{
+	shadow_maps->update(view_matrix, projection_matrix, SHADOW_NEAR, SHADOW_FAR, SUN_DIRECTION);
+	const ShadowCascades & cascades = shadow_maps->getCascades();
+
+	unsigned int dynamic_cascades = 0;
+	scene_entities.forEach<WorldMatrix, LocalBounds, ShadowCaster>([&](Entity entity, WorldMatrix & world, LocalBounds & bounds, ShadowCaster & caster)
+	{
+		for (unsigned int cascade = 0; cascade < cascades.getCascadeCount() && !caster.isStatic; cascade++)
+			if (cascades.overlaps(cascade, world.value, bounds.min, bounds.max))
+				dynamic_cascades |= 1u << cascade;
+	});
+
+	shadow_maps->render([&cascades](unsigned int cascade, bool static_casters)
+	{
+		scene_entities.forEach<WorldMatrix, LocalBounds, MeshDraw, ShadowCaster>([&](Entity entity, WorldMatrix & world, LocalBounds & bounds, MeshDraw & mesh, ShadowCaster & caster)
+		{
+			if (caster.isStatic != static_casters || !cascades.overlaps(cascade, world.value, bounds.min, bounds.max))
+				return;
+
+			shadow_maps->setModelMatrix(world.value);
+			draw_mesh(mesh);
+		});
+	}, dynamic_cascades);
+	glBindVertexArray(0);
+}
+
+// Draws every entity with the transforms as they are
+void draw_scene()
+{
+	scene_entities.forEachChunk<TransformNode, WorldMatrix>([](unsigned int count, const Entity * entities, TransformNode * nodes, WorldMatrix * worlds)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			worlds[i].value = scene_transforms.getWorldMatrix(nodes[i].node);
+	});
+
+	view_matrix = lookAt(camera_position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	if (shadow_maps)
+	{
+		draw_shadows();
+		shaderProgram->use();
+		shadow_maps->bind(shaderProgram, SHADOW_TEXTURE_UNIT);
+	}
+
+	shaderProgram->setUniform("view_matrix", view_matrix);
+	shaderProgram->setUniform("projection_matrix", projection_matrix);
+	shaderProgram->setUniform("textured", scene_texture.isValid());
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (clustered_lighting)
+	{
+		clustered_lighting->update(scene_lights.data(), (unsigned int)scene_lights.size(), view_matrix, projection_matrix);
+		clustered_lighting->bind(shaderProgram, LIGHT_TEXTURE_UNIT, viewport[2], viewport[3]);
+	}
+
+	// Coarsest detail level whose error stays under LOD_PIXEL_ERROR pixels
+	float pixel_scale = lodPixelScale(projection_matrix, (float)viewport[3]);
+	scene_entities.forEach<WorldMatrix, LocalBounds, MeshLods, MeshDraw>([pixel_scale](Entity entity, WorldMatrix & world, LocalBounds & bounds, MeshLods & lods, MeshDraw & mesh)
+	{
+		float pixels_per_unit = lodPixelsPerUnit(world.value, bounds.min, bounds.max, camera_position, pixel_scale);
+		lods.current = selectLod(lods, pixels_per_unit, LOD_PIXEL_ERROR, LOD_HYSTERESIS);
+		mesh.first = (int)lods.levels[lods.current].firstIndex;
+		mesh.count = (int)lods.levels[lods.current].indexCount;
+	}, true);
+
+	// Occluders into the CPU depth buffer, then every bounded entity against it
+	occlusion_culler.beginFrame(projection_matrix * view_matrix);
+	scene_entities.forEach<WorldMatrix, Occluder>([](Entity entity, WorldMatrix & world, Occluder & occluder)
+	{
+		occlusion_culler.addOccluder(world.value, occluder.positions, occluder.triangleIndices, occluder.triangleCount, occluder.cullBackFaces);
+	});
+	occlusion_culler.rasterize();
+	scene_entities.forEach<WorldMatrix, LocalBounds, Visibility>([](Entity entity, WorldMatrix & world, LocalBounds & bounds, Visibility & visibility)
+	{
+		visibility.visible = occlusion_culler.isVisible(world.value, bounds.min, bounds.max);
+	}, true);
+
+	scene_entities.forEach<WorldMatrix, MeshDraw, Visibility>([](Entity entity, WorldMatrix & world, MeshDraw & mesh, Visibility & visibility)
+	{
+		if (!visibility.visible)
+			return;
+
+		shaderProgram->setUniform("model_matrix", world.value);
+		draw_mesh(mesh);
+	});
+	glBindVertexArray(0);
+}
+
+// Unit cube drawn through the GPU culler, which holds the object matrices
+bool create_gpu_culling(unsigned int max_objects)
+{
+	gpu_culler = new GpuCuller();
+	if (!gpu_culler->create(max_objects))
+		return false;
+
+	culled_program = new GLSLProgram();
+	if (!culled_program->compileShaderFromFile("culled.vs", GL_VERTEX_SHADER) || !culled_program->compileShaderFromFile("triangle.fs", GL_FRAGMENT_SHADER) || !culled_program->link())
+	{
+		printf("Culled shader program failed to build!\n%s", culled_program->log().c_str());
+		return false;
+	}
+
+	const GLfloat positions[] = {
+		-0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  -0.5f, 0.5f, -0.5f,  0.5f, 0.5f, -0.5f,
+		-0.5f, -0.5f, 0.5f,  0.5f, -0.5f, 0.5f,  -0.5f, 0.5f, 0.5f,  0.5f, 0.5f, 0.5f
+	};
+	const GLuint indices[] = {
+		0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,  0, 1, 4, 1, 5, 4,
+		2, 6, 3, 3, 6, 7,  0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5
+	};
+
+	glGenVertexArrays(1, &cube_vao);
+	glBindVertexArray(cube_vao);
+	glGenBuffers(1, &cube_vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, cube_vertices);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(positions), positions, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), nullptr);
+	glEnableVertexAttribArray(0);
+	glGenBuffers(1, &cube_indices);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cube_indices);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	gpu_culler->setObjectIdAttribute(3);
+	glBindVertexArray(0);
+	return true;
+}
+
+GpuObject cube_object(const glm::vec3 & position, const glm::vec3 & scale)
+{
+	GpuObject object = {};
+	object.model = glm::scale(glm::translate(glm::mat4(), position), scale);
+	object.boundsMin = glm::vec4(-0.5f, -0.5f, -0.5f, 1.0f);
+	object.boundsMax = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+	object.indexCount = 36;
+	return object;
+}
+
+// Culls and draws the cubes, then keeps the depth of the frame for culling
+// the next one
+void draw_gpu_culled(GLuint framebuffer, unsigned int width, unsigned int height)
+{
+	glm::mat4 view_projection = projection_matrix * view_matrix;
+	gpu_culler->cull(view_projection);
+
+	culled_program->use();
+	culled_program->setUniform("view_matrix", view_matrix);
+	culled_program->setUniform("projection_matrix", projection_matrix);
+	glBindVertexArray(cube_vao);
+	gpu_culler->draw();
+	glBindVertexArray(0);
+
+	gpu_culler->updateHiZ(framebuffer, width, height, view_projection);
+	shaderProgram->use();
+}
+
+// Checks the GPU culling results against the CPU: a wall filling the view
+// with a row of cubes in front of it, a grid of cubes behind it partly
+// outside the frustum, and cubes behind the camera. Returns the number of
+// failed checks.
+unsigned int run_gpu_culling_test()
+{
+	std::vector<GpuObject> objects;
+	objects.push_back(cube_object(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(200.0f, 200.0f, 1.0f)));
+	for (int x = -2; x <= 2; x++)
+		objects.push_back(cube_object(glm::vec3((float)x, 0.0f, -5.0f), glm::vec3(1.0f)));
+	unsigned int first_hidden = (unsigned int)objects.size();
+	for (int z = 0; z < 4; z++)
+		for (int x = 0; x < 8; x++)
+			objects.push_back(cube_object(glm::vec3(-10.5f + 3.0f * x, 0.0f, -20.0f - 5.0f * z), glm::vec3(1.0f)));
+	for (int x = -2; x <= 2; x++)
+		objects.push_back(cube_object(glm::vec3((float)x, 0.0f, 20.0f), glm::vec3(1.0f)));
+
+	if (!create_gpu_culling((unsigned int)objects.size()))
+		return 1;
+	gpu_culler->setObjects(objects.data(), (unsigned int)objects.size());
+
+	GLuint framebuffer, color, depth;
+	glGenRenderbuffers(1, &color);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, GPU_CULL_TEST_WIDTH, GPU_CULL_TEST_HEIGHT);
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, GPU_CULL_TEST_WIDTH, GPU_CULL_TEST_HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	glViewport(0, 0, GPU_CULL_TEST_WIDTH, GPU_CULL_TEST_HEIGHT);
+	glEnable(GL_DEPTH_TEST);
+
+	view_matrix = lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	projection_matrix = glm::perspective(glm::radians(45.0f), (GLfloat)GPU_CULL_TEST_WIDTH / (GLfloat)GPU_CULL_TEST_HEIGHT, 0.1f, 100.0f);
+	glm::mat4 view_projection = projection_matrix * view_matrix;
+
+	// Same test as cull.cs: outside when all 8 corners are beyond one clip plane
+	std::vector<unsigned int> expected_frustum, expected_hiz;
+	for (unsigned int i = 0; i < objects.size(); i++)
+	{
+		glm::mat4 model_view_projection = view_projection * objects[i].model;
+		glm::vec3 below(0.0f), above(0.0f);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 position = glm::mix(glm::vec3(objects[i].boundsMin), glm::vec3(objects[i].boundsMax), glm::vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1));
+			glm::vec4 clip = model_view_projection * glm::vec4(position, 1.0f);
+			below += glm::vec3(glm::lessThan(glm::vec3(clip), glm::vec3(-clip.w)));
+			above += glm::vec3(glm::greaterThan(glm::vec3(clip), glm::vec3(clip.w)));
+		}
+		if (glm::all(glm::lessThan(below, glm::vec3(8.0f))) && glm::all(glm::lessThan(above, glm::vec3(8.0f))))
+		{
+			expected_frustum.push_back(i);
+			if (i < first_hidden)
+				expected_hiz.push_back(i);
+		}
+	}
+
+	unsigned int failures = 0;
+	const char* PASSES[] = { "frustum", "frustum and Hi-Z" };
+	for (int pass = 0; pass < 2; pass++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		draw_gpu_culled(framebuffer, GPU_CULL_TEST_WIDTH, GPU_CULL_TEST_HEIGHT);
+		std::vector<unsigned int> drawn = gpu_culler->readDrawnObjects();
+		std::sort(drawn.begin(), drawn.end());
+
+		const std::vector<unsigned int> & expected = pass == 0 ? expected_frustum : expected_hiz;
+		bool passed = drawn == expected;
+		printf("GPU culling, %s: %u of %u objects drawn, %u expected: %s\n", PASSES[pass], (unsigned int)drawn.size(), (unsigned int)objects.size(), (unsigned int)expected.size(), passed ? "passed" : "FAILED");
+		if (!passed)
+			failures++;
+	}
+	printf("Draw count %s\n", gpu_culler->isDrawCountOnGpu() ? "read by the GPU" : "fixed, culled commands empty");
+
+	glDisable(GL_DEPTH_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &color);
+	glDeleteRenderbuffers(1, &depth);
+	return failures;
+}
+
+// Tube along x bending at the origin, its left half bound to joint 0 and its
+// right half to joint 1, blended across the middle
+void create_skinned_tube(std::vector<SkinnedVertex> & vertices, std::vector<GLuint> & indices)
+{
+	for (unsigned int ring = 0; ring < SKINNED_RINGS; ring++)
+	{
+		float x = 2.0f * ring / (SKINNED_RINGS - 1) - 1.0f;
+		float weight = glm::smoothstep(-0.25f, 0.25f, x);
+		for (unsigned int side = 0; side < SKINNED_SIDES; side++)
+		{
+			float angle = 6.2831853f * side / SKINNED_SIDES;
+			SkinnedVertex vertex;
+			vertex.normal = glm::vec3(0.0f, cosf(angle), sinf(angle));
+			vertex.position = glm::vec3(x, 0.0f, 0.0f) + 0.2f * vertex.normal;
+			vertex.joints = glm::u8vec4(0, 1, 0, 0);
+			vertex.weights = glm::vec4(1.0f - weight, weight, 0.0f, 0.0f);
+			vertices.push_back(vertex);
+		}
+	}
+
+	for (unsigned int ring = 0; ring + 1 < SKINNED_RINGS; ring++)
+	{
+		for (unsigned int side = 0; side < SKINNED_SIDES; side++)
+		{
+			GLuint a = ring * SKINNED_SIDES + side, b = ring * SKINNED_SIDES + (side + 1) % SKINNED_SIDES;
+			GLuint quad[] = { a, b, a + SKINNED_SIDES, b, b + SKINNED_SIDES, a + SKINNED_SIDES };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+// Joint 1 of the tube swinging about the z axis through the origin
+void skinned_tube_pose(float time, glm::mat2x4 * palette)
+{
+	glm::mat4 joints[2];
+	joints[1] = glm::rotate(glm::mat4(), 0.8f * sinf(time), glm::vec3(0.0f, 0.0f, 1.0f));
+	dualQuatsFromMatrices(joints, palette, 2);
+}
+
+bool create_skinned_program(GLSLProgram* program, bool fragment_shader)
+{
+	if (!program->compileShaderFromFile("skinned.vs", GL_VERTEX_SHADER) || (fragment_shader && !program->compileShaderFromFile("skinned.fs", GL_FRAGMENT_SHADER)))
+	{
+		printf("Skinned shader failed to compile!\n%s", program->log().c_str());
+		return false;
+	}
+
+	// Transform feedback varyings must be declared before linking
+	if (!fragment_shader)
+	{
+		const char* VARYINGS[] = { "gl_Position", "normal" };
+		glTransformFeedbackVaryings(program->getHandle(), 2, VARYINGS, GL_INTERLEAVED_ATTRIBS);
+	}
+
+	if (!program->link())
+	{
+		printf("Skinned shader program failed to link!\n%s", program->log().c_str());
+		return false;
+	}
+	program->bindUniformBlock("JointPalette", SKINNING_PALETTE_BINDING);
+	return true;
+}
+
+// The tube from create_skinned_tube(), below the triangle
+bool create_skinning()
+{
+	skinned_program = new GLSLProgram();
+	if (!create_skinned_program(skinned_program, true))
+		return false;
+
+	skinning_palette = new SkinningPalette();
+	if (!skinning_palette->create(2, SKINNING_PALETTE_BINDING))
+		return false;
+
+	std::vector<SkinnedVertex> vertices;
+	std::vector<GLuint> indices;
+	create_skinned_tube(vertices, indices);
+	skinned_index_count = (GLsizei)indices.size();
+
+	glGenVertexArrays(1, &skinned_vao);
+	glBindVertexArray(skinned_vao);
+	glGenBuffers(1, &skinned_vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, skinned_vertices);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SkinnedVertex), vertices.data(), GL_STATIC_DRAW);
+	SkinningPalette::setVertexAttributes();
+	glGenBuffers(1, &skinned_indices);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skinned_indices);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+	return true;
+}
+
+void update_skinning(float time)
+{
+	glm::mat2x4 palette[2];
+	skinned_tube_pose(time, palette);
+	skinning_palette->upload(palette, 2);
+}
+
+void draw_skinned()
+{
+	skinned_program->use();
+	skinned_program->setUniform("model_matrix", glm::translate(glm::mat4(), glm::vec3(0.0f, -1.0f, 0.0f)));
+	skinned_program->setUniform("view_matrix", view_matrix);
+	skinned_program->setUniform("projection_matrix", projection_matrix);
+	skinning_palette->bind();
+	glBindVertexArray(skinned_vao);
+	glDrawElements(GL_TRIANGLES, skinned_index_count, GL_UNSIGNED_INT, nullptr);
+	glBindVertexArray(0);
+	shaderProgram->use();
+}
+
+// Skins vertices with skinned.vs into transform feedback, with identity
+// matrices so gl_Position is the skinned position, and compares them with
+// skinVertices() on the CPU: the tube in a known pose, then vertices with
+// random weights over random rigid joints. Returns the number of failed
+// checks.
+unsigned int run_skinning_test()
+{
+	GLSLProgram program;
+	SkinningPalette palette;
+	if (!create_skinned_program(&program, false) || !palette.create(SKINNING_TEST_JOINTS, SKINNING_PALETTE_BINDING))
+		return 1;
+	program.use();
+	program.setUniform("model_matrix", glm::mat4());
+	program.setUniform("view_matrix", glm::mat4());
+	program.setUniform("projection_matrix", glm::mat4());
+	palette.bind();
+
+	std::vector<SkinnedVertex> tube_vertices;
+	std::vector<GLuint> tube_indices;
+	create_skinned_tube(tube_vertices, tube_indices);
+	std::vector<glm::mat2x4> tube_palette(2);
+	skinned_tube_pose(1.0f, tube_palette.data());
+
+	srand(1);
+	std::vector<glm::mat4> random_joints(SKINNING_TEST_JOINTS);
+	std::vector<glm::mat2x4> random_palette(SKINNING_TEST_JOINTS);
+	for (unsigned int j = 0; j < SKINNING_TEST_JOINTS; j++)
+	{
+		glm::vec3 axis = glm::normalize(glm::vec3(rand() + 1.0f, rand() - RAND_MAX / 2.0f, rand() - RAND_MAX / 2.0f));
+		glm::vec3 translation = glm::vec3(rand(), rand(), rand()) * (4.0f / RAND_MAX) - 2.0f;
+		random_joints[j] = glm::translate(glm::mat4(), translation) * glm::rotate(glm::mat4(), 6.2831853f * rand() / RAND_MAX, axis);
+	}
+	dualQuatsFromMatrices(random_joints.data(), random_palette.data(), SKINNING_TEST_JOINTS);
+
+	std::vector<SkinnedVertex> random_vertices(SKINNING_TEST_VERTICES);
+	for (SkinnedVertex & vertex : random_vertices)
+	{
+		vertex.position = glm::vec3(rand(), rand(), rand()) * (2.0f / RAND_MAX) - 1.0f;
+		vertex.normal = glm::normalize(glm::vec3(rand(), rand(), rand()) - RAND_MAX / 2.0f + 1.0f);
+		for (int k = 0; k < 4; k++)
+			vertex.joints[k] = (unsigned char)(rand() % SKINNING_TEST_JOINTS);
+		vertex.weights = glm::vec4(rand(), rand(), rand(), rand()) + 1.0f;
+		vertex.weights /= vertex.weights.x + vertex.weights.y + vertex.weights.z + vertex.weights.w;
+	}
+
+	GLuint vao, vertex_buffer, feedback_buffer;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, &vertex_buffer);
+	glGenBuffers(1, &feedback_buffer);
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	unsigned int failures = 0;
+	const char* POSES[] = { "tube", "random" };
+	for (int pose = 0; pose < 2; pose++)
+	{
+		const std::vector<SkinnedVertex> & vertices = pose == 0 ? tube_vertices : random_vertices;
+		const std::vector<glm::mat2x4> & joints = pose == 0 ? tube_palette : random_palette;
+		palette.upload(joints.data(), (unsigned int)joints.size());
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SkinnedVertex), vertices.data(), GL_STATIC_DRAW);
+		SkinningPalette::setVertexAttributes();
+
+		// gl_Position then normal, 7 floats a vertex
+		std::vector<GLfloat> skinned(vertices.size() * 7);
+		glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedback_buffer);
+		glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, skinned.size() * sizeof(GLfloat), nullptr, GL_STATIC_READ);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedback_buffer);
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArrays(GL_POINTS, 0, (GLsizei)vertices.size());
+		glEndTransformFeedback();
+		glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, skinned.size() * sizeof(GLfloat), skinned.data());
+
+		std::vector<glm::vec3> positions(vertices.size()), normals(vertices.size());
+		skinVertices(joints.data(), vertices.data(), positions.data(), normals.data(), vertices.size());
+
+		float position_error = 0.0f, normal_error = 0.0f;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const GLfloat* gpu = &skinned[i * 7];
+			position_error = glm::max(position_error, glm::length(glm::vec3(gpu[0], gpu[1], gpu[2]) / gpu[3] - positions[i]));
+			normal_error = glm::max(normal_error, glm::length(glm::vec3(gpu[4], gpu[5], gpu[6]) - normals[i]));
+		}
+
+		bool passed = position_error < SKINNING_TOLERANCE && normal_error < SKINNING_TOLERANCE;
+		printf("Skinning, %s pose: %u vertices, max position error %g, max normal error %g: %s\n", POSES[pose], (unsigned int)vertices.size(), position_error, normal_error, passed ? "passed" : "FAILED");
+		if (!passed)
+			failures++;
+	}
+
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &vertex_buffer);
+	glDeleteBuffers(1, &feedback_buffer);
+	glDeleteProgram(program.getHandle());
+	shaderProgram->use();
+	return failures;
 }
 
-int main()
+// The frame as render graph passes: the scene and the GPU culled cubes into
+// the backbuffer, or into HDR colour and depth at the render scale
+// post-processed into it, then the capture reading it back. The backbuffer
+// is the window's when framebuffer is 0.
+void build_frame_graph(RenderGraph & graph, unsigned int width, unsigned int height, GLuint framebuffer)
+{
+	graph.clear();
+	RenderGraph::Resource backbuffer = graph.importBackbuffer("backbuffer", width, height, framebuffer);
+	graph.markOutput(backbuffer);
+
+	RenderGraph::Resource color = backbuffer, depth = 0;
+	if (post_chain)
+	{
+		unsigned int render_width = std::max(1u, (unsigned int)(width * render_scale + 0.5f));
+		unsigned int render_height = std::max(1u, (unsigned int)(height * render_scale + 0.5f));
+		color = graph.createTexture("hdr", render_width, render_height, GL_RGBA16F);
+		depth = graph.createTexture("depth", render_width, render_height, GL_DEPTH_COMPONENT24);
+	}
+
+	unsigned int scene = graph.addPass("scene", [](const RenderPassTarget &)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		draw_scene();
+	});
+	graph.write(scene, color, ACCESS_ATTACHMENT);
+	if (post_chain)
+		graph.write(scene, depth, ACCESS_ATTACHMENT);
+
+	if (gpu_culler)
+	{
+		unsigned int culled = graph.addPass("gpu culled", [](const RenderPassTarget & target)
+		{
+			draw_gpu_culled(target.framebuffer, target.width, target.height);
+		});
+		graph.write(culled, color, ACCESS_ATTACHMENT);
+		if (post_chain)
+			graph.write(culled, depth, ACCESS_ATTACHMENT);
+	}
+
+	if (skinned_program)
+	{
+		unsigned int skinned = graph.addPass("skinned", [](const RenderPassTarget &)
+		{
+			draw_skinned();
+		});
+		graph.write(skinned, color, ACCESS_ATTACHMENT);
+		if (post_chain)
+			graph.write(skinned, depth, ACCESS_ATTACHMENT);
+	}
+
+	if (post_chain)
+		post_chain->addPasses(graph, color, backbuffer);
+
+	unsigned int capture = graph.addPass("capture", [](const RenderPassTarget & target)
+	{
+		frame_capture->capture(target.framebuffer, target.width, target.height);
+	});
+	graph.read(capture, backbuffer, ACCESS_TRANSFER);
+	graph.setSideEffects(capture);
+}
+
+// Renders the frame graph at fixed timestamps into an offscreen framebuffer
+// and compares it with the golden images in directory, or writes them when
+// updating. The scenes are named after the configuration, such as
+// triangle_lights_shadows_2500ms, so each set of options has its own
+// goldens. Returns the number of failed scenes.
+unsigned int run_golden_tests(const char* directory, const string & configuration, bool update)
+{
+	GoldenRenderer golden;
+	if (!golden.create(GOLDEN_WIDTH, GOLDEN_HEIGHT))
+		return 1;
+
+	projection_matrix = glm::perspective(45.0f, (GLfloat)GOLDEN_WIDTH / (GLfloat)GOLDEN_HEIGHT, 0.1f, 100.0f);
+	const float TIMESTAMPS[] = { 0.0f, 2.5f, 10.0f };
+	for (float timestamp : TIMESTAMPS)
+	{
+		scene_transforms.setRotation(triangle_node, glm::angleAxis(timestamp / 10.0f, glm::vec3(0.0f, 0.0f, 1.0f)));
+		scene_transforms.update();
+		update_lights(timestamp);
+		if (skinning_palette)
+			update_skinning(timestamp);
+
+		string name = configuration + "_" + std::to_string((int)(timestamp * 1000.0f)) + "ms";
+		golden.run(directory, name.c_str(), update, GOLDEN_TOLERANCE, [&golden]
+		{
+			build_frame_graph(frame_graph, GOLDEN_WIDTH, GOLDEN_HEIGHT, golden.getFramebuffer());
+			frame_executor->execute(frame_graph);
+		});
+	}
+
+	golden.appendReport((string(directory) + "/golden_report.csv").c_str());
+	printf("%u of %u golden scenes failed\n", golden.getFailureCount(), (unsigned int)golden.getResults().size());
+	return golden.getFailureCount();
+}
+
+int main(int argc, char* argv[])
 {
 	GLFWwindow* window;
 
+	if (argc > 1 && string(argv[1]) == "--benchmark")
+	{
+		runBenchmarks();
+		return 0;
+	}
+
+	// --convert-mesh <input> <output> [lods]
+	if (argc > 3 && string(argv[1]) == "--convert-mesh")
+		return convertMesh(argv[2], argv[3], argc > 4 ? (unsigned int)std::stoul(argv[4]) : DEFAULT_MESH_LODS) ? 0 : 1;
+
+	// --compress-texture <input> <output.dds> [bc1|bc4|bc5] [fast|normal|high]
+	if (argc > 3 && string(argv[1]) == "--compress-texture")
+	{
+		string format = argc > 4 ? argv[4] : "bc1", quality = argc > 5 ? argv[5] : "normal";
+		TextureFormat texture_format = format == "bc4" ? TEXTURE_BC4 : format == "bc5" ? TEXTURE_BC5 : TEXTURE_BC1;
+		BlockQuality block_quality = quality == "fast" ? BLOCK_QUALITY_FAST : quality == "high" ? BLOCK_QUALITY_HIGH : BLOCK_QUALITY_NORMAL;
+		return convertTexture(argv[2], argv[3], texture_format, block_quality) ? 0 : 1;
+	}
+
+	// --golden <directory> [--update] renders the golden image scenes without
+	// showing the window, with the scene options below that are also given
+	const char* golden_directory = argc > 2 && string(argv[1]) == "--golden" ? argv[2] : nullptr;
+	bool golden_update = argc > 3 && string(argv[3]) == "--update";
+
+	// --gpu-cull <count> draws a field of cubes culled on the GPU, --gpu-cull-test checks the culling without showing the window
+	unsigned int gpu_cull_count = 0;
+	for (int i = 1; i + 1 < argc; i++)
+		if (string(argv[i]) == "--gpu-cull")
+			gpu_cull_count = (unsigned int)std::stoul(argv[i + 1]);
+	bool gpu_cull_test = argc > 1 && string(argv[1]) == "--gpu-cull-test";
+
+	// --skinned draws a tube bent by dual quaternion skinning in skinned.vs,
+	// --skinning-test checks skinned.vs against the CPU without showing the window
+	bool skinned = std::find(argv + 1, argv + argc, string("--skinned")) != argv + argc;
+	bool skinning_test = argc > 1 && string(argv[1]) == "--skinning-test";
+
+	// --lights <count> shades the scene with that many point lights through clustered.fs
+	unsigned int light_count = 0;
+	for (int i = 1; i + 1 < argc; i++)
+		if (string(argv[i]) == "--lights")
+			light_count = (unsigned int)std::stoul(argv[i + 1]);
+
+	// --shadows adds a ground for the scene to cast shadows on from the sun,
+	// which clustered.fs adds to its point lights when both are given
+	bool shadows = std::find(argv + 1, argv + argc, string("--shadows")) != argv + argc;
+
+	// --post [half|quarter] renders in HDR and post-processes it, with bloom at
+	// that resolution; --lut <file.cube> grades the result
+	bool post = false;
+	unsigned int bloom_downsample = 2;
+	const char* lut_file = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (string(argv[i]) == "--post")
+		{
+			post = true;
+			if (i + 1 < argc && string(argv[i + 1]) == "quarter")
+				bloom_downsample = 4;
+		}
+		else if (string(argv[i]) == "--lut" && i + 1 < argc)
+			lut_file = argv[i + 1];
+	}
+
+	// --swap immediate|vsync|adaptive sets the swap interval, vsync by default.
+	// --target-ms <ms> scales the HDR render target to hold the GPU frame time
+	// there, post-processing it.
+	SwapMode swap_mode = SWAP_VSYNC;
+	GLfloat target_milliseconds = 0.0f;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (string(argv[i]) == "--swap")
+			swap_mode = string(argv[i + 1]) == "immediate" ? SWAP_IMMEDIATE : string(argv[i + 1]) == "adaptive" ? SWAP_ADAPTIVE : SWAP_VSYNC;
+		else if (string(argv[i]) == "--target-ms")
+			target_milliseconds = std::stof(argv[i + 1]);
+	}
+	post = post || target_milliseconds > 0.0f;
+
 	if (!glfwInit())
 		return -1;
 
+	if (golden_directory || gpu_cull_test || skinning_test)
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// Compute shaders and indirect draws
+	if (gpu_cull_count || gpu_cull_test || post)
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	}
+
 	window = glfwCreateWindow(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, "Hello World", NULL, NULL);
 	if (!window)
 	{
@@ -66,8 +953,11 @@ int main()
 		return -1;
 	}
 
+	input_queue.create(INPUT_QUEUE_CAPACITY);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetCursorPosCallback(window, cursor_pos_callback);
+	glfwSetMouseButtonCallback(window, mouse_button_callback);
+	glfwSetKeyCallback(window, key_callback);
 	glfwMakeContextCurrent(window);
 
 	glewExperimental = GL_TRUE;
@@ -86,7 +976,7 @@ int main()
 		exit(1);
 	}
 
-	if (!shaderProgram->compileShaderFromFile("triangle.fs", GL_FRAGMENT_SHADER))
+	if (!shaderProgram->compileShaderFromFile(light_count ? "clustered.fs" : shadows ? "shadowed.fs" : "triangle.fs", GL_FRAGMENT_SHADER, shadows ? "#define SHADOWS 1\n" : ""))
 	{
 		printf("Fragment shader failed to compile!\n%s", shaderProgram->log().c_str());
 		getchar();
@@ -101,6 +991,28 @@ int main()
 	}
 
 	shaderProgram->use();
+	shaderProgram->setUniform("albedo_texture", (int)SCENE_TEXTURE_UNIT);
+
+	if (light_count)
+	{
+		clustered_lighting = new ClusteredLighting();
+		if (!clustered_lighting->create(LIGHT_TILES_X, LIGHT_TILES_Y, LIGHT_SLICES, LIGHT_NEAR, LIGHT_FAR))
+		{
+			getchar();
+			exit(1);
+		}
+		create_lights(light_count);
+	}
+
+	if (shadows)
+	{
+		shadow_maps = new CascadedShadowMaps();
+		if (!shadow_maps->create(SHADOW_CASCADES, SHADOW_RESOLUTION, SHADOW_SPLIT_BLEND, SHADOW_CASTER_DISTANCE))
+		{
+			getchar();
+			exit(1);
+		}
+	}
 
 	shaderProgram->printActiveUniforms();
 	shaderProgram->printActiveAttribs();
@@ -122,29 +1034,235 @@ int main()
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
 	glEnableVertexAttribArray(0);
 
+	const GLfloat triangle_uvs[] = { 0.5f, 1.0f,  1.0f, 0.0f,  0.0f, 0.0f };
+	GLuint triangleUvs;
+	glGenBuffers(1, &triangleUvs);
+	glBindBuffer(GL_ARRAY_BUFFER, triangleUvs);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(triangle_uvs), triangle_uvs, GL_STATIC_DRAW);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), 0);
+	glEnableVertexAttribArray(2);
+
+	triangle_bvh.build((const glm::vec3*)triangle_vertices, nullptr, 1);
+	triangle_node = scene_transforms.createNode();
+
+	TransformNode triangle_transform = { triangle_node };
+	MeshDraw triangle_draw = { triangleVAO, 0, 3, 0 };
+	LocalBounds triangle_bounds = { glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, 0.5f, 0.0f) };
+	Occluder triangle_occluder = { (const glm::vec3*)triangle_vertices, nullptr, 1, false };
+	Visibility visible = { true };
+	ShadowCaster moving_caster = { false };
+	scene_entities.create(triangle_transform, WorldMatrix(), triangle_draw, triangle_bounds, triangle_occluder, visible, moving_caster);
+
+	if (shadows)
+	{
+		const GLfloat ground_positions[] = {
+			-5.0f, -1.0f, -5.0f,  -5.0f, -1.0f, 5.0f,  5.0f, -1.0f, 5.0f,
+			-5.0f, -1.0f, -5.0f,  5.0f, -1.0f, 5.0f,  5.0f, -1.0f, -5.0f
+		};
+
+		glGenVertexArrays(1, &ground_vao);
+		glBindVertexArray(ground_vao);
+		glGenBuffers(1, &ground_vertices);
+		glBindBuffer(GL_ARRAY_BUFFER, ground_vertices);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(ground_positions), ground_positions, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+
+		TransformNode ground_transform = { scene_transforms.createNode() };
+		MeshDraw ground_draw = { ground_vao, 0, 6, 0 };
+		LocalBounds ground_bounds = { glm::vec3(-5.0f, -1.0f, -5.0f), glm::vec3(5.0f, -1.0f, 5.0f) };
+		ShadowCaster static_caster = { true };
+		scene_entities.create(ground_transform, WorldMatrix(), ground_draw, ground_bounds, visible, static_caster);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	if (!occlusion_culler.create(OCCLUSION_WIDTH, OCCLUSION_HEIGHT))
+	{
+		getchar();
+		exit(1);
+	}
+
+	frame_capture = new FrameCapture();
+	frame_executor = new RenderGraphExecutor();
+
+	frame_pacer = new FramePacer();
+	frame_pacer->create();
+	frame_pacer->setSwapMode(swap_mode);
+	if (target_milliseconds > 0.0f && !resolution_controller.create(target_milliseconds, DYNAMIC_MIN_SCALE, 1.0f, DYNAMIC_SCALE_STEP, FramePacer::QUERY_LATENCY))
+	{
+		getchar();
+		exit(1);
+	}
+
+	if (post)
+	{
+		post_chain = new PostProcessChain();
+		if (!post_chain->create(POST_TEXTURE_UNIT))
+		{
+			getchar();
+			exit(1);
+		}
+
+		PostSettings post_settings = post_chain->getSettings();
+		post_settings.bloomDownsample = bloom_downsample;
+		post_chain->setSettings(post_settings);
+
+		ColorLut lut;
+		if (lut_file && loadCubeLut(lut_file, lut))
+			post_chain->setLut(lut);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	texture_manager = new TextureManager();
+	if (!texture_manager->create(TEXTURE_STAGING_BYTES, TEXTURE_UPLOAD_BUDGET, TEXTURE_MEMORY_BUDGET))
+	{
+		getchar();
+		exit(1);
+	}
+
+	asset_streamer = new AssetStreamer();
+	if (!asset_streamer->create(ASSET_STAGING_BYTES, ASSET_FRAME_BUDGET, texture_manager))
+	{
+		getchar();
+		exit(1);
+	}
+	asset_streamer->setPlaceholderMesh(triangle_draw);
+
+	// Mesh from --mesh, streamed in while the triangle stands in for it
+	const char* mesh_file = nullptr;
+	for (int i = 1; i + 1 < argc; i++)
+		if (string(argv[i]) == "--mesh")
+			mesh_file = argv[i + 1];
+	if (mesh_file)
+	{
+		scene_mesh = asset_streamer->loadMesh(mesh_file);
+		TransformNode mesh_transform = { scene_transforms.createNode(triangle_node) };
+		scene_transforms.setTranslation(mesh_transform.node, glm::vec3(1.0f, 0.0f, 0.0f));
+		MeshLods placeholder_lods = {};
+		placeholder_lods.levels[0].indexCount = 3;
+		placeholder_lods.count = 1;
+		scene_mesh_entity = scene_entities.create(mesh_transform, WorldMatrix(), triangle_draw, triangle_bounds, visible, placeholder_lods, moving_caster);
+	}
+
+	// Texture from --texture, sampled by the scene shaders as it streams in
+	for (int i = 1; i + 1 < argc; i++)
+		if (string(argv[i]) == "--texture")
+			scene_texture = asset_streamer->loadTexture(argv[i + 1]);
+
 	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
+	if (gpu_cull_test)
+	{
+		unsigned int failures = run_gpu_culling_test();
+		cleanUp();
+		glfwTerminate();
+		return failures > 0 ? 1 : 0;
+	}
+
+	if (skinning_test)
+	{
+		unsigned int failures = run_skinning_test();
+		cleanUp();
+		glfwTerminate();
+		return failures > 0 ? 1 : 0;
+	}
+
+	if (skinned)
+	{
+		if (!create_skinning())
+		{
+			getchar();
+			exit(1);
+		}
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	// Square grid of cubes stretching away from the camera
+	if (gpu_cull_count)
+	{
+		if (!create_gpu_culling(gpu_cull_count))
+		{
+			getchar();
+			exit(1);
+		}
+
+		unsigned int side = (unsigned int)ceil(sqrt((double)gpu_cull_count));
+		std::vector<GpuObject> objects(gpu_cull_count);
+		for (unsigned int i = 0; i < gpu_cull_count; i++)
+			objects[i] = cube_object(glm::vec3(2.0f * (i % side) - side, -1.5f, -2.0f * (i / side)), glm::vec3(1.0f));
+		gpu_culler->setObjects(objects.data(), gpu_cull_count);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	if (golden_directory)
+	{
+		string configuration = "triangle";
+		configuration += light_count ? "_lights" : "";
+		configuration += shadows ? "_shadows" : "";
+		configuration += post ? "_post" : "";
+		configuration += post && lut_file ? "_lut" : "";
+		configuration += gpu_cull_count ? "_gpucull" : "";
+		configuration += skinned ? "_skinned" : "";
+		unsigned int failures = run_golden_tests(golden_directory, configuration, golden_update);
+		cleanUp();
+		glfwTerminate();
+		return failures > 0 ? 1 : 0;
+	}
+
 	projection_matrix = glm::perspective(45.0f, (GLfloat)DEFAULT_WINDOW_HEIGHT / (GLfloat)DEFAULT_WINDOW_WIDTH, 0.1f, 100.0f);
 
 	while (!glfwWindowShouldClose(window))
 	{
-		glClear(GL_COLOR_BUFFER_BIT);
+		glm::quat spin = glm::angleAxis((GLfloat)glfwGetTime() / 10.0f, glm::vec3(0.0f, 0.0f, 1.0f));
+		scene_transforms.setRotation(triangle_node, glm::normalize(scene_transforms.getRotation(triangle_node) * spin));
+		asset_streamer->update();
+		updateStreamedMesh();
+		texture_manager->bind(asset_streamer->getTexture(scene_texture), SCENE_TEXTURE_UNIT);
+		texture_manager->update();
+		scene_transforms.update();
+		update_lights((GLfloat)glfwGetTime());
+		if (skinning_palette)
+			update_skinning((GLfloat)glfwGetTime());
 
-		triangle_model_matrix = rotate(triangle_model_matrix, (GLfloat)glfwGetTime() / 10.0f, glm::vec3(0.0f, 0.0f, 1.0f));
-		view_matrix = lookAt(camera_position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		// Input is polled and applied after the frame's other updates, right
+		// before draw_scene() derives the view matrix from the camera
+		glfwPollEvents();
+		apply_input(window);
 
-		shaderProgram->setUniform("model_matrix", triangle_model_matrix);
-		shaderProgram->setUniform("view_matrix", view_matrix);
-		shaderProgram->setUniform("projection_matrix", projection_matrix);
+		int framebuffer_width, framebuffer_height;
+		glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+		frame_pacer->beginFrame();
+		build_frame_graph(frame_graph, framebuffer_width, framebuffer_height, 0);
+		if (!frame_executor->execute(frame_graph))
+			break;
+		frame_pacer->endFrame();
 
-		glBindVertexArray(triangleVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 3);
-		glBindVertexArray(0);
+		if (target_milliseconds > 0.0f && frame_pacer->hasNewGpuTime())
+		{
+			GLfloat scale = resolution_controller.update(frame_pacer->getGpuMilliseconds());
+			if (scale != render_scale)
+				printf("Render scale %.2f at %.2f ms on the GPU\n", scale, frame_pacer->getGpuMilliseconds());
+			render_scale = scale;
+		}
 
+		// Swapping returns once the frame is queued for display, which is as
+		// close to presentation as the application can see
 		glfwSwapBuffers(window);
-		glfwPollEvents();
+		if (input_time >= 0.0)
+		{
+			double latency = glfwGetTime() - input_time;
+			input_latency_total += latency;
+			input_latency_worst = std::max(input_latency_worst, latency);
+			input_latency_frames++;
+			input_time = -1.0;
+		}
 	}
 
+	if (input_latency_frames)
+		printf("Input to present: %.2f ms mean, %.2f ms worst over %u frames, %u events dropped\n",
+			input_latency_total / input_latency_frames * 1e3, input_latency_worst * 1e3, input_latency_frames, input_queue.getDroppedCount());
+
 	cleanUp();
 
 	glfwTerminate();
@@ -0,0 +1,531 @@
+#include "AssetStreamer.h"
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <cfloat>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include "MeshBuffer.h"
+#include "MeshImport.h"
+
+const unsigned int AssetStreamer::WORKER_COUNT;
+
+struct Asset
+{
+	AssetType type;
+	std::atomic<int> references;
+	AssetState state;
+	bool decoding; // owned by a worker until update() drains it from the decoded list
+	std::string key;
+	std::string fileNames[2];
+
+	// Filled in by the worker
+	bool decodeFailed;
+	MeshFile meshFile;
+	MeshData meshData;
+	const unsigned char * blobs[2]; // vertex and index data, in meshFile or meshData
+	size_t blobBytes[2];
+	unsigned int indexCount;
+	unsigned int indexSize;
+	glm::vec3 boundsMin, boundsMax;
+	MeshLods lods;
+	TextureData textureData;
+	std::string sources[2];
+
+	// Upload progress and GL objects
+	size_t uploaded;
+	size_t totalBytes;
+	GLuint vertexArray;
+	GLuint buffers[2];
+	unsigned int texture; // TextureManager id
+	GLSLProgram * program;
+
+	Asset()
+	{
+		references = 0;
+		state = ASSET_LOADING;
+		decoding = false;
+		decodeFailed = false;
+		blobs[0] = blobs[1] = nullptr;
+		blobBytes[0] = blobBytes[1] = 0;
+		indexCount = 0;
+		indexSize = 4;
+		lods = MeshLods();
+		uploaded = 0;
+		totalBytes = 0;
+		vertexArray = 0;
+		buffers[0] = buffers[1] = 0;
+		texture = TextureManager::PLACEHOLDER;
+		program = nullptr;
+	}
+
+	void freeSourceData()
+	{
+		meshFile.close();
+		meshData = MeshData();
+		textureData = TextureData();
+		sources[0].clear();
+		sources[1].clear();
+		blobs[0] = blobs[1] = nullptr;
+	}
+};
+
+AssetHandle::AssetHandle()
+{
+	asset = nullptr;
+}
+
+AssetHandle::AssetHandle(Asset * asset)
+{
+	this->asset = asset;
+	if (asset)
+		asset->references++;
+}
+
+AssetHandle::AssetHandle(const AssetHandle & other)
+{
+	asset = other.asset;
+	if (asset)
+		asset->references++;
+}
+
+AssetHandle & AssetHandle::operator=(const AssetHandle & other)
+{
+	if (other.asset)
+		other.asset->references++;
+	reset();
+	asset = other.asset;
+	return *this;
+}
+
+AssetHandle::~AssetHandle()
+{
+	reset();
+}
+
+void AssetHandle::reset()
+{
+	if (asset)
+		asset->references--;
+	asset = nullptr;
+}
+
+bool AssetHandle::isValid() const
+{
+	return asset != nullptr;
+}
+
+AssetStreamer::AssetStreamer() : workers(WORKER_COUNT)
+{
+	frameBudget = 0;
+	textures = nullptr;
+	placeholderMesh.vertexArray = 0;
+	placeholderMesh.first = 0;
+	placeholderMesh.count = 0;
+	placeholderMesh.indexType = 0;
+	placeholderShader = nullptr;
+	uploadedBytes = 0;
+	decodingCount = 0;
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	// Workers write into the assets, let them finish before freeing anything
+	while (decodingCount > 0)
+		std::this_thread::yield();
+
+	for (Asset * asset : assets)
+	{
+		if (asset->vertexArray)
+			glDeleteVertexArrays(1, &asset->vertexArray);
+		if (asset->buffers[0])
+			glDeleteBuffers(2, asset->buffers);
+		delete asset->program;
+		delete asset;
+	}
+}
+
+bool AssetStreamer::create(size_t stagingBytes, size_t frameBudget, TextureManager * textures)
+{
+	if (!staging.create(stagingBytes))
+	{
+		printf("Could not create the %zu byte asset staging ring\n", stagingBytes);
+		return false;
+	}
+	this->frameBudget = frameBudget;
+	this->textures = textures;
+	return true;
+}
+
+// Requests for a file already loaded or loading share its asset
+AssetHandle AssetStreamer::request(AssetType type, const std::string & key, const std::string & first, const std::string & second)
+{
+	auto cached = cache.find(key);
+	if (cached != cache.end())
+		return AssetHandle(cached->second);
+
+	Asset * asset = new Asset();
+	asset->type = type;
+	asset->key = key;
+	asset->fileNames[0] = first;
+	asset->fileNames[1] = second;
+	asset->decoding = true;
+	assets.push_back(asset);
+	cache[key] = asset;
+
+	AssetHandle handle(asset);
+	decodingCount++;
+	workers.submit([this, asset] { decode(asset); });
+	return handle;
+}
+
+AssetHandle AssetStreamer::loadMesh(const char * fileName)
+{
+	return request(ASSET_MESH, std::string("mesh:") + fileName, fileName, std::string());
+}
+
+AssetHandle AssetStreamer::loadTexture(const char * fileName)
+{
+	return request(ASSET_TEXTURE, std::string("texture:") + fileName, fileName, std::string());
+}
+
+AssetHandle AssetStreamer::loadShader(const char * vertexFileName, const char * fragmentFileName)
+{
+	return request(ASSET_SHADER, std::string("shader:") + vertexFileName + "|" + fragmentFileName, vertexFileName, fragmentFileName);
+}
+
+static bool readText(const std::string & fileName, std::string & text)
+{
+	std::ifstream stream(fileName, std::ios::in | std::ios::binary);
+	if (!stream.is_open())
+	{
+		printf("Could not open %s\n", fileName.c_str());
+		return false;
+	}
+
+	std::stringstream contents;
+	contents << stream.rdbuf();
+	text = contents.str();
+	return true;
+}
+
+// Worker thread. Everything the render thread will read is produced here,
+// including faulting in the pages of a mapped mesh.
+void AssetStreamer::decode(Asset * asset)
+{
+	bool decoded = false;
+	switch (asset->type)
+	{
+	case ASSET_MESH:
+		if (isImportableMesh(asset->fileNames[0].c_str()))
+		{
+			MeshData & mesh = asset->meshData;
+			decoded = importMesh(asset->fileNames[0].c_str(), mesh);
+			asset->blobs[0] = (const unsigned char *)mesh.vertices.data();
+			asset->blobs[1] = (const unsigned char *)mesh.indices.data();
+			asset->blobBytes[0] = mesh.vertices.size() * sizeof(MeshVertex);
+			asset->blobBytes[1] = mesh.indices.size() * sizeof(unsigned int);
+			asset->indexCount = (unsigned int)mesh.indices.size();
+			asset->indexSize = 4;
+			MeshLod whole = { 0, asset->indexCount, 0.0f, 0 };
+			asset->lods.levels[0] = whole;
+			asset->lods.count = 1;
+			asset->boundsMin = glm::vec3(FLT_MAX);
+			asset->boundsMax = glm::vec3(-FLT_MAX);
+			for (const MeshVertex & vertex : mesh.vertices)
+			{
+				asset->boundsMin = glm::min(asset->boundsMin, vertex.position);
+				asset->boundsMax = glm::max(asset->boundsMax, vertex.position);
+			}
+		}
+		else if (asset->meshFile.open(asset->fileNames[0].c_str()))
+		{
+			MeshFile & file = asset->meshFile;
+			asset->blobs[0] = (const unsigned char *)file.getVertices();
+			asset->blobs[1] = (const unsigned char *)file.getIndices();
+			asset->blobBytes[0] = (size_t)file.getHeader().vertexBytes;
+			asset->blobBytes[1] = (size_t)file.getHeader().indexBytes;
+			asset->indexCount = file.getIndexCount();
+			asset->indexSize = file.getIndexSize();
+			asset->boundsMin = file.getHeader().boundsMin;
+			asset->boundsMax = file.getHeader().boundsMax;
+			asset->lods.count = file.getLodCount();
+			for (unsigned int level = 0; level < asset->lods.count; level++)
+				asset->lods.levels[level] = file.getLod(level);
+
+			volatile unsigned char sink = 0;
+			for (int b = 0; b < 2; b++)
+				for (size_t offset = 0; offset < asset->blobBytes[b]; offset += 4096)
+					sink += asset->blobs[b][offset];
+			decoded = true;
+		}
+		decoded = decoded && asset->indexCount > 0;
+		asset->totalBytes = asset->blobBytes[0] + asset->blobBytes[1];
+		break;
+	case ASSET_TEXTURE:
+		decoded = loadTextureData(asset->fileNames[0].c_str(), MIP_FILTER_KAISER, asset->textureData);
+		asset->totalBytes = textureBytes(asset->textureData);
+		break;
+	case ASSET_SHADER:
+		decoded = readText(asset->fileNames[0], asset->sources[0]) && readText(asset->fileNames[1], asset->sources[1]);
+		asset->totalBytes = asset->sources[0].size() + asset->sources[1].size();
+		break;
+	}
+
+	asset->decodeFailed = !decoded;
+	{
+		std::lock_guard<std::mutex> lock(decodedMutex);
+		this->decoded.push_back(asset);
+	}
+	decodingCount--;
+}
+
+void AssetStreamer::beginUpload(Asset * asset)
+{
+	if (asset->type == ASSET_MESH)
+	{
+		glGenVertexArrays(1, &asset->vertexArray);
+		glGenBuffers(2, asset->buffers);
+		glBindVertexArray(asset->vertexArray);
+
+		GLenum targets[2] = { GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER };
+		for (int b = 0; b < 2; b++)
+		{
+			// Written only by buffer copies, so immutable storage needs no flags
+			glBindBuffer(targets[b], asset->buffers[b]);
+			if (GLEW_ARB_buffer_storage)
+				glBufferStorage(targets[b], asset->blobBytes[b], nullptr, 0);
+			else
+				glBufferData(targets[b], asset->blobBytes[b], nullptr, GL_STATIC_DRAW);
+			if (b == 0)
+				MeshBuffer::setVertexAttributes();
+		}
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+// Uploads the next part of the asset and returns the bytes it took. The
+// first upload of a frame may exceed the budget by one shader so that every
+// asset makes progress. Mesh chunks never exceed a quarter of the staging
+// ring, so a failed allocation only waits for earlier copies to retire;
+// textures whose rows cannot fit are refused by TextureManager::add().
+size_t AssetStreamer::uploadSome(Asset * asset, size_t budget)
+{
+	bool firstOfFrame = budget == frameBudget;
+	size_t limit = std::min(budget, staging.getSize() / 4);
+	size_t offset;
+
+	if (asset->type == ASSET_MESH)
+	{
+		if (asset->uploaded == asset->totalBytes)
+			return 0;
+
+		int b = asset->uploaded < asset->blobBytes[0] ? 0 : 1;
+		size_t blobOffset = b == 0 ? asset->uploaded : asset->uploaded - asset->blobBytes[0];
+		size_t bytes = std::min(asset->blobBytes[b] - blobOffset, limit);
+		assert(bytes > 0 && bytes <= staging.getSize() / 4);
+		if (!staging.allocate(bytes, offset))
+			return 0;
+
+		void * mapped = staging.map(offset, bytes);
+		memcpy(mapped, asset->blobs[b] + blobOffset, bytes);
+		staging.unmap();
+
+		glBindBuffer(GL_COPY_READ_BUFFER, staging.getBuffer());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, asset->buffers[b]);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, blobOffset, bytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		asset->uploaded += bytes;
+		return bytes;
+	}
+
+	// Shaders compile in one go, the source length stands in for their cost
+	if (asset->totalBytes > budget && !firstOfFrame)
+		return 0;
+
+	asset->program = new GLSLProgram();
+	if (!asset->program->compileShaderFromString(asset->sources[0], GL_VERTEX_SHADER) ||
+		!asset->program->compileShaderFromString(asset->sources[1], GL_FRAGMENT_SHADER) ||
+		!asset->program->link())
+	{
+		printf("Could not build shader %s + %s\n%s", asset->fileNames[0].c_str(), asset->fileNames[1].c_str(), asset->program->log().c_str());
+		delete asset->program;
+		asset->program = nullptr;
+		asset->state = ASSET_FAILED;
+	}
+
+	asset->uploaded = asset->totalBytes;
+	return asset->totalBytes;
+}
+
+void AssetStreamer::finishUpload(Asset * asset)
+{
+	if (asset->state == ASSET_LOADING)
+		asset->state = ASSET_READY;
+	asset->freeSourceData();
+}
+
+// Assets nobody references any more, unless a worker still owns them
+void AssetStreamer::releaseUnused()
+{
+	for (size_t i = 0; i < assets.size();)
+	{
+		Asset * asset = assets[i];
+		if (asset->references > 0 || asset->decoding)
+		{
+			i++;
+			continue;
+		}
+
+		uploads.erase(std::remove(uploads.begin(), uploads.end(), asset), uploads.end());
+		cache.erase(asset->key);
+
+		if (asset->vertexArray)
+			glDeleteVertexArrays(1, &asset->vertexArray);
+		if (asset->buffers[0])
+			glDeleteBuffers(2, asset->buffers);
+		if (textures)
+			textures->remove(asset->texture);
+		delete asset->program;
+		delete asset;
+
+		assets[i] = assets.back();
+		assets.pop_back();
+	}
+}
+
+void AssetStreamer::update()
+{
+	std::vector<Asset *> finished;
+	{
+		std::lock_guard<std::mutex> lock(decodedMutex);
+		finished.swap(decoded);
+	}
+
+	for (Asset * asset : finished)
+	{
+		asset->decoding = false;
+		if (asset->decodeFailed)
+		{
+			asset->state = ASSET_FAILED;
+			asset->freeSourceData();
+			continue;
+		}
+
+		// The texture manager streams textures in within its own budgets
+		if (asset->type == ASSET_TEXTURE)
+		{
+			asset->texture = textures ? textures->add(asset->textureData) : TextureManager::PLACEHOLDER;
+			asset->state = asset->texture != TextureManager::PLACEHOLDER ? ASSET_READY : ASSET_FAILED;
+			asset->freeSourceData();
+			continue;
+		}
+
+		beginUpload(asset);
+		uploads.push_back(asset);
+	}
+
+	size_t budget = frameBudget;
+	uploadedBytes = 0;
+	while (!uploads.empty() && budget > 0)
+	{
+		Asset * asset = uploads.front();
+		size_t bytes = uploadSome(asset, budget);
+		if (bytes == 0 && asset->uploaded != asset->totalBytes)
+			break;
+
+		uploadedBytes += bytes;
+		budget -= std::min(bytes, budget);
+		if (asset->uploaded == asset->totalBytes)
+		{
+			finishUpload(asset);
+			uploads.pop_front();
+		}
+	}
+
+	staging.endFrame();
+	releaseUnused();
+}
+
+AssetState AssetStreamer::getState(const AssetHandle & handle) const
+{
+	return handle.asset ? handle.asset->state : ASSET_FAILED;
+}
+
+MeshDraw AssetStreamer::getMesh(const AssetHandle & handle) const
+{
+	const Asset * asset = handle.asset;
+	if (!asset || asset->state != ASSET_READY || asset->type != ASSET_MESH)
+		return placeholderMesh;
+
+	const MeshLod & full = asset->lods.levels[0];
+	MeshDraw draw = { asset->vertexArray, (int)full.firstIndex, (int)full.indexCount, (unsigned int)(asset->indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT) };
+	return draw;
+}
+
+bool AssetStreamer::getMeshLods(const AssetHandle & handle, MeshLods & lods) const
+{
+	const Asset * asset = handle.asset;
+	if (!asset || asset->state != ASSET_READY || asset->type != ASSET_MESH)
+		return false;
+
+	lods = asset->lods;
+	return true;
+}
+
+bool AssetStreamer::getMeshBounds(const AssetHandle & handle, glm::vec3 & boundsMin, glm::vec3 & boundsMax) const
+{
+	const Asset * asset = handle.asset;
+	if (!asset || asset->state != ASSET_READY || asset->type != ASSET_MESH)
+		return false;
+
+	boundsMin = asset->boundsMin;
+	boundsMax = asset->boundsMax;
+	return true;
+}
+
+unsigned int AssetStreamer::getTexture(const AssetHandle & handle) const
+{
+	const Asset * asset = handle.asset;
+	return asset && asset->state == ASSET_READY && asset->type == ASSET_TEXTURE ? asset->texture : TextureManager::PLACEHOLDER;
+}
+
+GLSLProgram * AssetStreamer::getShader(const AssetHandle & handle) const
+{
+	const Asset * asset = handle.asset;
+	return asset && asset->state == ASSET_READY && asset->type == ASSET_SHADER ? asset->program : placeholderShader;
+}
+
+void AssetStreamer::setPlaceholderMesh(const MeshDraw & mesh)
+{
+	placeholderMesh = mesh;
+}
+
+void AssetStreamer::setPlaceholderShader(GLSLProgram * shader)
+{
+	placeholderShader = shader;
+}
+
+void AssetStreamer::setFrameBudget(size_t bytes)
+{
+	frameBudget = bytes;
+}
+
+unsigned int AssetStreamer::getLoadingCount() const
+{
+	unsigned int count = 0;
+	for (const Asset * asset : assets)
+		count += asset->state == ASSET_LOADING;
+	return count;
+}
+
+size_t AssetStreamer::getUploadedBytes() const
+{
+	return uploadedBytes;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <glew.h>
+#include "ThreadPool.h"
+#include "StagingRing.h"
+#include "MeshFile.h"
+#include "TextureManager.h"
+#include "GLSLProgram.h"
+#include "RenderComponents.h"
+
+enum AssetType
+{
+	ASSET_MESH,
+	ASSET_TEXTURE,
+	ASSET_SHADER
+};
+
+enum AssetState
+{
+	ASSET_LOADING,
+	ASSET_READY,
+	ASSET_FAILED
+};
+
+struct Asset;
+class AssetStreamer;
+
+// Reference counted handle to a streamed asset. Handles may be copied and
+// released on any thread, the asset is freed by the next
+// AssetStreamer::update() after the last one goes away.
+class AssetHandle
+{
+private:
+	Asset * asset;
+
+	friend class AssetStreamer;
+	explicit AssetHandle(Asset * asset);
+public:
+	AssetHandle();
+	AssetHandle(const AssetHandle & other);
+	AssetHandle & operator=(const AssetHandle & other);
+	~AssetHandle();
+	void reset();
+	bool isValid() const;
+};
+
+// Loads meshes, textures and shaders without stalling the render thread.
+// File I/O and decoding run on the streamer's own worker threads, and the
+// render thread uploads the decoded data through a StagingRing in update(),
+// at most frameBudget bytes per frame so large assets are spread over
+// several frames. Until an asset is ready the getters return a placeholder.
+//
+// Meshes are binary mesh files (see MeshFile.h) or anything importMesh()
+// reads, and shaders are a vertex and fragment shader pair. Textures are
+// anything loadTextureData() reads, with mip chains built on the worker,
+// and are handed to a TextureManager which streams them in. Everything except handle copies must happen on the thread
+// owning the GL context.
+class AssetStreamer
+{
+private:
+	ThreadPool workers;
+	StagingRing staging;
+	size_t frameBudget;
+
+	std::vector<Asset *> assets;
+	std::unordered_map<std::string, Asset *> cache;
+
+	std::mutex decodedMutex;
+	std::vector<Asset *> decoded; // filled by the workers, drained by update()
+	std::deque<Asset *> uploads;
+
+	TextureManager * textures;
+	MeshDraw placeholderMesh;
+	GLSLProgram * placeholderShader;
+	size_t uploadedBytes;
+	std::atomic<unsigned int> decodingCount;
+
+	AssetHandle request(AssetType type, const std::string & key, const std::string & first, const std::string & second);
+	void decode(Asset * asset);
+	void beginUpload(Asset * asset);
+	size_t uploadSome(Asset * asset, size_t budget);
+	void finishUpload(Asset * asset);
+	void releaseUnused();
+public:
+	static const unsigned int WORKER_COUNT = 2;
+
+	AssetStreamer();
+	~AssetStreamer();
+	bool create(size_t stagingBytes, size_t frameBudget, TextureManager * textures);
+
+	AssetHandle loadMesh(const char * fileName);
+	AssetHandle loadTexture(const char * fileName);
+	AssetHandle loadShader(const char * vertexFileName, const char * fragmentFileName);
+
+	// Once per frame on the render thread
+	void update();
+
+	AssetState getState(const AssetHandle & handle) const;
+	MeshDraw getMesh(const AssetHandle & handle) const; // the finest level
+	bool getMeshLods(const AssetHandle & handle, MeshLods & lods) const;
+	bool getMeshBounds(const AssetHandle & handle, glm::vec3 & boundsMin, glm::vec3 & boundsMax) const;
+	unsigned int getTexture(const AssetHandle & handle) const; // TextureManager id
+	GLSLProgram * getShader(const AssetHandle & handle) const;
+
+	void setPlaceholderMesh(const MeshDraw & mesh);
+	void setPlaceholderShader(GLSLProgram * shader);
+	void setFrameBudget(size_t bytes);
+	unsigned int getLoadingCount() const;
+	size_t getUploadedBytes() const; // by the last update()
+};
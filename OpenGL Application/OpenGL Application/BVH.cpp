@@ -0,0 +1,360 @@
+#include "BVH.h"
+#include <algorithm>
+#include <intersect.hpp>
+
+const unsigned int BIN_COUNT = 16;
+const unsigned int MAX_LEAF_SIZE = 8;
+const unsigned int MAX_DEPTH = 64;
+const float TRAVERSAL_COST = 1.0f;
+const float INTERSECTION_COST = 1.0f;
+
+struct BVH::BuildItem
+{
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	glm::vec3 centroid;
+	unsigned int triangle;
+};
+
+struct Bin
+{
+	glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+	glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+	unsigned int count = 0;
+};
+
+static float surfaceArea(const glm::vec3 & boundsMin, const glm::vec3 & boundsMax)
+{
+	glm::vec3 e = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+	return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+// Slab test, returns the entry distance or FLT_MAX when the box is missed or
+// lies beyond tMax.
+static inline float intersectBounds(const glm::vec3 & orig, const glm::vec3 & invDir,
+	const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, float tMax)
+{
+	glm::vec3 t0 = (boundsMin - orig) * invDir;
+	glm::vec3 t1 = (boundsMax - orig) * invDir;
+	glm::vec3 tSmall = glm::min(t0, t1);
+	glm::vec3 tBig = glm::max(t0, t1);
+	float tEnter = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, 0.0f));
+	float tExit = std::min(std::min(tBig.x, tBig.y), std::min(tBig.z, tMax));
+	return tEnter <= tExit ? tEnter : FLT_MAX;
+}
+
+BVH::BVH()
+{
+}
+
+void BVH::build(const glm::vec3 * positions, const unsigned int * triangleIndices, unsigned int triangleCount)
+{
+	nodes.clear();
+	vertices.clear();
+	triangleIds.clear();
+
+	indices.resize(triangleCount * 3);
+	for (unsigned int i = 0; i < triangleCount * 3; i++)
+		indices[i] = triangleIndices ? triangleIndices[i] : i;
+
+	if (triangleCount == 0)
+		return;
+
+	std::vector<BuildItem> items(triangleCount);
+	for (unsigned int i = 0; i < triangleCount; i++)
+	{
+		const glm::vec3 & a = positions[indices[i * 3 + 0]];
+		const glm::vec3 & b = positions[indices[i * 3 + 1]];
+		const glm::vec3 & c = positions[indices[i * 3 + 2]];
+		items[i].boundsMin = glm::min(a, glm::min(b, c));
+		items[i].boundsMax = glm::max(a, glm::max(b, c));
+		items[i].centroid = (items[i].boundsMin + items[i].boundsMax) * 0.5f;
+		items[i].triangle = i;
+	}
+
+	nodes.reserve(triangleCount * 2);
+	buildRecursive(items, 0, triangleCount, 0);
+
+	triangleIds.resize(triangleCount);
+	for (unsigned int i = 0; i < triangleCount; i++)
+		triangleIds[i] = items[i].triangle;
+
+	refit(positions);
+}
+
+unsigned int BVH::buildRecursive(std::vector<BuildItem> & items, unsigned int first, unsigned int count, unsigned int depth)
+{
+	unsigned int nodeIndex = (unsigned int)nodes.size();
+	nodes.push_back(Node());
+
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		boundsMin = glm::min(boundsMin, items[i].boundsMin);
+		boundsMax = glm::max(boundsMax, items[i].boundsMax);
+		centroidMin = glm::min(centroidMin, items[i].centroid);
+		centroidMax = glm::max(centroidMax, items[i].centroid);
+	}
+
+	nodes[nodeIndex].boundsMin = boundsMin;
+	nodes[nodeIndex].boundsMax = boundsMax;
+
+	if (count <= 2 || depth >= MAX_DEPTH - 1)
+	{
+		nodes[nodeIndex].rightOrFirst = first;
+		nodes[nodeIndex].count = count;
+		return nodeIndex;
+	}
+
+	// Binned SAH over the centroid bounds on every axis
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	unsigned int bestBin = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0.0f)
+			continue;
+
+		Bin bins[BIN_COUNT];
+		float scale = BIN_COUNT / extent;
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			unsigned int b = std::min(BIN_COUNT - 1, (unsigned int)((items[i].centroid[axis] - centroidMin[axis]) * scale));
+			bins[b].boundsMin = glm::min(bins[b].boundsMin, items[i].boundsMin);
+			bins[b].boundsMax = glm::max(bins[b].boundsMax, items[i].boundsMax);
+			bins[b].count++;
+		}
+
+		float leftArea[BIN_COUNT - 1];
+		unsigned int leftCount[BIN_COUNT - 1];
+		Bin accumulated;
+		for (unsigned int b = 0; b < BIN_COUNT - 1; b++)
+		{
+			accumulated.boundsMin = glm::min(accumulated.boundsMin, bins[b].boundsMin);
+			accumulated.boundsMax = glm::max(accumulated.boundsMax, bins[b].boundsMax);
+			accumulated.count += bins[b].count;
+			leftArea[b] = surfaceArea(accumulated.boundsMin, accumulated.boundsMax);
+			leftCount[b] = accumulated.count;
+		}
+
+		accumulated = Bin();
+		for (unsigned int b = BIN_COUNT - 1; b > 0; b--)
+		{
+			accumulated.boundsMin = glm::min(accumulated.boundsMin, bins[b].boundsMin);
+			accumulated.boundsMax = glm::max(accumulated.boundsMax, bins[b].boundsMax);
+			accumulated.count += bins[b].count;
+
+			if (leftCount[b - 1] == 0 || accumulated.count == 0)
+				continue;
+
+			float cost = leftCount[b - 1] * leftArea[b - 1] + accumulated.count * surfaceArea(accumulated.boundsMin, accumulated.boundsMax);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	float nodeArea = surfaceArea(boundsMin, boundsMax);
+	float leafCost = INTERSECTION_COST * count;
+	float splitCost = nodeArea > 0.0f ? TRAVERSAL_COST + INTERSECTION_COST * bestCost / nodeArea : FLT_MAX;
+
+	unsigned int leftCount = 0;
+	if (bestAxis != -1 && splitCost < leafCost)
+	{
+		float scale = BIN_COUNT / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+		float minimum = centroidMin[bestAxis];
+		BuildItem * middle = std::partition(items.data() + first, items.data() + first + count, [&](const BuildItem & item)
+		{
+			return std::min(BIN_COUNT - 1, (unsigned int)((item.centroid[bestAxis] - minimum) * scale)) < bestBin;
+		});
+		leftCount = (unsigned int)(middle - (items.data() + first));
+	}
+	else if (count > MAX_LEAF_SIZE)
+	{
+		// No useful SAH split (e.g. coincident centroids), fall back to an
+		// object median split so leaves stay small.
+		glm::vec3 extent = centroidMax - centroidMin;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		leftCount = count / 2;
+		std::nth_element(items.data() + first, items.data() + first + leftCount, items.data() + first + count,
+			[axis](const BuildItem & a, const BuildItem & b) { return a.centroid[axis] < b.centroid[axis]; });
+	}
+
+	if (leftCount == 0 || leftCount == count)
+	{
+		nodes[nodeIndex].rightOrFirst = first;
+		nodes[nodeIndex].count = count;
+		return nodeIndex;
+	}
+
+	buildRecursive(items, first, leftCount, depth + 1);
+	unsigned int right = buildRecursive(items, first + leftCount, count - leftCount, depth + 1);
+	nodes[nodeIndex].rightOrFirst = right;
+	nodes[nodeIndex].count = 0;
+	return nodeIndex;
+}
+
+void BVH::refit(const glm::vec3 * positions)
+{
+	unsigned int triangleCount = (unsigned int)triangleIds.size();
+	vertices.resize(triangleCount * 3);
+	for (unsigned int i = 0; i < triangleCount; i++)
+	{
+		unsigned int t = triangleIds[i];
+		vertices[i * 3 + 0] = positions[indices[t * 3 + 0]];
+		vertices[i * 3 + 1] = positions[indices[t * 3 + 1]];
+		vertices[i * 3 + 2] = positions[indices[t * 3 + 2]];
+	}
+
+	// Children always come after their parent, so a reverse sweep visits
+	// every node after both of its children.
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		Node & node = nodes[i];
+		if (node.count > 0)
+		{
+			node.boundsMin = glm::vec3(FLT_MAX);
+			node.boundsMax = glm::vec3(-FLT_MAX);
+			for (unsigned int v = node.rightOrFirst * 3; v < (node.rightOrFirst + node.count) * 3; v++)
+			{
+				node.boundsMin = glm::min(node.boundsMin, vertices[v]);
+				node.boundsMax = glm::max(node.boundsMax, vertices[v]);
+			}
+		}
+		else
+		{
+			const Node & left = nodes[i + 1];
+			const Node & right = nodes[node.rightOrFirst];
+			node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+			node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+		}
+	}
+}
+
+bool BVH::intersectClosest(const glm::vec3 & orig, const glm::vec3 & dir, RayHit & hit, float tMax) const
+{
+	if (nodes.empty())
+		return false;
+
+	glm::vec3 invDir = 1.0f / dir;
+	unsigned int stack[MAX_DEPTH];
+	unsigned int stackSize = 0;
+	unsigned int current = 0;
+	bool found = false;
+	hit.t = tMax;
+
+	if (intersectBounds(orig, invDir, nodes[0].boundsMin, nodes[0].boundsMax, tMax) == FLT_MAX)
+		return false;
+
+	for (;;)
+	{
+		const Node & node = nodes[current];
+
+		if (node.count > 0)
+		{
+			for (unsigned int i = node.rightOrFirst; i < node.rightOrFirst + node.count; i++)
+			{
+				glm::vec3 bary;
+				if (glm::intersectRayTriangle(orig, dir, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], bary) && bary.z < hit.t)
+				{
+					hit.t = bary.z;
+					hit.u = bary.x;
+					hit.v = bary.y;
+					hit.triangle = triangleIds[i];
+					found = true;
+				}
+			}
+		}
+		else
+		{
+			unsigned int near = current + 1;
+			unsigned int far = node.rightOrFirst;
+			float tNear = intersectBounds(orig, invDir, nodes[near].boundsMin, nodes[near].boundsMax, hit.t);
+			float tFar = intersectBounds(orig, invDir, nodes[far].boundsMin, nodes[far].boundsMax, hit.t);
+
+			if (tFar < tNear)
+			{
+				std::swap(near, far);
+				std::swap(tNear, tFar);
+			}
+
+			if (tNear != FLT_MAX)
+			{
+				if (tFar != FLT_MAX)
+					stack[stackSize++] = far;
+				current = near;
+				continue;
+			}
+		}
+
+		// Pop the next subtree, skipping those that now lie behind the closest hit
+		bool popped = false;
+		while (stackSize > 0 && !popped)
+		{
+			current = stack[--stackSize];
+			popped = intersectBounds(orig, invDir, nodes[current].boundsMin, nodes[current].boundsMax, hit.t) != FLT_MAX;
+		}
+
+		if (!popped)
+			break;
+	}
+
+	return found;
+}
+
+bool BVH::intersectAny(const glm::vec3 & orig, const glm::vec3 & dir, float tMax) const
+{
+	if (nodes.empty())
+		return false;
+
+	glm::vec3 invDir = 1.0f / dir;
+	unsigned int stack[MAX_DEPTH];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node & node = nodes[stack[--stackSize]];
+
+		if (intersectBounds(orig, invDir, node.boundsMin, node.boundsMax, tMax) == FLT_MAX)
+			continue;
+
+		if (node.count > 0)
+		{
+			for (unsigned int i = node.rightOrFirst; i < node.rightOrFirst + node.count; i++)
+			{
+				glm::vec3 bary;
+				if (glm::intersectRayTriangle(orig, dir, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], bary) && bary.z < tMax)
+					return true;
+			}
+		}
+		else
+		{
+			stack[stackSize++] = node.rightOrFirst;
+			stack[stackSize++] = (unsigned int)(&node - nodes.data()) + 1;
+		}
+	}
+
+	return false;
+}
+
+unsigned int BVH::getNodeCount() const
+{
+	return (unsigned int)nodes.size();
+}
+
+unsigned int BVH::getTriangleCount() const
+{
+	return (unsigned int)triangleIds.size();
+}
+
+bool BVH::isEmpty() const
+{
+	return nodes.empty();
+}
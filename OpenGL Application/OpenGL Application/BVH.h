@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <glm.hpp>
+
+struct RayHit
+{
+	float t;
+	float u, v; // barycentric coordinates of the hit on the triangle
+	unsigned int triangle; // index of the triangle in the source mesh
+};
+
+class BVH
+{
+private:
+	// 32 byte node, two per cache line. Nodes are stored depth first so the
+	// left child of an interior node always directly follows its parent.
+	struct Node
+	{
+		glm::vec3 boundsMin;
+		unsigned int rightOrFirst; // interior: index of right child, leaf: first triangle
+		glm::vec3 boundsMax;
+		unsigned int count; // 0 for interior nodes
+	};
+
+	std::vector<Node> nodes;
+	std::vector<glm::vec3> vertices; // triangle soup in leaf order, 3 per triangle
+	std::vector<unsigned int> triangleIds; // leaf order -> source triangle
+	std::vector<unsigned int> indices; // copy of the source topology, used by refit()
+
+	struct BuildItem;
+
+	unsigned int buildRecursive(std::vector<BuildItem> & items, unsigned int first, unsigned int count, unsigned int depth);
+public:
+	BVH();
+	void build(const glm::vec3 * positions, const unsigned int * triangleIndices, unsigned int triangleCount);
+	void refit(const glm::vec3 * positions);
+	bool intersectClosest(const glm::vec3 & orig, const glm::vec3 & dir, RayHit & hit, float tMax = FLT_MAX) const;
+	bool intersectAny(const glm::vec3 & orig, const glm::vec3 & dir, float tMax = FLT_MAX) const;
+	unsigned int getNodeCount() const;
+	unsigned int getTriangleCount() const;
+	bool isEmpty() const;
+};
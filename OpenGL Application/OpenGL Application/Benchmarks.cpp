@@ -0,0 +1,2126 @@
+#include "Benchmarks.h"
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <climits>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <glm.hpp>
+#include <constants.hpp>
+#include <integer.hpp>
+#include <intersect.hpp>
+#include <matrix_transform.hpp>
+#include <dual_quaternion.hpp>
+#include <gtx/hash.hpp>
+#include "BVH.h"
+#include "RayPacket.h"
+#include "Noise.h"
+#include "Packing.h"
+#include "QuatBatch.h"
+#include "DualQuatSkinning.h"
+#include "TransformHierarchy.h"
+#include "EntityStore.h"
+#include "RenderComponents.h"
+#include "MeshFile.h"
+#include "MeshImport.h"
+#include "Image.h"
+#include "MipChain.h"
+#include "TextureData.h"
+#include "BlockCompress.h"
+#include "Y4mWriter.h"
+#include "OcclusionCuller.h"
+#include "MeshSimplify.h"
+#include "LodSelection.h"
+#include "LightClusters.h"
+#include "ShadowCascades.h"
+#include "RenderGraph.h"
+#include "ColorLut.h"
+#include "ResolutionController.h"
+#include "InputQueue.h"
+#include "MeshWeld.h"
+#include "ThreadPool.h"
+
+static double elapsedSeconds(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Bumpy sphere with roughly 2 * segments * segments triangles
+static void makeTestMesh(unsigned int segments, std::vector<glm::vec3> & positions, std::vector<unsigned int> & indices)
+{
+	positions.clear();
+	indices.clear();
+
+	for (unsigned int y = 0; y <= segments; y++)
+	{
+		for (unsigned int x = 0; x <= segments; x++)
+		{
+			float theta = glm::pi<float>() * y / segments;
+			float phi = 2.0f * glm::pi<float>() * x / segments;
+			float radius = 1.0f + 0.05f * sinf(13.0f * theta) * cosf(7.0f * phi);
+			positions.push_back(radius * glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)));
+		}
+	}
+
+	for (unsigned int y = 0; y < segments; y++)
+	{
+		for (unsigned int x = 0; x < segments; x++)
+		{
+			unsigned int i = y * (segments + 1) + x;
+			indices.insert(indices.end(), { i, i + segments + 1, i + 1, i + 1, i + segments + 1, i + segments + 2 });
+		}
+	}
+}
+
+static void makeTestRay(unsigned int i, glm::vec3 & orig, glm::vec3 & dir)
+{
+	float a = i * 2.39996323f;
+	float h = ((i * 7919) % 1000) / 500.0f - 1.0f;
+	orig = glm::vec3(3.0f * cosf(a), 3.0f * h, 3.0f * sinf(a));
+	glm::vec3 target = glm::vec3(0.3f * sinf(a * 3.0f), 0.3f * cosf(a * 5.0f), 0.0f);
+	dir = glm::normalize(target - orig);
+}
+
+static void benchmarkBVH()
+{
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	makeTestMesh(1000, positions, indices);
+	unsigned int triangleCount = (unsigned int)indices.size() / 3;
+
+	BVH bvh;
+	auto start = std::chrono::high_resolution_clock::now();
+	bvh.build(positions.data(), indices.data(), triangleCount);
+	double buildTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	bvh.refit(positions.data());
+	double refitTime = elapsedSeconds(start);
+
+	printf("BVH: %u triangles, %u nodes, build %.3f s, refit %.3f s\n", triangleCount, bvh.getNodeCount(), buildTime, refitTime);
+
+	const unsigned int BVH_RAYS = 200000, BRUTE_FORCE_RAYS = 64;
+	unsigned int hits = 0, mismatches = 0;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < BVH_RAYS; i++)
+	{
+		glm::vec3 orig, dir;
+		makeTestRay(i, orig, dir);
+		RayHit hit;
+		hits += bvh.intersectClosest(orig, dir, hit);
+	}
+	double bvhTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < BRUTE_FORCE_RAYS; i++)
+	{
+		glm::vec3 orig, dir;
+		makeTestRay(i, orig, dir);
+		float closest = FLT_MAX;
+		for (unsigned int t = 0; t < triangleCount; t++)
+		{
+			glm::vec3 bary;
+			if (glm::intersectRayTriangle(orig, dir, positions[indices[t * 3]], positions[indices[t * 3 + 1]], positions[indices[t * 3 + 2]], bary) && bary.z < closest)
+				closest = bary.z;
+		}
+
+		RayHit hit;
+		bool found = bvh.intersectClosest(orig, dir, hit);
+		if (found != (closest != FLT_MAX) || (found && hit.t != closest))
+			mismatches++;
+	}
+	double bruteForceTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	unsigned int occluded = 0;
+	for (unsigned int i = 0; i < BVH_RAYS; i++)
+	{
+		glm::vec3 orig, dir;
+		makeTestRay(i, orig, dir);
+		occluded += bvh.intersectAny(orig, dir);
+	}
+	double anyTime = elapsedSeconds(start);
+
+	printf("BVH closest hit: %.0f rays/s (%u/%u hits)\n", BVH_RAYS / bvhTime, hits, BVH_RAYS);
+	printf("BVH any hit:     %.0f rays/s (%u/%u occluded)\n", BVH_RAYS / anyTime, occluded, BVH_RAYS);
+	printf("Brute force:     %.0f rays/s, %u mismatches against BVH\n", BRUTE_FORCE_RAYS / bruteForceTime, mismatches);
+}
+
+static void benchmarkRayPackets()
+{
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	makeTestMesh(128, positions, indices);
+	unsigned int packetCount = (unsigned int)indices.size() / 3 / 8;
+
+	std::vector<TrianglePacket8> packets8(packetCount);
+	std::vector<TrianglePacket4> packets4(packetCount * 2);
+	for (unsigned int i = 0; i < packetCount * 8; i++)
+	{
+		const glm::vec3 & v0 = positions[indices[i * 3]];
+		const glm::vec3 & v1 = positions[indices[i * 3 + 1]];
+		const glm::vec3 & v2 = positions[indices[i * 3 + 2]];
+		packets8[i / 8].set(i % 8, v0, v1, v2);
+		packets4[i / 4].set(i % 4, v0, v1, v2);
+	}
+
+	const unsigned int RAY_COUNT = 256;
+	unsigned int scalarHits = 0, hits4 = 0, hits8 = 0, mismatches = 0;
+	float maxError = 0.0f;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int r = 0; r < RAY_COUNT; r++)
+	{
+		glm::vec3 orig, dir;
+		makeTestRay(r, orig, dir);
+		for (unsigned int i = 0; i < packetCount * 8; i++)
+		{
+			glm::vec3 bary;
+			scalarHits += glm::intersectRayTriangle(orig, dir, positions[indices[i * 3]], positions[indices[i * 3 + 1]], positions[indices[i * 3 + 2]], bary);
+		}
+	}
+	double scalarTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int r = 0; r < RAY_COUNT; r++)
+	{
+		glm::vec3 orig, dir;
+		makeTestRay(r, orig, dir);
+		for (unsigned int i = 0; i < packetCount * 2; i++)
+		{
+			float t[4], u[4], v[4];
+			hits4 += glm::bitCount(intersectRayTriangle4(orig, dir, packets4[i], t, u, v));
+		}
+	}
+	double time4 = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int r = 0; r < RAY_COUNT; r++)
+	{
+		glm::vec3 orig, dir;
+		makeTestRay(r, orig, dir);
+		for (unsigned int i = 0; i < packetCount; i++)
+		{
+			float t[8], u[8], v[8];
+			hits8 += glm::bitCount(intersectRayTriangle8(orig, dir, packets8[i], t, u, v));
+		}
+	}
+	double time8 = elapsedSeconds(start);
+
+	// Compare every lane of the 8-wide ray packet kernel against the scalar function
+	for (unsigned int r = 0; r < RAY_COUNT; r += 8)
+	{
+		RayPacket8 rays;
+		glm::vec3 orig[8], dir[8];
+		for (int lane = 0; lane < 8; lane++)
+		{
+			makeTestRay(r + lane, orig[lane], dir[lane]);
+			rays.set(lane, orig[lane], dir[lane]);
+		}
+
+		for (unsigned int i = 0; i < packetCount * 8; i++)
+		{
+			const glm::vec3 & v0 = positions[indices[i * 3]];
+			const glm::vec3 & v1 = positions[indices[i * 3 + 1]];
+			const glm::vec3 & v2 = positions[indices[i * 3 + 2]];
+			float t[8], u[8], v[8];
+			int mask = intersectRayPacketTriangle8(rays, v0, v1, v2, t, u, v);
+
+			for (int lane = 0; lane < 8; lane++)
+			{
+				glm::vec3 bary;
+				bool hit = glm::intersectRayTriangle(orig[lane], dir[lane], v0, v1, v2, bary);
+				bool packetHit = ((mask >> lane) & 1) != 0;
+				if (hit != packetHit)
+					mismatches++;
+				else if (hit)
+					maxError = glm::max(maxError, glm::max(glm::abs(bary.z - t[lane]), glm::max(glm::abs(bary.x - u[lane]), glm::abs(bary.y - v[lane]))));
+			}
+		}
+	}
+
+	double tests = (double)RAY_COUNT * packetCount * 8;
+	printf("Ray/triangle scalar: %.1f M tests/s (%u hits)\n", tests / scalarTime / 1e6, scalarHits);
+	printf("Ray/triangle x4:     %.1f M tests/s (%u hits)\n", tests / time4 / 1e6, hits4);
+	printf("Ray/triangle x8:     %.1f M tests/s (%u hits, %s)\n", tests / time8 / 1e6, hits8, cpuHasAVX() ? "AVX" : "SSE2");
+	printf("Ray packet x8 vs scalar: %u mismatches, max error %g\n", mismatches, maxError);
+}
+
+static void benchmarkNoise()
+{
+	const unsigned int SIZE = 1024, OCTAVES = 4;
+	const glm::vec2 origin(-37.0f, 11.0f), step(1.0f / 64.0f);
+	std::vector<float> scalar(SIZE * SIZE), batch(SIZE * SIZE);
+
+	for (int b = 0; b < 2; b++)
+	{
+		NoiseBasis basis = (NoiseBasis)b;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int y = 0; y < SIZE; y++)
+			for (unsigned int x = 0; x < SIZE; x++)
+				scalar[y * SIZE + x] = fbm(origin + step * glm::vec2(x, y), basis, OCTAVES);
+		double scalarTime = elapsedSeconds(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		fbmGrid(batch.data(), SIZE, SIZE, origin, step, basis, OCTAVES);
+		double batchTime = elapsedSeconds(start);
+
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i < SIZE * SIZE; i++)
+			mismatches += scalar[i] != batch[i];
+
+		printf("%s fBm %ux%u, %u octaves: scalar %.3f s, batch %.3f s on %u threads, %u mismatches\n",
+			basis == NOISE_PERLIN ? "Perlin" : "Simplex", SIZE, SIZE, OCTAVES, scalarTime, batchTime,
+			ThreadPool::instance().getThreadCount(), mismatches);
+	}
+}
+
+static void benchmarkHalfPacking()
+{
+	const size_t COUNT = 16 * 1024 * 1024;
+	std::vector<float> source(COUNT), roundTrip(COUNT);
+	std::vector<glm::uint16> scalar(COUNT), bulk(COUNT);
+	for (size_t i = 0; i < COUNT; i++)
+		source[i] = sinf(i * 0.001f) * (float)(i % 70000);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; i++)
+		scalar[i] = glm::packHalf1x16(source[i]);
+	double scalarTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	packHalf(source.data(), bulk.data(), COUNT);
+	double bulkTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	unpackHalf(bulk.data(), roundTrip.data(), COUNT);
+	double unpackTime = elapsedSeconds(start);
+
+	unsigned int mismatches = 0;
+	for (size_t i = 0; i < COUNT; i++)
+		mismatches += scalar[i] != bulk[i] || glm::unpackHalf1x16(bulk[i]) != roundTrip[i];
+
+	printf("packHalf %u M values: scalar %.1f M/s, bulk %.1f M/s (%s), unpack %.1f M/s, %u mismatches\n",
+		(unsigned int)(COUNT >> 20), COUNT / scalarTime / 1e6, COUNT / bulkTime / 1e6, cpuHasF16C() ? "F16C" : "SSE2",
+		COUNT / unpackTime / 1e6, mismatches);
+}
+
+// Times the scalar glm packer against the array version and reports the
+// mismatches between them and the worst round trip quantisation error
+template <typename Vector, typename ScalarPack, typename ScalarUnpack, typename BulkPack, typename BulkUnpack>
+static void benchmarkPacker(const char * name, const std::vector<Vector> & source,
+	ScalarPack scalarPack, ScalarUnpack scalarUnpack, BulkPack bulkPack, BulkUnpack bulkUnpack)
+{
+	size_t count = source.size();
+	std::vector<glm::uint32> scalar(count), bulk(count);
+	std::vector<Vector> unpacked(count);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < count; i++)
+		scalar[i] = scalarPack(source[i]);
+	double scalarTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	bulkPack(source.data(), bulk.data(), count);
+	double bulkTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	bulkUnpack(bulk.data(), unpacked.data(), count);
+	double unpackTime = elapsedSeconds(start);
+
+	unsigned int mismatches = 0;
+	float maxError = 0.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		Vector reference = scalarUnpack(scalar[i]);
+		mismatches += scalar[i] != bulk[i] || memcmp(&reference, &unpacked[i], sizeof(Vector)) != 0;
+		for (int c = 0; c < unpacked[i].length(); c++)
+			maxError = glm::max(maxError, glm::abs(unpacked[i][c] - source[i][c]));
+	}
+
+	double bytes = (double)count * (sizeof(Vector) + sizeof(glm::uint32));
+	printf("%-18s scalar %5.2f GB/s, pack %5.2f GB/s, unpack %5.2f GB/s, max error %g, %u mismatches\n",
+		name, bytes / scalarTime / 1e9, bytes / bulkTime / 1e9, bytes / unpackTime / 1e9, maxError, mismatches);
+}
+
+static void benchmarkPacking()
+{
+	const size_t COUNT = 4 * 1024 * 1024;
+	std::vector<glm::vec4> unitVectors(COUNT), colors(COUNT);
+	std::vector<glm::vec3> hdrColors(COUNT);
+	std::vector<glm::vec2> texCoords(COUNT);
+	for (size_t i = 0; i < COUNT; i++)
+	{
+		glm::vec3 n = glm::normalize(glm::vec3(sinf(i * 0.37f), cosf(i * 0.11f), sinf(i * 0.05f) + 0.01f));
+		unitVectors[i] = glm::vec4(n, i % 2 ? 1.0f : -1.0f);
+		colors[i] = glm::vec4(n * 0.5f + 0.5f, (i % 256) / 255.0f);
+		hdrColors[i] = (n * 0.5f + 0.5f) * (float)(i % 1000);
+		texCoords[i] = glm::vec2(n) * 0.5f + 0.5f;
+	}
+
+	benchmarkPacker("packUnorm4x8", colors,
+		[](const glm::vec4 & v) { return glm::packUnorm4x8(v); }, [](glm::uint32 p) { return glm::unpackUnorm4x8(p); },
+		[](const glm::vec4 * s, glm::uint32 * d, size_t n) { packUnorm4x8(s, d, n); }, [](const glm::uint32 * s, glm::vec4 * d, size_t n) { unpackUnorm4x8(s, d, n); });
+	benchmarkPacker("packUnorm2x16", texCoords,
+		[](const glm::vec2 & v) { return glm::packUnorm2x16(v); }, [](glm::uint32 p) { return glm::unpackUnorm2x16(p); },
+		[](const glm::vec2 * s, glm::uint32 * d, size_t n) { packUnorm2x16(s, d, n); }, [](const glm::uint32 * s, glm::vec2 * d, size_t n) { unpackUnorm2x16(s, d, n); });
+	benchmarkPacker("packSnorm3x10_1x2", unitVectors,
+		[](const glm::vec4 & v) { return glm::packSnorm3x10_1x2(v); }, [](glm::uint32 p) { return glm::unpackSnorm3x10_1x2(p); },
+		[](const glm::vec4 * s, glm::uint32 * d, size_t n) { packSnorm3x10_1x2(s, d, n); }, [](const glm::uint32 * s, glm::vec4 * d, size_t n) { unpackSnorm3x10_1x2(s, d, n); });
+	benchmarkPacker("packF2x11_1x10", hdrColors,
+		[](const glm::vec3 & v) { return glm::packF2x11_1x10(v); }, [](glm::uint32 p) { return glm::unpackF2x11_1x10(p); },
+		[](const glm::vec3 * s, glm::uint32 * d, size_t n) { packF2x11_1x10(s, d, n); }, [](const glm::uint32 * s, glm::vec3 * d, size_t n) { unpackF2x11_1x10(s, d, n); });
+}
+
+static float maxDifference(const QuatArray & batch, const std::vector<glm::quat> & scalar)
+{
+	float difference = 0.0f;
+	for (size_t i = 0; i < scalar.size(); i++)
+		for (int c = 0; c < 4; c++)
+			difference = glm::max(difference, glm::abs(batch.get(i)[c] - scalar[i][c]));
+	return difference;
+}
+
+static void benchmarkQuaternions()
+{
+	const unsigned int BONES = 300, CHARACTERS = 2000, COUNT = BONES * CHARACTERS;
+	QuatArray poseA, poseB, blended;
+	std::vector<glm::quat> scalarA(COUNT), scalarB(COUNT), scalar(COUNT);
+	std::vector<float> weights(CHARACTERS);
+	poseA.resize(COUNT);
+	poseB.resize(COUNT);
+	blended.resize(COUNT);
+	for (unsigned int i = 0; i < COUNT; i++)
+	{
+		glm::vec3 axis = glm::normalize(glm::vec3(sinf(i * 0.37f), cosf(i * 0.11f), sinf(i * 0.05f) + 0.01f));
+		scalarA[i] = glm::angleAxis(i * 0.013f, axis);
+		scalarB[i] = glm::angleAxis(i * 0.013f + sinf(i * 0.7f) * 1.5f, glm::normalize(axis + glm::vec3(0.3f, -0.2f, 0.1f)));
+		if (i % 3 == 0)
+			scalarB[i] = -scalarB[i];
+		poseA.set(i, scalarA[i]);
+		poseB.set(i, scalarB[i]);
+	}
+	for (unsigned int c = 0; c < CHARACTERS; c++)
+		weights[c] = (c % 101) / 100.0f;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < COUNT; i++)
+		scalar[i] = glm::slerp(scalarA[i], scalarB[i], weights[i / BONES]);
+	double scalarTime = elapsedSeconds(start);
+
+	const char * names[3] = { "nlerp", "slerp", "slerp fast" };
+	for (int m = 0; m < 3; m++)
+	{
+		QuatBlendMode mode = (QuatBlendMode)m;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int c = 0; c < CHARACTERS; c++)
+		{
+			size_t first = c * BONES;
+			if (mode == QUAT_BLEND_NLERP)
+				quatNlerp(poseA, poseB, weights[c], blended, first, first + BONES);
+			else if (mode == QUAT_BLEND_SLERP)
+				quatSlerp(poseA, poseB, weights[c], blended, first, first + BONES);
+			else
+				quatSlerpFast(poseA, poseB, weights[c], blended, first, first + BONES);
+		}
+		double batchTime = elapsedSeconds(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		blendPoses(poseA, poseB, weights.data(), blended, BONES, CHARACTERS, mode);
+		double parallelTime = elapsedSeconds(start);
+
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i < COUNT; i++)
+		{
+			float t = weights[i / BONES];
+			glm::quat reference = mode == QUAT_BLEND_NLERP ? quatNlerp(scalarA[i], scalarB[i], t) :
+				mode == QUAT_BLEND_SLERP ? quatSlerp(scalarA[i], scalarB[i], t) : quatSlerpFast(scalarA[i], scalarB[i], t);
+			mismatches += blended.get(i) != reference;
+		}
+
+		printf("Blend %ux%u bones, %-10s: glm::slerp %.2f ms, batch %.2f ms, %u threads %.2f ms, max difference to glm::slerp %g, %u mismatches\n",
+			CHARACTERS, BONES, names[m], scalarTime * 1e3, batchTime * 1e3, ThreadPool::instance().getThreadCount(), parallelTime * 1e3,
+			maxDifference(blended, scalar), mismatches);
+	}
+
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < COUNT; i++)
+		scalar[i] = glm::normalize(scalarA[i] * scalarB[i]);
+	scalarTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	quatMultiply(poseA, poseB, blended, 0, COUNT);
+	quatNormalize(blended, blended, 0, COUNT);
+	double batchTime = elapsedSeconds(start);
+
+	printf("Multiply and normalize %u: scalar %.2f ms, batch %.2f ms, max difference %g\n",
+		COUNT, scalarTime * 1e3, batchTime * 1e3, maxDifference(blended, scalar));
+
+	std::vector<glm::vec3> translations(COUNT);
+	std::vector<glm::mat3x4> scalarMatrices(COUNT), batchMatrices(COUNT);
+	for (unsigned int i = 0; i < COUNT; i++)
+		translations[i] = glm::vec3(i % 7, i % 5, i % 3);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < COUNT; i++)
+		scalarMatrices[i] = quatToMat3x4(scalarA[i], translations[i]);
+	scalarTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	quatToMat3x4(poseA, translations.data(), batchMatrices.data(), 0, COUNT);
+	batchTime = elapsedSeconds(start);
+
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < COUNT; i++)
+		mismatches += scalarMatrices[i] != batchMatrices[i];
+
+	printf("Quaternion to mat3x4 %u: mat3_cast %.2f ms, batch %.2f ms, %u mismatches\n",
+		COUNT, scalarTime * 1e3, batchTime * 1e3, mismatches);
+}
+
+static void benchmarkSkinning()
+{
+	const unsigned int JOINTS = 256, SEGMENTS = 512;
+	std::vector<glm::vec3> meshPositions;
+	std::vector<unsigned int> meshIndices;
+	makeTestMesh(SEGMENTS, meshPositions, meshIndices);
+	size_t count = meshPositions.size();
+
+	QuatArray rotations;
+	std::vector<glm::vec3> translations(JOINTS);
+	std::vector<glm::mat4> matrices(JOINTS);
+	std::vector<glm::mat2x4> palette(JOINTS);
+	rotations.resize(JOINTS);
+	for (unsigned int j = 0; j < JOINTS; j++)
+	{
+		glm::quat q = glm::angleAxis(j * 0.05f, glm::normalize(glm::vec3(1.0f, sinf(j * 0.3f), cosf(j * 0.7f))));
+		rotations.set(j, j % 2 ? -q : q);
+		translations[j] = glm::vec3(sinf(j * 0.1f), cosf(j * 0.2f), j * 0.01f);
+		matrices[j] = glm::translate(glm::mat4(1.0f), translations[j]) * glm::mat4_cast(q);
+	}
+
+	dualQuatsFromPose(rotations, translations.data(), palette.data(), 0, JOINTS);
+	unsigned int paletteMismatches = 0;
+	for (unsigned int j = 0; j < JOINTS; j++)
+		paletteMismatches += palette[j] != glm::mat2x4_cast(glm::dualquat(rotations.get(j), translations[j]));
+
+	// Every fourth vertex is bound rigidly to one joint so it can be checked against the matrix
+	std::vector<SkinnedVertex> vertices(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		SkinnedVertex & v = vertices[i];
+		v.position = meshPositions[i];
+		v.normal = glm::normalize(meshPositions[i]);
+		unsigned int j = (unsigned int)(i * 7) % JOINTS;
+		v.joints = glm::u8vec4(j, (j + 1) % JOINTS, (j + 2) % JOINTS, (j + 3) % JOINTS);
+		v.weights = i % 4 == 0 ? glm::vec4(1.0f, 0.0f, 0.0f, 0.0f) : glm::vec4(0.4f, 0.3f, 0.2f, 0.1f);
+	}
+
+	std::vector<glm::vec3> scalarPositions(count), scalarNormals(count), positions(count), normals(count);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < count; i++)
+		skinVertex(palette.data(), vertices[i], scalarPositions[i], scalarNormals[i]);
+	double scalarTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	skinVertices(palette.data(), vertices.data(), positions.data(), normals.data(), count);
+	double batchTime = elapsedSeconds(start);
+
+	unsigned int mismatches = 0;
+	float rigidError = 0.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		mismatches += positions[i] != scalarPositions[i] || normals[i] != scalarNormals[i];
+		if (i % 4 == 0)
+		{
+			glm::vec3 expected(matrices[vertices[i].joints[0]] * glm::vec4(vertices[i].position, 1.0f));
+			rigidError = glm::max(rigidError, glm::length(positions[i] - expected));
+		}
+	}
+
+	printf("Dual quaternion skinning %u vertices: scalar %.2f ms, batch %.2f ms, %u mismatches, max rigid error %g\n",
+		(unsigned int)count, scalarTime * 1e3, batchTime * 1e3, mismatches, rigidError);
+	printf("Palette of %u joints: %u bytes as mat2x4, %u as mat4, %u conversion mismatches\n",
+		JOINTS, (unsigned int)(JOINTS * sizeof(glm::mat2x4)), (unsigned int)(JOINTS * sizeof(glm::mat4)), paletteMismatches);
+}
+
+// Creates a tree depth first, so the hierarchy has to sort it by depth on the first update
+static void makeTestTree(TransformHierarchy & hierarchy, std::vector<unsigned int> & parents, unsigned int parent,
+	unsigned int depth, unsigned int maxDepth, unsigned int branching)
+{
+	unsigned int node = hierarchy.createNode(parent);
+	parents.push_back(parent);
+	float f = (float)node;
+	hierarchy.setTranslation(node, glm::vec3(sinf(f), cosf(f * 0.3f), 0.5f));
+	hierarchy.setRotation(node, glm::angleAxis(f * 0.01f, glm::normalize(glm::vec3(1.0f, sinf(f), 2.0f))));
+	hierarchy.setScale(node, glm::vec3(0.9f + 0.1f * sinf(f * 0.7f)));
+
+	if (depth < maxDepth)
+		for (unsigned int c = 0; c < branching; c++)
+			makeTestTree(hierarchy, parents, node, depth + 1, maxDepth, branching);
+}
+
+static void benchmarkTransformHierarchy()
+{
+	TransformHierarchy hierarchy;
+	std::vector<unsigned int> parents;
+	makeTestTree(hierarchy, parents, TransformHierarchy::NO_PARENT, 0, 10, 4);
+	unsigned int count = hierarchy.getNodeCount();
+
+	// Reference in creation order, where parents also come first
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<glm::mat4> reference(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		glm::mat4 local = composeMatrix(hierarchy.getTranslation(i), hierarchy.getRotation(i), hierarchy.getScale(i));
+		reference[i] = parents[i] == TransformHierarchy::NO_PARENT ? local : reference[parents[i]] * local;
+	}
+	double scalarTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	hierarchy.update();
+	double firstTime = elapsedSeconds(start);
+
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < count; i++)
+		mismatches += hierarchy.getWorldMatrix(i) != reference[i];
+
+	const int FRAMES = 10;
+	double fullTimes[2], partialTimes[2];
+	for (int parallel = 0; parallel < 2; parallel++)
+	{
+		start = std::chrono::high_resolution_clock::now();
+		for (int frame = 0; frame < FRAMES; frame++)
+		{
+			hierarchy.setRotation(0, glm::angleAxis(frame * 0.1f, glm::vec3(0.0f, 1.0f, 0.0f)));
+			hierarchy.update(parallel != 0);
+		}
+		fullTimes[parallel] = elapsedSeconds(start) / FRAMES;
+
+		// About 1% of the nodes animated, mostly leaves as in a typical scene
+		start = std::chrono::high_resolution_clock::now();
+		for (int frame = 0; frame < FRAMES; frame++)
+		{
+			for (unsigned int i = frame; i < count; i += 97)
+				hierarchy.setScale(i, glm::vec3(1.0f + frame * 0.01f));
+			hierarchy.update(parallel != 0);
+		}
+		partialTimes[parallel] = elapsedSeconds(start) / FRAMES;
+	}
+
+	printf("Transform hierarchy %u nodes, %u levels: scalar %.2f ms, first update with sort %.2f ms, %u mismatches\n",
+		count, hierarchy.getLevelCount(), scalarTime * 1e3, firstTime * 1e3, mismatches);
+	printf("  all dirty %.2f ms (%.2f ms parallel), 1%% dirty %.2f ms (%.2f ms parallel), %.2f GB/s of world matrices when all dirty\n",
+		fullTimes[0] * 1e3, fullTimes[1] * 1e3, partialTimes[0] * 1e3, partialTimes[1] * 1e3,
+		count * sizeof(glm::mat4) / fullTimes[0] / 1e9);
+}
+
+struct Velocity
+{
+	glm::vec3 value;
+};
+
+struct Lifetime
+{
+	float seconds;
+};
+
+// What the chunked store replaces: one heap object per entity
+struct SceneObject
+{
+	glm::mat4 world;
+	glm::vec4 sphere;
+	glm::vec3 velocity;
+	float lifetime;
+	MeshDraw draw;
+};
+
+static void benchmarkEntityStore()
+{
+	const unsigned int COUNT = 200000;
+	const int FRAMES = 10;
+
+	EntityStore store;
+	std::vector<Entity> entities(COUNT);
+	std::vector<SceneObject *> objects(COUNT);
+
+	// Three archetypes, the objects are allocated interleaved with other
+	// allocations as they would be over a session
+	std::vector<void *> noise;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < COUNT; i++)
+	{
+		WorldMatrix world = { glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 100), 0.0f, 0.0f)) };
+		WorldBounds bounds = { glm::vec4((float)(i % 100), 0.0f, 0.0f, 1.0f) };
+		Velocity velocity = { glm::vec3(1.0f, 0.0f, 0.0f) };
+		MeshDraw draw = { i, 0, 3, 0 };
+		if (i % 3 == 0)
+			entities[i] = store.create(world, bounds, velocity);
+		else if (i % 3 == 1)
+			entities[i] = store.create(world, bounds, velocity, draw);
+		else
+			entities[i] = store.create(world, bounds, draw);
+	}
+	double createTime = elapsedSeconds(start);
+
+	for (unsigned int i = 0; i < COUNT; i++)
+	{
+		objects[i] = new SceneObject();
+		objects[i]->world = glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 100), 0.0f, 0.0f));
+		objects[i]->sphere = glm::vec4((float)(i % 100), 0.0f, 0.0f, 1.0f);
+		objects[i]->velocity = i % 3 == 2 ? glm::vec3(0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		noise.push_back(new char[16 + i % 200]);
+	}
+	for (unsigned int i = COUNT - 1; i > 0; i--)
+		std::swap(objects[i], objects[(i * 7919u) % (i + 1)]);
+
+	// Integrate velocities into matrices and bounds
+	auto integrate = [](unsigned int count, const Entity * ids, WorldMatrix * worlds, WorldBounds * bounds, Velocity * velocities)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			worlds[i].value[3] += glm::vec4(velocities[i].value * 0.01f, 0.0f);
+			bounds[i].sphere += glm::vec4(velocities[i].value * 0.01f, 0.0f);
+		}
+	};
+
+	double chunkTimes[2];
+	for (int parallel = 0; parallel < 2; parallel++)
+	{
+		start = std::chrono::high_resolution_clock::now();
+		for (int frame = 0; frame < FRAMES; frame++)
+			store.forEachChunk<WorldMatrix, WorldBounds, Velocity>(integrate, parallel != 0);
+		chunkTimes[parallel] = elapsedSeconds(start) / FRAMES;
+	}
+
+	start = std::chrono::high_resolution_clock::now();
+	for (int frame = 0; frame < FRAMES; frame++)
+		for (SceneObject * object : objects)
+		{
+			object->world[3] += glm::vec4(object->velocity * 0.01f, 0.0f);
+			object->sphere += glm::vec4(object->velocity * 0.01f, 0.0f);
+		}
+	double objectTime = elapsedSeconds(start) / FRAMES;
+
+	// Every moving entity went 2 * FRAMES * 0.01 along x
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < COUNT; i++)
+	{
+		float expected = (float)(i % 100) + (i % 3 == 2 ? 0.0f : 0.01f * 2 * FRAMES);
+		if (glm::abs(store.get<WorldMatrix>(entities[i])->value[3].x - expected) > 1e-3f ||
+			glm::abs(store.get<WorldBounds>(entities[i])->sphere.x - expected) > 1e-3f)
+			mismatches++;
+	}
+
+	// Structural changes: stop half the movers and expire a tenth of
+	// everything through the deferred commands, as a system iterating the
+	// chunks would
+	start = std::chrono::high_resolution_clock::now();
+	store.forEach<Velocity>([&](Entity entity, Velocity & velocity)
+	{
+		if (entity.index % 2 == 0)
+			store.deferRemove<Velocity>(entity);
+		if (entity.index % 10 == 0)
+			store.deferAdd(entity, Lifetime{ 0.0f });
+	}, true);
+	store.forEach<WorldBounds>([&](Entity entity, WorldBounds & bounds)
+	{
+		if (entity.index % 10 == 5)
+			store.deferDestroy(entity);
+	}, true);
+	store.flush();
+	double flushTime = elapsedSeconds(start);
+
+	unsigned int movers = 0, alive = 0;
+	store.forEach<Velocity>([&](Entity entity, Velocity & velocity) { movers++; });
+	for (unsigned int i = 0; i < COUNT; i++)
+	{
+		bool shouldLive = i % 10 != 5;
+		bool shouldMove = shouldLive && i % 3 != 2 && i % 2 != 0;
+		if (store.isAlive(entities[i]) != shouldLive || (shouldLive && store.has<Velocity>(entities[i]) != shouldMove))
+			mismatches++;
+		alive += store.isAlive(entities[i]);
+	}
+	if (alive != store.getEntityCount())
+		mismatches++;
+
+	printf("Entity store %u entities, %u archetypes, %u chunks: create %.2f ms, deferred changes %.2f ms, %u mismatches\n",
+		COUNT, store.getArchetypeCount(), store.getChunkCount(), createTime * 1e3, flushTime * 1e3, mismatches);
+	printf("  integrate %.2f ms (%.2f ms parallel), scattered heap objects %.2f ms, %u movers left\n",
+		chunkTimes[0] * 1e3, chunkTimes[1] * 1e3, objectTime * 1e3, movers);
+
+	for (SceneObject * object : objects)
+		delete object;
+	for (void * block : noise)
+		delete[] (char *)block;
+}
+
+// Writes the mesh as OBJ and as glTF with an external buffer, the text
+// formats the binary mesh files are converted from
+static bool writeTextMeshes(const MeshData & mesh, const char * objName, const char * gltfName, const char * binName)
+{
+	FILE * obj = fopen(objName, "w");
+	if (!obj)
+		return false;
+	for (const MeshVertex & v : mesh.vertices)
+		fprintf(obj, "v %.9g %.9g %.9g\nvt %.9g %.9g\nvn %.9g %.9g %.9g\n", v.position.x, v.position.y, v.position.z,
+			v.uv.x, v.uv.y, v.normal.x, v.normal.y, v.normal.z);
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		unsigned int a = mesh.indices[i] + 1, b = mesh.indices[i + 1] + 1, c = mesh.indices[i + 2] + 1;
+		fprintf(obj, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+	}
+	fclose(obj);
+
+	size_t vertexBytes = mesh.vertices.size() * sizeof(MeshVertex);
+	size_t indexBytes = mesh.indices.size() * sizeof(unsigned int);
+	FILE * bin = fopen(binName, "wb");
+	if (!bin)
+		return false;
+	fwrite(mesh.vertices.data(), 1, vertexBytes, bin);
+	fwrite(mesh.indices.data(), 1, indexBytes, bin);
+	fclose(bin);
+
+	FILE * gltf = fopen(gltfName, "w");
+	if (!gltf)
+		return false;
+	fprintf(gltf, "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"uri\":\"%s\",\"byteLength\":%zu}],\n", binName, vertexBytes + indexBytes);
+	fprintf(gltf, "\"bufferViews\":[{\"buffer\":0,\"byteLength\":%zu,\"byteStride\":32},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],\n",
+		vertexBytes, vertexBytes, indexBytes);
+	fprintf(gltf, "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+		"{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+		"{\"bufferView\":0,\"byteOffset\":24,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC2\"},"
+		"{\"bufferView\":1,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}],\n",
+		mesh.vertices.size(), mesh.vertices.size(), mesh.vertices.size(), mesh.indices.size());
+	fprintf(gltf, "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}]}\n");
+	fclose(gltf);
+	return true;
+}
+
+// Same triangles with the same vertices, the OBJ importer numbers vertices
+// in order of first use
+static bool sameMesh(const MeshData & a, const MeshData & b)
+{
+	if (a.indices.size() != b.indices.size())
+		return false;
+	for (size_t i = 0; i < a.indices.size(); i++)
+		if (memcmp(&a.vertices[a.indices[i]], &b.vertices[b.indices[i]], sizeof(MeshVertex)) != 0)
+			return false;
+	return true;
+}
+
+static void benchmarkMeshLoading()
+{
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	makeTestMesh(400, positions, indices);
+
+	MeshData mesh;
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		MeshVertex vertex;
+		vertex.position = positions[i];
+		vertex.normal = glm::normalize(positions[i]);
+		vertex.uv = glm::vec2((i % 401) / 400.0f, (i / 401) / 400.0f);
+		mesh.vertices.push_back(vertex);
+	}
+	mesh.indices = indices;
+
+	const char * objName = "benchmark_mesh.obj";
+	const char * gltfName = "benchmark_mesh.gltf";
+	const char * binName = "benchmark_mesh.bin";
+	const char * meshName = "benchmark_mesh.vsmesh";
+	if (!writeTextMeshes(mesh, objName, gltfName, binName))
+	{
+		printf("Mesh loading: could not write the test files\n");
+		return;
+	}
+
+	MeshData objMesh, gltfMesh;
+	auto start = std::chrono::high_resolution_clock::now();
+	bool imported = importObj(objName, objMesh);
+	double objTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	imported = importGltf(gltfName, gltfMesh) && imported;
+	double gltfTime = elapsedSeconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	bool converted = imported && convertMesh(objName, meshName, 1);
+	double convertTime = elapsedSeconds(start);
+
+	// Mapping plus one pass over the blobs, which is what the buffer upload
+	// reads, so every page is faulted in
+	MeshFile file;
+	const int LOADS = 10;
+	unsigned int checksum = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (int load = 0; load < LOADS && converted; load++)
+	{
+		if (!file.open(meshName))
+			break;
+		const unsigned int * words = (const unsigned int *)file.getVertices();
+		for (size_t i = 0; i < file.getHeader().vertexBytes / 4; i++)
+			checksum += words[i];
+		const unsigned short * shorts = (const unsigned short *)file.getIndices();
+		for (size_t i = 0; i < file.getHeader().indexBytes / 2; i++)
+			checksum += shorts[i];
+		if (load < LOADS - 1)
+			file.close();
+	}
+	double binaryTime = elapsedSeconds(start) / LOADS;
+
+	unsigned int mismatches = 0;
+	if (!converted || !file.getVertices())
+		mismatches++;
+	else
+	{
+		MeshData binaryMesh;
+		binaryMesh.vertices.assign(file.getVertices(), file.getVertices() + file.getVertexCount());
+		for (unsigned int i = 0; i < file.getIndexCount(); i++)
+			binaryMesh.indices.push_back(file.getIndexSize() == 2 ? ((const glm::uint16 *)file.getIndices())[i] : ((const glm::uint32 *)file.getIndices())[i]);
+		mismatches += !sameMesh(mesh, objMesh) + !sameMesh(mesh, gltfMesh) + !sameMesh(mesh, binaryMesh);
+	}
+	file.close();
+
+	printf("Mesh loading %u vertices, %u triangles: OBJ %.2f ms, glTF %.2f ms, conversion %.2f ms, mapped binary %.2f ms, %u mismatches (checksum %08x)\n",
+		(unsigned int)mesh.vertices.size(), (unsigned int)mesh.indices.size() / 3, objTime * 1e3, gltfTime * 1e3,
+		convertTime * 1e3, binaryTime * 1e3, mismatches, checksum);
+
+	remove(objName);
+	remove(gltfName);
+	remove(binName);
+	remove(meshName);
+}
+
+// In memory TGA of an RGBA image, 32 bit raw or 24 bit run length encoded
+static std::vector<unsigned char> encodeTestTga(const Image & image, bool rle)
+{
+	unsigned int bytesPerPixel = rle ? 3 : 4;
+	std::vector<unsigned char> tga(18, 0);
+	tga[2] = rle ? 10 : 2;
+	tga[12] = image.width & 0xff;
+	tga[13] = image.width >> 8;
+	tga[14] = image.height & 0xff;
+	tga[15] = image.height >> 8;
+	tga[16] = (unsigned char)(bytesPerPixel * 8);
+	tga[17] = 0x20; // top down
+
+	size_t pixelCount = (size_t)image.width * image.height;
+	for (size_t i = 0; i < pixelCount;)
+	{
+		const unsigned char * rgba = &image.pixels[i * 4];
+		size_t count = 1;
+		if (rle)
+		{
+			while (i + count < pixelCount && count < 128 && memcmp(rgba, &image.pixels[(i + count) * 4], 3) == 0)
+				count++;
+			tga.push_back((unsigned char)(0x80 | (count - 1)));
+		}
+		tga.push_back(rgba[2]);
+		tga.push_back(rgba[1]);
+		tga.push_back(rgba[0]);
+		if (!rle)
+			tga.push_back(rgba[3]);
+		i += count;
+	}
+	return tga;
+}
+
+static void benchmarkImageDecode()
+{
+	// Flat color bands with noise in between, so runs of all lengths occur
+	Image source;
+	source.width = 2048;
+	source.height = 2048;
+	source.pixels.resize(source.width * source.height * 4);
+	for (unsigned int y = 0; y < source.height; y++)
+	{
+		for (unsigned int x = 0; x < source.width; x++)
+		{
+			unsigned char * rgba = &source.pixels[(y * source.width + x) * 4];
+			bool flat = ((x / 64) + (y / 64)) % 2 == 0;
+			unsigned int noise = (x * 7919u + y * 104729u) * 2654435761u >> 24;
+			rgba[0] = (unsigned char)(flat ? x / 64 * 8 : noise);
+			rgba[1] = (unsigned char)(flat ? y / 64 * 8 : noise ^ 0x55);
+			rgba[2] = (unsigned char)(flat ? 128 : noise ^ 0xaa);
+			rgba[3] = 255;
+		}
+	}
+
+	const int RUNS = 5;
+	unsigned int mismatches = 0;
+	double times[2];
+	size_t sizes[2];
+	for (int rle = 0; rle < 2; rle++)
+	{
+		std::vector<unsigned char> tga = encodeTestTga(source, rle != 0);
+		sizes[rle] = tga.size();
+
+		Image decoded;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int run = 0; run < RUNS; run++)
+			if (!decodeTga(tga.data(), tga.size(), decoded))
+				mismatches++;
+		times[rle] = elapsedSeconds(start) / RUNS;
+
+		if (decoded.width != source.width || decoded.height != source.height || decoded.pixels != source.pixels)
+			mismatches++;
+	}
+
+	double megapixels = source.width * source.height / 1e6;
+	printf("TGA decode %ux%u: raw %.2f ms (%.0f Mpixel/s, %zu bytes), RLE %.2f ms (%.0f Mpixel/s, %zu bytes), %u mismatches\n",
+		source.width, source.height, times[0] * 1e3, megapixels / times[0], sizes[0], times[1] * 1e3, megapixels / times[1], sizes[1], mismatches);
+}
+
+// Scalar references for the mip filters, the Kaiser one in double precision
+// with the same taps and edge clamping
+static void downsampleBoxScalar(const unsigned char * source, unsigned int width, unsigned int height, unsigned char * result)
+{
+	unsigned int resultWidth = std::max(width / 2, 1u), resultHeight = std::max(height / 2, 1u);
+	for (unsigned int y = 0; y < resultHeight; y++)
+		for (unsigned int x = 0; x < resultWidth; x++)
+			for (int c = 0; c < 4; c++)
+			{
+				unsigned int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+				unsigned int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+				unsigned int sum = source[(y0 * width + x0) * 4 + c] + source[(y0 * width + x1) * 4 + c] +
+					source[(y1 * width + x0) * 4 + c] + source[(y1 * width + x1) * 4 + c];
+				result[(y * resultWidth + x) * 4 + c] = (unsigned char)((sum + 2) >> 2);
+			}
+}
+
+static void downsampleKaiserScalar(const unsigned char * source, unsigned int width, unsigned int height, unsigned char * result)
+{
+	double weights[8], total = 0.0;
+	auto besselI0 = [](double x)
+	{
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 20; k++)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	};
+	for (int t = 0; t < 8; t++)
+	{
+		double distance = t - 3.5, x = distance / 2.0 * glm::pi<double>();
+		weights[t] = std::sin(x) / x * besselI0(4.0 * std::sqrt(1.0 - distance * distance / 16.0)) / besselI0(4.0);
+		total += weights[t];
+	}
+
+	unsigned int resultWidth = std::max(width / 2, 1u), resultHeight = std::max(height / 2, 1u);
+	auto tap = [](unsigned int size, unsigned int result, int t)
+	{
+		return size == 1 ? result : (unsigned int)std::min(std::max((int)(2 * result) + t - 3, 0), (int)size - 1);
+	};
+	for (unsigned int y = 0; y < resultHeight; y++)
+		for (unsigned int x = 0; x < resultWidth; x++)
+			for (int c = 0; c < 4; c++)
+			{
+				double sum = 0.0;
+				for (int ty = 0; ty < (height == 1 ? 1 : 8); ty++)
+					for (int tx = 0; tx < (width == 1 ? 1 : 8); tx++)
+					{
+						double weight = (height == 1 ? 1.0 : weights[ty] / total) * (width == 1 ? 1.0 : weights[tx] / total);
+						sum += weight * source[(tap(height, y, ty) * width + tap(width, x, tx)) * 4 + c];
+					}
+				result[(y * resultWidth + x) * 4 + c] = (unsigned char)glm::clamp(std::floor(sum + 0.5), 0.0, 255.0);
+			}
+}
+
+static void benchmarkMipChain()
+{
+	Image source;
+	source.width = 2048;
+	source.height = 2048;
+	source.pixels.resize(source.width * source.height * 4);
+	for (size_t i = 0; i < source.pixels.size(); i++)
+		source.pixels[i] = (unsigned char)(((i / 4) % source.width * 3 + (i / 4) / source.width * 5 + i % 4 * 64) ^ (i * 2654435761u >> 27));
+
+	const int RUNS = 5;
+	std::vector<unsigned char> result(source.width * source.height), reference(result.size());
+	typedef void (*Downsample)(const unsigned char *, unsigned int, unsigned int, unsigned char *);
+	Downsample simd[2] = { downsampleBox, downsampleKaiser };
+	Downsample scalar[2] = { downsampleBoxScalar, downsampleKaiserScalar };
+	double simdTimes[2], scalarTimes[2];
+	unsigned int mismatches = 0;
+	for (int filter = 0; filter < 2; filter++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int run = 0; run < RUNS; run++)
+			simd[filter](source.pixels.data(), source.width, source.height, result.data());
+		simdTimes[filter] = elapsedSeconds(start) / RUNS;
+
+		start = std::chrono::high_resolution_clock::now();
+		scalar[filter](source.pixels.data(), source.width, source.height, reference.data());
+		scalarTimes[filter] = elapsedSeconds(start);
+
+		// Box must match exactly, Kaiser within one step of float rounding
+		for (size_t i = 0; i < result.size(); i++)
+			if (std::abs((int)result[i] - (int)reference[i]) > filter)
+				mismatches++;
+	}
+
+	// Odd and degenerate sizes
+	const unsigned int sizes[][2] = { { 7, 5 }, { 1, 9 }, { 13, 1 }, { 1, 1 }, { 3, 2 } };
+	for (const auto & size : sizes)
+	{
+		std::vector<unsigned char> small(size[0] * size[1] * 4), smallResult(size[0] * size[1] * 4), smallReference(smallResult.size());
+		for (size_t i = 0; i < small.size(); i++)
+			small[i] = (unsigned char)(i * 37);
+		for (int filter = 0; filter < 2; filter++)
+		{
+			simd[filter](small.data(), size[0], size[1], smallResult.data());
+			scalar[filter](small.data(), size[0], size[1], smallReference.data());
+			for (size_t i = 0; i < std::max(size[0] / 2, 1u) * std::max(size[1] / 2, 1u) * 4; i++)
+				if (std::abs((int)smallResult[i] - (int)smallReference[i]) > filter)
+					mismatches++;
+		}
+	}
+
+	TextureData texture;
+	auto start = std::chrono::high_resolution_clock::now();
+	buildMipChain(source, MIP_FILTER_KAISER, texture);
+	double chainTime = elapsedSeconds(start);
+	if (texture.levels.size() != 12 || texture.levels.back().width != 1 || textureBytes(texture) * 3 > source.pixels.size() * 4)
+		mismatches++;
+
+	printf("Mip 2048x2048 -> 1024x1024: box SSE2 %.2f ms vs scalar %.2f ms, Kaiser SSE2 %.2f ms vs scalar %.2f ms, full Kaiser chain %.2f ms, %u mismatches\n",
+		simdTimes[0] * 1e3, scalarTimes[0] * 1e3, simdTimes[1] * 1e3, scalarTimes[1] * 1e3, chainTime * 1e3, mismatches);
+}
+
+static void benchmarkBlockCompression()
+{
+	// Smooth gradients with hard edged shapes, a typical albedo and normal mix
+	TextureData source;
+	source.levels.resize(1);
+	TextureLevel & level = source.levels[0];
+	level.width = 1024;
+	level.height = 1024;
+	level.data.resize(level.width * level.height * 4);
+	for (unsigned int y = 0; y < level.height; y++)
+	{
+		for (unsigned int x = 0; x < level.width; x++)
+		{
+			unsigned char * rgba = &level.data[(y * level.width + x) * 4];
+			bool inside = ((x / 96) + (y / 80)) % 3 == 0;
+			unsigned int noise = (x * 7919u + y * 104729u) * 2654435761u >> 27;
+			rgba[0] = (unsigned char)(inside ? 200 + noise : x / 4 + noise / 4);
+			rgba[1] = (unsigned char)(inside ? 40 + noise : (y * 3 / 4 + noise) % 256);
+			rgba[2] = (unsigned char)((x + y) / 8 + noise / 2);
+			rgba[3] = 255;
+		}
+	}
+
+	// A single color per block must come back exactly from BC4
+	unsigned int mismatches = 0;
+	for (int value = 0; value < 256; value++)
+	{
+		unsigned char values[16], block[8], decoded[16];
+		memset(values, value, sizeof(values));
+		encodeBlockBC4(values, 1, BLOCK_QUALITY_FAST, block);
+		decodeBlockBC4(block, decoded, 1);
+		if (memcmp(values, decoded, sizeof(values)) != 0)
+			mismatches++;
+	}
+
+	const TextureFormat formats[3] = { TEXTURE_BC1, TEXTURE_BC4, TEXTURE_BC5 };
+	const char * formatNames[3] = { "BC1", "BC4", "BC5" };
+	const char * qualityNames[3] = { "fast", "normal", "high" };
+	double megapixels = level.width * level.height / 1e6;
+	for (int f = 0; f < 3; f++)
+	{
+		printf("%s %ux%u:", formatNames[f], level.width, level.height);
+		double previousPsnr = 0.0;
+		for (int q = 0; q < 3; q++)
+		{
+			TextureData compressed;
+			auto start = std::chrono::high_resolution_clock::now();
+			if (!compressTexture(source, formats[f], (BlockQuality)q, compressed))
+				mismatches++;
+			double seconds = elapsedSeconds(start);
+
+			// Higher presets may never lose quality
+			double psnr = computePsnr(source, compressed);
+			if (psnr + 0.01 < previousPsnr)
+				mismatches++;
+			previousPsnr = psnr;
+			printf(" %s %.1f ms (%.0f Mpixel/s) %.2f dB%s", qualityNames[q], seconds * 1e3, megapixels / seconds, psnr, q < 2 ? "," : "");
+		}
+		printf("\n");
+	}
+
+	// Encoded files read back unchanged
+	TextureData compressed, decoded;
+	std::vector<unsigned char> dds;
+	compressTexture(source, TEXTURE_BC5, BLOCK_QUALITY_FAST, compressed);
+	encodeDds(compressed, dds);
+	if (!decodeDds(dds.data(), dds.size(), decoded) || decoded.format != TEXTURE_BC5 || decoded.levels.size() != 1 ||
+		decoded.levels[0].data != compressed.levels[0].data)
+		mismatches++;
+	printf("Block compression on %u threads, %u mismatches\n", ThreadPool::instance().getThreadCount(), mismatches);
+}
+
+static void benchmarkCaptureEncoding()
+{
+	// The encoder thread's work per captured 1080p frame
+	Image frame;
+	frame.width = 1920;
+	frame.height = 1080;
+	frame.pixels.resize(frame.width * frame.height * 4);
+	for (size_t i = 0; i < frame.pixels.size(); i++)
+		frame.pixels[i] = (unsigned char)(i * 2654435761u >> 24);
+
+	const int RUNS = 10;
+	unsigned int mismatches = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int run = 0; run < RUNS; run++)
+		flipRows(frame);
+	double flipTime = elapsedSeconds(start) / RUNS;
+
+	std::vector<unsigned char> png;
+	start = std::chrono::high_resolution_clock::now();
+	for (int run = 0; run < RUNS; run++)
+		encodePng(frame, png);
+	double pngTime = elapsedSeconds(start) / RUNS;
+
+	// Signature, IHDR, stored blocks of the filtered rows, IEND
+	size_t rawBytes = (frame.width * 4 + 1) * frame.height;
+	size_t expected = 8 + 25 + 12 + 2 + rawBytes + (rawBytes + 65534) / 65535 * 5 + 4 + 12;
+	if (png.size() != expected)
+		mismatches++;
+
+	Y4mWriter video;
+	const char * videoName = "benchmark_capture.y4m";
+	start = std::chrono::high_resolution_clock::now();
+	if (!video.open(videoName, frame.width, frame.height, 60))
+		mismatches++;
+	for (int run = 0; run < RUNS; run++)
+		if (!video.writeFrame(frame))
+			mismatches++;
+	video.close();
+	double videoTime = elapsedSeconds(start) / RUNS;
+	remove(videoName);
+
+	printf("Capture encoding 1920x1080: flip %.2f ms, PNG %.2f ms (%zu bytes), Y4M frame %.2f ms, %u mismatches\n",
+		flipTime * 1e3, pngTime * 1e3, png.size(), videoTime * 1e3, mismatches);
+}
+
+static void benchmarkGoldenCompare()
+{
+	Image golden;
+	golden.width = 1024;
+	golden.height = 1024;
+	golden.pixels.resize(golden.width * golden.height * 4);
+	for (size_t i = 0; i < golden.pixels.size(); i++)
+		golden.pixels[i] = (unsigned char)(i * 2654435761u >> 24);
+
+	// Goldens are stored as TGA and must read back exactly
+	unsigned int mismatches = 0;
+	std::vector<unsigned char> tga;
+	Image decoded;
+	auto start = std::chrono::high_resolution_clock::now();
+	encodeTga(golden, tga);
+	if (!decodeTga(tga.data(), tga.size(), decoded) || decoded.pixels != golden.pixels)
+		mismatches++;
+	double roundTripTime = elapsedSeconds(start);
+
+	// Every 97th pixel off by one to three steps, only those past the tolerance count
+	Image actual = golden, diff;
+	unsigned int expected = 0;
+	for (size_t p = 0; p < actual.pixels.size() / 4; p += 97)
+	{
+		unsigned int step = 1 + p % 3;
+		actual.pixels[p * 4 + 1] = (unsigned char)(golden.pixels[p * 4 + 1] < 128 ? golden.pixels[p * 4 + 1] + step : golden.pixels[p * 4 + 1] - step);
+		expected += step > 2 ? 1 : 0;
+	}
+
+	ImageDifference difference;
+	start = std::chrono::high_resolution_clock::now();
+	if (!compareImages(golden, actual, 2, difference, diff))
+		mismatches++;
+	double compareTime = elapsedSeconds(start);
+	if (difference.differingPixels != expected || difference.maxDifference != 3)
+		mismatches++;
+
+	printf("Golden image 1024x1024: TGA round trip %.2f ms, compare %.2f ms (%u pixels off), %u mismatches\n",
+		roundTripTime * 1e3, compareTime * 1e3, difference.differingPixels, mismatches);
+}
+
+static void benchmarkOcclusionCulling()
+{
+	// Unit cube, counter-clockwise from outside
+	const glm::vec3 cube[8] = {
+		glm::vec3(0, 0, 0), glm::vec3(1, 0, 0), glm::vec3(1, 1, 0), glm::vec3(0, 1, 0),
+		glm::vec3(0, 0, 1), glm::vec3(1, 0, 1), glm::vec3(1, 1, 1), glm::vec3(0, 1, 1) };
+	const unsigned int cubeIndices[36] = {
+		0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4,
+		3, 6, 2, 3, 7, 6, 0, 4, 7, 0, 7, 3, 1, 2, 6, 1, 6, 5 };
+
+	OcclusionCuller culler;
+	unsigned int mismatches = culler.create(256, 128) ? 0 : 1;
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 2.0f, 0.5f, 500.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// A wall 20 wide at z = -10 must hide boxes well inside its shadow and no others
+	glm::mat4 wall = glm::scale(glm::translate(glm::mat4(), glm::vec3(-10.0f, -8.0f, -10.0f)), glm::vec3(20.0f, 20.0f, 0.5f));
+	culler.beginFrame(projection * view);
+	culler.addOccluder(wall, cube, cubeIndices, 12, true);
+	culler.rasterize();
+	glm::vec3 size(0.5f);
+	const glm::vec3 hidden[3] = { glm::vec3(0.0f, 2.0f, -30.0f), glm::vec3(-8.0f, -4.0f, -14.0f), glm::vec3(5.0f, 8.0f, -100.0f) };
+	const glm::vec3 shown[4] = { glm::vec3(0.0f, 2.0f, -5.0f), glm::vec3(20.5f, 2.0f, -20.0f), glm::vec3(0.0f, 2.0f, 3.0f), glm::vec3(-12.0f, 2.0f, -10.5f) };
+	for (const glm::vec3 & position : hidden)
+		if (culler.isVisible(glm::mat4(), position, position + size))
+			mismatches++;
+	for (int i = 0; i < 4; i++)
+	{
+		// The box behind the camera is outside the frustum, the rest must be visible
+		bool visible = culler.isVisible(glm::mat4(), shown[i], shown[i] + size);
+		if (visible != (i != 2))
+			mismatches++;
+	}
+	// Straddling the near plane is always visible
+	if (!culler.isVisible(glm::mat4(), glm::vec3(-1.0f, 1.0f, -2.0f), glm::vec3(1.0f, 3.0f, 2.0f)))
+		mismatches++;
+
+	// A street level city: buildings 8 wide on a 12 unit grid, small props between them
+	const unsigned int GRID = 24, PROPS = 20000;
+	std::vector<glm::mat4> buildings;
+	for (unsigned int z = 0; z < GRID; z++)
+	{
+		for (unsigned int x = 0; x < GRID; x++)
+		{
+			float height = 10.0f + (float)((x * 7 + z * 13) % 30);
+			glm::vec3 corner(-144.0f + x * 12.0f + 2.0f, 0.0f, -12.0f - z * 12.0f);
+			if (x == GRID / 2)
+				continue; // the street the camera looks down
+			buildings.push_back(glm::scale(glm::translate(glm::mat4(), corner), glm::vec3(8.0f, height, 8.0f)));
+		}
+	}
+
+	std::vector<glm::vec3> props(PROPS);
+	for (unsigned int i = 0; i < PROPS; i++)
+	{
+		unsigned int hash = i * 2654435761u;
+		props[i] = glm::vec3(-150.0f + (hash % 3000) / 10.0f, 0.0f, -5.0f - ((hash >> 12) % 2900) / 10.0f);
+	}
+
+	const int RUNS = 10;
+	double rasterTime = 0.0, testTime = 0.0;
+	unsigned int visibleCount = 0;
+	for (int run = 0; run < RUNS; run++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		culler.beginFrame(projection * view);
+		for (const glm::mat4 & building : buildings)
+			culler.addOccluder(building, cube, cubeIndices, 12, true);
+		culler.rasterize();
+		rasterTime += elapsedSeconds(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		visibleCount = 0;
+		for (const glm::vec3 & prop : props)
+			visibleCount += culler.isVisible(glm::mat4(), prop, prop + glm::vec3(1.0f)) ? 1 : 0;
+		testTime += elapsedSeconds(start);
+	}
+
+	printf("Occlusion %ux%u: %zu occluders (%u triangles) %.3f ms, %u box tests %.3f ms (%.0f ns each), %u of %u visible, %u mismatches\n",
+		culler.getWidth(), culler.getHeight(), buildings.size(), culler.getTriangleCount(), rasterTime / RUNS * 1e3,
+		PROPS, testTime / RUNS * 1e3, testTime / RUNS / PROPS * 1e9, visibleCount, PROPS, mismatches);
+}
+
+static void benchmarkMeshSimplify()
+{
+	// The bumpy sphere with a texture seam and poles of repeated positions
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> indices;
+	makeTestMesh(256, positions, indices);
+
+	// Close the seam exactly, rounding leaves the last column apart from the first
+	MeshData mesh;
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		if (i % 257 == 256)
+			positions[i] = positions[i - 256];
+
+		MeshVertex vertex;
+		vertex.position = positions[i];
+		vertex.normal = glm::normalize(positions[i]);
+		vertex.uv = glm::vec2((i % 257) / 256.0f, (i / 257) / 256.0f);
+		mesh.vertices.push_back(vertex);
+	}
+	mesh.indices = indices;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	buildLodChain(mesh, 6);
+	double buildTime = elapsedSeconds(start);
+
+	unsigned int mismatches = mesh.lods.size() < 4 || mesh.lods[0].indexCount != indices.size();
+	printf("LOD chain of %u triangles in %.1f ms on %u threads:\n", (unsigned int)indices.size() / 3, buildTime * 1e3, ThreadPool::instance().getThreadCount());
+	for (size_t level = 1; level < mesh.lods.size(); level++)
+	{
+		const MeshLod & lod = mesh.lods[level], & previous = mesh.lods[level - 1];
+		mismatches += lod.indexCount > previous.indexCount * 0.9 || lod.error < previous.error || lod.firstIndex + lod.indexCount > mesh.indices.size();
+		for (unsigned int i = 0; i < lod.indexCount; i += 3)
+		{
+			const unsigned int * triangle = &mesh.indices[lod.firstIndex + i];
+			mismatches += triangle[0] >= positions.size() || triangle[1] >= positions.size() || triangle[2] >= positions.size() ||
+				positions[triangle[0]] == positions[triangle[1]] || positions[triangle[1]] == positions[triangle[2]] || positions[triangle[0]] == positions[triangle[2]];
+		}
+
+		// Radial distance of the full mesh's triangle centres from the level, as
+		// the sphere is star shaped. A few rays slip between triangles at
+		// shared edges through the rounding of the ray test.
+		BVH bvh;
+		bvh.build(positions.data(), &mesh.indices[lod.firstIndex], lod.indexCount / 3);
+		float deviation = 0.0f;
+		unsigned int misses = 0;
+		for (size_t i = 0; i < indices.size(); i += 3 * 7)
+		{
+			RayHit hit;
+			glm::vec3 centroid = (positions[indices[i]] + positions[indices[i + 1]] + positions[indices[i + 2]]) / 3.0f;
+			if (bvh.intersectClosest(glm::vec3(0.0f), glm::normalize(centroid), hit))
+				deviation = glm::max(deviation, fabsf(hit.t - glm::length(centroid)));
+			else
+				misses++;
+		}
+		printf("  LOD %u: %u triangles, error %.5f, measured deviation %.5f (%u rays missed)\n", (unsigned int)level, lod.indexCount / 3, lod.error, deviation, misses);
+	}
+
+	// The chain survives the binary mesh file
+	const char * meshName = "benchmark_lods.vsmesh";
+	MeshFile file;
+	if (!writeMeshFile(meshName, mesh) || !file.open(meshName) || file.getLodCount() != mesh.lods.size())
+		mismatches++;
+	else
+		for (unsigned int level = 0; level < file.getLodCount(); level++)
+		{
+			MeshLod lod = file.getLod(level);
+			mismatches += memcmp(&mesh.lods[level], &lod, sizeof(MeshLod)) != 0;
+		}
+	file.close();
+	remove(meshName);
+
+	// Moving away and back: levels only get coarser then finer, and each
+	// switch back happens closer than the switch out did
+	MeshLods lods = {};
+	lods.count = (unsigned int)mesh.lods.size();
+	std::copy(mesh.lods.begin(), mesh.lods.end(), lods.levels);
+	std::vector<float> switchOut(lods.count, 0.0f), switchBack(lods.count, 0.0f);
+	float pixelScale = lodPixelScale(glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f), 1080.0f);
+	for (int step = 0; step < 2000; step++)
+	{
+		float distance = 1.0f + 0.05f * (step < 1000 ? step : 1999 - step);
+		unsigned int level = selectLod(lods, pixelScale / distance, 1.0f, 0.25f);
+		if (level != lods.current)
+		{
+			mismatches += step < 1000 ? level < lods.current : level > lods.current;
+			if (step < 1000)
+				switchOut[level] = distance;
+			else
+				switchBack[lods.current] = distance;
+			lods.current = level;
+		}
+	}
+	unsigned int switches = 0;
+	for (unsigned int level = 1; level < lods.count; level++)
+		if (switchOut[level] > 0.0f)
+		{
+			mismatches += switchBack[level] >= switchOut[level];
+			switches++;
+		}
+
+	printf("Mesh simplification: %u LODs, %u switching distances with hysteresis, %u mismatches\n", (unsigned int)mesh.lods.size(), switches, mismatches);
+}
+
+static void benchmarkLightClusters()
+{
+	const unsigned int LIGHTS = 512, TILES_X = 16, TILES_Y = 9, SLICES = 24, POINTS = 100000;
+	const float WIDTH = 1600.0f, HEIGHT = 900.0f;
+	std::vector<PointLight> lights(LIGHTS);
+	for (unsigned int i = 0; i < LIGHTS; i++)
+	{
+		unsigned int hash = i * 2654435761u;
+		lights[i].position = glm::vec3(-20.0f + (hash % 4000) / 100.0f, -3.0f + ((hash >> 8) % 600) / 100.0f, 5.0f - ((hash >> 12) % 6500) / 100.0f);
+		lights[i].radius = 0.5f + ((hash >> 4) % 250) / 100.0f;
+		lights[i].color = glm::vec3(1.0f);
+		lights[i].intensity = 1.0f;
+	}
+
+	LightClusters clusters;
+	unsigned int mismatches = clusters.create(TILES_X, TILES_Y, SLICES, 0.1f, 100.0f) ? 0 : 1;
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), WIDTH / HEIGHT, 0.1f, 100.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	const int RUNS = 20;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int run = 0; run < RUNS; run++)
+		clusters.build(lights.data(), LIGHTS, view, projection);
+	double buildTime = elapsedSeconds(start) / RUNS;
+
+	// Every light against every cluster box, in the same arithmetic order
+	const std::vector<glm::vec4> & viewLights = clusters.getViewLights();
+	const std::vector<unsigned int> & ranges = clusters.getClusters(), & indices = clusters.getLightIndices();
+	for (unsigned int cluster = 0; cluster < clusters.getClusterCount(); cluster++)
+	{
+		glm::vec3 boundsMin, boundsMax;
+		clusters.getClusterBounds(cluster, boundsMin, boundsMax);
+		std::vector<unsigned int> expected;
+		for (unsigned int i = 0; i < LIGHTS; i++)
+		{
+			glm::vec3 center(viewLights[i]);
+			glm::vec3 distance = glm::max(glm::max(boundsMin - center, center - boundsMax), glm::vec3(0.0f));
+			float depth = -center.z, radius = viewLights[i].w;
+			if (depth + radius > 0.1f && depth - radius < 100.0f && (distance.x * distance.x + distance.y * distance.y) + distance.z * distance.z <= radius * radius)
+				expected.push_back(i);
+		}
+		if (expected.size() != ranges[cluster * 2 + 1] || !std::equal(expected.begin(), expected.end(), indices.begin() + ranges[cluster * 2]))
+			mismatches++;
+	}
+
+	// Points in the frustum must find every light reaching them in the
+	// cluster clustered.fs would look up
+	float scale = clusters.getSliceScale(), bias = clusters.getSliceBias();
+	unsigned int missed = 0;
+	for (unsigned int i = 0; i < POINTS; i++)
+	{
+		unsigned int hash = i * 2654435761u;
+		glm::vec3 ndc(-1.0f + (hash % 10000) / 5000.0f, -1.0f + ((hash >> 6) % 10000) / 5000.0f, 0.0f);
+		float depth = 0.1f * powf(1000.0f, ((hash >> 3) % 9973) / 9973.0f);
+		glm::vec4 ray = glm::inverse(projection) * glm::vec4(ndc, 1.0f);
+		glm::vec3 point = glm::vec3(ray) / ray.w;
+		point *= depth / -point.z;
+
+		glm::vec3 cell(floorf((ndc.x * 0.5f + 0.5f) * TILES_X), floorf((ndc.y * 0.5f + 0.5f) * TILES_Y), floorf(logf(depth) * scale - bias));
+		cell = glm::clamp(cell, glm::vec3(0.0f), glm::vec3(TILES_X - 1, TILES_Y - 1, SLICES - 1));
+		unsigned int cluster = ((unsigned int)cell.z * TILES_Y + (unsigned int)cell.y) * TILES_X + (unsigned int)cell.x;
+		const unsigned int * first = &indices[0] + ranges[cluster * 2], * last = first + ranges[cluster * 2 + 1];
+		for (unsigned int light = 0; light < LIGHTS; light++)
+			if (glm::length(glm::vec3(viewLights[light]) - point) < viewLights[light].w && std::find(first, last, light) == last)
+				missed++;
+	}
+
+	printf("Light clusters %ux%ux%u: %u lights binned in %.3f ms on %u threads, %zu indices, %u mismatches, %u missed lights\n",
+		TILES_X, TILES_Y, SLICES, LIGHTS, buildTime * 1e3, ThreadPool::instance().getThreadCount(), indices.size(), mismatches, missed);
+}
+
+static void benchmarkShadowCascades()
+{
+	const unsigned int CASCADES = 4, RESOLUTION = 1024, FRAMES = 2000;
+	const float NEAR_DEPTH = 0.1f, FAR_DEPTH = 100.0f;
+	ShadowCascades cascades;
+	unsigned int mismatches = cascades.create(CASCADES, RESOLUTION, 0.75f, 10.0f) ? 0 : 1;
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, NEAR_DEPTH, 1000.0f);
+	glm::vec3 lightDirection = glm::normalize(glm::vec3(0.3f, -1.0f, -0.4f));
+	glm::vec4 probe(3.0f, 0.0f, -7.0f, 1.0f);
+
+	// A camera standing still, then walking forward at 2 cm a frame, then
+	// looking around on the spot
+	const char * PHASES[3] = { "standing", "walking", "turning" };
+	std::vector<float> texelSizes(CASCADES), phases(CASCADES);
+	unsigned int redraws[3][CASCADES] = {};
+	double updateTime = 0.0;
+	for (unsigned int frame = 0; frame < FRAMES; frame++)
+	{
+		unsigned int step = frame * 3 / FRAMES;
+		float walked = 0.02f * glm::clamp((float)frame - FRAMES / 3, 0.0f, FRAMES / 3.0f);
+		float turned = std::max((float)frame - 2 * FRAMES / 3, 0.0f);
+		glm::vec3 eye(0.0f, 2.0f, -walked);
+		float yaw = 0.003f * turned, pitch = 0.3f * sinf(0.01f * turned);
+		glm::vec3 forward(cosf(pitch) * sinf(yaw), sinf(pitch), -cosf(pitch) * cosf(yaw));
+		glm::mat4 view = glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+
+		auto start = std::chrono::high_resolution_clock::now();
+		cascades.update(view, projection, NEAR_DEPTH, FAR_DEPTH, lightDirection);
+		updateTime += elapsedSeconds(start);
+
+		glm::mat4 inverseView = glm::inverse(view);
+		for (unsigned int i = 0; i < CASCADES; i++)
+		{
+			const ShadowCascade & cascade = cascades.getCascade(i);
+			redraws[step][i] += frame > 0 && cascades.hasChanged(i) ? 1 : 0;
+
+			// The texel size never changes, and a fixed world point keeps its
+			// place within a texel
+			float texel = (cascade.viewProjection * probe).x * RESOLUTION * 0.5f;
+			if (frame == 0)
+			{
+				texelSizes[i] = cascade.texelSize;
+				phases[i] = texel - floorf(texel);
+			}
+			float offset = fabsf(texel - floorf(texel) - phases[i]);
+			if (fabsf(cascade.texelSize - texelSizes[i]) > 1e-4f * texelSizes[i] || std::min(offset, 1.0f - offset) > 0.01f)
+				mismatches++;
+
+			// Every corner of the camera's slice lies inside the cascade
+			for (int corner = 0; corner < 8; corner++)
+			{
+				float depth = corner & 4 ? cascade.splitFar : cascade.splitNear;
+				glm::vec4 ndc(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, 0.0f, 1.0f);
+				glm::vec4 ray = glm::inverse(projection) * ndc;
+				glm::vec3 point = glm::vec3(ray) / ray.w;
+				glm::vec4 clip = cascade.viewProjection * inverseView * glm::vec4(point * (depth / -point.z), 1.0f);
+				if (fabsf(clip.x) > 1.0f || fabsf(clip.y) > 1.0f || clip.z < -1.0f || clip.z > 1.0f)
+					mismatches++;
+			}
+		}
+	}
+
+	printf("Shadow cascades: %u cascades updated in %.2f us, %u mismatches, static caches redrawn in\n", CASCADES, updateTime / FRAMES * 1e6, mismatches);
+	for (unsigned int step = 0; step < 3; step++)
+	{
+		printf("  %s:", PHASES[step]);
+		for (unsigned int i = 0; i < CASCADES; i++)
+			printf(" %.0f%%", 300.0 * redraws[step][i] / FRAMES);
+		printf(" of frames\n");
+	}
+}
+
+// Declarations of a render graph, kept to check what it compiles to
+struct DeclaredAccess
+{
+	unsigned int pass;
+	RenderGraph::Resource resource;
+	unsigned int access;
+	bool write;
+};
+
+static void declareAccess(RenderGraph & graph, std::vector<DeclaredAccess> & declared, unsigned int pass, RenderGraph::Resource resource, unsigned int access, bool write)
+{
+	DeclaredAccess entry = { pass, resource, access, write };
+	declared.push_back(entry);
+	if (write)
+		graph.write(pass, resource, access);
+	else
+		graph.read(pass, resource, access);
+}
+
+// Checks every read runs after all other writers, writers run in declaration
+// order, aliased resources never live at once, and barriers are exactly
+// those an incoherent write needs. Returns the number of violations.
+static unsigned int checkRenderGraph(const RenderGraph & graph, const std::vector<DeclaredAccess> & declared)
+{
+	const GLbitfield KIND_BARRIERS[8] = {
+		GL_FRAMEBUFFER_BARRIER_BIT, GL_TEXTURE_FETCH_BARRIER_BIT, GL_SHADER_IMAGE_ACCESS_BARRIER_BIT, GL_SHADER_STORAGE_BARRIER_BIT,
+		GL_UNIFORM_BARRIER_BIT, GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT, GL_COMMAND_BARRIER_BIT,
+		GL_TEXTURE_UPDATE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT };
+
+	unsigned int violations = 0;
+	std::vector<int> position(graph.getPassCount(), -1);
+	for (size_t i = 0; i < graph.getOrder().size(); i++)
+		position[graph.getOrder()[i]] = (int)i;
+
+	std::vector<int> firstUse(graph.getResourceCount(), INT_MAX), lastUse(graph.getResourceCount(), -1);
+	for (const DeclaredAccess & access : declared)
+	{
+		if (position[access.pass] < 0)
+			continue;
+		firstUse[access.resource] = std::min(firstUse[access.resource], position[access.pass]);
+		lastUse[access.resource] = std::max(lastUse[access.resource], position[access.pass]);
+
+		int previousWriter = -1;
+		for (const DeclaredAccess & other : declared)
+		{
+			if (!other.write || other.resource != access.resource || other.pass == access.pass)
+				continue;
+			if (!access.write && (position[other.pass] < 0 || position[other.pass] > position[access.pass]))
+				violations++;
+			if (access.write && other.pass < access.pass)
+				previousWriter = std::max(previousWriter, (int)other.pass);
+		}
+		if (previousWriter >= 0 && (position[previousWriter] < 0 || position[previousWriter] > position[access.pass]))
+			violations++;
+	}
+
+	for (RenderGraph::Resource a = 0; a < graph.getResourceCount(); a++)
+	{
+		int physical = graph.getPhysicalIndex(a);
+		if (physical < 0)
+			continue;
+		const RenderPhysical & memory = graph.getPhysicals()[physical], & description = graph.getDescription(a);
+		if (memory.bytes < description.bytes || (!description.isBuffer && (memory.width != description.width || memory.format != description.format)))
+			violations++;
+		for (RenderGraph::Resource b = a + 1; b < graph.getResourceCount(); b++)
+			if (graph.getPhysicalIndex(b) == physical && firstUse[a] <= lastUse[b] && firstUse[b] <= lastUse[a])
+				violations++;
+	}
+
+	// Replay the barriers: every access to an incoherent write must be
+	// covered, and every kind barriered must have been needed
+	std::vector<int> incoherentWrite(graph.getResourceCount(), -1);
+	int lastBarrier[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+	for (int i = 0; i < (int)graph.getOrder().size(); i++)
+	{
+		unsigned int pass = graph.getOrder()[i];
+		GLbitfield barriers = graph.getBarriers(pass), needed = 0;
+		for (const DeclaredAccess & access : declared)
+		{
+			int written = incoherentWrite[access.resource];
+			if (access.pass != pass || written < 0 || written == i)
+				continue;
+			for (int kind = 0; kind < 8; kind++)
+			{
+				if (!(access.access >> kind & 1) || lastBarrier[kind] > written)
+					continue;
+				needed |= KIND_BARRIERS[kind];
+				if ((barriers & KIND_BARRIERS[kind]) != KIND_BARRIERS[kind])
+					violations++;
+			}
+		}
+		if (barriers != needed)
+			violations++;
+		for (int kind = 0; kind < 8; kind++)
+			if ((barriers & KIND_BARRIERS[kind]) == KIND_BARRIERS[kind])
+				lastBarrier[kind] = i;
+		for (const DeclaredAccess & access : declared)
+			if (access.pass == pass && access.write)
+				incoherentWrite[access.resource] = access.access & (ACCESS_IMAGE | ACCESS_STORAGE) ? i : -1;
+	}
+	return violations;
+}
+
+static void benchmarkRenderGraph()
+{
+	// A deferred frame, declared out of order, with a debug view nothing reads
+	const unsigned int WIDTH = 1920, HEIGHT = 1080;
+	RenderGraph graph;
+	std::vector<DeclaredAccess> declared;
+	RenderGraph::Resource backbuffer = graph.importBackbuffer("backbuffer", WIDTH, HEIGHT);
+	RenderGraph::Resource objects = graph.importBuffer("objects", 1, 1 << 20);
+	RenderGraph::Resource commands = graph.createBuffer("commands", 1 << 18);
+	RenderGraph::Resource albedo = graph.createTexture("albedo", WIDTH, HEIGHT, GL_RGBA8);
+	RenderGraph::Resource normals = graph.createTexture("normals", WIDTH, HEIGHT, GL_RGBA16F);
+	RenderGraph::Resource depth = graph.createTexture("depth", WIDTH, HEIGHT, GL_DEPTH_COMPONENT24);
+	RenderGraph::Resource occlusion = graph.createTexture("occlusion", WIDTH, HEIGHT, GL_R8);
+	RenderGraph::Resource hdr = graph.createTexture("hdr", WIDTH, HEIGHT, GL_RGBA16F);
+	RenderGraph::Resource bloom = graph.createTexture("bloom", WIDTH / 2, HEIGHT / 2, GL_RGBA16F);
+	RenderGraph::Resource histogram = graph.createBuffer("histogram", 256 * 4);
+	RenderGraph::Resource exposure = graph.createBuffer("exposure", 16);
+	RenderGraph::Resource ldr = graph.createTexture("ldr", WIDTH, HEIGHT, GL_RGBA8);
+	RenderGraph::Resource debug = graph.createTexture("debug", WIDTH, HEIGHT, GL_RGBA8);
+	graph.markOutput(backbuffer);
+
+	unsigned int antialias = graph.addPass("fxaa", nullptr);
+	unsigned int tonemap = graph.addPass("tonemap", nullptr);
+	unsigned int gbuffer = graph.addPass("gbuffer", nullptr);
+	unsigned int cull = graph.addPass("cull", nullptr);
+	unsigned int ssao = graph.addPass("ssao", nullptr);
+	unsigned int lighting = graph.addPass("lighting", nullptr);
+	unsigned int debugView = graph.addPass("debug view", nullptr);
+	unsigned int bloomPass = graph.addPass("bloom", nullptr);
+	unsigned int luminance = graph.addPass("luminance", nullptr);
+	unsigned int adapt = graph.addPass("exposure", nullptr);
+	unsigned int capture = graph.addPass("capture", nullptr);
+	graph.setSideEffects(capture);
+
+	declareAccess(graph, declared, tonemap, hdr, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, tonemap, bloom, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, tonemap, exposure, ACCESS_UNIFORM, false);
+	declareAccess(graph, declared, tonemap, ldr, ACCESS_ATTACHMENT, true);
+	declareAccess(graph, declared, antialias, ldr, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, antialias, backbuffer, ACCESS_ATTACHMENT, true);
+	declareAccess(graph, declared, gbuffer, objects, ACCESS_STORAGE, false);
+	declareAccess(graph, declared, gbuffer, commands, ACCESS_INDIRECT, false);
+	declareAccess(graph, declared, gbuffer, albedo, ACCESS_ATTACHMENT, true);
+	declareAccess(graph, declared, gbuffer, normals, ACCESS_ATTACHMENT, true);
+	declareAccess(graph, declared, gbuffer, depth, ACCESS_ATTACHMENT, true);
+	declareAccess(graph, declared, cull, objects, ACCESS_STORAGE, false);
+	declareAccess(graph, declared, cull, commands, ACCESS_STORAGE, true);
+	declareAccess(graph, declared, ssao, depth, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, ssao, normals, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, ssao, occlusion, ACCESS_IMAGE, true);
+	declareAccess(graph, declared, lighting, albedo, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, lighting, normals, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, lighting, depth, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, lighting, occlusion, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, lighting, hdr, ACCESS_IMAGE, true);
+	declareAccess(graph, declared, debugView, normals, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, debugView, debug, ACCESS_ATTACHMENT, true);
+	declareAccess(graph, declared, bloomPass, hdr, ACCESS_SAMPLED, false);
+	declareAccess(graph, declared, bloomPass, bloom, ACCESS_ATTACHMENT, true);
+	declareAccess(graph, declared, luminance, hdr, ACCESS_IMAGE, false);
+	declareAccess(graph, declared, luminance, histogram, ACCESS_STORAGE, true);
+	declareAccess(graph, declared, adapt, histogram, ACCESS_STORAGE, false);
+	declareAccess(graph, declared, adapt, exposure, ACCESS_STORAGE, true);
+	declareAccess(graph, declared, capture, backbuffer, ACCESS_TRANSFER, false);
+
+	unsigned int mismatches = graph.compile() ? 0 : 1;
+	for (unsigned int pass = 0; pass < graph.getPassCount(); pass++)
+		if (graph.isCulled(pass) != (pass == debugView))
+			mismatches++;
+	mismatches += checkRenderGraph(graph, declared);
+
+	printf("Render graph, deferred frame:");
+	for (unsigned int pass : graph.getOrder())
+		printf(" %s%s", graph.getPassName(pass), graph.getBarriers(pass) ? "*" : "");
+	printf("\n  %.1f MB of transients in %.1f MB, %u mismatches (* after a barrier)\n",
+		graph.getTransientBytes() / 1048576.0, graph.getPhysicalBytes() / 1048576.0, mismatches);
+
+	// Random steps over a few formats, declared shuffled. A step writes new
+	// resources from ones earlier steps wrote, and sometimes updates one in
+	// place with a second pass. Many steps are never read.
+	const unsigned int STEPS = 1500, RUNS = 10;
+	const GLenum FORMATS[3] = { GL_RGBA8, GL_RGBA16F, GL_R32F };
+	const unsigned int KINDS[6] = { ACCESS_ATTACHMENT, ACCESS_SAMPLED, ACCESS_IMAGE, ACCESS_STORAGE, ACCESS_INDIRECT, ACCESS_SAMPLED | ACCESS_TRANSFER };
+	double compileTime = 0.0;
+	unsigned int passCount = 0, culled = 0;
+	for (unsigned int run = 0; run < RUNS; run++)
+	{
+		graph.clear();
+		declared.clear();
+		unsigned int hash = run * 2654435761u + 1;
+		auto next = [&hash]() { hash ^= hash << 13; hash ^= hash >> 17; hash ^= hash << 5; return hash; };
+
+		struct StepAccess { RenderGraph::Resource resource; unsigned int access; bool write; };
+		std::vector<std::vector<std::vector<StepAccess>>> steps(STEPS);
+		std::vector<RenderGraph::Resource> written;
+		backbuffer = graph.importBackbuffer("backbuffer", WIDTH, HEIGHT);
+		graph.markOutput(backbuffer);
+		for (unsigned int step = 0; step < STEPS; step++)
+		{
+			std::vector<StepAccess> accesses;
+			for (unsigned int read = 0; read < 2 && !written.empty(); read++)
+			{
+				StepAccess access = { written[written.size() - 1 - next() % std::min<size_t>(written.size(), 40)], KINDS[1 + next() % 5], false };
+				accesses.push_back(access);
+			}
+			unsigned int writes = 1 + next() % 2;
+			for (unsigned int write = 0; write < writes; write++)
+			{
+				unsigned int size = next() % 3;
+				RenderGraph::Resource resource = step + 1 == STEPS ? backbuffer : next() % 5 == 0 ? graph.createBuffer("buffer", 1024 * (1 + next() % 64)) :
+					graph.createTexture("texture", 256 << size, 256 << size, FORMATS[size]);
+				StepAccess access = { resource, graph.getDescription(resource).isBuffer ? (unsigned int)ACCESS_STORAGE : KINDS[next() % 3], true };
+				accesses.push_back(access);
+				written.push_back(resource);
+			}
+			steps[step].push_back(accesses);
+
+			if (next() % 4 == 0)
+			{
+				StepAccess update[2] = { { written.back(), ACCESS_IMAGE, false }, { written.back(), ACCESS_IMAGE, true } };
+				steps[step].push_back(std::vector<StepAccess>(update, update + 2));
+			}
+		}
+
+		for (unsigned int i = STEPS - 1; i > 0; i--)
+			std::swap(steps[i], steps[next() % (i + 1)]);
+		for (const std::vector<std::vector<StepAccess>> & step : steps)
+		{
+			for (const std::vector<StepAccess> & accesses : step)
+			{
+				unsigned int pass = graph.addPass("pass", nullptr);
+				for (const StepAccess & access : accesses)
+					declareAccess(graph, declared, pass, access.resource, access.access, access.write);
+			}
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		if (!graph.compile())
+			mismatches++;
+		compileTime += elapsedSeconds(start);
+		passCount = graph.getPassCount();
+		culled += graph.getPassCount() - (unsigned int)graph.getOrder().size();
+		mismatches += checkRenderGraph(graph, declared);
+	}
+
+	printf("Render graph, %u random passes over %u resources: compiled in %.3f ms, %.0f culled, %.1f MB of transients in %.1f MB, %u mismatches\n",
+		passCount, graph.getResourceCount(), compileTime / RUNS * 1e3, (double)culled / RUNS, graph.getTransientBytes() / 1048576.0, graph.getPhysicalBytes() / 1048576.0, mismatches);
+}
+
+// A warm, contrasty grade written out as a .cube table, parsed back and
+// sampled the way the post-processing LUT texture is
+static glm::vec3 gradeColor(const glm::vec3 & color)
+{
+	glm::vec3 contrast = color * color * (3.0f - 2.0f * color);
+	return glm::clamp(glm::mix(color, contrast, 0.5f) * glm::vec3(1.0f, 0.97f, 0.9f) + glm::vec3(0.0f, 0.01f, 0.03f), 0.0f, 1.0f);
+}
+
+static void benchmarkColorLut()
+{
+	const unsigned int SIZE = 33, SAMPLES = 1000000;
+	std::string text = "TITLE \"warm\"\n# generated\nLUT_3D_SIZE 33\nDOMAIN_MIN 0.0 0.0 0.0\nDOMAIN_MAX 1.0 1.0 1.0\n";
+	char line[64];
+	for (unsigned int b = 0; b < SIZE; b++)
+		for (unsigned int g = 0; g < SIZE; g++)
+			for (unsigned int r = 0; r < SIZE; r++)
+			{
+				glm::vec3 color = gradeColor(glm::vec3((float)r, (float)g, (float)b) / (float)(SIZE - 1));
+				snprintf(line, sizeof(line), "%.6f %.6f %.6f\n", color.r, color.g, color.b);
+				text += line;
+			}
+
+	ColorLut lut, identity;
+	auto start = std::chrono::high_resolution_clock::now();
+	unsigned int mismatches = parseCubeLut(text.data(), text.size(), lut) ? 0 : 1;
+	double parseTime = elapsedSeconds(start);
+	makeIdentityLut(SIZE, identity);
+	if (lut.size != SIZE)
+		mismatches++;
+
+	// Grid points come back exactly, the identity table returns its input
+	// and the graded one follows the grade closely between grid points
+	for (unsigned int i = 0; i < lut.colors.size() && lut.size == SIZE; i++)
+	{
+		glm::vec3 expected = gradeColor(glm::vec3((float)(i % SIZE), (float)(i / SIZE % SIZE), (float)(i / SIZE / SIZE)) / (float)(SIZE - 1));
+		if (glm::any(glm::greaterThan(glm::abs(lut.colors[i] - expected), glm::vec3(1e-5f))))
+			mismatches++;
+	}
+
+	unsigned int seed = 1;
+	auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+	std::vector<glm::vec3> inputs(SAMPLES);
+	for (glm::vec3 & input : inputs)
+		input = glm::vec3(next(), next(), next());
+
+	float maxError = 0.0f;
+	glm::vec3 checksum(0.0f);
+	start = std::chrono::high_resolution_clock::now();
+	for (const glm::vec3 & input : inputs)
+		checksum += sampleLut(lut, input);
+	double sampleTime = elapsedSeconds(start);
+	for (unsigned int i = 0; i < SAMPLES && lut.size == SIZE; i += 97)
+	{
+		if (glm::any(glm::greaterThan(glm::abs(sampleLut(identity, inputs[i]) - inputs[i]), glm::vec3(1e-5f))))
+			mismatches++;
+		glm::vec3 error = glm::abs(sampleLut(lut, inputs[i]) - gradeColor(inputs[i]));
+		maxError = std::max(maxError, std::max(error.r, std::max(error.g, error.b)));
+	}
+	if (maxError > 1.0f / 255.0f)
+		mismatches++;
+
+	printf("Colour LUT %u^3: parsed in %.2f ms, %.1f M trilinear samples/s, largest error %.5f, checksum %.1f, %u mismatches\n",
+		SIZE, parseTime * 1e3, SAMPLES / sampleTime / 1e6, maxError, checksum.r + checksum.g + checksum.b, mismatches);
+}
+
+// Simulated GPU whose frame time is a fixed part plus a part following the
+// render area, under a load stepping between light and heavy scenes, with
+// noise and timings arriving three frames late as timer queries do
+static void benchmarkDynamicResolution()
+{
+	const unsigned int FRAMES = 6000, LATENCY = 3;
+	const float TARGET = 14.0f, BUDGET = 1000.0f / 60.0f, FIXED = 2.0f, FULL_AREA = 12.0f;
+	const float LOADS[] = { 1.0f, 1.8f, 0.6f, 1.4f, 2.6f, 1.0f };
+	const unsigned int SEGMENT = FRAMES / (sizeof(LOADS) / sizeof(LOADS[0]));
+
+	ResolutionController controller;
+	unsigned int mismatches = controller.create(TARGET, 0.5f, 1.0f, 0.05f, LATENCY) ? 0 : 1;
+	unsigned int seed = 1;
+	auto noise = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f - 0.5f; };
+
+	std::vector<float> times(FRAMES);
+	unsigned int overBudget = 0, overBudgetFixed = 0, changes = 0;
+	double scaleSum = 0.0;
+	float scale = controller.getScale();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int frame = 0; frame < FRAMES; frame++)
+	{
+		float load = LOADS[frame / SEGMENT] * (1.0f + 0.1f * noise());
+		times[frame] = FIXED + FULL_AREA * load * scale * scale;
+		overBudget += times[frame] > BUDGET ? 1 : 0;
+		overBudgetFixed += FIXED + FULL_AREA * load > BUDGET ? 1 : 0;
+		scaleSum += scale;
+
+		if (frame >= LATENCY)
+		{
+			float next = controller.update(times[frame - LATENCY]);
+			changes += next != scale ? 1 : 0;
+			scale = next;
+		}
+		if (scale < 0.5f || scale > 1.0f)
+			mismatches++;
+	}
+	double updateTime = elapsedSeconds(start);
+
+	// Once settled in each segment the time holds near the target, or the
+	// scale sits at a limit when the target cannot be met
+	for (unsigned int segment = 0; segment < FRAMES / SEGMENT; segment++)
+	{
+		double sum = 0.0;
+		for (unsigned int frame = (segment + 1) * SEGMENT - SEGMENT / 4; frame < (segment + 1) * SEGMENT; frame++)
+			sum += times[frame];
+		float mean = (float)(sum / (SEGMENT / 4));
+		float atFull = FIXED + FULL_AREA * LOADS[segment], atMin = FIXED + FULL_AREA * LOADS[segment] * 0.25f;
+		bool limited = atFull < TARGET || atMin > TARGET;
+		if (!limited && fabsf(mean - TARGET) > 0.1f * TARGET)
+			mismatches++;
+		printf("  load %.1f: %.2f ms settled (%.2f ms at full resolution)\n", LOADS[segment], mean, atFull);
+	}
+
+	printf("Dynamic resolution, %.1f ms target: %.1f%% of frames over %.1f ms (%.1f%% at full resolution), mean scale %.2f, %u scale changes, %.3f us per update, %u mismatches\n",
+		TARGET, 100.0 * overBudget / FRAMES, BUDGET, 100.0 * overBudgetFixed / FRAMES, scaleSum / FRAMES, changes, updateTime / FRAMES * 1e6, mismatches);
+}
+
+// A producer thread standing in for the input callbacks pushes numbered
+// events while the consumer drains them, as the frame does, in bursts
+static void benchmarkInputQueue()
+{
+	const unsigned int EVENTS = 4000000, CAPACITY = 256;
+	InputQueue queue;
+	queue.create(CAPACITY);
+
+	unsigned int fullCount = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	std::thread producer([&queue, &fullCount]()
+	{
+		InputEvent event = { INPUT_CURSOR, 0.0, 0.0, 0.0, 0, 0 };
+		for (unsigned int i = 0; i < EVENTS; i++)
+		{
+			event.timestamp = i;
+			event.x = i;
+			while (!queue.push(event))
+			{
+				fullCount++;
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	unsigned int received = 0, mismatches = 0, drains = 0;
+	InputEvent event;
+	while (received < EVENTS)
+	{
+		while (queue.pop(event))
+		{
+			if (event.x != received || event.timestamp != received)
+				mismatches++;
+			received++;
+		}
+		drains++;
+		std::this_thread::yield();
+	}
+	producer.join();
+	double seconds = elapsedSeconds(start);
+	if (queue.getDroppedCount() != fullCount || queue.pop(event))
+		mismatches++;
+
+	printf("Input queue, %u events through %u slots: %.1f M events/s, %u pushes found it full, %u drains, %u mismatches\n",
+		EVENTS, CAPACITY, EVENTS / seconds / 1e6, fullCount, drains, mismatches);
+}
+
+// Vertices a FIFO post-transform cache of 16 entries shades per triangle
+static float averageCacheMissRatio(const std::vector<unsigned int> & indices)
+{
+	const unsigned int CACHE_SIZE = 16;
+	unsigned int cache[CACHE_SIZE], next = 0, misses = 0;
+	std::fill(cache, cache + CACHE_SIZE, UINT_MAX);
+	for (unsigned int index : indices)
+	{
+		if (std::find(cache, cache + CACHE_SIZE, index) != cache + CACHE_SIZE)
+			continue;
+		cache[next] = index;
+		next = (next + 1) % CACHE_SIZE;
+		misses++;
+	}
+	return indices.empty() ? 0.0f : 3.0f * misses / indices.size();
+}
+
+// A grid as a plain triangle list with noise well inside the welding cells
+// and a texture seam down the middle, welded and compared with a serial
+// std::unordered_map over the same cells
+static void benchmarkMeshWeld()
+{
+	const unsigned int SIDE = 600;
+	const float SPACING = 0.01f, TOLERANCE = 1e-4f, NOISE = 1e-5f;
+	MeshData mesh;
+	mesh.vertices.reserve(SIDE * SIDE * 6);
+	unsigned int seed = 1;
+	auto noise = [&seed, NOISE]() { seed = seed * 1664525u + 1013904223u; return ((seed >> 8) / 16777216.0f - 0.5f) * 2.0f * NOISE; };
+	for (unsigned int y = 0; y < SIDE; y++)
+	{
+		for (unsigned int x = 0; x < SIDE; x++)
+		{
+			const unsigned int CORNERS[6][2] = { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 1, 0 } };
+			for (const unsigned int * corner : CORNERS)
+			{
+				unsigned int cx = x + corner[0], cy = y + corner[1];
+				MeshVertex vertex;
+				vertex.position = glm::vec3(cx * SPACING + noise(), 0.0f, cy * SPACING + noise());
+				vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+				vertex.uv = glm::vec2(x < SIDE / 2 ? 0.0f : 1.0f, (float)cy);
+				mesh.vertices.push_back(vertex);
+			}
+		}
+	}
+	unsigned int count = (unsigned int)mesh.vertices.size();
+	unsigned int expected = (SIDE + 1) * (SIDE + 2);
+
+	std::vector<unsigned int> remap;
+	auto start = std::chrono::high_resolution_clock::now();
+	unsigned int welded = weldVertices(mesh.vertices.data(), count, TOLERANCE, 0.0f, 0.0f, remap);
+	double weldTime = elapsedSeconds(start);
+
+	struct Cell
+	{
+		glm::vec3 position;
+		glm::vec2 uv;
+		bool operator==(const Cell & other) const { return position == other.position && uv == other.uv; }
+	};
+	struct CellHash
+	{
+		size_t operator()(const Cell & cell) const { return std::hash<glm::vec3>()(cell.position) ^ (std::hash<glm::vec2>()(cell.uv) << 1); }
+	};
+	start = std::chrono::high_resolution_clock::now();
+	std::unordered_map<Cell, unsigned int, CellHash> cells;
+	std::vector<unsigned int> reference(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Cell cell = { glm::floor(mesh.vertices[i].position / TOLERANCE + 0.5f), mesh.vertices[i].uv };
+		reference[i] = cells.emplace(cell, (unsigned int)cells.size()).first->second;
+	}
+	double referenceTime = elapsedSeconds(start);
+
+	unsigned int mismatches = welded == expected && cells.size() == expected ? 0 : 1;
+	for (unsigned int i = 0; i < count; i++)
+		if (remap[i] != reference[i])
+			mismatches++;
+
+	MeshData weldedMesh = mesh;
+	weldMesh(weldedMesh, TOLERANCE, 0.0f, 0.0f);
+	if (weldedMesh.vertices.size() != welded || weldedMesh.indices.size() != count)
+		mismatches++;
+	for (unsigned int i = 0; i < weldedMesh.indices.size() && i < count; i++)
+		if (glm::length(weldedMesh.vertices[weldedMesh.indices[i]].position - mesh.vertices[i].position) > 2.0f * TOLERANCE)
+			mismatches++;
+
+	printf("Mesh welding, %u vertices to %u: %.1f ms on %u threads, %.1f ms with std::unordered_map, %.2f vertex transforms per triangle from 3, %u mismatches\n",
+		count, welded, weldTime * 1e3, ThreadPool::instance().getThreadCount(), referenceTime * 1e3, averageCacheMissRatio(weldedMesh.indices), mismatches);
+}
+
+void runBenchmarks()
+{
+	benchmarkBVH();
+	benchmarkRayPackets();
+	benchmarkNoise();
+	benchmarkHalfPacking();
+	benchmarkPacking();
+	benchmarkQuaternions();
+	benchmarkSkinning();
+	benchmarkTransformHierarchy();
+	benchmarkEntityStore();
+	benchmarkMeshLoading();
+	benchmarkImageDecode();
+	benchmarkMipChain();
+	benchmarkBlockCompression();
+	benchmarkCaptureEncoding();
+	benchmarkGoldenCompare();
+	benchmarkOcclusionCulling();
+	benchmarkMeshSimplify();
+	benchmarkLightClusters();
+	benchmarkShadowCascades();
+	benchmarkRenderGraph();
+	benchmarkColorLut();
+	benchmarkDynamicResolution();
+	benchmarkInputQueue();
+	benchmarkMeshWeld();
+}
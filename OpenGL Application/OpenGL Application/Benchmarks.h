@@ -0,0 +1,5 @@
+#pragma once
+
+// Runs the CPU micro-benchmarks and prints the results to stdout. Started
+// from the command line with --benchmark instead of opening a window.
+void runBenchmarks();
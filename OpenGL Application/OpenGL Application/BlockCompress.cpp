@@ -0,0 +1,651 @@
+#include "BlockCompress.h"
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <gtc/packing.hpp>
+#include "Simd.h"
+#include "ThreadPool.h"
+
+// Block pixels as float columns so four pixels go through SSE at a time.
+// Transparent pixels take the color of an opaque one so they never widen
+// the endpoints, and have no weight in the fits.
+struct ColorBlock
+{
+	float r[16], g[16], b[16], weight[16];
+	bool anyTransparent;
+	bool allTransparent;
+};
+
+static void loadColorBlock(const unsigned char * rgba, ColorBlock & block)
+{
+	int opaque = -1;
+	for (int i = 0; i < 16 && opaque < 0; i++)
+		if (rgba[i * 4 + 3] >= 128)
+			opaque = i;
+
+	block.anyTransparent = false;
+	block.allTransparent = opaque < 0;
+	for (int i = 0; i < 16; i++)
+	{
+		bool transparent = rgba[i * 4 + 3] < 128;
+		const unsigned char * pixel = rgba + (transparent && opaque >= 0 ? opaque : i) * 4;
+		block.r[i] = pixel[0];
+		block.g[i] = pixel[1];
+		block.b[i] = pixel[2];
+		block.weight[i] = transparent ? 0.0f : 1.0f;
+		block.anyTransparent |= transparent;
+	}
+}
+
+static inline float horizontalMin(__m128 v)
+{
+	v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtss_f32(v);
+}
+
+static inline float horizontalMax(__m128 v)
+{
+	v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtss_f32(v);
+}
+
+static inline float horizontalSum(__m128 v)
+{
+	v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtss_f32(v);
+}
+
+static void minMax16(const float * values, float & minimum, float & maximum)
+{
+	__m128 low = _mm_loadu_ps(values), high = low;
+	for (int i = 4; i < 16; i += 4)
+	{
+		__m128 v = _mm_loadu_ps(values + i);
+		low = _mm_min_ps(low, v);
+		high = _mm_max_ps(high, v);
+	}
+	minimum = horizontalMin(low);
+	maximum = horizontalMax(high);
+}
+
+// Corners of the color bounding box, inset by 1/16 of its size since the
+// extremes are rarely worth a palette entry
+static void boundingBoxEndpoints(const ColorBlock & block, float * low, float * high)
+{
+	const float * channels[3] = { block.r, block.g, block.b };
+	for (int c = 0; c < 3; c++)
+	{
+		minMax16(channels[c], low[c], high[c]);
+		float inset = (high[c] - low[c]) / 16.0f;
+		low[c] += inset;
+		high[c] -= inset;
+	}
+}
+
+// Extremes of the pixels projected on the principal axis of their colors
+static void principalAxisEndpoints(const ColorBlock & block, float * low, float * high)
+{
+	__m128 sumR = _mm_setzero_ps(), sumG = _mm_setzero_ps(), sumB = _mm_setzero_ps(), sumW = _mm_setzero_ps();
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128 w = _mm_loadu_ps(block.weight + i);
+		sumR = _mm_add_ps(sumR, _mm_mul_ps(w, _mm_loadu_ps(block.r + i)));
+		sumG = _mm_add_ps(sumG, _mm_mul_ps(w, _mm_loadu_ps(block.g + i)));
+		sumB = _mm_add_ps(sumB, _mm_mul_ps(w, _mm_loadu_ps(block.b + i)));
+		sumW = _mm_add_ps(sumW, w);
+	}
+	float count = horizontalSum(sumW);
+	float mean[3] = { horizontalSum(sumR) / count, horizontalSum(sumG) / count, horizontalSum(sumB) / count };
+
+	__m128 meanR = _mm_set1_ps(mean[0]), meanG = _mm_set1_ps(mean[1]), meanB = _mm_set1_ps(mean[2]);
+	__m128 rr = _mm_setzero_ps(), rg = _mm_setzero_ps(), rb = _mm_setzero_ps();
+	__m128 gg = _mm_setzero_ps(), gb = _mm_setzero_ps(), bb = _mm_setzero_ps();
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128 w = _mm_loadu_ps(block.weight + i);
+		__m128 r = _mm_sub_ps(_mm_loadu_ps(block.r + i), meanR);
+		__m128 g = _mm_sub_ps(_mm_loadu_ps(block.g + i), meanG);
+		__m128 b = _mm_sub_ps(_mm_loadu_ps(block.b + i), meanB);
+		__m128 wr = _mm_mul_ps(w, r), wg = _mm_mul_ps(w, g);
+		rr = _mm_add_ps(rr, _mm_mul_ps(wr, r));
+		rg = _mm_add_ps(rg, _mm_mul_ps(wr, g));
+		rb = _mm_add_ps(rb, _mm_mul_ps(wr, b));
+		gg = _mm_add_ps(gg, _mm_mul_ps(wg, g));
+		gb = _mm_add_ps(gb, _mm_mul_ps(wg, b));
+		bb = _mm_add_ps(bb, _mm_mul_ps(_mm_mul_ps(w, b), b));
+	}
+	float covariance[3][3];
+	covariance[0][0] = horizontalSum(rr);
+	covariance[0][1] = covariance[1][0] = horizontalSum(rg);
+	covariance[0][2] = covariance[2][0] = horizontalSum(rb);
+	covariance[1][1] = horizontalSum(gg);
+	covariance[1][2] = covariance[2][1] = horizontalSum(gb);
+	covariance[2][2] = horizontalSum(bb);
+
+	// Power iteration from the row of the largest variance
+	int largest = covariance[0][0] >= covariance[1][1] && covariance[0][0] >= covariance[2][2] ? 0 : covariance[1][1] >= covariance[2][2] ? 1 : 2;
+	float axis[3] = { covariance[largest][0], covariance[largest][1], covariance[largest][2] };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[3];
+		for (int c = 0; c < 3; c++)
+			next[c] = covariance[c][0] * axis[0] + covariance[c][1] * axis[1] + covariance[c][2] * axis[2];
+		float scale = std::max(std::max(std::fabs(next[0]), std::fabs(next[1])), std::fabs(next[2]));
+		if (scale < 1e-6f)
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / scale;
+	}
+
+	float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	if (length < 1e-6f)
+	{
+		// A single color
+		for (int c = 0; c < 3; c++)
+			low[c] = high[c] = mean[c];
+		return;
+	}
+
+	__m128 axisR = _mm_set1_ps(axis[0] / length), axisG = _mm_set1_ps(axis[1] / length), axisB = _mm_set1_ps(axis[2] / length);
+	float projections[16];
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128 t = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(block.r + i), meanR), axisR);
+		t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(block.g + i), meanG), axisG));
+		t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(block.b + i), meanB), axisB));
+		_mm_storeu_ps(projections + i, t);
+	}
+
+	float minimum, maximum;
+	minMax16(projections, minimum, maximum);
+	for (int c = 0; c < 3; c++)
+	{
+		low[c] = std::min(std::max(mean[c] + axis[c] / length * minimum, 0.0f), 255.0f);
+		high[c] = std::min(std::max(mean[c] + axis[c] / length * maximum, 0.0f), 255.0f);
+	}
+}
+
+static glm::uint16 pack565(const float * rgb)
+{
+	// Blue lands in the low bits, as BC1 stores it
+	return glm::packUnorm1x5_1x6_1x5(glm::vec3(rgb[2], rgb[1], rgb[0]) / 255.0f);
+}
+
+static void unpack565(glm::uint16 color, int * rgb)
+{
+	int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Palette as decoders build it: 4 colors when color0 > color1, otherwise 3
+// colors and transparent black. Returns the number of colors.
+static int bc1Palette(glm::uint16 color0, glm::uint16 color1, int palette[4][3])
+{
+	unpack565(color0, palette[0]);
+	unpack565(color1, palette[1]);
+	for (int c = 0; c < 3; c++)
+	{
+		if (color0 > color1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	return color0 > color1 ? 4 : 3;
+}
+
+// Nearest of the first count palette colors for every opaque pixel, index 3
+// for transparent ones. Returns the squared error.
+static float selectColorIndices(const ColorBlock & block, const int palette[4][3], int count, unsigned int * indices)
+{
+	float errors[16];
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128 r = _mm_loadu_ps(block.r + i), g = _mm_loadu_ps(block.g + i), b = _mm_loadu_ps(block.b + i);
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (int p = 0; p < count; p++)
+		{
+			__m128 dr = _mm_sub_ps(r, _mm_set1_ps((float)palette[p][0]));
+			__m128 dg = _mm_sub_ps(g, _mm_set1_ps((float)palette[p][1]));
+			__m128 db = _mm_sub_ps(b, _mm_set1_ps((float)palette[p][2]));
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+			best = _mm_min_ps(best, distance);
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+		}
+		_mm_storeu_ps(errors + i, _mm_mul_ps(best, _mm_loadu_ps(block.weight + i)));
+		_mm_storeu_si128((__m128i *)(indices + i), bestIndex);
+	}
+
+	float error = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		error += errors[i];
+		if (block.weight[i] == 0.0f)
+			indices[i] = 3;
+	}
+	return error;
+}
+
+// Quantizes the endpoints in the order the block's mode needs and picks the
+// indices. Returns the squared error.
+static float encodeColorEndpoints(const ColorBlock & block, const float * low, const float * high, glm::uint16 & color0, glm::uint16 & color1, unsigned int * indices)
+{
+	glm::uint16 a = pack565(high), b = pack565(low);
+	color0 = block.anyTransparent ? std::min(a, b) : std::max(a, b);
+	color1 = block.anyTransparent ? std::max(a, b) : std::min(a, b);
+
+	int palette[4][3];
+	int count = bc1Palette(color0, color1, palette);
+	return selectColorIndices(block, palette, count, indices);
+}
+
+// Endpoints minimizing the squared error for the given indices
+static bool leastSquaresEndpoints(const ColorBlock & block, glm::uint16 color0, glm::uint16 color1, const unsigned int * indices, float * low, float * high)
+{
+	const float FOUR_COLOR_WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	const float THREE_COLOR_WEIGHTS[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+	const float * weights = color0 > color1 ? FOUR_COLOR_WEIGHTS : THREE_COLOR_WEIGHTS;
+	const float * channels[3] = { block.r, block.g, block.b };
+
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		if (block.weight[i] == 0.0f)
+			continue;
+		float a = weights[indices[i]], b = 1.0f - a;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (int c = 0; c < 3; c++)
+		{
+			ax[c] += a * channels[c][i];
+			bx[c] += b * channels[c][i];
+		}
+	}
+
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f)
+		return false;
+
+	for (int c = 0; c < 3; c++)
+	{
+		high[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+		low[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+static void writeUint16(unsigned char * block, glm::uint16 value)
+{
+	block[0] = (unsigned char)value;
+	block[1] = (unsigned char)(value >> 8);
+}
+
+void encodeBlockBC1(const unsigned char * rgba, BlockQuality quality, unsigned char * block)
+{
+	ColorBlock colors;
+	loadColorBlock(rgba, colors);
+
+	glm::uint16 color0 = 0, color1 = 0;
+	unsigned int indices[16];
+	if (colors.allTransparent)
+	{
+		std::fill(indices, indices + 16, 3u);
+	}
+	else
+	{
+		float low[3], high[3];
+		if (quality == BLOCK_QUALITY_FAST)
+			boundingBoxEndpoints(colors, low, high);
+		else
+			principalAxisEndpoints(colors, low, high);
+		float error = encodeColorEndpoints(colors, low, high, color0, color1, indices);
+
+		if (quality == BLOCK_QUALITY_HIGH)
+		{
+			glm::uint16 candidate0, candidate1;
+			unsigned int candidateIndices[16];
+			boundingBoxEndpoints(colors, low, high);
+			float candidateError = encodeColorEndpoints(colors, low, high, candidate0, candidate1, candidateIndices);
+
+			// Then least squares fits while they keep improving
+			for (int iteration = 0; ; iteration++)
+			{
+				if (candidateError < error)
+				{
+					error = candidateError;
+					color0 = candidate0;
+					color1 = candidate1;
+					std::copy(candidateIndices, candidateIndices + 16, indices);
+				}
+				else if (iteration > 0)
+					break;
+
+				if (iteration == 3 || !leastSquaresEndpoints(colors, color0, color1, indices, low, high))
+					break;
+				candidateError = encodeColorEndpoints(colors, low, high, candidate0, candidate1, candidateIndices);
+			}
+		}
+	}
+
+	unsigned int packed = 0;
+	for (int i = 0; i < 16; i++)
+		packed |= indices[i] << (2 * i);
+	writeUint16(block, color0);
+	writeUint16(block + 2, color1);
+	for (int i = 0; i < 4; i++)
+		block[4 + i] = (unsigned char)(packed >> (8 * i));
+}
+
+void decodeBlockBC1(const unsigned char * block, unsigned char * rgba)
+{
+	glm::uint16 color0 = (glm::uint16)(block[0] | (block[1] << 8)), color1 = (glm::uint16)(block[2] | (block[3] << 8));
+	unsigned int packed = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+
+	int palette[4][3];
+	int count = bc1Palette(color0, color1, palette);
+	for (int i = 0; i < 16; i++)
+	{
+		unsigned int index = (packed >> (2 * i)) & 3;
+		for (int c = 0; c < 3; c++)
+			rgba[i * 4 + c] = (unsigned char)palette[index][c];
+		rgba[i * 4 + 3] = count == 3 && index == 3 ? 0 : 255;
+	}
+}
+
+// 8 values interpolated when endpoint0 > endpoint1, otherwise 6 and the
+// exact 0 and 255
+static void bc4Palette(int endpoint0, int endpoint1, int palette[8])
+{
+	palette[0] = endpoint0;
+	palette[1] = endpoint1;
+	if (endpoint0 > endpoint1)
+	{
+		for (int i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * endpoint0 + i * endpoint1) / 7;
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+			palette[i + 1] = ((5 - i) * endpoint0 + i * endpoint1) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+static float encodeValueEndpoints(const float * values, int endpoint0, int endpoint1, unsigned int * indices)
+{
+	int palette[8];
+	bc4Palette(endpoint0, endpoint1, palette);
+
+	__m128 error = _mm_setzero_ps();
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128 v = _mm_loadu_ps(values + i);
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (int p = 0; p < 8; p++)
+		{
+			__m128 difference = _mm_sub_ps(v, _mm_set1_ps((float)palette[p]));
+			__m128 distance = _mm_mul_ps(difference, difference);
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+			best = _mm_min_ps(best, distance);
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+		}
+		error = _mm_add_ps(error, best);
+		_mm_storeu_si128((__m128i *)(indices + i), bestIndex);
+	}
+	return horizontalSum(error);
+}
+
+void encodeBlockBC4(const unsigned char * values, unsigned int stride, BlockQuality quality, unsigned char * block)
+{
+	float v[16];
+	float inner[2] = { 255.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		v[i] = values[i * stride];
+		if (v[i] > 0.0f && v[i] < 255.0f)
+		{
+			inner[0] = std::min(inner[0], v[i]);
+			inner[1] = std::max(inner[1], v[i]);
+		}
+	}
+
+	float minimum, maximum;
+	minMax16(v, minimum, maximum);
+
+	int endpoints[2] = { (int)maximum, (int)minimum };
+	unsigned int indices[16];
+	float error = encodeValueEndpoints(v, endpoints[0], endpoints[1], indices);
+
+	// 6 value mode over the values between the exact 0 and 255
+	if (quality != BLOCK_QUALITY_FAST && error > 0.0f)
+	{
+		int candidate[2] = { inner[0] <= inner[1] ? (int)inner[0] : 0, inner[0] <= inner[1] ? (int)inner[1] : 0 };
+		unsigned int candidateIndices[16];
+		float candidateError = encodeValueEndpoints(v, candidate[0], candidate[1], candidateIndices);
+		if (candidateError < error)
+		{
+			error = candidateError;
+			endpoints[0] = candidate[0];
+			endpoints[1] = candidate[1];
+			std::copy(candidateIndices, candidateIndices + 16, indices);
+		}
+	}
+
+	// Nearby endpoints in the same mode, which often round better
+	if (quality == BLOCK_QUALITY_HIGH && error > 0.0f)
+	{
+		const int RADIUS = 3;
+		bool eightValues = endpoints[0] > endpoints[1];
+		int centre[2] = { endpoints[0], endpoints[1] };
+		for (int d0 = -RADIUS; d0 <= RADIUS; d0++)
+		{
+			for (int d1 = -RADIUS; d1 <= RADIUS; d1++)
+			{
+				int candidate[2] = { std::min(std::max(centre[0] + d0, 0), 255), std::min(std::max(centre[1] + d1, 0), 255) };
+				if ((candidate[0] > candidate[1]) != eightValues)
+					continue;
+
+				unsigned int candidateIndices[16];
+				float candidateError = encodeValueEndpoints(v, candidate[0], candidate[1], candidateIndices);
+				if (candidateError < error)
+				{
+					error = candidateError;
+					endpoints[0] = candidate[0];
+					endpoints[1] = candidate[1];
+					std::copy(candidateIndices, candidateIndices + 16, indices);
+				}
+			}
+		}
+	}
+
+	block[0] = (unsigned char)endpoints[0];
+	block[1] = (unsigned char)endpoints[1];
+	unsigned long long packed = 0;
+	for (int i = 0; i < 16; i++)
+		packed |= (unsigned long long)indices[i] << (3 * i);
+	for (int i = 0; i < 6; i++)
+		block[2 + i] = (unsigned char)(packed >> (8 * i));
+}
+
+void decodeBlockBC4(const unsigned char * block, unsigned char * values, unsigned int stride)
+{
+	int palette[8];
+	bc4Palette(block[0], block[1], palette);
+
+	unsigned long long packed = 0;
+	for (int i = 0; i < 6; i++)
+		packed |= (unsigned long long)block[2 + i] << (8 * i);
+	for (int i = 0; i < 16; i++)
+		values[i * stride] = (unsigned char)palette[(packed >> (3 * i)) & 7];
+}
+
+static bool isEncodableFormat(TextureFormat format)
+{
+	return format == TEXTURE_BC1 || format == TEXTURE_BC4 || format == TEXTURE_BC5;
+}
+
+bool compressTexture(const TextureData & source, TextureFormat format, BlockQuality quality, TextureData & result)
+{
+	if (source.format != TEXTURE_RGBA8 || !isEncodableFormat(format))
+	{
+		printf("Block compression needs an RGBA8 texture and BC1, BC4 or BC5 as the target\n");
+		return false;
+	}
+
+	result.format = format;
+	result.levels.resize(source.levels.size());
+	unsigned int unitBytes = formatUnitBytes(format);
+	for (size_t l = 0; l < source.levels.size(); l++)
+	{
+		const TextureLevel & level = source.levels[l];
+		TextureLevel & compressed = result.levels[l];
+		compressed.width = level.width;
+		compressed.height = level.height;
+		compressed.data.resize(levelBytes(format, level.width, level.height));
+
+		unsigned int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+		ThreadPool::instance().parallelFor(blocksY, 1, [&](size_t begin, size_t end)
+		{
+			unsigned char pixels[64];
+			for (size_t by = begin; by < end; by++)
+			{
+				for (unsigned int bx = 0; bx < blocksX; bx++)
+				{
+					// Edge blocks repeat the last row and column
+					for (unsigned int y = 0; y < 4; y++)
+					{
+						unsigned int sourceY = std::min((unsigned int)by * 4 + y, level.height - 1);
+						for (unsigned int x = 0; x < 4; x++)
+						{
+							unsigned int sourceX = std::min(bx * 4 + x, level.width - 1);
+							memcpy(pixels + (y * 4 + x) * 4, &level.data[((size_t)sourceY * level.width + sourceX) * 4], 4);
+						}
+					}
+
+					unsigned char * block = &compressed.data[(by * blocksX + bx) * unitBytes];
+					if (format == TEXTURE_BC1)
+						encodeBlockBC1(pixels, quality, block);
+					else
+						encodeBlockBC4(pixels, 4, quality, block);
+					if (format == TEXTURE_BC5)
+						encodeBlockBC4(pixels + 1, 4, quality, block + 8);
+				}
+			}
+		});
+	}
+	return true;
+}
+
+bool decompressTexture(const TextureData & source, TextureData & result)
+{
+	if (!isEncodableFormat(source.format))
+	{
+		printf("Only BC1, BC4 and BC5 textures can be decompressed\n");
+		return false;
+	}
+
+	result.format = TEXTURE_RGBA8;
+	result.levels.resize(source.levels.size());
+	unsigned int unitBytes = formatUnitBytes(source.format);
+	for (size_t l = 0; l < source.levels.size(); l++)
+	{
+		const TextureLevel & level = source.levels[l];
+		TextureLevel & decompressed = result.levels[l];
+		decompressed.width = level.width;
+		decompressed.height = level.height;
+		decompressed.data.resize((size_t)level.width * level.height * 4);
+
+		unsigned int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+		for (unsigned int by = 0; by < blocksY; by++)
+		{
+			for (unsigned int bx = 0; bx < blocksX; bx++)
+			{
+				unsigned char pixels[64] = {};
+				const unsigned char * block = &level.data[((size_t)by * blocksX + bx) * unitBytes];
+				if (source.format == TEXTURE_BC1)
+					decodeBlockBC1(block, pixels);
+				else
+				{
+					decodeBlockBC4(block, pixels, 4);
+					if (source.format == TEXTURE_BC5)
+						decodeBlockBC4(block + 8, pixels + 1, 4);
+					for (int i = 0; i < 16; i++)
+						pixels[i * 4 + 3] = 255;
+				}
+
+				for (unsigned int y = 0; y < 4 && by * 4 + y < level.height; y++)
+					for (unsigned int x = 0; x < 4 && bx * 4 + x < level.width; x++)
+						memcpy(&decompressed.data[((size_t)(by * 4 + y) * level.width + bx * 4 + x) * 4], pixels + (y * 4 + x) * 4, 4);
+			}
+		}
+	}
+	return true;
+}
+
+double computePsnr(const TextureData & reference, const TextureData & compressed)
+{
+	TextureData decompressed;
+	if (reference.format != TEXTURE_RGBA8 || reference.levels.size() != compressed.levels.size() || !decompressTexture(compressed, decompressed))
+		return 0.0;
+
+	unsigned int channels = compressed.format == TEXTURE_BC1 ? 3 : compressed.format == TEXTURE_BC5 ? 2 : 1;
+	double squaredError = 0.0, samples = 0.0;
+	for (size_t l = 0; l < reference.levels.size(); l++)
+	{
+		const std::vector<unsigned char> & a = reference.levels[l].data, & b = decompressed.levels[l].data;
+		if (a.size() != b.size())
+			return 0.0;
+
+		for (size_t i = 0; i < a.size(); i += 4)
+		{
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				double difference = (double)a[i + c] - b[i + c];
+				squaredError += difference * difference;
+			}
+		}
+		samples += (double)a.size() / 4 * channels;
+	}
+
+	if (squaredError == 0.0)
+		return std::numeric_limits<double>::infinity();
+	return 10.0 * std::log10(255.0 * 255.0 * samples / squaredError);
+}
+
+bool convertTexture(const char * inputFileName, const char * outputFileName, TextureFormat format, BlockQuality quality)
+{
+	TextureData source, compressed;
+	if (!loadTextureData(inputFileName, MIP_FILTER_KAISER, source))
+		return false;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!compressTexture(source, format, quality, compressed))
+		return false;
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	if (!writeDds(outputFileName, compressed))
+		return false;
+
+	printf("Converted %s to %s: %ux%u, %u levels in %.1f ms, PSNR %.2f dB\n", inputFileName, outputFileName,
+		source.levels[0].width, source.levels[0].height, (unsigned int)source.levels.size(), seconds * 1e3, computePsnr(source, compressed));
+	return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "TextureData.h"
+
+// Endpoint search effort of the block encoders
+enum BlockQuality
+{
+	BLOCK_QUALITY_FAST,   // bounding box endpoints
+	BLOCK_QUALITY_NORMAL, // principal axis endpoints, both BC4 modes
+	BLOCK_QUALITY_HIGH    // NORMAL refined by least squares and a local search
+};
+
+// One 4x4 block, pixels row by row. BC1 reads RGBA pixels and switches to
+// its 3 color mode for blocks with alpha below 128; BC4 reads one byte every
+// stride bytes, so it can encode a single channel of RGBA pixels.
+void encodeBlockBC1(const unsigned char * rgba, BlockQuality quality, unsigned char * block);
+void encodeBlockBC4(const unsigned char * values, unsigned int stride, BlockQuality quality, unsigned char * block);
+void decodeBlockBC1(const unsigned char * block, unsigned char * rgba);
+void decodeBlockBC4(const unsigned char * block, unsigned char * values, unsigned int stride);
+
+// Encodes every level of an RGBA8 texture as BC1, BC4 (red) or BC5 (red and
+// green), block rows spread over the thread pool
+bool compressTexture(const TextureData & source, TextureFormat format, BlockQuality quality, TextureData & result);
+
+// RGBA8 copy of a BC1, BC4 or BC5 texture, missing channels 0 and alpha 255
+bool decompressTexture(const TextureData & source, TextureData & result);
+
+// Peak signal to noise ratio in dB over all levels and the channels the
+// compressed format stores, infinite for a lossless result
+double computePsnr(const TextureData & reference, const TextureData & compressed);
+
+// Compresses a .tga or .dds file to a .dds file and reports the PSNR
+bool convertTexture(const char * inputFileName, const char * outputFileName, TextureFormat format, BlockQuality quality);
@@ -0,0 +1,201 @@
+#include "CascadedShadowMaps.h"
+#include <cstdio>
+#include <string>
+#include <matrix_transform.hpp>
+
+// glPolygonOffset of the depth passes, against shadow acne
+const float SLOPE_BIAS = 2.0f, CONSTANT_BIAS = 4.0f;
+
+static void attachLayer(GLuint framebuffer, GLuint texture, unsigned int layer)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+}
+
+CascadedShadowMaps::CascadedShadowMaps()
+{
+	depthProgram = nullptr;
+	shadowTexture = 0;
+	staticTexture = 0;
+	shadowFramebuffer = 0;
+	staticFramebuffer = 0;
+	staticValid = false;
+	staticPasses = 0;
+	dynamicPasses = 0;
+}
+
+CascadedShadowMaps::~CascadedShadowMaps()
+{
+	GLuint framebuffers[] = { shadowFramebuffer, staticFramebuffer };
+	glDeleteFramebuffers(2, framebuffers);
+	GLuint textures[] = { shadowTexture, staticTexture };
+	glDeleteTextures(2, textures);
+	delete depthProgram;
+}
+
+bool CascadedShadowMaps::create(unsigned int cascadeCount, unsigned int resolution, float splitBlend, float casterDistance)
+{
+	if (!cascades.create(cascadeCount, resolution, splitBlend, casterDistance))
+		return false;
+
+	// Position and matrices only, the depth is all that is written
+	depthProgram = new GLSLProgram();
+	if (!depthProgram->compileShaderFromFile("shadow.vs", GL_VERTEX_SHADER) || !depthProgram->link())
+	{
+		printf("Shadow shader failed to build!\n%s", depthProgram->log().c_str());
+		return false;
+	}
+
+	GLuint * textures[] = { &shadowTexture, &staticTexture };
+	GLuint * framebuffers[] = { &shadowFramebuffer, &staticFramebuffer };
+	for (int i = 0; i < 2; i++)
+	{
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, *textures[i]);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		if (*textures[i] == shadowTexture)
+		{
+			// Depth comparison with bilinear filtering of the results
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		}
+		else
+		{
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+
+		glGenFramebuffers(1, framebuffers[i]);
+		attachLayer(*framebuffers[i], *textures[i], 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			printf("Shadow map framebuffer is incomplete\n");
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			return false;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	hadDynamic.assign(cascadeCount, false);
+	staticValid = false;
+	return true;
+}
+
+void CascadedShadowMaps::update(const glm::mat4 & view, const glm::mat4 & projection, float nearDepth, float farDepth, const glm::vec3 & lightDirection)
+{
+	cascades.update(view, projection, nearDepth, farDepth, lightDirection);
+	inverseView = glm::inverse(view);
+	lightToView = -glm::normalize(glm::mat3(view) * lightDirection);
+}
+
+void CascadedShadowMaps::invalidateStatic()
+{
+	staticValid = false;
+}
+
+void CascadedShadowMaps::render(const ShadowCasterCallback & drawCasters, unsigned int dynamicCascades)
+{
+	GLint drawFramebuffer, readFramebuffer, viewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+	GLsizei resolution = cascades.getResolution();
+	glViewport(0, 0, resolution, resolution);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_DEPTH_CLAMP);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(SLOPE_BIAS, CONSTANT_BIAS);
+	depthProgram->use();
+
+	staticPasses = 0;
+	dynamicPasses = 0;
+	for (unsigned int i = 0; i < cascades.getCascadeCount(); i++)
+	{
+		bool dynamicInside = (dynamicCascades >> i & 1) != 0;
+		bool staticStale = !staticValid || cascades.hasChanged(i);
+		depthProgram->setUniform("light_view_projection", cascades.getCascade(i).viewProjection);
+
+		if (staticStale)
+		{
+			attachLayer(staticFramebuffer, staticTexture, i);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			drawCasters(i, true);
+			staticPasses++;
+		}
+
+		// Dynamic casters gone since the last frame still have to be erased
+		if (staticStale || dynamicInside || hadDynamic[i])
+		{
+			attachLayer(staticFramebuffer, staticTexture, i);
+			attachLayer(shadowFramebuffer, shadowTexture, i);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFramebuffer);
+			glBlitFramebuffer(0, 0, resolution, resolution, 0, 0, resolution, resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			if (dynamicInside)
+			{
+				drawCasters(i, false);
+				dynamicPasses++;
+			}
+		}
+		hadDynamic[i] = dynamicInside;
+	}
+	staticValid = true;
+
+	glUseProgram(0);
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glDisable(GL_DEPTH_CLAMP);
+	if (!depthTest)
+		glDisable(GL_DEPTH_TEST);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void CascadedShadowMaps::setModelMatrix(const glm::mat4 & model)
+{
+	depthProgram->setUniform("model_matrix", model);
+}
+
+void CascadedShadowMaps::bind(GLSLProgram * program, GLuint unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, shadowTexture);
+	glActiveTexture(GL_TEXTURE0);
+	program->setUniform("shadow_maps", (int)unit);
+
+	// From view space, where shadowed.fs has its positions, to shadow map
+	// texture coordinates and depth
+	glm::mat4 textureSpace = glm::scale(glm::translate(glm::mat4(), glm::vec3(0.5f)), glm::vec3(0.5f));
+	glm::vec4 splits(cascades.getCascade(cascades.getCascadeCount() - 1).splitFar);
+	for (unsigned int i = 0; i < cascades.getCascadeCount(); i++)
+	{
+		std::string name = "shadow_matrices[" + std::to_string(i) + "]";
+		program->setUniform(name.c_str(), textureSpace * cascades.getCascade(i).viewProjection * inverseView);
+		splits[i] = cascades.getCascade(i).splitFar;
+	}
+	program->setUniform("cascade_splits", splits);
+	program->setUniform("light_direction", lightToView);
+}
+
+const ShadowCascades & CascadedShadowMaps::getCascades() const
+{
+	return cascades;
+}
+
+unsigned int CascadedShadowMaps::getStaticPasses() const
+{
+	return staticPasses;
+}
+
+unsigned int CascadedShadowMaps::getDynamicPasses() const
+{
+	return dynamicPasses;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <glew.h>
+#include "ShadowCascades.h"
+#include "GLSLProgram.h"
+
+// Draws the static or the dynamic shadow casters of a cascade, setting each
+// one's matrix with setModelMatrix()
+typedef std::function<void(unsigned int cascade, bool staticCasters)> ShadowCasterCallback;
+
+// Cascaded shadow maps in a depth texture array, one layer per cascade,
+// rendered depth only with shadow.vs and no fragment shader. Casters in
+// front of a cascade are clamped onto its near plane.
+//
+// Static casters are rendered into a second array that is kept between
+// frames and only redrawn when the cascade moves (see ShadowCascades) or
+// invalidateStatic() is called. A cascade's shadow map is the cached depth
+// with the dynamic casters drawn over it, and is left alone while neither
+// the cache nor the dynamic casters in it changed.
+class CascadedShadowMaps
+{
+private:
+	ShadowCascades cascades;
+	GLSLProgram * depthProgram;
+	GLuint shadowTexture;
+	GLuint staticTexture;
+	GLuint shadowFramebuffer;
+	GLuint staticFramebuffer;
+	bool staticValid;
+	std::vector<bool> hadDynamic;
+	unsigned int staticPasses;
+	unsigned int dynamicPasses;
+	glm::mat4 inverseView;
+	glm::vec3 lightToView; // view space direction towards the light
+public:
+	CascadedShadowMaps();
+	~CascadedShadowMaps();
+	bool create(unsigned int cascadeCount, unsigned int resolution, float splitBlend, float casterDistance);
+
+	void update(const glm::mat4 & view, const glm::mat4 & projection, float nearDepth, float farDepth, const glm::vec3 & lightDirection);
+
+	// Static casters changed, every cache is redrawn by the next render()
+	void invalidateStatic();
+
+	// Bit i of dynamicCascades is set when dynamic casters overlap cascade i.
+	// Restores the framebuffer and viewport, and leaves no program in use.
+	void render(const ShadowCasterCallback & drawCasters, unsigned int dynamicCascades);
+	void setModelMatrix(const glm::mat4 & model);
+
+	// Binds the shadow maps to the texture unit and sets the uniforms of
+	// shadowed.fs on the program in use
+	void bind(GLSLProgram * program, GLuint unit);
+
+	const ShadowCascades & getCascades() const;
+
+	// Cascades redrawn by the last render()
+	unsigned int getStaticPasses() const;
+	unsigned int getDynamicPasses() const;
+};
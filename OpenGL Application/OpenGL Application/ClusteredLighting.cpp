@@ -0,0 +1,88 @@
+#include "ClusteredLighting.h"
+#include <algorithm>
+
+ClusteredLighting::ClusteredLighting()
+{
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		buffers[i] = 0;
+		textures[i] = 0;
+	}
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+	if (buffers[0])
+	{
+		glDeleteTextures(BUFFER_COUNT, textures);
+		glDeleteBuffers(BUFFER_COUNT, buffers);
+	}
+}
+
+bool ClusteredLighting::create(unsigned int tilesX, unsigned int tilesY, unsigned int slices, float nearDepth, float farDepth)
+{
+	if (!clusters.create(tilesX, tilesY, slices, nearDepth, farDepth))
+		return false;
+
+	const GLenum FORMATS[BUFFER_COUNT] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	glGenBuffers(BUFFER_COUNT, buffers);
+	glGenTextures(BUFFER_COUNT, textures);
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		upload((BufferIndex)i, nullptr, 0);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, FORMATS[i], buffers[i]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	return true;
+}
+
+// Orphans the previous contents so the driver need not wait for frames
+// still reading them
+void ClusteredLighting::upload(BufferIndex index, const void * data, size_t bytes)
+{
+	const size_t MIN_BYTES = 16;
+	glBindBuffer(GL_TEXTURE_BUFFER, buffers[index]);
+	glBufferData(GL_TEXTURE_BUFFER, std::max(bytes, MIN_BYTES), nullptr, GL_STREAM_DRAW);
+	if (bytes > 0)
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::update(const PointLight * lights, unsigned int count, const glm::mat4 & view, const glm::mat4 & projection)
+{
+	clusters.build(lights, count, view, projection);
+
+	const std::vector<glm::vec4> & viewLights = clusters.getViewLights();
+	lightData.resize(count * 2);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		lightData[i * 2] = viewLights[i];
+		lightData[i * 2 + 1] = glm::vec4(lights[i].color * lights[i].intensity, 0.0f);
+	}
+
+	upload(LIGHT_DATA, lightData.data(), lightData.size() * sizeof(glm::vec4));
+	upload(CLUSTER_DATA, clusters.getClusters().data(), clusters.getClusters().size() * sizeof(unsigned int));
+	upload(LIGHT_INDICES, clusters.getLightIndices().data(), clusters.getLightIndices().size() * sizeof(unsigned int));
+}
+
+void ClusteredLighting::bind(GLSLProgram * program, GLuint firstUnit, unsigned int viewportWidth, unsigned int viewportHeight)
+{
+	const char * SAMPLERS[BUFFER_COUNT] = { "light_data", "cluster_data", "light_indices" };
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		program->setUniform(SAMPLERS[i], (int)(firstUnit + i));
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	program->setUniform("cluster_count", glm::vec3((float)clusters.getTilesX(), (float)clusters.getTilesY(), (float)clusters.getSlices()));
+	program->setUniform("cluster_scale", glm::vec3((float)clusters.getTilesX() / viewportWidth, (float)clusters.getTilesY() / viewportHeight, clusters.getSliceScale()));
+	program->setUniform("cluster_bias", clusters.getSliceBias());
+}
+
+const LightClusters & ClusteredLighting::getClusters() const
+{
+	return clusters;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <glew.h>
+#include "LightClusters.h"
+#include "GLSLProgram.h"
+
+// Clustered forward lighting. update() bins the lights on the CPU (see
+// LightClusters) and uploads the view space lights, the per cluster ranges
+// and the packed light index list into texture buffers, which clustered.fs
+// reads to shade each fragment with only the lights of its cluster.
+class ClusteredLighting
+{
+private:
+	enum BufferIndex
+	{
+		LIGHT_DATA,     // RGBA32F, view space position and radius then color times intensity
+		CLUSTER_DATA,   // RG32UI, first index and count
+		LIGHT_INDICES,  // R32UI
+		BUFFER_COUNT
+	};
+
+	LightClusters clusters;
+	GLuint buffers[BUFFER_COUNT];
+	GLuint textures[BUFFER_COUNT];
+	std::vector<glm::vec4> lightData;
+
+	void upload(BufferIndex index, const void * data, size_t bytes);
+public:
+	ClusteredLighting();
+	~ClusteredLighting();
+	bool create(unsigned int tilesX, unsigned int tilesY, unsigned int slices, float nearDepth, float farDepth);
+
+	void update(const PointLight * lights, unsigned int count, const glm::mat4 & view, const glm::mat4 & projection);
+
+	// Binds the buffers to three texture units from firstUnit and sets the
+	// uniforms of clustered.fs on the program in use
+	void bind(GLSLProgram * program, GLuint firstUnit, unsigned int viewportWidth, unsigned int viewportHeight);
+
+	const LightClusters & getClusters() const;
+};
@@ -0,0 +1,116 @@
+#include "ColorLut.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+const unsigned int MAX_LUT_SIZE = 256;
+
+void makeIdentityLut(unsigned int size, ColorLut & lut)
+{
+	lut.size = size;
+	lut.colors.resize((size_t)size * size * size);
+	for (unsigned int b = 0; b < size; b++)
+		for (unsigned int g = 0; g < size; g++)
+			for (unsigned int r = 0; r < size; r++)
+				lut.colors[((size_t)b * size + g) * size + r] = glm::vec3((float)r, (float)g, (float)b) / (float)(size - 1);
+}
+
+bool parseCubeLut(const char * text, size_t length, ColorLut & lut)
+{
+	std::string line;
+	const char * end = text + length;
+	lut.size = 0;
+	lut.colors.clear();
+	for (const char * p = text; p < end;)
+	{
+		const char * lineEnd = p;
+		while (lineEnd < end && *lineEnd != '\n')
+			lineEnd++;
+		line.assign(p, lineEnd);
+		p = lineEnd + 1;
+
+		const char * c = line.c_str();
+		while (*c == ' ' || *c == '\t')
+			c++;
+		if (*c == '\0' || *c == '\r' || *c == '#' || strncmp(c, "TITLE", 5) == 0)
+			continue;
+
+		if (strncmp(c, "LUT_3D_SIZE", 11) == 0)
+		{
+			lut.size = (unsigned int)strtoul(c + 11, nullptr, 10);
+			if (lut.size < 2 || lut.size > MAX_LUT_SIZE)
+			{
+				printf("Unsupported .cube size %u\n", lut.size);
+				return false;
+			}
+			lut.colors.reserve((size_t)lut.size * lut.size * lut.size);
+			continue;
+		}
+		if (strncmp(c, "DOMAIN_MIN", 10) == 0 || strncmp(c, "DOMAIN_MAX", 10) == 0)
+		{
+			float expected = c[8] == 'A' ? 1.0f : 0.0f, values[3];
+			if (sscanf(c + 10, "%f %f %f", &values[0], &values[1], &values[2]) != 3 || values[0] != expected || values[1] != expected || values[2] != expected)
+			{
+				printf("Unsupported .cube domain\n");
+				return false;
+			}
+			continue;
+		}
+		if (strncmp(c, "LUT_1D_SIZE", 11) == 0)
+		{
+			printf("1D .cube tables are not supported\n");
+			return false;
+		}
+
+		glm::vec3 color;
+		if (sscanf(c, "%f %f %f", &color.r, &color.g, &color.b) != 3)
+		{
+			printf("Unexpected .cube line: %s\n", c);
+			return false;
+		}
+		lut.colors.push_back(color);
+	}
+
+	if (lut.size == 0 || lut.colors.size() != (size_t)lut.size * lut.size * lut.size)
+	{
+		printf(".cube table has %u entries for size %u\n", (unsigned int)lut.colors.size(), lut.size);
+		return false;
+	}
+	return true;
+}
+
+bool loadCubeLut(const char * fileName, ColorLut & lut)
+{
+	FILE * file = fopen(fileName, "rb");
+	if (!file)
+	{
+		printf("Could not open %s\n", fileName);
+		return false;
+	}
+
+	std::string text;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		text.append(buffer, read);
+	fclose(file);
+	return parseCubeLut(text.data(), text.size(), lut);
+}
+
+glm::vec3 sampleLut(const ColorLut & lut, const glm::vec3 & color)
+{
+	glm::vec3 position = glm::clamp(color, 0.0f, 1.0f) * (float)(lut.size - 1);
+	glm::uvec3 low = glm::min(glm::uvec3(position), glm::uvec3(lut.size - 2));
+	glm::vec3 t = position - glm::vec3(low);
+
+	glm::vec3 result(0.0f);
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::uvec3 offset(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+		glm::uvec3 index = low + offset;
+		glm::vec3 weights = glm::mix(1.0f - t, t, glm::vec3(offset));
+		result += lut.colors[((size_t)index.b * lut.size + index.g) * lut.size + index.r] * (weights.x * weights.y * weights.z);
+	}
+	return result;
+}
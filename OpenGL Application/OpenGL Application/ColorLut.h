@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <glm.hpp>
+
+// Colour grading lookup table: size^3 output colours for inputs on a
+// regular grid over [0, 1]^3, red varying fastest, then green, then blue
+struct ColorLut
+{
+	unsigned int size;
+	std::vector<glm::vec3> colors;
+
+	ColorLut()
+	{
+		size = 0;
+	}
+};
+
+void makeIdentityLut(unsigned int size, ColorLut & lut);
+
+// Adobe/Resolve .cube 3D tables. Domains other than [0, 1] are not supported.
+bool parseCubeLut(const char * text, size_t length, ColorLut & lut);
+bool loadCubeLut(const char * fileName, ColorLut & lut);
+
+// Trilinear lookup, as a 3D texture samples the table with the input
+// scaled onto the centres of the first and last texels
+glm::vec3 sampleLut(const ColorLut & lut, const glm::vec3 & color);
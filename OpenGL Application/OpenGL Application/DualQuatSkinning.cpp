@@ -0,0 +1,182 @@
+#include "DualQuatSkinning.h"
+#include <dual_quaternion.hpp>
+#include "Simd.h"
+#include "ThreadPool.h"
+
+void dualQuatsFromPose(const QuatArray & rotations, const glm::vec3 * translations, glm::mat2x4 * palette, size_t begin, size_t end)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 negHalf = _mm_set1_ps(-0.5f);
+
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 qx = _mm_loadu_ps(&rotations.x[i]);
+		__m128 qy = _mm_loadu_ps(&rotations.y[i]);
+		__m128 qz = _mm_loadu_ps(&rotations.z[i]);
+		__m128 qw = _mm_loadu_ps(&rotations.w[i]);
+
+		__m128 px = _mm_setzero_ps(), py = _mm_setzero_ps(), pz = _mm_setzero_ps();
+		if (translations)
+		{
+			const glm::vec3 * t = translations + i;
+			px = _mm_set_ps(t[3].x, t[2].x, t[1].x, t[0].x);
+			py = _mm_set_ps(t[3].y, t[2].y, t[1].y, t[0].y);
+			pz = _mm_set_ps(t[3].z, t[2].z, t[1].z, t[0].z);
+		}
+
+		// Same expressions as the tdualquat(quat, vec3) constructor
+		__m128 dw = _mm_mul_ps(negHalf, _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, qx), _mm_mul_ps(py, qy)), _mm_mul_ps(pz, qz)));
+		__m128 dx = _mm_mul_ps(half, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(px, qw), _mm_mul_ps(py, qz)), _mm_mul_ps(pz, qy)));
+		__m128 dy = _mm_mul_ps(half, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(py, qw), _mm_mul_ps(px, qz)), _mm_mul_ps(pz, qx)));
+		__m128 dz = _mm_mul_ps(half, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(px, qy), _mm_mul_ps(py, qx)), _mm_mul_ps(pz, qw)));
+
+		_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+		_MM_TRANSPOSE4_PS(dx, dy, dz, dw);
+		__m128 real[4] = { qx, qy, qz, qw };
+		__m128 dual[4] = { dx, dy, dz, dw };
+		for (int k = 0; k < 4; k++)
+		{
+			_mm_storeu_ps(&palette[i + k][0][0], real[k]);
+			_mm_storeu_ps(&palette[i + k][1][0], dual[k]);
+		}
+	}
+	for (; i < end; i++)
+		palette[i] = glm::mat2x4_cast(glm::dualquat(rotations.get(i), translations ? translations[i] : glm::vec3(0.0f)));
+}
+
+void dualQuatsFromMatrices(const glm::mat4 * joints, glm::mat2x4 * palette, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		palette[i] = glm::mat2x4_cast(glm::dualquat_cast(glm::mat3x4(glm::transpose(joints[i]))));
+}
+
+void skinVertex(const glm::mat2x4 * palette, const SkinnedVertex & vertex, glm::vec3 & position, glm::vec3 & normal)
+{
+	const glm::mat2x4 & first = palette[vertex.joints[0]];
+	glm::vec4 real = first[0] * vertex.weights[0];
+	glm::vec4 dual = first[1] * vertex.weights[0];
+
+	// Keep every joint in the hemisphere of the first so the blend takes the short way round
+	for (int k = 1; k < 4; k++)
+	{
+		const glm::mat2x4 & joint = palette[vertex.joints[k]];
+		float weight = glm::dot(first[0], joint[0]) < 0.0f ? -vertex.weights[k] : vertex.weights[k];
+		real += joint[0] * weight;
+		dual += joint[1] * weight;
+	}
+
+	float oneOverLength = 1.0f / glm::length(real);
+	real *= oneOverLength;
+	dual *= oneOverLength;
+
+	glm::vec3 r(real), d(dual);
+	glm::vec3 translation = 2.0f * (real.w * d - dual.w * r + glm::cross(r, d));
+	position = vertex.position + 2.0f * glm::cross(r, glm::cross(r, vertex.position) + real.w * vertex.position) + translation;
+	normal = vertex.normal + 2.0f * glm::cross(r, glm::cross(r, vertex.normal) + real.w * vertex.normal);
+}
+
+// glm::cross on four lanes. Vectors past the third are references, MSVC x86
+// passes at most three aligned vectors by value (C2719).
+static inline void cross4(__m128 ax, __m128 ay, __m128 az, const __m128 & bx, const __m128 & by, const __m128 & bz, __m128 & cx, __m128 & cy, __m128 & cz)
+{
+	cx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(by, az));
+	cy = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(bz, ax));
+	cz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(bx, ay));
+}
+
+// v + 2 * cross(r, cross(r, v) + rw * v), the rotation part of the transform
+static inline void rotate4(const __m128 & rx, const __m128 & ry, const __m128 & rz, const __m128 & rw, __m128 & vx, __m128 & vy, __m128 & vz)
+{
+	const __m128 two = _mm_set1_ps(2.0f);
+	__m128 cx, cy, cz, ux, uy, uz;
+	cross4(rx, ry, rz, vx, vy, vz, cx, cy, cz);
+	cx = _mm_add_ps(cx, _mm_mul_ps(rw, vx));
+	cy = _mm_add_ps(cy, _mm_mul_ps(rw, vy));
+	cz = _mm_add_ps(cz, _mm_mul_ps(rw, vz));
+	cross4(rx, ry, rz, cx, cy, cz, ux, uy, uz);
+	vx = _mm_add_ps(vx, _mm_mul_ps(two, ux));
+	vy = _mm_add_ps(vy, _mm_mul_ps(two, uy));
+	vz = _mm_add_ps(vz, _mm_mul_ps(two, uz));
+}
+
+static void skinVertices4(const glm::mat2x4 * palette, const SkinnedVertex * vertices, glm::vec3 * positions, glm::vec3 * normals)
+{
+	// Blend the dual quaternions of each vertex with one register per part,
+	// then transpose to one register per component for the transform
+	__m128 real[4], dual[4];
+	for (int lane = 0; lane < 4; lane++)
+	{
+		const SkinnedVertex & vertex = vertices[lane];
+		const glm::mat2x4 & first = palette[vertex.joints[0]];
+		__m128 weight = _mm_set1_ps(vertex.weights[0]);
+		real[lane] = _mm_mul_ps(_mm_loadu_ps(&first[0][0]), weight);
+		dual[lane] = _mm_mul_ps(_mm_loadu_ps(&first[1][0]), weight);
+
+		for (int k = 1; k < 4; k++)
+		{
+			const glm::mat2x4 & joint = palette[vertex.joints[k]];
+			weight = _mm_set1_ps(glm::dot(first[0], joint[0]) < 0.0f ? -vertex.weights[k] : vertex.weights[k]);
+			real[lane] = _mm_add_ps(real[lane], _mm_mul_ps(_mm_loadu_ps(&joint[0][0]), weight));
+			dual[lane] = _mm_add_ps(dual[lane], _mm_mul_ps(_mm_loadu_ps(&joint[1][0]), weight));
+		}
+	}
+	_MM_TRANSPOSE4_PS(real[0], real[1], real[2], real[3]);
+	_MM_TRANSPOSE4_PS(dual[0], dual[1], dual[2], dual[3]);
+
+	__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(real[0], real[0]), _mm_mul_ps(real[1], real[1])),
+		_mm_add_ps(_mm_mul_ps(real[2], real[2]), _mm_mul_ps(real[3], real[3]))));
+	__m128 oneOverLength = _mm_div_ps(_mm_set1_ps(1.0f), length);
+	for (int c = 0; c < 4; c++)
+	{
+		real[c] = _mm_mul_ps(real[c], oneOverLength);
+		dual[c] = _mm_mul_ps(dual[c], oneOverLength);
+	}
+
+	__m128 rx = real[0], ry = real[1], rz = real[2], rw = real[3];
+	__m128 dx = dual[0], dy = dual[1], dz = dual[2], dw = dual[3];
+
+	// translation = 2 * (rw * d - dw * r + cross(r, d))
+	const __m128 two = _mm_set1_ps(2.0f);
+	__m128 cx, cy, cz;
+	cross4(rx, ry, rz, dx, dy, dz, cx, cy, cz);
+	__m128 tx = _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, dx), _mm_mul_ps(dw, rx)), cx));
+	__m128 ty = _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, dy), _mm_mul_ps(dw, ry)), cy));
+	__m128 tz = _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rw, dz), _mm_mul_ps(dw, rz)), cz));
+
+	const SkinnedVertex * v = vertices;
+	__m128 px = _mm_set_ps(v[3].position.x, v[2].position.x, v[1].position.x, v[0].position.x);
+	__m128 py = _mm_set_ps(v[3].position.y, v[2].position.y, v[1].position.y, v[0].position.y);
+	__m128 pz = _mm_set_ps(v[3].position.z, v[2].position.z, v[1].position.z, v[0].position.z);
+	__m128 nx = _mm_set_ps(v[3].normal.x, v[2].normal.x, v[1].normal.x, v[0].normal.x);
+	__m128 ny = _mm_set_ps(v[3].normal.y, v[2].normal.y, v[1].normal.y, v[0].normal.y);
+	__m128 nz = _mm_set_ps(v[3].normal.z, v[2].normal.z, v[1].normal.z, v[0].normal.z);
+
+	rotate4(rx, ry, rz, rw, px, py, pz);
+	rotate4(rx, ry, rz, rw, nx, ny, nz);
+	px = _mm_add_ps(px, tx);
+	py = _mm_add_ps(py, ty);
+	pz = _mm_add_ps(pz, tz);
+
+	float out[6][4];
+	_mm_storeu_ps(out[0], px); _mm_storeu_ps(out[1], py); _mm_storeu_ps(out[2], pz);
+	_mm_storeu_ps(out[3], nx); _mm_storeu_ps(out[4], ny); _mm_storeu_ps(out[5], nz);
+	for (int lane = 0; lane < 4; lane++)
+	{
+		positions[lane] = glm::vec3(out[0][lane], out[1][lane], out[2][lane]);
+		normals[lane] = glm::vec3(out[3][lane], out[4][lane], out[5][lane]);
+	}
+}
+
+void skinVertices(const glm::mat2x4 * palette, const SkinnedVertex * vertices, glm::vec3 * positions, glm::vec3 * normals, size_t count)
+{
+	// Chunks are a multiple of four so only the last one has a scalar tail
+	ThreadPool::instance().parallelFor(count, 4096, [&](size_t begin, size_t end)
+	{
+		size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+			skinVertices4(palette, vertices + i, positions + i, normals + i);
+		for (; i < end; i++)
+			skinVertex(palette, vertices[i], positions[i], normals[i]);
+	});
+}
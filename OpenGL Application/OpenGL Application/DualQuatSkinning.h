@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <glm.hpp>
+#include <gtc/type_precision.hpp>
+#include "QuatBatch.h"
+
+// Joint palettes are stored as glm::mat2x4 in the layout of glm::mat2x4_cast:
+// column 0 is the real part and column 1 the dual part, each as (x, y, z, w)
+// with w the scalar. That is 32 bytes a joint against 64 for a mat4 and is
+// what skinned.vs reads from its JointPalette uniform block.
+
+// Vertex layout shared by the CPU skinning and skinned.vs. Weights should sum to one.
+struct SkinnedVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::u8vec4 joints;
+	glm::vec4 weights;
+};
+
+// Palette from an animated pose, element i is
+// mat2x4_cast(dualquat(rotations[i], translations[i])).
+void dualQuatsFromPose(const QuatArray & rotations, const glm::vec3 * translations, glm::mat2x4 * palette, size_t begin, size_t end);
+
+// Palette from rigid joint matrices. Scale and shear cannot be represented
+// by a dual quaternion and are lost.
+void dualQuatsFromMatrices(const glm::mat4 * joints, glm::mat2x4 * palette, size_t count);
+
+// Dual quaternion linear blending of up to four joints per vertex, the same
+// maths as skinned.vs. Runs four vertices per SSE2 iteration over the shared
+// ThreadPool, for headless use and baking.
+void skinVertices(const glm::mat2x4 * palette, const SkinnedVertex * vertices, glm::vec3 * positions, glm::vec3 * normals, size_t count);
+
+// Scalar version of skinVertices for a single vertex, giving identical results
+void skinVertex(const glm::mat2x4 * palette, const SkinnedVertex & vertex, glm::vec3 & position, glm::vec3 & normal);
@@ -0,0 +1,265 @@
+#include "EntityStore.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+const unsigned int EntityStore::NO_ARCHETYPE;
+const Entity EntityStore::INVALID_ENTITY = { 0xffffffff, 0 };
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+std::vector<EntityStore::ComponentInfo> & EntityStore::componentInfos()
+{
+	static std::vector<ComponentInfo> infos;
+	return infos;
+}
+
+unsigned int EntityStore::registerComponent(size_t size, size_t alignment)
+{
+	static std::mutex mutex;
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<ComponentInfo> & infos = componentInfos();
+	if (infos.size() == MAX_COMPONENTS)
+	{
+		printf("More than %u component types registered\n", MAX_COMPONENTS);
+		return MAX_COMPONENTS - 1;
+	}
+
+	ComponentInfo info = { size, alignment };
+	infos.push_back(info);
+	return (unsigned int)infos.size() - 1;
+}
+
+EntityStore::EntityStore()
+{
+}
+
+EntityStore::~EntityStore()
+{
+	for (Archetype & archetype : archetypes)
+		for (Chunk & chunk : archetype.chunks)
+			delete[] chunk.allocation;
+}
+
+unsigned int EntityStore::findArchetype(ComponentMask mask)
+{
+	for (unsigned int a = 0; a < archetypes.size(); a++)
+		if (archetypes[a].mask == mask)
+			return a;
+
+	const std::vector<ComponentInfo> & infos = componentInfos();
+	size_t rowBytes = sizeof(Entity);
+	for (unsigned int c = 0; c < infos.size(); c++)
+		if (mask & (ComponentMask(1) << c))
+			rowBytes += infos[c].size;
+
+	// Largest capacity whose layout, with every array starting on a cache
+	// line, fits in a chunk
+	Archetype archetype;
+	archetype.mask = mask;
+	archetype.capacity = (unsigned int)glm::max<size_t>(CHUNK_SIZE / rowBytes, 1);
+	for (;;)
+	{
+		size_t offset = alignUp(sizeof(Entity) * archetype.capacity, CACHE_LINE);
+		for (unsigned int c = 0; c < MAX_COMPONENTS; c++)
+		{
+			archetype.offsets[c] = 0;
+			if (c < infos.size() && (mask & (ComponentMask(1) << c)))
+			{
+				offset = alignUp(offset, glm::max<size_t>(infos[c].alignment, CACHE_LINE));
+				archetype.offsets[c] = offset;
+				offset += infos[c].size * archetype.capacity;
+			}
+		}
+
+		archetype.chunkBytes = glm::max<size_t>(offset, CHUNK_SIZE);
+		if (offset <= CHUNK_SIZE || archetype.capacity == 1)
+			break;
+		archetype.capacity--;
+	}
+
+	if (archetype.chunkBytes > CHUNK_SIZE)
+		printf("Components of %zu bytes do not fit a %u byte chunk, using %zu byte chunks\n", rowBytes, CHUNK_SIZE, archetype.chunkBytes);
+
+	archetypes.push_back(archetype);
+	return (unsigned int)archetypes.size() - 1;
+}
+
+// Appends the entity to the last chunk of the archetype, components are zeroed
+void EntityStore::placeRow(unsigned int archetype, EntityRecord & record, Entity entity)
+{
+	Archetype & a = archetypes[archetype];
+	if (a.chunks.empty() || a.chunks.back().count == a.capacity)
+	{
+		Chunk chunk;
+		chunk.allocation = new unsigned char[a.chunkBytes + CACHE_LINE];
+		chunk.memory = (unsigned char *)alignUp((size_t)chunk.allocation, CACHE_LINE);
+		chunk.count = 0;
+		memset(chunk.memory, 0, a.chunkBytes);
+		a.chunks.push_back(chunk);
+	}
+
+	Chunk & chunk = a.chunks.back();
+	record.archetype = archetype;
+	record.chunk = (unsigned int)a.chunks.size() - 1;
+	record.row = chunk.count++;
+	((Entity *)chunk.memory)[record.row] = entity;
+}
+
+// Fills the hole with the last entity of the archetype so every chunk but
+// the last stays full, and frees the last chunk once it is empty
+void EntityStore::removeRow(unsigned int archetype, unsigned int chunk, unsigned int row)
+{
+	Archetype & a = archetypes[archetype];
+	Chunk & last = a.chunks.back();
+	Chunk & target = a.chunks[chunk];
+	unsigned int lastRow = last.count - 1;
+
+	if (&last != &target || lastRow != row)
+	{
+		Entity moved = ((Entity *)last.memory)[lastRow];
+		((Entity *)target.memory)[row] = moved;
+
+		const std::vector<ComponentInfo> & infos = componentInfos();
+		for (unsigned int c = 0; c < infos.size(); c++)
+			if (a.mask & (ComponentMask(1) << c))
+				memcpy(target.memory + a.offsets[c] + row * infos[c].size, last.memory + a.offsets[c] + lastRow * infos[c].size, infos[c].size);
+
+		records[moved.index].chunk = chunk;
+		records[moved.index].row = row;
+	}
+
+	const std::vector<ComponentInfo> & infos = componentInfos();
+	for (unsigned int c = 0; c < infos.size(); c++)
+		if (a.mask & (ComponentMask(1) << c))
+			memset(last.memory + a.offsets[c] + lastRow * infos[c].size, 0, infos[c].size);
+
+	if (--last.count == 0)
+	{
+		delete[] last.allocation;
+		a.chunks.pop_back();
+	}
+}
+
+Entity EntityStore::allocate(ComponentMask mask)
+{
+	Entity entity;
+	if (!freeIndices.empty())
+	{
+		entity.index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	else
+	{
+		entity.index = (unsigned int)records.size();
+		EntityRecord record = { 0, NO_ARCHETYPE, 0, 0 };
+		records.push_back(record);
+	}
+	entity.generation = records[entity.index].generation;
+
+	placeRow(findArchetype(mask), records[entity.index], entity);
+	return entity;
+}
+
+void EntityStore::changeArchetype(Entity entity, ComponentMask mask)
+{
+	if (!isAlive(entity))
+		return;
+
+	EntityRecord old = records[entity.index];
+	unsigned int target = findArchetype(mask);
+	if (target == old.archetype)
+		return;
+
+	placeRow(target, records[entity.index], entity);
+	EntityRecord & current = records[entity.index];
+
+	// Copy the components both archetypes have, new ones stay zeroed
+	const Archetype & from = archetypes[old.archetype];
+	const Archetype & to = archetypes[target];
+	const std::vector<ComponentInfo> & infos = componentInfos();
+	for (unsigned int c = 0; c < infos.size(); c++)
+		if ((from.mask & to.mask) & (ComponentMask(1) << c))
+			memcpy(to.chunks[current.chunk].memory + to.offsets[c] + current.row * infos[c].size,
+				from.chunks[old.chunk].memory + from.offsets[c] + old.row * infos[c].size, infos[c].size);
+
+	removeRow(old.archetype, old.chunk, old.row);
+}
+
+void * EntityStore::componentPointer(Entity entity, unsigned int component)
+{
+	if (!isAlive(entity))
+		return nullptr;
+
+	const EntityRecord & record = records[entity.index];
+	const Archetype & archetype = archetypes[record.archetype];
+	if (!(archetype.mask & (ComponentMask(1) << component)))
+		return nullptr;
+
+	return archetype.chunks[record.chunk].memory + archetype.offsets[component] + record.row * componentInfos()[component].size;
+}
+
+void EntityStore::destroy(Entity entity)
+{
+	if (!isAlive(entity))
+		return;
+
+	EntityRecord & record = records[entity.index];
+	removeRow(record.archetype, record.chunk, record.row);
+	record.archetype = NO_ARCHETYPE;
+	record.generation++;
+	freeIndices.push_back(entity.index);
+}
+
+bool EntityStore::isAlive(Entity entity) const
+{
+	return entity.index < records.size() && records[entity.index].generation == entity.generation &&
+		records[entity.index].archetype != NO_ARCHETYPE;
+}
+
+void EntityStore::deferDestroy(Entity entity)
+{
+	std::lock_guard<std::mutex> lock(deferredMutex);
+	deferred.push_back([=](EntityStore & store) { store.destroy(entity); });
+}
+
+void EntityStore::flush()
+{
+	// Commands may defer further changes, keep going until none are left
+	for (;;)
+	{
+		std::vector<std::function<void(EntityStore &)>> commands;
+		{
+			std::lock_guard<std::mutex> lock(deferredMutex);
+			commands.swap(deferred);
+		}
+
+		if (commands.empty())
+			break;
+
+		for (auto & command : commands)
+			command(*this);
+	}
+}
+
+unsigned int EntityStore::getEntityCount() const
+{
+	return (unsigned int)(records.size() - freeIndices.size());
+}
+
+unsigned int EntityStore::getArchetypeCount() const
+{
+	return (unsigned int)archetypes.size();
+}
+
+unsigned int EntityStore::getChunkCount() const
+{
+	size_t count = 0;
+	for (const Archetype & archetype : archetypes)
+		count += archetype.chunks.size();
+	return (unsigned int)count;
+}
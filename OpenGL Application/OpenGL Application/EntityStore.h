@@ -0,0 +1,237 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <type_traits>
+#include <glm.hpp>
+#include "ThreadPool.h"
+
+// Entity handle, the generation tells a destroyed entity from a later one
+// reusing its index
+struct Entity
+{
+	unsigned int index;
+	unsigned int generation;
+
+	bool operator==(const Entity & other) const
+	{
+		return index == other.index && generation == other.generation;
+	}
+
+	bool operator!=(const Entity & other) const
+	{
+		return !(*this == other);
+	}
+};
+
+typedef glm::uint64 ComponentMask;
+
+// Archetype based entity-component store. Entities with the same set of
+// components share an archetype whose components are stored in 16 KB
+// chunks, one cache line aligned array per component, so systems stream
+// over contiguous memory. Components must be trivially copyable as rows are
+// moved with memcpy when an entity changes archetype.
+class EntityStore
+{
+public:
+	static const unsigned int CHUNK_SIZE = 16 * 1024;
+	static const unsigned int CACHE_LINE = 64;
+	static const unsigned int MAX_COMPONENTS = 64;
+	static const Entity INVALID_ENTITY;
+
+private:
+	struct ComponentInfo
+	{
+		size_t size;
+		size_t alignment;
+	};
+
+	struct Chunk
+	{
+		unsigned char * allocation;
+		unsigned char * memory; // allocation aligned to CACHE_LINE, starts with the Entity array
+		unsigned int count;
+	};
+
+	struct Archetype
+	{
+		ComponentMask mask;
+		unsigned int capacity; // entities per chunk
+		size_t chunkBytes;
+		size_t offsets[MAX_COMPONENTS]; // array of each component within a chunk
+		std::vector<Chunk> chunks;
+	};
+
+	struct EntityRecord
+	{
+		unsigned int generation;
+		unsigned int archetype; // NO_ARCHETYPE once destroyed
+		unsigned int chunk;
+		unsigned int row;
+	};
+
+	static const unsigned int NO_ARCHETYPE = 0xffffffff;
+
+	std::vector<Archetype> archetypes;
+	std::vector<EntityRecord> records;
+	std::vector<unsigned int> freeIndices;
+
+	std::mutex deferredMutex;
+	std::vector<std::function<void(EntityStore &)>> deferred;
+
+	static std::vector<ComponentInfo> & componentInfos();
+	static unsigned int registerComponent(size_t size, size_t alignment);
+
+	unsigned int findArchetype(ComponentMask mask);
+	void placeRow(unsigned int archetype, EntityRecord & record, Entity entity);
+	void removeRow(unsigned int archetype, unsigned int chunk, unsigned int row);
+	Entity allocate(ComponentMask mask);
+	void changeArchetype(Entity entity, ComponentMask mask);
+	void * componentPointer(Entity entity, unsigned int component);
+
+	template <typename... Components, typename Function>
+	void gatherChunks(Function function, bool parallel);
+public:
+	EntityStore();
+	~EntityStore();
+
+	// Ids are handed out on first use of a component type, up to MAX_COMPONENTS
+	template <typename T>
+	static unsigned int componentId()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Components are moved with memcpy");
+		static const unsigned int id = registerComponent(sizeof(T), alignof(T));
+		return id;
+	}
+
+	template <typename... Components>
+	static ComponentMask componentMask()
+	{
+		ComponentMask mask = 0;
+		int expand[] = { 0, ((mask |= ComponentMask(1) << componentId<Components>()), 0)... };
+		(void)expand;
+		return mask;
+	}
+
+	template <typename... Components>
+	Entity create(const Components &... values)
+	{
+		Entity entity = allocate(componentMask<Components...>());
+		int expand[] = { 0, ((*get<Components>(entity) = values), 0)... };
+		(void)expand;
+		return entity;
+	}
+
+	void destroy(Entity entity);
+	bool isAlive(Entity entity) const;
+
+	template <typename T>
+	void add(Entity entity, const T & value)
+	{
+		if (!isAlive(entity))
+			return;
+		changeArchetype(entity, archetypes[records[entity.index].archetype].mask | componentMask<T>());
+		*get<T>(entity) = value;
+	}
+
+	template <typename T>
+	void remove(Entity entity)
+	{
+		if (!isAlive(entity))
+			return;
+		changeArchetype(entity, archetypes[records[entity.index].archetype].mask & ~componentMask<T>());
+	}
+
+	template <typename T>
+	bool has(Entity entity) const
+	{
+		return isAlive(entity) && (archetypes[records[entity.index].archetype].mask & componentMask<T>()) != 0;
+	}
+
+	// Null if the entity is dead or lacks the component. Pointers stay valid
+	// until the next structural change.
+	template <typename T>
+	T * get(Entity entity)
+	{
+		return (T *)componentPointer(entity, componentId<T>());
+	}
+
+	// Structural changes requested while chunks are being iterated. May be
+	// called from several threads, flush() applies them in order.
+	template <typename... Components>
+	void deferCreate(const Components &... values)
+	{
+		std::lock_guard<std::mutex> lock(deferredMutex);
+		deferred.push_back([=](EntityStore & store) { store.create(values...); });
+	}
+
+	template <typename T>
+	void deferAdd(Entity entity, const T & value)
+	{
+		std::lock_guard<std::mutex> lock(deferredMutex);
+		deferred.push_back([=](EntityStore & store) { if (store.isAlive(entity)) store.add(entity, value); });
+	}
+
+	template <typename T>
+	void deferRemove(Entity entity)
+	{
+		std::lock_guard<std::mutex> lock(deferredMutex);
+		deferred.push_back([=](EntityStore & store) { if (store.isAlive(entity)) store.remove<T>(entity); });
+	}
+
+	void deferDestroy(Entity entity);
+	void flush();
+
+	// Calls function(count, entities, arrays...) once per chunk holding all of
+	// Components, with one array of count elements per component. With
+	// parallel set, chunks are spread over the shared ThreadPool.
+	template <typename... Components, typename Function>
+	void forEachChunk(Function function, bool parallel = false)
+	{
+		gatherChunks<Components...>(function, parallel);
+	}
+
+	// Calls function(entity, components...) for every entity holding all of Components
+	template <typename... Components, typename Function>
+	void forEach(Function function, bool parallel = false)
+	{
+		gatherChunks<Components...>([&](unsigned int count, const Entity * entities, Components *... arrays)
+		{
+			for (unsigned int i = 0; i < count; i++)
+				function(entities[i], arrays[i]...);
+		}, parallel);
+	}
+
+	unsigned int getEntityCount() const;
+	unsigned int getArchetypeCount() const;
+	unsigned int getChunkCount() const;
+};
+
+template <typename... Components, typename Function>
+void EntityStore::gatherChunks(Function function, bool parallel)
+{
+	ComponentMask required = componentMask<Components...>();
+
+	std::vector<std::pair<const Archetype *, const Chunk *>> matches;
+	for (const Archetype & archetype : archetypes)
+		if ((archetype.mask & required) == required)
+			for (const Chunk & chunk : archetype.chunks)
+				matches.push_back(std::make_pair(&archetype, &chunk));
+
+	auto run = [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const Archetype & archetype = *matches[i].first;
+			const Chunk & chunk = *matches[i].second;
+			function(chunk.count, (const Entity *)chunk.memory,
+				(Components *)(chunk.memory + archetype.offsets[componentId<Components>()])...);
+		}
+	};
+
+	if (parallel)
+		ThreadPool::instance().parallelFor(matches.size(), 1, run);
+	else
+		run(0, matches.size());
+}
@@ -0,0 +1,223 @@
+#include "FrameCapture.h"
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+const unsigned int FrameCapture::RING_SIZE;
+const unsigned int FrameCapture::MAX_QUEUED_FRAMES;
+
+FrameCapture::FrameCapture() : encoder(1)
+{
+	slots.resize(RING_SIZE);
+	for (Slot & slot : slots)
+	{
+		slot.buffer = 0;
+		slot.fence = nullptr;
+		slot.width = 0;
+		slot.height = 0;
+		slot.video = false;
+	}
+
+	next = 0;
+	recording = false;
+	videoWidth = 0;
+	videoHeight = 0;
+	videoFramesPerSecond = 0;
+	frameCount = 0;
+	droppedFrames = 0;
+	queuedFrames = 0;
+}
+
+FrameCapture::~FrameCapture()
+{
+	stopRecording();
+	flush();
+
+	for (Slot & slot : slots)
+		if (slot.buffer)
+			glDeleteBuffers(1, &slot.buffer);
+}
+
+void FrameCapture::screenshot(const char * fileName, CaptureFormat format)
+{
+	Target target = { fileName, format };
+	pendingScreenshots.push_back(target);
+}
+
+void FrameCapture::startRecording(const char * fileName, unsigned int framesPerSecond)
+{
+	stopRecording();
+	recording = true;
+	videoFileName = fileName;
+	videoWidth = 0;
+	videoHeight = 0;
+	videoFramesPerSecond = framesPerSecond;
+}
+
+void FrameCapture::stopRecording()
+{
+	if (!recording)
+		return;
+
+	// Frames still in flight belong to the video
+	flush();
+	recording = false;
+	if (videoWidth == 0)
+		return;
+
+	std::string fileName = videoFileName;
+	encoder.submit([this, fileName]
+	{
+		printf("Recorded %u frames to %s\n", video.getFrameCount(), fileName.c_str());
+		video.close();
+	});
+	videoWidth = 0;
+}
+
+bool FrameCapture::isRecording() const
+{
+	return recording;
+}
+
+// Maps a finished readback and hands a copy of the pixels to the encoder.
+// Without wait, slots whose fence has not passed yet are left alone. Returns
+// whether the slot is free.
+bool FrameCapture::readBack(Slot & slot, bool wait)
+{
+	if (!slot.fence)
+		return true;
+
+	const GLuint64 TIMEOUT_NANOSECONDS = 1000000000;
+	GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? TIMEOUT_NANOSECONDS : 0);
+	if (!wait && status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+
+	std::shared_ptr<Image> frame = std::make_shared<Image>();
+	frame->width = slot.width;
+	frame->height = slot.height;
+	frame->pixels.resize((size_t)slot.width * slot.height * 4);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	void * mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame->pixels.size(), GL_MAP_READ_BIT);
+	if (mapped)
+	{
+		memcpy(frame->pixels.data(), mapped, frame->pixels.size());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	std::vector<Target> screenshots;
+	screenshots.swap(slot.screenshots);
+	if (!mapped)
+	{
+		printf("Could not map a %ux%u capture buffer\n", slot.width, slot.height);
+		return true;
+	}
+
+	bool video = slot.video;
+	queuedFrames++;
+	encoder.submit([this, frame, screenshots, video] { encode(frame, screenshots, video); });
+	return true;
+}
+
+void FrameCapture::encode(std::shared_ptr<Image> frame, std::vector<Target> screenshots, bool video)
+{
+	flipRows(*frame);
+
+	for (const Target & target : screenshots)
+	{
+		bool written = false;
+		if (target.format == CAPTURE_PNG)
+			written = writePng(target.fileName.c_str(), *frame);
+		else if (target.format == CAPTURE_RAW)
+			written = writeRaw(target.fileName.c_str(), *frame);
+		else
+		{
+			Y4mWriter single;
+			written = single.open(target.fileName.c_str(), frame->width, frame->height, 1) && single.writeFrame(*frame);
+		}
+
+		if (written)
+			printf("Saved %ux%u screenshot to %s\n", frame->width, frame->height, target.fileName.c_str());
+	}
+
+	if (video)
+		this->video.writeFrame(*frame);
+	queuedFrames--;
+}
+
+void FrameCapture::capture(GLuint framebuffer, unsigned int width, unsigned int height)
+{
+	// Collect what the GPU has finished, oldest first so video frames stay in
+	// order
+	for (unsigned int i = 0; i < RING_SIZE; i++)
+		if (!readBack(slots[(next + i) % RING_SIZE], false))
+			break;
+
+	bool videoFrame = recording && width > 0 && height > 0;
+	if (videoFrame && videoWidth == 0)
+	{
+		videoWidth = width;
+		videoHeight = height;
+		std::string fileName = videoFileName;
+		unsigned int framesPerSecond = videoFramesPerSecond;
+		encoder.submit([this, fileName, width, height, framesPerSecond] { video.open(fileName.c_str(), width, height, framesPerSecond); });
+	}
+	if (videoFrame && (width != videoWidth || height != videoHeight || queuedFrames >= MAX_QUEUED_FRAMES))
+	{
+		droppedFrames++;
+		videoFrame = false;
+	}
+	if (!videoFrame && (pendingScreenshots.empty() || width == 0 || height == 0))
+		return;
+
+	// Waits only when the GPU is a whole ring of frames behind
+	Slot & slot = slots[next];
+	readBack(slot, true);
+
+	if (!slot.buffer)
+		glGenBuffers(1, &slot.buffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	if (slot.width != width || slot.height != height)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, nullptr, GL_STREAM_READ);
+		slot.width = width;
+		slot.height = height;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer(framebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.screenshots.swap(pendingScreenshots);
+	pendingScreenshots.clear();
+	slot.video = videoFrame;
+	next = (next + 1) % RING_SIZE;
+	frameCount++;
+}
+
+void FrameCapture::flush()
+{
+	for (unsigned int i = 0; i < RING_SIZE; i++)
+		readBack(slots[(next + i) % RING_SIZE], true);
+
+	while (queuedFrames > 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+unsigned int FrameCapture::getFrameCount() const
+{
+	return frameCount;
+}
+
+unsigned int FrameCapture::getDroppedFrames() const
+{
+	return droppedFrames;
+}
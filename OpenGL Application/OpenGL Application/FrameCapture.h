@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <glew.h>
+#include "Image.h"
+#include "Y4mWriter.h"
+#include "ThreadPool.h"
+
+enum CaptureFormat
+{
+	CAPTURE_PNG,
+	CAPTURE_RAW, // RGBA pixels without a header
+	CAPTURE_Y4M  // a single frame video
+};
+
+// Reads frames back without stalling the pipeline. capture() only queues a
+// glReadPixels into one of RING_SIZE pixel pack buffers; the buffer is
+// mapped a few frames later once its fence has passed, and the copied pixels
+// are flipped and written out by an encoder thread.
+//
+// Screenshots take the next captured frame. While recording, every frame is
+// appended to a Y4M video; frames are dropped rather than queued without
+// bound when the encoder falls behind.
+class FrameCapture
+{
+private:
+	struct Target
+	{
+		std::string fileName;
+		CaptureFormat format;
+	};
+
+	struct Slot
+	{
+		GLuint buffer;
+		GLsync fence;
+		unsigned int width;
+		unsigned int height;
+		std::vector<Target> screenshots;
+		bool video;
+	};
+
+	std::vector<Slot> slots;
+	unsigned int next; // slot the next capture goes to
+	std::vector<Target> pendingScreenshots;
+	bool recording;
+	std::string videoFileName;
+	unsigned int videoWidth; // 0 until the first recorded frame opens the video
+	unsigned int videoHeight;
+	unsigned int videoFramesPerSecond;
+	unsigned int frameCount;
+	unsigned int droppedFrames;
+	std::atomic<unsigned int> queuedFrames;
+
+	// Only used by the encoder thread, which must be destroyed first
+	Y4mWriter video;
+	ThreadPool encoder;
+
+	bool readBack(Slot & slot, bool wait);
+	void encode(std::shared_ptr<Image> frame, std::vector<Target> screenshots, bool video);
+public:
+	static const unsigned int RING_SIZE = 3;
+	static const unsigned int MAX_QUEUED_FRAMES = 8;
+
+	FrameCapture();
+	~FrameCapture();
+
+	void screenshot(const char * fileName, CaptureFormat format);
+	// The video takes the size of its first frame, frames of other sizes are
+	// dropped
+	void startRecording(const char * fileName, unsigned int framesPerSecond);
+	void stopRecording();
+	bool isRecording() const;
+
+	// After drawing and before swapping: collects finished readbacks and
+	// starts one of the framebuffer's first color attachment, or of the back
+	// buffer for framebuffer 0, if a screenshot or recording wants it
+	void capture(GLuint framebuffer, unsigned int width, unsigned int height);
+
+	// Waits for every readback and has them encoded
+	void flush();
+
+	unsigned int getFrameCount() const; // captured
+	unsigned int getDroppedFrames() const;
+};
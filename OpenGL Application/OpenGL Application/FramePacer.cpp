@@ -0,0 +1,117 @@
+#include "FramePacer.h"
+#include <cstdio>
+#include <glfw3.h>
+
+const unsigned int FramePacer::QUERY_LATENCY;
+
+FramePacer::FramePacer()
+{
+	for (unsigned int i = 0; i < QUERY_LATENCY; i++)
+	{
+		queries[i] = 0;
+		pending[i] = false;
+	}
+	next = 0;
+	timing = false;
+	queryActive = false;
+	tearControl = false;
+	swapMode = SWAP_VSYNC;
+	frameStart = 0.0;
+	cpuMilliseconds = 0.0f;
+	gpuMilliseconds = 0.0f;
+	newGpuTime = false;
+}
+
+FramePacer::~FramePacer()
+{
+	if (timing)
+		glDeleteQueries(QUERY_LATENCY, queries);
+}
+
+bool FramePacer::create()
+{
+	timing = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	if (timing)
+		glGenQueries(QUERY_LATENCY, queries);
+	else
+		printf("No timer queries, GPU frame times are not measured\n");
+
+	tearControl = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+	return true;
+}
+
+SwapMode FramePacer::setSwapMode(SwapMode mode)
+{
+	if (mode == SWAP_ADAPTIVE && !tearControl)
+	{
+		printf("No swap control tear extension, using vsync\n");
+		mode = SWAP_VSYNC;
+	}
+
+	// A negative interval syncs unless the frame missed the last vblank
+	glfwSwapInterval(mode == SWAP_IMMEDIATE ? 0 : mode == SWAP_VSYNC ? 1 : -1);
+	swapMode = mode;
+	return mode;
+}
+
+SwapMode FramePacer::getSwapMode() const
+{
+	return swapMode;
+}
+
+void FramePacer::beginFrame()
+{
+	frameStart = glfwGetTime();
+	if (!timing)
+		return;
+
+	// Collect every query that has come back, oldest first
+	for (unsigned int i = 0; i < QUERY_LATENCY; i++)
+	{
+		unsigned int slot = (next + i) % QUERY_LATENCY;
+		if (!pending[slot])
+			continue;
+		GLint available = 0;
+		glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &nanoseconds);
+		gpuMilliseconds = (float)(nanoseconds / 1e6);
+		newGpuTime = true;
+		pending[slot] = false;
+	}
+
+	queryActive = !pending[next];
+	if (queryActive)
+		glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+}
+
+void FramePacer::endFrame()
+{
+	if (queryActive)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		pending[next] = true;
+		next = (next + 1) % QUERY_LATENCY;
+		queryActive = false;
+	}
+	cpuMilliseconds = (float)((glfwGetTime() - frameStart) * 1e3);
+}
+
+float FramePacer::getCpuMilliseconds() const
+{
+	return cpuMilliseconds;
+}
+
+float FramePacer::getGpuMilliseconds() const
+{
+	return gpuMilliseconds;
+}
+
+bool FramePacer::hasNewGpuTime()
+{
+	bool result = newGpuTime;
+	newGpuTime = false;
+	return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glew.h>
+
+enum SwapMode
+{
+	SWAP_IMMEDIATE, // no vsync, frames tear
+	SWAP_VSYNC,
+	SWAP_ADAPTIVE   // vsync, but a late frame is shown at once and tears
+};
+
+// Frame pacing: the swap interval, and the CPU and GPU time of each frame.
+// The GPU time comes from a GL_TIME_ELAPSED query around the frame's work.
+// Queries are kept in a ring and read once available, a few frames late,
+// so reading them never waits for the GPU; a frame finding the ring full
+// goes untimed rather than stalling.
+class FramePacer
+{
+public:
+	static const unsigned int QUERY_LATENCY = 4;
+private:
+	GLuint queries[QUERY_LATENCY];
+	bool pending[QUERY_LATENCY];
+	unsigned int next;
+	bool timing;
+	bool queryActive;
+	bool tearControl;
+	SwapMode swapMode;
+	double frameStart;
+	float cpuMilliseconds;
+	float gpuMilliseconds;
+	bool newGpuTime;
+public:
+	FramePacer();
+	~FramePacer();
+
+	// Needs a current context. Without timer queries only CPU time is measured.
+	bool create();
+
+	// Adaptive falls back to vsync without the swap control tear extension.
+	// Returns the mode set.
+	SwapMode setSwapMode(SwapMode mode);
+	SwapMode getSwapMode() const;
+
+	// Around everything the frame draws, before the buffers are swapped
+	void beginFrame();
+	void endFrame();
+
+	float getCpuMilliseconds() const;
+
+	// Of the latest frame whose query came back; hasNewGpuTime() is true once
+	// after each, so a controller sees every timing only once
+	float getGpuMilliseconds() const;
+	bool hasNewGpuTime();
+};
@@ -45,6 +45,11 @@ bool GLSLProgram::compileShaderFromString(const string & source, GLuint type)
 }
 
 bool GLSLProgram::compileShaderFromFile(const char * fileName, GLuint type)
+{
+	return compileShaderFromFile(fileName, type, "");
+}
+
+bool GLSLProgram::compileShaderFromFile(const char * fileName, GLuint type, const string & defines)
 {
 	if(fileExists(fileName))
 	{
@@ -53,7 +58,11 @@ bool GLSLProgram::compileShaderFromFile(const char * fileName, GLuint type)
 		if (ShaderStream.is_open()) {
 			std::string Line = "";
 			while (getline(ShaderStream, Line))
+			{
 				shaderCode += "\n" + Line;
+				if (!defines.empty() && Line.compare(0, 8, "#version") == 0)
+					shaderCode += "\n" + defines;
+			}
 			ShaderStream.close();
 
 			return compileShaderFromString(shaderCode, type);
@@ -122,6 +131,14 @@ void GLSLProgram::bindFragDataLocation(GLuint location, const char * name)
 	glBindFragDataLocation(handle, location, name);
 }
 
+void GLSLProgram::bindUniformBlock(const char * name, GLuint bindingPoint)
+{
+	GLuint index = glGetUniformBlockIndex(handle, name);
+
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(handle, index, bindingPoint);
+}
+
 void GLSLProgram::setUniform(const char *name, float x, float y, float z)
 {
 	GLint location = glGetUniformLocation(handle, name);
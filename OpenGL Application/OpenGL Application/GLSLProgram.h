@@ -18,6 +18,8 @@ public:
 	GLSLProgram();
 	bool compileShaderFromString(const string & source, GLuint type);
 	bool compileShaderFromFile(const char * fileName, GLuint type);
+	// Inserts defines, such as "#define FXAA 1", after the #version line
+	bool compileShaderFromFile(const char * fileName, GLuint type, const string & defines);
 	bool link();
 	void use();
 	string log();
@@ -25,6 +27,7 @@ public:
 	bool isLinked();
 	void bindAttribLocation(GLuint location, const char * name);
 	void bindFragDataLocation(GLuint location, const char * name);
+	void bindUniformBlock(const char * name, GLuint bindingPoint);
 	void setUniform(const char *name, float x, float y, float z);
 	void setUniform(const char *name, const glm::vec3 & v);
 	void setUniform(const char *name, const glm::vec4 & v);
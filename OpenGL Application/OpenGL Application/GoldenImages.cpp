@@ -0,0 +1,163 @@
+#include "GoldenImages.h"
+#include <cstdio>
+#include <ctime>
+#include <chrono>
+
+const unsigned int GoldenRenderer::TIMED_FRAMES;
+
+GoldenRenderer::GoldenRenderer()
+{
+	framebuffer = 0;
+	color = 0;
+	depth = 0;
+	query = 0;
+	width = 0;
+	height = 0;
+}
+
+GoldenRenderer::~GoldenRenderer()
+{
+	if (query)
+		glDeleteQueries(1, &query);
+	if (framebuffer)
+		glDeleteFramebuffers(1, &framebuffer);
+	if (color)
+		glDeleteRenderbuffers(1, &color);
+	if (depth)
+		glDeleteRenderbuffers(1, &depth);
+}
+
+bool GoldenRenderer::create(unsigned int width, unsigned int height)
+{
+	glGenRenderbuffers(1, &color);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		printf("Golden image framebuffer is incomplete: 0x%x\n", status);
+		return false;
+	}
+
+	glGenQueries(1, &query);
+	this->width = width;
+	this->height = height;
+	return true;
+}
+
+bool GoldenRenderer::run(const char * directory, const char * name, bool update, unsigned int tolerance, const std::function<void()> & draw)
+{
+	GoldenResult result;
+	result.name = name;
+	result.passed = false;
+	result.difference = ImageDifference();
+	result.cpuMilliseconds = 0.0;
+	result.gpuMilliseconds = 0.0;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+
+	// One untimed frame for shader and driver warm up
+	draw();
+	glFinish();
+	for (unsigned int frame = 0; frame < TIMED_FRAMES; frame++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		draw();
+		glEndQuery(GL_TIME_ELAPSED);
+		glFinish();
+		result.cpuMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+		result.gpuMilliseconds += nanoseconds / 1e6;
+	}
+	result.cpuMilliseconds /= TIMED_FRAMES;
+	result.gpuMilliseconds /= TIMED_FRAMES;
+
+	Image actual;
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	actual.width = width;
+	actual.height = height;
+	actual.pixels.resize((size_t)width * height * 4);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, actual.pixels.data());
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	flipRows(actual);
+
+	std::string base = std::string(directory) + "/" + name;
+	Image golden, diff;
+	if (update)
+		result.passed = writeTga((base + ".tga").c_str(), actual);
+	else if (loadTga((base + ".tga").c_str(), golden) && compareImages(golden, actual, tolerance, result.difference, diff))
+	{
+		result.passed = result.difference.differingPixels == 0;
+		if (!result.passed)
+			writeTga((base + "_diff.tga").c_str(), diff);
+	}
+	if (!update && !result.passed)
+		writeTga((base + "_actual.tga").c_str(), actual);
+
+	printf("%-24s %s %7u pixels off (max %3u, mean %.3f), cpu %.3f ms, gpu %.3f ms\n", name,
+		update ? (result.passed ? "UPDATED" : "FAILED ") : (result.passed ? "PASSED " : "FAILED "),
+		result.difference.differingPixels, result.difference.maxDifference, result.difference.meanDifference,
+		result.cpuMilliseconds, result.gpuMilliseconds);
+	results.push_back(result);
+	return result.passed;
+}
+
+bool GoldenRenderer::appendReport(const char * fileName) const
+{
+	FILE * file = fopen(fileName, "r");
+	bool exists = file != nullptr;
+	if (file)
+		fclose(file);
+
+	file = fopen(fileName, "a");
+	if (!file)
+	{
+		printf("Could not open %s\n", fileName);
+		return false;
+	}
+
+	if (!exists)
+		fprintf(file, "run,scene,passed,differing_pixels,max_difference,mean_difference,cpu_ms,gpu_ms\n");
+	long long run = (long long)time(nullptr);
+	for (const GoldenResult & result : results)
+		fprintf(file, "%lld,%s,%d,%u,%u,%.4f,%.4f,%.4f\n", run, result.name.c_str(), result.passed ? 1 : 0,
+			result.difference.differingPixels, result.difference.maxDifference, result.difference.meanDifference,
+			result.cpuMilliseconds, result.gpuMilliseconds);
+	fclose(file);
+	return true;
+}
+
+GLuint GoldenRenderer::getFramebuffer() const
+{
+	return framebuffer;
+}
+
+const std::vector<GoldenResult> & GoldenRenderer::getResults() const
+{
+	return results;
+}
+
+unsigned int GoldenRenderer::getFailureCount() const
+{
+	unsigned int failures = 0;
+	for (const GoldenResult & result : results)
+		if (!result.passed)
+			failures++;
+	return failures;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <glew.h>
+#include "Image.h"
+
+struct GoldenResult
+{
+	std::string name;
+	bool passed;
+	ImageDifference difference;
+	double cpuMilliseconds; // from the first GL call of a frame until glFinish() returns
+	double gpuMilliseconds; // GL_TIME_ELAPSED
+};
+
+// Renders scenes into an offscreen framebuffer of a fixed size and compares
+// them with golden images, timing each scene over several frames so one run
+// shows both correctness and performance regressions.
+//
+// Goldens are <directory>/<name>.tga. A scene fails when any channel of any
+// pixel is off by more than the tolerance, which leaves <name>_actual.tga
+// and <name>_diff.tga next to the golden. Update mode writes the goldens.
+class GoldenRenderer
+{
+private:
+	GLuint framebuffer;
+	GLuint color;
+	GLuint depth;
+	GLuint query;
+	unsigned int width;
+	unsigned int height;
+	std::vector<GoldenResult> results;
+public:
+	static const unsigned int TIMED_FRAMES = 8;
+
+	GoldenRenderer();
+	~GoldenRenderer();
+	bool create(unsigned int width, unsigned int height);
+	GLuint getFramebuffer() const;
+
+	// draw renders one complete frame, clear included, into the bound
+	// framebuffer or into getFramebuffer(). Returns whether the scene passed.
+	bool run(const char * directory, const char * name, bool update, unsigned int tolerance, const std::function<void()> & draw);
+
+	// Appends the results to a CSV file with a column for the time of the run
+	bool appendReport(const char * fileName) const;
+
+	const std::vector<GoldenResult> & getResults() const;
+	unsigned int getFailureCount() const;
+};
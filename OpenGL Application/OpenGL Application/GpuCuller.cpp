@@ -0,0 +1,251 @@
+#include "GpuCuller.h"
+#include <cstdio>
+#include <algorithm>
+
+const unsigned int GpuCuller::CULL_GROUP_SIZE;
+const unsigned int GpuCuller::HIZ_GROUP_SIZE;
+
+// DrawElementsIndirectCommand
+const unsigned int COMMAND_SIZE = 5 * sizeof(GLuint);
+
+GpuCuller::GpuCuller()
+{
+	cullProgram = nullptr;
+	hiZProgram = nullptr;
+	objectBuffer = 0;
+	commandBuffer = 0;
+	countBuffer = 0;
+	objectIdBuffer = 0;
+	depthTexture = 0;
+	hiZTexture = 0;
+	maxObjects = 0;
+	objectCount = 0;
+	hiZWidth = 0;
+	hiZHeight = 0;
+	hiZLevels = 0;
+	hiZValid = false;
+	drawCountOnGpu = false;
+}
+
+GpuCuller::~GpuCuller()
+{
+	GLuint buffers[] = { objectBuffer, commandBuffer, countBuffer, objectIdBuffer };
+	glDeleteBuffers(4, buffers);
+	GLuint textures[] = { depthTexture, hiZTexture };
+	glDeleteTextures(2, textures);
+	delete cullProgram;
+	delete hiZProgram;
+}
+
+bool GpuCuller::create(unsigned int maxObjects)
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		printf("GPU culling needs OpenGL 4.3\n");
+		return false;
+	}
+
+	cullProgram = new GLSLProgram();
+	if (!cullProgram->compileShaderFromFile("cull.cs", GL_COMPUTE_SHADER) || !cullProgram->link())
+	{
+		printf("Culling shader failed to build!\n%s", cullProgram->log().c_str());
+		return false;
+	}
+
+	hiZProgram = new GLSLProgram();
+	if (!hiZProgram->compileShaderFromFile("hiz.cs", GL_COMPUTE_SHADER) || !hiZProgram->link())
+	{
+		printf("Hi-Z shader failed to build!\n%s", hiZProgram->log().c_str());
+		return false;
+	}
+
+	glGenBuffers(1, &objectBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, maxObjects * sizeof(GpuObject), nullptr, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &commandBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, maxObjects * COMMAND_SIZE, nullptr, GL_DYNAMIC_COPY);
+
+	glGenBuffers(1, &countBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	std::vector<GLuint> ids(maxObjects);
+	for (unsigned int i = 0; i < maxObjects; i++)
+		ids[i] = i;
+	glGenBuffers(1, &objectIdBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, objectIdBuffer);
+	glBufferData(GL_ARRAY_BUFFER, maxObjects * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	this->maxObjects = maxObjects;
+	drawCountOnGpu = GLEW_ARB_indirect_parameters != 0;
+	return true;
+}
+
+void GpuCuller::setObjects(const GpuObject * objects, unsigned int count)
+{
+	objectCount = std::min(count, maxObjects);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, objectCount * sizeof(GpuObject), objects);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCuller::setObjectIdAttribute(GLuint location)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, objectIdBuffer);
+	glEnableVertexAttribArray(location);
+	glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, 0, nullptr);
+	glVertexAttribDivisor(location, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool GpuCuller::resizeHiZ(unsigned int width, unsigned int height)
+{
+	if (width == hiZWidth && height == hiZHeight)
+		return true;
+	if (width == 0 || height == 0)
+		return false;
+
+	GLuint textures[] = { depthTexture, hiZTexture };
+	glDeleteTextures(2, textures);
+
+	hiZLevels = 1;
+	while ((std::max(width, height) >> hiZLevels) > 0)
+		hiZLevels++;
+
+	glGenTextures(1, &depthTexture);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenTextures(1, &hiZTexture);
+	glBindTexture(GL_TEXTURE_2D, hiZTexture);
+	glTexStorage2D(GL_TEXTURE_2D, hiZLevels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	hiZWidth = width;
+	hiZHeight = height;
+	return true;
+}
+
+void GpuCuller::updateHiZ(GLuint framebuffer, unsigned int width, unsigned int height, const glm::mat4 & viewProjection)
+{
+	if (!resizeHiZ(width, height))
+		return;
+
+	GLint readFramebuffer;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+
+	// Level 0 from the depth copy, every other level from the one above it
+	hiZProgram->use();
+	glActiveTexture(GL_TEXTURE0);
+	for (unsigned int level = 0; level < hiZLevels; level++)
+	{
+		unsigned int levelWidth = std::max(width >> level, 1u), levelHeight = std::max(height >> level, 1u);
+		glBindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : hiZTexture);
+		hiZProgram->setUniform("source_level", level == 0 ? 0 : (int)level - 1);
+		glBindImageTexture(0, hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((levelWidth + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (levelHeight + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+
+	hiZViewProjection = viewProjection;
+	hiZValid = true;
+}
+
+void GpuCuller::disableHiZ()
+{
+	hiZValid = false;
+}
+
+void GpuCuller::cull(const glm::mat4 & viewProjection)
+{
+	// Without a draw count on the GPU every slot is drawn, so the ones
+	// nothing is appended to must be empty commands
+	GLuint zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	if (!drawCountOnGpu)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	cullProgram->use();
+	cullProgram->setUniform("object_count", (int)objectCount);
+	cullProgram->setUniform("view_projection", viewProjection);
+	cullProgram->setUniform("hiz_view_projection", hiZViewProjection);
+	cullProgram->setUniform("hiz_enabled", hiZValid);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, hiZValid ? hiZTexture : 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, countBuffer);
+	glDispatchCompute((objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+}
+
+void GpuCuller::draw()
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, objectBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	if (drawCountOnGpu)
+	{
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, countBuffer);
+		glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, objectCount, 0);
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+	}
+	else
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, objectCount, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+unsigned int GpuCuller::readDrawCount()
+{
+	GLuint count = 0;
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_COPY_READ_BUFFER, countBuffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &count);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	return count;
+}
+
+std::vector<unsigned int> GpuCuller::readDrawnObjects()
+{
+	unsigned int count = std::min(readDrawCount(), objectCount);
+	std::vector<GLuint> commands(count * 5);
+	glBindBuffer(GL_COPY_READ_BUFFER, commandBuffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, count * COMMAND_SIZE, commands.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	std::vector<unsigned int> objects(count);
+	for (unsigned int i = 0; i < count; i++)
+		objects[i] = commands[i * 5 + 4]; // base instance
+	return objects;
+}
+
+unsigned int GpuCuller::getObjectCount() const
+{
+	return objectCount;
+}
+
+bool GpuCuller::isDrawCountOnGpu() const
+{
+	return drawCountOnGpu;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <glew.h>
+#include <glm.hpp>
+#include "GLSLProgram.h"
+
+// One object of the GPU culled scene, laid out as the std430 Object struct of
+// cull.cs and culled.vs. Every object is drawn from the same vertex array
+// with 32 bit indices.
+struct GpuObject
+{
+	glm::mat4 model;
+	glm::vec4 boundsMin; // model space box, w unused
+	glm::vec4 boundsMax;
+	unsigned int indexCount;
+	unsigned int firstIndex;
+	int baseVertex;
+	unsigned int padding;
+};
+
+// GPU driven culling. A compute shader tests every object's bounding box
+// against the frustum and a Hi-Z pyramid (farthest depth of the previous
+// frame), and atomically appends the survivors to an indirect command buffer
+// drawn with a single glMultiDrawElementsIndirect, so the CPU cost does not
+// depend on the object count.
+//
+// The pyramid is tested with the view projection it was rendered with, which
+// is exact for static objects; a moving object may pop in one frame late.
+// Needs OpenGL 4.3. The draw count stays on the GPU with
+// ARB_indirect_parameters; otherwise the command buffer is cleared before
+// culling and every object slot is drawn, culled slots being empty commands.
+class GpuCuller
+{
+private:
+	GLSLProgram * cullProgram;
+	GLSLProgram * hiZProgram;
+	GLuint objectBuffer;
+	GLuint commandBuffer;
+	GLuint countBuffer;
+	GLuint objectIdBuffer; // 0, 1, 2... read as an instanced attribute
+	GLuint depthTexture;   // copy of the rendered depth
+	GLuint hiZTexture;
+	unsigned int maxObjects;
+	unsigned int objectCount;
+	unsigned int hiZWidth;
+	unsigned int hiZHeight;
+	unsigned int hiZLevels;
+	glm::mat4 hiZViewProjection;
+	bool hiZValid;
+	bool drawCountOnGpu;
+
+	bool resizeHiZ(unsigned int width, unsigned int height);
+public:
+	static const unsigned int CULL_GROUP_SIZE = 64;
+	static const unsigned int HIZ_GROUP_SIZE = 8;
+
+	GpuCuller();
+	~GpuCuller();
+	bool create(unsigned int maxObjects);
+
+	void setObjects(const GpuObject * objects, unsigned int count);
+
+	// Sets up the object id attribute, divisor 1, in the bound vertex array.
+	// Every draw command's base instance is its object's index, which
+	// culled.vs uses to look up the model matrix.
+	void setObjectIdAttribute(GLuint location);
+
+	// Builds the Hi-Z pyramid from the depth buffer of a framebuffer (0 for
+	// the default one) rendered with viewProjection. Until then, and after
+	// disableHiZ(), only the frustum is tested. Leaves no program in use.
+	void updateHiZ(GLuint framebuffer, unsigned int width, unsigned int height, const glm::mat4 & viewProjection);
+	void disableHiZ();
+
+	// Leaves no program in use
+	void cull(const glm::mat4 & viewProjection);
+
+	// Draws the survivors of the last cull() with the bound program and
+	// vertex array; the object buffer is bound to shader storage binding 0
+	void draw();
+
+	// Waits for the GPU, for tests and statistics only
+	unsigned int readDrawCount();
+	std::vector<unsigned int> readDrawnObjects(); // in append order
+
+	unsigned int getObjectCount() const;
+	bool isDrawCountOnGpu() const;
+};
@@ -0,0 +1,400 @@
+#include "Image.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "MappedFile.h"
+
+// Converts one source pixel to RGBA
+static inline void expandPixel(const unsigned char * source, unsigned int bytesPerPixel, unsigned char * rgba)
+{
+	switch (bytesPerPixel)
+	{
+	case 1:
+		rgba[0] = rgba[1] = rgba[2] = source[0];
+		rgba[3] = 255;
+		break;
+	case 2:
+	{
+		// A1R5G5B5, the bit replication maps 31 to 255
+		unsigned int value = source[0] | (source[1] << 8);
+		unsigned int r = (value >> 10) & 31, g = (value >> 5) & 31, b = value & 31;
+		rgba[0] = (unsigned char)((r << 3) | (r >> 2));
+		rgba[1] = (unsigned char)((g << 3) | (g >> 2));
+		rgba[2] = (unsigned char)((b << 3) | (b >> 2));
+		rgba[3] = 255;
+		break;
+	}
+	case 3:
+		rgba[0] = source[2];
+		rgba[1] = source[1];
+		rgba[2] = source[0];
+		rgba[3] = 255;
+		break;
+	default:
+		rgba[0] = source[2];
+		rgba[1] = source[1];
+		rgba[2] = source[0];
+		rgba[3] = source[3];
+		break;
+	}
+}
+
+bool decodeTga(const unsigned char * data, size_t size, Image & image)
+{
+	if (size < 18)
+	{
+		printf("TGA header is truncated\n");
+		return false;
+	}
+
+	unsigned int idLength = data[0];
+	unsigned int colorMapType = data[1];
+	unsigned int imageType = data[2];
+	unsigned int width = data[12] | (data[13] << 8);
+	unsigned int height = data[14] | (data[15] << 8);
+	unsigned int bitsPerPixel = data[16];
+	bool topDown = (data[17] & 0x20) != 0;
+
+	bool rle = imageType == 10 || imageType == 11;
+	bool gray = imageType == 3 || imageType == 11;
+	bool supported = colorMapType == 0 && (imageType == 2 || imageType == 3 || rle) &&
+		(gray ? bitsPerPixel == 8 : (bitsPerPixel == 16 || bitsPerPixel == 24 || bitsPerPixel == 32));
+	if (!supported || width == 0 || height == 0)
+	{
+		printf("Unsupported TGA type %u with %u bits per pixel\n", imageType, bitsPerPixel);
+		return false;
+	}
+
+	unsigned int bytesPerPixel = bitsPerPixel / 8;
+	size_t pixelCount = (size_t)width * height;
+	const unsigned char * p = data + 18 + idLength;
+	const unsigned char * end = data + size;
+
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(pixelCount * 4);
+
+	// Decoded in file order, which is bottom up unless the descriptor says otherwise
+	std::vector<unsigned char> & pixels = image.pixels;
+	if (!rle)
+	{
+		if ((size_t)(end - p) < pixelCount * bytesPerPixel)
+		{
+			printf("TGA pixel data is truncated\n");
+			return false;
+		}
+
+		if (bytesPerPixel == 4)
+		{
+			// Swizzle BGRA to RGBA
+			for (size_t i = 0; i < pixelCount; i++, p += 4)
+			{
+				unsigned char * rgba = &pixels[i * 4];
+				rgba[0] = p[2];
+				rgba[1] = p[1];
+				rgba[2] = p[0];
+				rgba[3] = p[3];
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < pixelCount; i++, p += bytesPerPixel)
+				expandPixel(p, bytesPerPixel, &pixels[i * 4]);
+		}
+	}
+	else
+	{
+		size_t i = 0;
+		while (i < pixelCount)
+		{
+			if (p == end)
+			{
+				printf("TGA run length data is truncated\n");
+				return false;
+			}
+
+			unsigned int packet = *p++;
+			size_t count = (packet & 0x7f) + 1;
+			bool run = (packet & 0x80) != 0;
+			size_t needed = run ? bytesPerPixel : count * bytesPerPixel;
+			if (count > pixelCount - i || (size_t)(end - p) < needed)
+			{
+				printf("TGA run length data is corrupt\n");
+				return false;
+			}
+
+			if (run)
+			{
+				unsigned char rgba[4];
+				expandPixel(p, bytesPerPixel, rgba);
+				for (size_t k = 0; k < count; k++)
+					memcpy(&pixels[(i + k) * 4], rgba, 4);
+			}
+			else
+			{
+				for (size_t k = 0; k < count; k++)
+					expandPixel(p + k * bytesPerPixel, bytesPerPixel, &pixels[(i + k) * 4]);
+			}
+			p += needed;
+			i += count;
+		}
+	}
+
+	if (!topDown)
+	{
+		size_t rowBytes = (size_t)width * 4;
+		std::vector<unsigned char> row(rowBytes);
+		for (unsigned int y = 0; y < height / 2; y++)
+		{
+			unsigned char * top = &pixels[y * rowBytes];
+			unsigned char * bottom = &pixels[(height - 1 - y) * rowBytes];
+			memcpy(row.data(), top, rowBytes);
+			memcpy(top, bottom, rowBytes);
+			memcpy(bottom, row.data(), rowBytes);
+		}
+	}
+	return true;
+}
+
+bool loadTga(const char * fileName, Image & image)
+{
+	MappedFile file;
+	if (!file.open(fileName))
+		return false;
+
+	if (!decodeTga(file.getData(), file.getSize(), image))
+	{
+		printf("Could not decode %s\n", fileName);
+		return false;
+	}
+	return true;
+}
+
+void flipRows(Image & image)
+{
+	size_t pitch = (size_t)image.width * 4;
+	std::vector<unsigned char> row(pitch);
+	for (unsigned int y = 0; y < image.height / 2; y++)
+	{
+		unsigned char * top = &image.pixels[y * pitch];
+		unsigned char * bottom = &image.pixels[(image.height - 1 - y) * pitch];
+		memcpy(row.data(), top, pitch);
+		memcpy(top, bottom, pitch);
+		memcpy(bottom, row.data(), pitch);
+	}
+}
+
+static unsigned int crc32(const unsigned char * data, size_t size, unsigned int crc = 0)
+{
+	static unsigned int table[256];
+	static bool tableReady = false;
+	if (!tableReady)
+	{
+		for (unsigned int n = 0; n < 256; n++)
+		{
+			unsigned int c = n;
+			for (int k = 0; k < 8; k++)
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		tableReady = true;
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void appendUintBigEndian(std::vector<unsigned char> & data, unsigned int value)
+{
+	for (int i = 3; i >= 0; i--)
+		data.push_back((unsigned char)(value >> (8 * i)));
+}
+
+// Length, type, payload and the CRC of type and payload
+static void appendChunk(std::vector<unsigned char> & data, const char * type, const unsigned char * payload, size_t size)
+{
+	appendUintBigEndian(data, (unsigned int)size);
+	size_t start = data.size();
+	data.insert(data.end(), type, type + 4);
+	data.insert(data.end(), payload, payload + size);
+	appendUintBigEndian(data, crc32(&data[start], size + 4));
+}
+
+void encodePng(const Image & image, std::vector<unsigned char> & data)
+{
+	const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	data.assign(SIGNATURE, SIGNATURE + 8);
+
+	std::vector<unsigned char> header;
+	appendUintBigEndian(header, image.width);
+	appendUintBigEndian(header, image.height);
+	const unsigned char FORMAT[5] = { 8, 6, 0, 0, 0 }; // 8 bit RGBA, deflate, adaptive filters, no interlace
+	header.insert(header.end(), FORMAT, FORMAT + 5);
+	appendChunk(data, "IHDR", header.data(), header.size());
+
+	// Rows each behind a zero (no filter) byte, in stored blocks of at most
+	// 65535 bytes behind a zlib header, with the Adler-32 of the rows at the end
+	size_t pitch = (size_t)image.width * 4, rawBytes = (pitch + 1) * image.height;
+	const size_t BLOCK_BYTES = 65535;
+	std::vector<unsigned char> stream;
+	stream.reserve(2 + rawBytes + (rawBytes / BLOCK_BYTES + 1) * 5 + 4);
+	stream.push_back(0x78);
+	stream.push_back(0x01);
+
+	unsigned int adlerA = 1, adlerB = 0;
+	size_t blockLeft = 0, remaining = rawBytes;
+	for (unsigned int y = 0; y < image.height; y++)
+	{
+		const unsigned char filter = 0;
+		const unsigned char * parts[2] = { &filter, &image.pixels[y * pitch] };
+		size_t partBytes[2] = { 1, pitch };
+		for (int p = 0; p < 2; p++)
+		{
+			const unsigned char * bytes = parts[p];
+			size_t count = partBytes[p];
+			while (count > 0)
+			{
+				if (blockLeft == 0)
+				{
+					blockLeft = std::min(remaining, BLOCK_BYTES);
+					stream.push_back(remaining == blockLeft ? 1 : 0);
+					stream.push_back((unsigned char)blockLeft);
+					stream.push_back((unsigned char)(blockLeft >> 8));
+					stream.push_back((unsigned char)~blockLeft);
+					stream.push_back((unsigned char)(~blockLeft >> 8));
+				}
+
+				size_t run = std::min(count, blockLeft);
+				stream.insert(stream.end(), bytes, bytes + run);
+				for (size_t i = 0; i < run;)
+				{
+					// The most bytes that cannot overflow the sums before reducing
+					size_t end = std::min(run, i + 5552);
+					for (; i < end; i++)
+					{
+						adlerA += bytes[i];
+						adlerB += adlerA;
+					}
+					adlerA %= 65521u;
+					adlerB %= 65521u;
+				}
+				bytes += run;
+				count -= run;
+				blockLeft -= run;
+				remaining -= run;
+			}
+		}
+	}
+	appendUintBigEndian(stream, (adlerB << 16) | adlerA);
+
+	appendChunk(data, "IDAT", stream.data(), stream.size());
+	appendChunk(data, "IEND", nullptr, 0);
+}
+
+static bool writeFile(const char * fileName, const unsigned char * data, size_t size)
+{
+	FILE * file = fopen(fileName, "wb");
+	if (!file)
+	{
+		printf("Could not create %s\n", fileName);
+		return false;
+	}
+
+	bool written = fwrite(data, 1, size, file) == size;
+	fclose(file);
+	if (!written)
+		printf("Could not write %s\n", fileName);
+	return written;
+}
+
+bool writePng(const char * fileName, const Image & image)
+{
+	std::vector<unsigned char> data;
+	encodePng(image, data);
+	return writeFile(fileName, data.data(), data.size());
+}
+
+bool writeRaw(const char * fileName, const Image & image)
+{
+	return writeFile(fileName, image.pixels.data(), image.pixels.size());
+}
+
+void encodeTga(const Image & image, std::vector<unsigned char> & data)
+{
+	const unsigned int HEADER_BYTES = 18;
+	data.assign(HEADER_BYTES + image.pixels.size(), 0);
+	data[2] = 2; // uncompressed truecolor
+	data[12] = (unsigned char)image.width;
+	data[13] = (unsigned char)(image.width >> 8);
+	data[14] = (unsigned char)image.height;
+	data[15] = (unsigned char)(image.height >> 8);
+	data[16] = 32;
+	data[17] = 0x28; // 8 alpha bits, top left origin
+
+	unsigned char * bgra = &data[HEADER_BYTES];
+	for (size_t i = 0; i < image.pixels.size(); i += 4)
+	{
+		bgra[i] = image.pixels[i + 2];
+		bgra[i + 1] = image.pixels[i + 1];
+		bgra[i + 2] = image.pixels[i];
+		bgra[i + 3] = image.pixels[i + 3];
+	}
+}
+
+bool writeTga(const char * fileName, const Image & image)
+{
+	std::vector<unsigned char> data;
+	encodeTga(image, data);
+	return writeFile(fileName, data.data(), data.size());
+}
+
+bool compareImages(const Image & expected, const Image & actual, unsigned int tolerance, ImageDifference & difference, Image & diff)
+{
+	difference.differingPixels = 0;
+	difference.maxDifference = 0;
+	difference.meanDifference = 0.0;
+	if (expected.width != actual.width || expected.height != actual.height)
+	{
+		printf("Image sizes differ: %ux%u expected, %ux%u found\n", expected.width, expected.height, actual.width, actual.height);
+		return false;
+	}
+
+	diff.width = expected.width;
+	diff.height = expected.height;
+	diff.pixels.resize(expected.pixels.size());
+
+	unsigned long long total = 0;
+	for (size_t i = 0; i < expected.pixels.size(); i += 4)
+	{
+		unsigned int pixelDifference = 0;
+		for (int c = 0; c < 4; c++)
+		{
+			unsigned int channel = (unsigned int)std::abs((int)expected.pixels[i + c] - (int)actual.pixels[i + c]);
+			pixelDifference = std::max(pixelDifference, channel);
+			total += channel;
+		}
+		difference.maxDifference = std::max(difference.maxDifference, pixelDifference);
+
+		unsigned char * out = &diff.pixels[i];
+		if (pixelDifference > tolerance)
+		{
+			difference.differingPixels++;
+			out[0] = (unsigned char)std::min(128u + pixelDifference, 255u);
+			out[1] = 0;
+			out[2] = 0;
+		}
+		else
+		{
+			unsigned int gray = (expected.pixels[i] * 77 + expected.pixels[i + 1] * 150 + expected.pixels[i + 2] * 29) >> 10;
+			out[0] = out[1] = out[2] = (unsigned char)gray;
+		}
+		out[3] = 255;
+	}
+
+	if (!expected.pixels.empty())
+		difference.meanDifference = (double)total / expected.pixels.size();
+	return true;
+}
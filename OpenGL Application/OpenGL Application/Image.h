@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// 8 bit RGBA image, rows stored top to bottom
+struct Image
+{
+	unsigned int width;
+	unsigned int height;
+	std::vector<unsigned char> pixels;
+
+	Image()
+	{
+		width = 0;
+		height = 0;
+	}
+};
+
+// Truecolor and grayscale TGA, raw or run length encoded, in 8, 16, 24 or
+// 32 bits per pixel. Grayscale is expanded to RGB with opaque alpha.
+bool decodeTga(const unsigned char * data, size_t size, Image & image);
+bool loadTga(const char * fileName, Image & image);
+
+// Uncompressed 32 bit TGA, rows stored top to bottom
+void encodeTga(const Image & image, std::vector<unsigned char> & data);
+bool writeTga(const char * fileName, const Image & image);
+
+// Reverses the row order, for pixels read back from OpenGL bottom row first
+void flipRows(Image & image);
+
+// PNG made of stored deflate blocks: no smaller than the pixels, but cheap
+// enough to write every frame of a capture
+void encodePng(const Image & image, std::vector<unsigned char> & data);
+bool writePng(const char * fileName, const Image & image);
+
+// The pixels alone, width * height * 4 bytes
+bool writeRaw(const char * fileName, const Image & image);
+
+struct ImageDifference
+{
+	unsigned int differingPixels; // with a channel off by more than the tolerance
+	unsigned int maxDifference;
+	double meanDifference; // over every channel of every pixel
+};
+
+// Compares two images of the same size. The diff image shows the expected
+// image dimmed, with differing pixels in red scaled by their difference.
+bool compareImages(const Image & expected, const Image & actual, unsigned int tolerance, ImageDifference & difference, Image & diff);
@@ -0,0 +1,51 @@
+#include "InputQueue.h"
+
+InputQueue::InputQueue()
+{
+	mask = 0;
+	head = 0;
+	tail = 0;
+	dropped = 0;
+}
+
+void InputQueue::create(unsigned int capacity)
+{
+	unsigned int size = 1;
+	while (size < capacity)
+		size <<= 1;
+	events.resize(size);
+	mask = size - 1;
+	head = 0;
+	tail = 0;
+	dropped = 0;
+}
+
+bool InputQueue::push(const InputEvent & event)
+{
+	unsigned int position = tail.load(std::memory_order_relaxed);
+	if (events.empty() || position - head.load(std::memory_order_acquire) > mask)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	events[position & mask] = event;
+	tail.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+bool InputQueue::pop(InputEvent & event)
+{
+	unsigned int position = head.load(std::memory_order_relaxed);
+	if (position == tail.load(std::memory_order_acquire))
+		return false;
+
+	event = events[position & mask];
+	head.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+unsigned int InputQueue::getDroppedCount() const
+{
+	return dropped.load(std::memory_order_relaxed);
+}
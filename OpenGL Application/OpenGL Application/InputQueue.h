@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+
+enum InputEventType
+{
+	INPUT_CURSOR,
+	INPUT_BUTTON,
+	INPUT_KEY
+};
+
+struct InputEvent
+{
+	InputEventType type;
+	double timestamp; // seconds, glfwGetTime() when the event was received
+	double x;         // cursor position
+	double y;
+	int code;         // mouse button or key
+	int action;       // GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+};
+
+// Lock-free ring of input events between one producer, the GLFW callbacks,
+// and one consumer applying them to the frame. The producer only writes the
+// tail and the consumer only the head, each published with release and read
+// with acquire, so neither ever waits. A full queue drops the new event and
+// counts it rather than blocking the callback.
+class InputQueue
+{
+private:
+	std::vector<InputEvent> events;
+	unsigned int mask;
+	alignas(64) std::atomic<unsigned int> head; // next event to pop
+	alignas(64) std::atomic<unsigned int> tail; // next slot to push into
+	std::atomic<unsigned int> dropped;
+public:
+	InputQueue();
+
+	// The capacity is rounded up to a power of two
+	void create(unsigned int capacity);
+
+	// Producer side
+	bool push(const InputEvent & event);
+
+	// Consumer side, false when empty
+	bool pop(InputEvent & event);
+
+	unsigned int getDroppedCount() const;
+};
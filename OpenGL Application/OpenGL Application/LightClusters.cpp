@@ -0,0 +1,233 @@
+#include "LightClusters.h"
+#include <cstdio>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include "Simd.h"
+#include "ThreadPool.h"
+
+LightClusters::LightClusters()
+{
+	tilesX = 0;
+	tilesY = 0;
+	slices = 0;
+	nearDepth = 0.0f;
+	farDepth = 0.0f;
+	projection = glm::mat4(0.0f);
+}
+
+bool LightClusters::create(unsigned int tilesX, unsigned int tilesY, unsigned int slices, float nearDepth, float farDepth)
+{
+	if (tilesX == 0 || tilesY == 0 || slices == 0 || nearDepth <= 0.0f || farDepth <= nearDepth)
+	{
+		printf("Light clusters need a non-empty grid and 0 < near < far\n");
+		return false;
+	}
+
+	this->tilesX = tilesX;
+	this->tilesY = tilesY;
+	this->slices = slices;
+	this->nearDepth = nearDepth;
+	this->farDepth = farDepth;
+	projection = glm::mat4(0.0f);
+	clusterMin.assign(getClusterCount(), glm::vec4(0.0f));
+	clusterMax.assign(getClusterCount(), glm::vec4(0.0f));
+	clusters.assign(getClusterCount() * 2, 0);
+	lightIndices.clear();
+	sliceIndices.assign(slices, std::vector<unsigned int>());
+	return true;
+}
+
+// Every corner of a tile lies on a ray from the eye through the near plane,
+// so a cluster's box is spanned by the tile's rays at the slice's depths
+void LightClusters::buildClusterBounds(const glm::mat4 & projection)
+{
+	glm::mat4 inverseProjection = glm::inverse(projection);
+	std::vector<glm::vec3> rays((tilesX + 1) * (tilesY + 1));
+	for (unsigned int y = 0; y <= tilesY; y++)
+	{
+		for (unsigned int x = 0; x <= tilesX; x++)
+		{
+			glm::vec4 corner = inverseProjection * glm::vec4(2.0f * x / tilesX - 1.0f, 2.0f * y / tilesY - 1.0f, -1.0f, 1.0f);
+			glm::vec3 point = glm::vec3(corner) / corner.w;
+			rays[y * (tilesX + 1) + x] = point / -point.z; // at depth 1
+		}
+	}
+
+	for (unsigned int z = 0; z < slices; z++)
+	{
+		float depths[2] = { nearDepth * powf(farDepth / nearDepth, (float)z / slices), nearDepth * powf(farDepth / nearDepth, (float)(z + 1) / slices) };
+		for (unsigned int y = 0; y < tilesY; y++)
+		{
+			for (unsigned int x = 0; x < tilesX; x++)
+			{
+				glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+				for (unsigned int corner = 0; corner < 8; corner++)
+				{
+					glm::vec3 point = rays[(y + (corner >> 1 & 1)) * (tilesX + 1) + x + (corner & 1)] * depths[corner >> 2];
+					boundsMin = glm::min(boundsMin, point);
+					boundsMax = glm::max(boundsMax, point);
+				}
+				unsigned int cluster = (z * tilesY + y) * tilesX + x;
+				clusterMin[cluster] = glm::vec4(boundsMin, 0.0f);
+				clusterMax[cluster] = glm::vec4(boundsMax, 0.0f);
+			}
+		}
+	}
+	this->projection = projection;
+}
+
+// Lists are slice relative until build() packs them
+void LightClusters::binSlice(unsigned int slice, const std::vector<unsigned int> & candidates)
+{
+	std::vector<unsigned int> & indices = sliceIndices[slice];
+	indices.clear();
+
+	// Structure of arrays, padded with spheres nothing is inside of
+	size_t padded = (candidates.size() + 3) & ~(size_t)3;
+	std::vector<float> centerX(padded, 0.0f), centerY(padded, 0.0f), centerZ(padded, 0.0f), radiusSquared(padded, -1.0f);
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		const glm::vec4 & light = viewLights[candidates[i]];
+		centerX[i] = light.x;
+		centerY[i] = light.y;
+		centerZ[i] = light.z;
+		radiusSquared[i] = light.w * light.w;
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (unsigned int tile = 0; tile < tilesX * tilesY; tile++)
+	{
+		unsigned int cluster = slice * tilesX * tilesY + tile;
+		const glm::vec4 & boundsMin = clusterMin[cluster], & boundsMax = clusterMax[cluster];
+		__m128 minX = _mm_set1_ps(boundsMin.x), minY = _mm_set1_ps(boundsMin.y), minZ = _mm_set1_ps(boundsMin.z);
+		__m128 maxX = _mm_set1_ps(boundsMax.x), maxY = _mm_set1_ps(boundsMax.y), maxZ = _mm_set1_ps(boundsMax.z);
+
+		unsigned int first = (unsigned int)indices.size();
+		for (size_t i = 0; i < padded; i += 4)
+		{
+			// Distance from the sphere centre to the box, per axis
+			__m128 x = _mm_loadu_ps(&centerX[i]), y = _mm_loadu_ps(&centerY[i]), z = _mm_loadu_ps(&centerZ[i]);
+			__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, x), _mm_sub_ps(x, maxX)), zero);
+			__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, y), _mm_sub_ps(y, maxY)), zero);
+			__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, z), _mm_sub_ps(z, maxZ)), zero);
+			__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_loadu_ps(&radiusSquared[i])));
+			for (int lane = 0; mask; lane++, mask >>= 1)
+				if (mask & 1)
+					indices.push_back(candidates[i + lane]);
+		}
+		clusters[cluster * 2] = first;
+		clusters[cluster * 2 + 1] = (unsigned int)indices.size() - first;
+	}
+}
+
+void LightClusters::build(const PointLight * lights, unsigned int count, const glm::mat4 & view, const glm::mat4 & projection)
+{
+	if (projection != this->projection)
+		buildClusterBounds(projection);
+
+	// Candidates of a slice overlap its depth range, with a slice of slack
+	// either side for rounding
+	float scale = getSliceScale(), bias = getSliceBias();
+	std::vector<std::vector<unsigned int>> candidates(slices);
+	viewLights.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		glm::vec4 position = view * glm::vec4(lights[i].position, 1.0f);
+		float radius = lights[i].radius;
+		viewLights[i] = glm::vec4(glm::vec3(position), radius);
+
+		float depth = -position.z;
+		if (radius <= 0.0f || depth + radius <= nearDepth || depth - radius >= farDepth)
+			continue;
+
+		int first = depth - radius <= nearDepth ? 0 : (int)floorf(logf(depth - radius) * scale - bias) - 1;
+		int last = depth + radius >= farDepth ? (int)slices - 1 : (int)floorf(logf(depth + radius) * scale - bias) + 1;
+		first = std::max(first, 0);
+		last = std::min(last, (int)slices - 1);
+		for (int z = first; z <= last; z++)
+			candidates[z].push_back(i);
+	}
+
+	ThreadPool::instance().parallelFor(slices, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t z = begin; z < end; z++)
+			binSlice((unsigned int)z, candidates[z]);
+	});
+
+	size_t total = 0;
+	for (const std::vector<unsigned int> & indices : sliceIndices)
+		total += indices.size();
+	lightIndices.resize(total);
+
+	unsigned int base = 0;
+	for (unsigned int z = 0; z < slices; z++)
+	{
+		for (unsigned int tile = 0; tile < tilesX * tilesY; tile++)
+			clusters[(z * tilesX * tilesY + tile) * 2] += base;
+		std::copy(sliceIndices[z].begin(), sliceIndices[z].end(), lightIndices.begin() + base);
+		base += (unsigned int)sliceIndices[z].size();
+	}
+}
+
+unsigned int LightClusters::getTilesX() const
+{
+	return tilesX;
+}
+
+unsigned int LightClusters::getTilesY() const
+{
+	return tilesY;
+}
+
+unsigned int LightClusters::getSlices() const
+{
+	return slices;
+}
+
+unsigned int LightClusters::getClusterCount() const
+{
+	return tilesX * tilesY * slices;
+}
+
+float LightClusters::getNearDepth() const
+{
+	return nearDepth;
+}
+
+float LightClusters::getFarDepth() const
+{
+	return farDepth;
+}
+
+float LightClusters::getSliceScale() const
+{
+	return slices / logf(farDepth / nearDepth);
+}
+
+float LightClusters::getSliceBias() const
+{
+	return logf(nearDepth) * getSliceScale();
+}
+
+const std::vector<glm::vec4> & LightClusters::getViewLights() const
+{
+	return viewLights;
+}
+
+const std::vector<unsigned int> & LightClusters::getClusters() const
+{
+	return clusters;
+}
+
+const std::vector<unsigned int> & LightClusters::getLightIndices() const
+{
+	return lightIndices;
+}
+
+void LightClusters::getClusterBounds(unsigned int cluster, glm::vec3 & boundsMin, glm::vec3 & boundsMax) const
+{
+	boundsMin = glm::vec3(clusterMin[cluster]);
+	boundsMax = glm::vec3(clusterMax[cluster]);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <glm.hpp>
+
+struct PointLight
+{
+	glm::vec3 position; // world space
+	float radius;       // no light beyond
+	glm::vec3 color;
+	float intensity;
+};
+
+// Bins point lights into a froxel grid for clustered shading: screen tiles
+// by exponential depth slices of the view frustum between nearDepth and
+// farDepth. Each depth slice is binned on its own thread, testing the
+// bounding box of every cluster in it against four light spheres at a time
+// with SSE, and the per cluster lists are then packed into one index list.
+//
+// Cluster (x, y, z) is z * tilesY * tilesX + y * tilesX + x, with y up from
+// the bottom of the screen, and slice z starts at view depth
+// nearDepth * (farDepth / nearDepth)^(z / slices).
+class LightClusters
+{
+private:
+	unsigned int tilesX;
+	unsigned int tilesY;
+	unsigned int slices;
+	float nearDepth;
+	float farDepth;
+	glm::mat4 projection; // the cluster bounds were built for
+	std::vector<glm::vec4> clusterMin; // view space bounding boxes, w unused
+	std::vector<glm::vec4> clusterMax;
+	std::vector<glm::vec4> viewLights; // view space position and radius
+	std::vector<unsigned int> clusters; // first index and count per cluster
+	std::vector<unsigned int> lightIndices;
+	std::vector<std::vector<unsigned int>> sliceIndices;
+
+	void buildClusterBounds(const glm::mat4 & projection);
+	void binSlice(unsigned int slice, const std::vector<unsigned int> & candidates);
+public:
+	LightClusters();
+	bool create(unsigned int tilesX, unsigned int tilesY, unsigned int slices, float nearDepth, float farDepth);
+
+	void build(const PointLight * lights, unsigned int count, const glm::mat4 & view, const glm::mat4 & projection);
+
+	unsigned int getTilesX() const;
+	unsigned int getTilesY() const;
+	unsigned int getSlices() const;
+	unsigned int getClusterCount() const;
+	float getNearDepth() const;
+	float getFarDepth() const;
+
+	// Slice of a view depth is floor(log(depth) * scale - bias)
+	float getSliceScale() const;
+	float getSliceBias() const;
+
+	const std::vector<glm::vec4> & getViewLights() const;
+	const std::vector<unsigned int> & getClusters() const;
+	const std::vector<unsigned int> & getLightIndices() const;
+	void getClusterBounds(unsigned int cluster, glm::vec3 & boundsMin, glm::vec3 & boundsMax) const;
+};
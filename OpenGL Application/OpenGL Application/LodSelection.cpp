@@ -0,0 +1,43 @@
+#include "LodSelection.h"
+#include <algorithm>
+#include <cfloat>
+
+float lodPixelScale(const glm::mat4 & projection, float viewportHeight)
+{
+	// projection[1][1] maps a unit at distance 1 to that much of the
+	// two unit high normalized device range
+	return 0.5f * projection[1][1] * viewportHeight;
+}
+
+float lodPixelsPerUnit(const glm::mat4 & world, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, const glm::vec3 & cameraPosition, float pixelScale)
+{
+	float scale = glm::max(glm::length(glm::vec3(world[0])), glm::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+	glm::vec3 center = glm::vec3(world * glm::vec4(0.5f * (boundsMin + boundsMax), 1.0f));
+	float radius = 0.5f * glm::length(boundsMax - boundsMin) * scale;
+
+	// Inside the sphere every level would be too coarse
+	float distance = glm::length(center - cameraPosition) - radius;
+	if (distance <= 0.0f)
+		return FLT_MAX;
+	return pixelScale * scale / distance;
+}
+
+unsigned int selectLod(const MeshLods & lods, float pixelsPerUnit, float threshold, float hysteresis)
+{
+	if (lods.count == 0)
+		return 0;
+
+	unsigned int current = std::min(lods.current, lods.count - 1);
+	if (lods.levels[current].error * pixelsPerUnit > threshold * (1.0f + hysteresis))
+	{
+		// Too coarse: the coarsest finer level that is good enough
+		while (current > 0 && lods.levels[current].error * pixelsPerUnit > threshold)
+			current--;
+		return current;
+	}
+
+	float coarserThreshold = threshold / (1.0f + hysteresis);
+	while (current + 1 < lods.count && lods.levels[current + 1].error * pixelsPerUnit <= coarserThreshold)
+		current++;
+	return current;
+}
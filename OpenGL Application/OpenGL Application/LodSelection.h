@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm.hpp>
+#include "RenderComponents.h"
+
+// Pixels one model unit at distance 1 covers on screen, for the projection
+// matrix and the viewport height in pixels
+float lodPixelScale(const glm::mat4 & projection, float viewportHeight);
+
+// Pixels per model unit of an object's bounding box as seen from the
+// camera, measured at the point of the box's bounding sphere nearest to it
+float lodPixelsPerUnit(const glm::mat4 & world, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, const glm::vec3 & cameraPosition, float pixelScale);
+
+// The coarsest level whose error projects to at most threshold pixels.
+// Hysteresis keeps the current level while its error stays below
+// threshold * (1 + hysteresis), and only moves to a coarser one once that
+// one is below threshold / (1 + hysteresis), so an object near a switching
+// distance does not pop between two levels.
+unsigned int selectLod(const MeshLods & lods, float pixelsPerUnit, float threshold, float hysteresis);
@@ -0,0 +1,125 @@
+#include "MappedFile.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+#else
+	descriptor = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const char * fileName)
+{
+	close();
+
+#ifdef _WIN32
+	file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		printf("Could not open %s\n", fileName);
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		printf("Could not map empty file %s\n", fileName);
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping)
+		data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	descriptor = ::open(fileName, O_RDONLY);
+	if (descriptor < 0)
+	{
+		printf("Could not open %s\n", fileName);
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size == 0)
+	{
+		printf("Could not map empty file %s\n", fileName);
+		close();
+		return false;
+	}
+	size = (size_t)status.st_size;
+
+	void * view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (view != MAP_FAILED)
+	{
+		data = (const unsigned char *)view;
+		madvise(view, size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (!data)
+	{
+		printf("Could not map %s\n", fileName);
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (data)
+		munmap((void *)data, size);
+	if (descriptor >= 0)
+		::close(descriptor);
+	descriptor = -1;
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+const unsigned char * MappedFile::getData() const
+{
+	return data;
+}
+
+size_t MappedFile::getSize() const
+{
+	return size;
+}
+
+bool MappedFile::isOpen() const
+{
+	return data != nullptr;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. The mapping is page aligned, so
+// data laid out at aligned offsets in the file is aligned in memory as well.
+class MappedFile
+{
+private:
+	const unsigned char * data;
+	size_t size;
+#ifdef _WIN32
+	void * file;
+	void * mapping;
+#else
+	int descriptor;
+#endif
+public:
+	MappedFile();
+	~MappedFile();
+	bool open(const char * fileName);
+	void close();
+	const unsigned char * getData() const;
+	size_t getSize() const;
+	bool isOpen() const;
+};
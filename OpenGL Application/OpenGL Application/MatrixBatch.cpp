@@ -0,0 +1,148 @@
+#include "MatrixBatch.h"
+#include "Simd.h"
+
+glm::mat4 composeMatrix(const glm::vec3 & translation, const glm::quat & rotation, const glm::vec3 & scale)
+{
+	glm::mat3 r = glm::mat3_cast(rotation);
+	return glm::mat4(
+		glm::vec4(r[0] * scale.x, 0.0f),
+		glm::vec4(r[1] * scale.y, 0.0f),
+		glm::vec4(r[2] * scale.z, 0.0f),
+		glm::vec4(translation, 1.0f));
+}
+
+// a * b in glm's order of operations, one column per iteration
+static inline void multiply4(const glm::mat4 & a, const glm::mat4 & b, glm::mat4 & result)
+{
+	__m128 a0 = _mm_loadu_ps(&a[0][0]);
+	__m128 a1 = _mm_loadu_ps(&a[1][0]);
+	__m128 a2 = _mm_loadu_ps(&a[2][0]);
+	__m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+	for (int c = 0; c < 4; c++)
+	{
+		__m128 column = _mm_loadu_ps(&b[c][0]);
+		__m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+		r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+		r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+		r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+		_mm_storeu_ps(&result[c][0], r);
+	}
+}
+
+SIMD_TARGET_AVX static inline __m256 loadColumnTwice(const glm::vec4 & column)
+{
+	__m128 v = _mm_loadu_ps(&column[0]);
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(v), v, 1);
+}
+
+// Two columns of b per register, each half broadcasting its own column's element
+SIMD_TARGET_AVX static inline void multiply8(const glm::mat4 & a, const glm::mat4 & b, glm::mat4 & result)
+{
+	__m256 a0 = loadColumnTwice(a[0]);
+	__m256 a1 = loadColumnTwice(a[1]);
+	__m256 a2 = loadColumnTwice(a[2]);
+	__m256 a3 = loadColumnTwice(a[3]);
+
+	__m256 columns01 = _mm256_loadu_ps(&b[0][0]);
+	__m256 columns23 = _mm256_loadu_ps(&b[2][0]);
+
+	__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(columns01, _MM_SHUFFLE(0, 0, 0, 0)));
+	__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(columns23, _MM_SHUFFLE(0, 0, 0, 0)));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1, _mm256_permute_ps(columns01, _MM_SHUFFLE(1, 1, 1, 1))));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1, _mm256_permute_ps(columns23, _MM_SHUFFLE(1, 1, 1, 1))));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2, _mm256_permute_ps(columns01, _MM_SHUFFLE(2, 2, 2, 2))));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2, _mm256_permute_ps(columns23, _MM_SHUFFLE(2, 2, 2, 2))));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3, _mm256_permute_ps(columns01, _MM_SHUFFLE(3, 3, 3, 3))));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3, _mm256_permute_ps(columns23, _MM_SHUFFLE(3, 3, 3, 3))));
+
+	_mm256_storeu_ps(&result[0][0], r01);
+	_mm256_storeu_ps(&result[2][0], r23);
+}
+
+SIMD_TARGET_AVX static void multiplyAVX(const glm::mat4 * a, const glm::mat4 * b, glm::mat4 * result, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		multiply8(a[i], b[i], result[i]);
+}
+
+SIMD_TARGET_AVX static void multiplyIndexedAVX(const glm::mat4 * a, const unsigned int * aIndices, const glm::mat4 * b, glm::mat4 * result, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		multiply8(a[aIndices[i]], b[i], result[i]);
+}
+
+void multiplyMatrices(const glm::mat4 * a, const glm::mat4 * b, glm::mat4 * result, size_t count)
+{
+	if (cpuHasAVX())
+	{
+		multiplyAVX(a, b, result, count);
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		multiply4(a[i], b[i], result[i]);
+}
+
+void multiplyMatrices(const glm::mat4 * a, const unsigned int * aIndices, const glm::mat4 * b, glm::mat4 * result, size_t count)
+{
+	if (cpuHasAVX())
+	{
+		multiplyIndexedAVX(a, aIndices, b, result, count);
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		multiply4(a[aIndices[i]], b[i], result[i]);
+}
+
+void composeMatrices(const Vec3Array & translations, const QuatArray & rotations, const Vec3Array & scales,
+	glm::mat4 * result, size_t begin, size_t end)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&rotations.x[i]);
+		__m128 y = _mm_loadu_ps(&rotations.y[i]);
+		__m128 z = _mm_loadu_ps(&rotations.z[i]);
+		__m128 w = _mm_loadu_ps(&rotations.w[i]);
+
+		// glm::mat3_cast on four lanes
+		__m128 qxx = _mm_mul_ps(x, x), qyy = _mm_mul_ps(y, y), qzz = _mm_mul_ps(z, z);
+		__m128 qxz = _mm_mul_ps(x, z), qxy = _mm_mul_ps(x, y), qyz = _mm_mul_ps(y, z);
+		__m128 qwx = _mm_mul_ps(w, x), qwy = _mm_mul_ps(w, y), qwz = _mm_mul_ps(w, z);
+
+		__m128 sx = _mm_loadu_ps(&scales.x[i]);
+		__m128 sy = _mm_loadu_ps(&scales.y[i]);
+		__m128 sz = _mm_loadu_ps(&scales.z[i]);
+
+		__m128 columns[4][4];
+		columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qyy, qzz))), sx);
+		columns[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qxy, qwz)), sx);
+		columns[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qxz, qwy)), sx);
+		columns[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qxy, qwz)), sy);
+		columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qxx, qzz))), sy);
+		columns[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qyz, qwx)), sy);
+		columns[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(qxz, qwy)), sz);
+		columns[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(qyz, qwx)), sz);
+		columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qxx, qyy))), sz);
+		columns[0][3] = columns[1][3] = columns[2][3] = _mm_setzero_ps();
+		columns[3][0] = _mm_loadu_ps(&translations.x[i]);
+		columns[3][1] = _mm_loadu_ps(&translations.y[i]);
+		columns[3][2] = _mm_loadu_ps(&translations.z[i]);
+		columns[3][3] = one;
+
+		glm::mat4 * m = result + (i - begin);
+		for (int c = 0; c < 4; c++)
+		{
+			_MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+			for (int k = 0; k < 4; k++)
+				_mm_storeu_ps(&m[k][c][0], columns[c][k]);
+		}
+	}
+	for (; i < end; i++)
+		result[i - begin] = composeMatrix(translations.get(i), rotations.get(i), scales.get(i));
+}
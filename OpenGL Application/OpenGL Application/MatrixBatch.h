@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <glm.hpp>
+#include "QuatBatch.h"
+
+// Vectors in structure-of-arrays layout, the vec3 counterpart of QuatArray
+struct Vec3Array
+{
+	std::vector<float> x, y, z;
+
+	void resize(size_t count)
+	{
+		x.resize(count); y.resize(count); z.resize(count);
+	}
+
+	size_t size() const
+	{
+		return x.size();
+	}
+
+	void set(size_t i, const glm::vec3 & v)
+	{
+		x[i] = v.x; y[i] = v.y; z[i] = v.z;
+	}
+
+	glm::vec3 get(size_t i) const
+	{
+		return glm::vec3(x[i], y[i], z[i]);
+	}
+};
+
+// result[i] = a[i] * b[i], identical to glm's mat4 operator*. Two columns are
+// computed per AVX instruction when available, one per SSE2 instruction
+// otherwise. result may alias either input.
+void multiplyMatrices(const glm::mat4 * a, const glm::mat4 * b, glm::mat4 * result, size_t count);
+
+// result[i] = a[aIndices[i]] * b[i], for multiplying by parent transforms
+void multiplyMatrices(const glm::mat4 * a, const unsigned int * aIndices, const glm::mat4 * b, glm::mat4 * result, size_t count);
+
+// Local matrices from translation, rotation and scale for the elements
+// [begin, end), written to result[i - begin]. Same as composeMatrix per element.
+void composeMatrices(const Vec3Array & translations, const QuatArray & rotations, const Vec3Array & scales,
+	glm::mat4 * result, size_t begin, size_t end);
+
+// translate(translation) * mat4_cast(rotation) * scale(scale), computed directly
+glm::mat4 composeMatrix(const glm::vec3 & translation, const glm::quat & rotation, const glm::vec3 & scale);
@@ -0,0 +1,114 @@
+#include "MeshBuffer.h"
+#include <cstdio>
+#include <cstddef>
+
+MeshBuffer::MeshBuffer()
+{
+	vertexArray = 0;
+	vertexBuffer = 0;
+	indexBuffer = 0;
+	indexCount = 0;
+	indexType = GL_UNSIGNED_INT;
+}
+
+MeshBuffer::~MeshBuffer()
+{
+	release();
+}
+
+void MeshBuffer::release()
+{
+	if (vertexArray)
+		glDeleteVertexArrays(1, &vertexArray);
+	if (vertexBuffer)
+		glDeleteBuffers(1, &vertexBuffer);
+	if (indexBuffer)
+		glDeleteBuffers(1, &indexBuffer);
+	vertexArray = vertexBuffer = indexBuffer = 0;
+	indexCount = 0;
+}
+
+static void uploadBuffer(GLenum target, GLuint buffer, GLsizeiptr size, const void * data)
+{
+	glBindBuffer(target, buffer);
+	if (GLEW_ARB_buffer_storage)
+		glBufferStorage(target, size, data, 0);
+	else
+		glBufferData(target, size, data, GL_STATIC_DRAW);
+}
+
+bool MeshBuffer::load(const char * fileName)
+{
+	MeshFile file;
+	if (!file.open(fileName))
+		return false;
+
+	const MeshFileHeader & header = file.getHeader();
+	if (header.vertexCount == 0 || header.indexCount == 0)
+	{
+		printf("%s has no triangles\n", fileName);
+		return false;
+	}
+
+	release();
+
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(1, &vertexBuffer);
+	glGenBuffers(1, &indexBuffer);
+
+	// The index buffer binding is part of the vertex array state
+	glBindVertexArray(vertexArray);
+	uploadBuffer(GL_ARRAY_BUFFER, vertexBuffer, (GLsizeiptr)header.vertexBytes, file.getVertices());
+	setVertexAttributes();
+	uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer, (GLsizeiptr)header.indexBytes, file.getIndices());
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	indexCount = header.indexCount;
+	indexType = header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	boundsMin = header.boundsMin;
+	boundsMax = header.boundsMax;
+	return true;
+}
+
+void MeshBuffer::draw()
+{
+	glBindVertexArray(vertexArray);
+	glDrawElements(GL_TRIANGLES, indexCount, indexType, nullptr);
+	glBindVertexArray(0);
+}
+
+GLuint MeshBuffer::getVertexArray()
+{
+	return vertexArray;
+}
+
+unsigned int MeshBuffer::getIndexCount()
+{
+	return indexCount;
+}
+
+GLenum MeshBuffer::getIndexType()
+{
+	return indexType;
+}
+
+glm::vec3 MeshBuffer::getBoundsMin()
+{
+	return boundsMin;
+}
+
+glm::vec3 MeshBuffer::getBoundsMax()
+{
+	return boundsMax;
+}
+
+void MeshBuffer::setVertexAttributes()
+{
+	GLsizei stride = sizeof(MeshVertex);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(MeshVertex, position));
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(MeshVertex, normal));
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(MeshVertex, uv));
+	for (GLuint location = 0; location < 3; location++)
+		glEnableVertexAttribArray(location);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glew.h>
+#include "MeshFile.h"
+
+// Vertex array and buffers of a binary mesh file (see MeshFile.h). The
+// mapped vertex and index blobs are handed straight to the buffers, with
+// immutable storage when ARB_buffer_storage is available.
+class MeshBuffer
+{
+private:
+	GLuint vertexArray;
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+	unsigned int indexCount;
+	GLenum indexType;
+	glm::vec3 boundsMin, boundsMax;
+
+	void release();
+public:
+	MeshBuffer();
+	~MeshBuffer();
+	bool load(const char * fileName);
+	void draw();
+	GLuint getVertexArray();
+	unsigned int getIndexCount();
+	GLenum getIndexType();
+	glm::vec3 getBoundsMin();
+	glm::vec3 getBoundsMax();
+
+	// Attribute pointers for an array of MeshVertex in the bound GL_ARRAY_BUFFER:
+	// position at location 0, normal at 1 and uv at 2
+	static void setVertexAttributes();
+};
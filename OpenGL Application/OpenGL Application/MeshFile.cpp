@@ -0,0 +1,177 @@
+#include "MeshFile.h"
+#include <cstdio>
+#include <cstring>
+#include <cfloat>
+
+static glm::uint64 alignUp(glm::uint64 value, glm::uint64 alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool writePadding(FILE * file, glm::uint64 from, glm::uint64 to)
+{
+	static const unsigned char zeros[MESH_FILE_ALIGNMENT] = {};
+	return to == from || fwrite(zeros, 1, (size_t)(to - from), file) == to - from;
+}
+
+bool writeMeshFile(const char * fileName, const MeshData & mesh)
+{
+	MeshFileHeader header = {};
+	memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+	header.version = MESH_FILE_VERSION;
+	header.vertexCount = (glm::uint32)mesh.vertices.size();
+	header.vertexStride = sizeof(MeshVertex);
+	header.indexCount = (glm::uint32)mesh.indices.size();
+	header.indexSize = mesh.vertices.size() <= 0x10000 ? 2 : 4;
+	header.vertexBytes = (glm::uint64)header.vertexCount * header.vertexStride;
+	header.indexBytes = (glm::uint64)header.indexCount * header.indexSize;
+	header.lodCount = (glm::uint32)mesh.lods.size();
+	header.vertexOffset = alignUp(sizeof(MeshFileHeader) + mesh.lods.size() * sizeof(MeshLod), MESH_FILE_ALIGNMENT);
+	header.indexOffset = alignUp(header.vertexOffset + header.vertexBytes, MESH_FILE_ALIGNMENT);
+
+	header.boundsMin = glm::vec3(FLT_MAX);
+	header.boundsMax = glm::vec3(-FLT_MAX);
+	for (const MeshVertex & vertex : mesh.vertices)
+	{
+		header.boundsMin = glm::min(header.boundsMin, vertex.position);
+		header.boundsMax = glm::max(header.boundsMax, vertex.position);
+	}
+
+	FILE * file = fopen(fileName, "wb");
+	if (!file)
+	{
+		printf("Could not create %s\n", fileName);
+		return false;
+	}
+
+	glm::uint64 lodBytes = mesh.lods.size() * sizeof(MeshLod);
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		(lodBytes == 0 || fwrite(mesh.lods.data(), 1, (size_t)lodBytes, file) == lodBytes) &&
+		writePadding(file, sizeof(header) + lodBytes, header.vertexOffset) &&
+		fwrite(mesh.vertices.data(), 1, (size_t)header.vertexBytes, file) == header.vertexBytes &&
+		writePadding(file, header.vertexOffset + header.vertexBytes, header.indexOffset);
+
+	if (written && header.indexSize == 2)
+	{
+		std::vector<glm::uint16> shortIndices(mesh.indices.begin(), mesh.indices.end());
+		written = fwrite(shortIndices.data(), 1, (size_t)header.indexBytes, file) == header.indexBytes;
+	}
+	else if (written)
+		written = fwrite(mesh.indices.data(), 1, (size_t)header.indexBytes, file) == header.indexBytes;
+
+	if (fclose(file) != 0 || !written)
+	{
+		printf("Could not write %s\n", fileName);
+		return false;
+	}
+	return true;
+}
+
+MeshFile::MeshFile()
+{
+	header = nullptr;
+	lods = nullptr;
+}
+
+bool MeshFile::open(const char * fileName)
+{
+	close();
+	if (!file.open(fileName))
+		return false;
+
+	const MeshFileHeader * candidate = (const MeshFileHeader *)file.getData();
+	size_t size = file.getSize();
+
+	if (size < sizeof(MeshFileHeader) || memcmp(candidate->magic, MESH_FILE_MAGIC, sizeof(candidate->magic)) != 0)
+	{
+		printf("%s is not a binary mesh file\n", fileName);
+		close();
+		return false;
+	}
+
+	if ((candidate->version != 1 && candidate->version != MESH_FILE_VERSION) || candidate->vertexStride != sizeof(MeshVertex) ||
+		(candidate->indexSize != 2 && candidate->indexSize != 4))
+	{
+		printf("%s has unsupported version %u or layout\n", fileName, candidate->version);
+		close();
+		return false;
+	}
+
+	if (candidate->vertexBytes != (glm::uint64)candidate->vertexCount * candidate->vertexStride ||
+		candidate->indexBytes != (glm::uint64)candidate->indexCount * candidate->indexSize ||
+		candidate->vertexOffset % MESH_FILE_ALIGNMENT != 0 || candidate->indexOffset % MESH_FILE_ALIGNMENT != 0 ||
+		candidate->vertexOffset + candidate->vertexBytes > size || candidate->indexOffset + candidate->indexBytes > size)
+	{
+		printf("%s is truncated or corrupt\n", fileName);
+		close();
+		return false;
+	}
+
+	// Version 1 files left the LOD count zeroed
+	unsigned int lodCount = candidate->version == 1 ? 0 : candidate->lodCount;
+	const MeshLod * candidateLods = (const MeshLod *)(file.getData() + sizeof(MeshFileHeader));
+	bool lodsValid = lodCount <= MESH_MAX_LODS && sizeof(MeshFileHeader) + lodCount * sizeof(MeshLod) <= candidate->vertexOffset;
+	for (unsigned int i = 0; lodsValid && i < lodCount; i++)
+		lodsValid = candidateLods[i].indexCount % 3 == 0 && (glm::uint64)candidateLods[i].firstIndex + candidateLods[i].indexCount <= candidate->indexCount;
+	if (!lodsValid)
+	{
+		printf("%s has a corrupt LOD table\n", fileName);
+		close();
+		return false;
+	}
+
+	header = candidate;
+	lods = lodCount > 0 ? candidateLods : nullptr;
+	return true;
+}
+
+void MeshFile::close()
+{
+	file.close();
+	header = nullptr;
+	lods = nullptr;
+}
+
+const MeshFileHeader & MeshFile::getHeader() const
+{
+	return *header;
+}
+
+const MeshVertex * MeshFile::getVertices() const
+{
+	return (const MeshVertex *)(file.getData() + header->vertexOffset);
+}
+
+const void * MeshFile::getIndices() const
+{
+	return file.getData() + header->indexOffset;
+}
+
+unsigned int MeshFile::getVertexCount() const
+{
+	return header->vertexCount;
+}
+
+unsigned int MeshFile::getIndexCount() const
+{
+	return header->indexCount;
+}
+
+unsigned int MeshFile::getIndexSize() const
+{
+	return header->indexSize;
+}
+
+unsigned int MeshFile::getLodCount() const
+{
+	return lods ? header->lodCount : 1;
+}
+
+MeshLod MeshFile::getLod(unsigned int level) const
+{
+	if (lods)
+		return lods[level];
+
+	MeshLod whole = { 0, header->indexCount, 0.0f, 0 };
+	return whole;
+}
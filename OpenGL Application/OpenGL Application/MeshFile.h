@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <glm.hpp>
+#include "MappedFile.h"
+
+// Interleaved vertex of the binary mesh format, 32 bytes
+struct MeshVertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 uv;
+};
+
+// Level of detail: a range of the index list drawing the whole mesh, with
+// error the estimated distance in model units from the full detail surface
+struct MeshLod
+{
+	glm::uint32 firstIndex;
+	glm::uint32 indexCount;
+	float error;
+	glm::uint32 reserved;
+};
+
+const unsigned int MESH_MAX_LODS = 8;
+
+struct MeshData
+{
+	std::vector<MeshVertex> vertices;
+	std::vector<unsigned int> indices; // triangle list
+	std::vector<MeshLod> lods; // finest first, empty when every index is one level
+};
+
+// Binary mesh file, little endian. The header and lodCount MeshLod entries
+// are followed by the vertex and index blobs, each starting at a
+// MESH_FILE_ALIGNMENT boundary, in exactly the layout the GPU buffers use so
+// a mapped file uploads without copying. Version 1 files have no LODs.
+struct MeshFileHeader
+{
+	char magic[4]; // MESH_FILE_MAGIC
+	glm::uint32 version;
+	glm::uint32 vertexCount;
+	glm::uint32 vertexStride; // sizeof(MeshVertex)
+	glm::uint32 indexCount;
+	glm::uint32 indexSize; // 2 when every index fits in 16 bits, 4 otherwise
+	glm::uint64 vertexOffset;
+	glm::uint64 vertexBytes;
+	glm::uint64 indexOffset;
+	glm::uint64 indexBytes;
+	glm::vec3 boundsMin;
+	glm::uint32 lodCount; // 0 when every index is one level
+	glm::vec3 boundsMax;
+	glm::uint32 reserved1;
+};
+
+const char MESH_FILE_MAGIC[4] = { 'V', 'S', 'M', 'B' };
+const glm::uint32 MESH_FILE_VERSION = 2;
+const glm::uint64 MESH_FILE_ALIGNMENT = 256;
+
+bool writeMeshFile(const char * fileName, const MeshData & mesh);
+
+// Memory mapped binary mesh. open() only checks the header, the blobs are
+// paged in when first read.
+class MeshFile
+{
+private:
+	MappedFile file;
+	const MeshFileHeader * header;
+	const MeshLod * lods;
+public:
+	MeshFile();
+	bool open(const char * fileName);
+	void close();
+	const MeshFileHeader & getHeader() const;
+	const MeshVertex * getVertices() const;
+	const void * getIndices() const;
+	unsigned int getVertexCount() const;
+	unsigned int getIndexCount() const;
+	unsigned int getIndexSize() const;
+	unsigned int getLodCount() const; // at least 1
+	MeshLod getLod(unsigned int level) const;
+};
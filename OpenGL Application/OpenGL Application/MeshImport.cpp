@@ -0,0 +1,778 @@
+#include "MeshImport.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include "MeshSimplify.h"
+#include "MeshWeld.h"
+
+using std::string;
+
+// Welding cells: positions as a fraction of the bounding box diagonal,
+// normals and texture coordinates in their own units
+const float WELD_POSITION_TOLERANCE = 1e-6f, WELD_NORMAL_TOLERANCE = 1e-3f, WELD_UV_TOLERANCE = 1e-5f;
+
+static bool readFile(const char * fileName, string & contents)
+{
+	FILE * file = fopen(fileName, "rb");
+	if (!file)
+	{
+		printf("Could not open %s\n", fileName);
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	contents.resize(size > 0 ? (size_t)size : 0);
+	bool read = size >= 0 && (size == 0 || fread(&contents[0], 1, contents.size(), file) == contents.size());
+	fclose(file);
+
+	if (!read)
+		printf("Could not read %s\n", fileName);
+	return read;
+}
+
+static bool hasExtension(const char * fileName, const char * extension)
+{
+	size_t length = strlen(fileName), extensionLength = strlen(extension);
+	if (length < extensionLength)
+		return false;
+
+	for (size_t i = 0; i < extensionLength; i++)
+		if (tolower((unsigned char)fileName[length - extensionLength + i]) != extension[i])
+			return false;
+	return true;
+}
+
+// Area weighted smooth normals for the vertices from firstVertex on that
+// have none, from the triangles from firstIndex on
+static void generateNormals(MeshData & mesh, size_t firstVertex, size_t firstIndex)
+{
+	std::vector<glm::vec3> sums(mesh.vertices.size() - firstVertex, glm::vec3(0.0f));
+	for (size_t i = firstIndex; i + 2 < mesh.indices.size(); i += 3)
+	{
+		unsigned int a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+		glm::vec3 normal = glm::cross(mesh.vertices[b].position - mesh.vertices[a].position, mesh.vertices[c].position - mesh.vertices[a].position);
+		sums[a - firstVertex] += normal;
+		sums[b - firstVertex] += normal;
+		sums[c - firstVertex] += normal;
+	}
+
+	for (size_t v = firstVertex; v < mesh.vertices.size(); v++)
+	{
+		glm::vec3 & normal = mesh.vertices[v].normal;
+		glm::vec3 sum = sums[v - firstVertex];
+		if (normal == glm::vec3(0.0f) && glm::dot(sum, sum) > 0.0f)
+			normal = glm::normalize(sum);
+	}
+}
+
+// OBJ
+
+struct ObjCorner
+{
+	int position;
+	int uv; // -1 when absent
+	int normal;
+
+	bool operator==(const ObjCorner & other) const
+	{
+		return position == other.position && uv == other.uv && normal == other.normal;
+	}
+};
+
+struct ObjCornerHash
+{
+	size_t operator()(const ObjCorner & corner) const
+	{
+		return (size_t)corner.position * 73856093u ^ (size_t)(corner.uv + 1) * 19349663u ^ (size_t)(corner.normal + 1) * 83492791u;
+	}
+};
+
+static void skipSpaces(const char *& p, const char * end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+}
+
+static void skipLine(const char *& p, const char * end)
+{
+	while (p < end && *p != '\n')
+		p++;
+	if (p < end)
+		p++;
+}
+
+// Parses floats until the end of the line, up to count of them
+static int parseFloats(const char *& p, const char * end, float * values, int count)
+{
+	int parsed = 0;
+	for (; parsed < count; parsed++)
+	{
+		skipSpaces(p, end);
+		char * next;
+		values[parsed] = strtof(p, &next);
+		if (next == p)
+			break;
+		p = next;
+	}
+	return parsed;
+}
+
+// 1 based or negative relative OBJ index to a 0 based one, -1 if out of range
+static int resolveObjIndex(long index, size_t count)
+{
+	long resolved = index > 0 ? index - 1 : (long)count + index;
+	return resolved >= 0 && (size_t)resolved < count ? (int)resolved : -1;
+}
+
+bool importObj(const char * fileName, MeshData & mesh)
+{
+	string contents;
+	if (!readFile(fileName, contents))
+		return false;
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+	std::unordered_map<ObjCorner, unsigned int, ObjCornerHash> corners;
+	std::vector<unsigned int> polygon;
+
+	const char * p = contents.data();
+	const char * end = p + contents.size();
+	unsigned int line = 1;
+	for (; p < end; line++)
+	{
+		skipSpaces(p, end);
+		if (p + 1 < end && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			p++;
+			glm::vec3 position(0.0f);
+			parseFloats(p, end, &position.x, 3);
+			positions.push_back(position);
+		}
+		else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			p += 2;
+			glm::vec3 normal(0.0f);
+			parseFloats(p, end, &normal.x, 3);
+			normals.push_back(normal);
+		}
+		else if (p + 2 < end && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			p += 2;
+			glm::vec2 uv(0.0f);
+			parseFloats(p, end, &uv.x, 2);
+			uvs.push_back(uv);
+		}
+		else if (p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			p++;
+			polygon.clear();
+			for (;;)
+			{
+				skipSpaces(p, end);
+				if (p == end || *p == '\n' || *p == '#')
+					break;
+
+				char * next;
+				ObjCorner corner = { resolveObjIndex(strtol(p, &next, 10), positions.size()), -1, -1 };
+				bool valid = next != p && corner.position >= 0;
+				p = next;
+				if (valid && p < end && *p == '/')
+				{
+					p++;
+					if (p < end && *p != '/')
+					{
+						corner.uv = resolveObjIndex(strtol(p, &next, 10), uvs.size());
+						valid = next != p && corner.uv >= 0;
+						p = next;
+					}
+					if (valid && p < end && *p == '/')
+					{
+						p++;
+						corner.normal = resolveObjIndex(strtol(p, &next, 10), normals.size());
+						valid = next != p && corner.normal >= 0;
+						p = next;
+					}
+				}
+
+				if (!valid)
+				{
+					printf("%s:%u: invalid face index\n", fileName, line);
+					return false;
+				}
+
+				auto inserted = corners.insert(std::make_pair(corner, (unsigned int)mesh.vertices.size()));
+				if (inserted.second)
+				{
+					MeshVertex vertex;
+					vertex.position = positions[corner.position];
+					vertex.normal = corner.normal >= 0 ? normals[corner.normal] : glm::vec3(0.0f);
+					vertex.uv = corner.uv >= 0 ? uvs[corner.uv] : glm::vec2(0.0f);
+					mesh.vertices.push_back(vertex);
+				}
+				polygon.push_back(inserted.first->second);
+			}
+
+			for (size_t i = 2; i < polygon.size(); i++)
+				mesh.indices.insert(mesh.indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+		}
+		skipLine(p, end);
+	}
+
+	generateNormals(mesh, 0, 0);
+	return true;
+}
+
+// glTF
+
+struct JsonValue
+{
+	enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+	Type type;
+	double number;
+	string text;
+	std::vector<string> keys; // object member names, matching values
+	std::vector<JsonValue> values; // array elements or object members
+
+	JsonValue()
+	{
+		type = JSON_NULL;
+		number = 0.0;
+	}
+
+	const JsonValue * find(const char * key) const
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+			if (keys[i] == key)
+				return &values[i];
+		return nullptr;
+	}
+
+	int getInt(const char * key, int fallback) const
+	{
+		const JsonValue * value = find(key);
+		return value && value->type == JSON_NUMBER ? (int)value->number : fallback;
+	}
+
+	const JsonValue * getElement(const char * key, int index) const
+	{
+		const JsonValue * array = find(key);
+		return array && array->type == JSON_ARRAY && index >= 0 && (size_t)index < array->values.size() ? &array->values[index] : nullptr;
+	}
+};
+
+static void skipWhitespace(const char *& p, const char * end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+		p++;
+}
+
+static void appendUtf8(string & text, unsigned int codePoint)
+{
+	if (codePoint < 0x80)
+		text += (char)codePoint;
+	else if (codePoint < 0x800)
+	{
+		text += (char)(0xc0 | (codePoint >> 6));
+		text += (char)(0x80 | (codePoint & 0x3f));
+	}
+	else
+	{
+		text += (char)(0xe0 | (codePoint >> 12));
+		text += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+		text += (char)(0x80 | (codePoint & 0x3f));
+	}
+}
+
+static bool parseJsonString(const char *& p, const char * end, string & text)
+{
+	p++; // opening quote
+	while (p < end && *p != '"')
+	{
+		if (*p != '\\')
+		{
+			text += *p++;
+			continue;
+		}
+
+		if (++p == end)
+			return false;
+		char escape = *p++;
+		switch (escape)
+		{
+		case 'b': text += '\b'; break;
+		case 'f': text += '\f'; break;
+		case 'n': text += '\n'; break;
+		case 'r': text += '\r'; break;
+		case 't': text += '\t'; break;
+		case 'u':
+			if (end - p < 4)
+				return false;
+			appendUtf8(text, (unsigned int)strtoul(string(p, 4).c_str(), nullptr, 16));
+			p += 4;
+			break;
+		default: text += escape; break;
+		}
+	}
+
+	if (p == end)
+		return false;
+	p++; // closing quote
+	return true;
+}
+
+static bool parseJson(const char *& p, const char * end, JsonValue & value)
+{
+	skipWhitespace(p, end);
+	if (p == end)
+		return false;
+
+	if (*p == '{' || *p == '[')
+	{
+		bool object = *p == '{';
+		char close = object ? '}' : ']';
+		value.type = object ? JsonValue::JSON_OBJECT : JsonValue::JSON_ARRAY;
+		p++;
+		skipWhitespace(p, end);
+		if (p < end && *p == close)
+		{
+			p++;
+			return true;
+		}
+
+		for (;;)
+		{
+			if (object)
+			{
+				skipWhitespace(p, end);
+				value.keys.push_back(string());
+				if (p == end || *p != '"' || !parseJsonString(p, end, value.keys.back()))
+					return false;
+				skipWhitespace(p, end);
+				if (p == end || *p++ != ':')
+					return false;
+			}
+
+			value.values.push_back(JsonValue());
+			if (!parseJson(p, end, value.values.back()))
+				return false;
+
+			skipWhitespace(p, end);
+			if (p == end)
+				return false;
+			if (*p == close)
+			{
+				p++;
+				return true;
+			}
+			if (*p++ != ',')
+				return false;
+		}
+	}
+
+	if (*p == '"')
+	{
+		value.type = JsonValue::JSON_STRING;
+		return parseJsonString(p, end, value.text);
+	}
+
+	static const char * literals[] = { "true", "false", "null" };
+	for (int i = 0; i < 3; i++)
+	{
+		size_t length = strlen(literals[i]);
+		if ((size_t)(end - p) >= length && strncmp(p, literals[i], length) == 0)
+		{
+			value.type = i < 2 ? JsonValue::JSON_BOOL : JsonValue::JSON_NULL;
+			value.number = i == 0 ? 1.0 : 0.0;
+			p += length;
+			return true;
+		}
+	}
+
+	// The text of a number ends at a delimiter, so strtod cannot run past the buffer
+	char * next;
+	value.type = JsonValue::JSON_NUMBER;
+	value.number = strtod(p, &next);
+	if (next == p)
+		return false;
+	p = next;
+	return true;
+}
+
+static bool decodeBase64(const char * p, const char * end, std::vector<unsigned char> & bytes)
+{
+	unsigned int bits = 0;
+	int bitCount = 0;
+	for (; p < end && *p != '='; p++)
+	{
+		int digit;
+		if (*p >= 'A' && *p <= 'Z') digit = *p - 'A';
+		else if (*p >= 'a' && *p <= 'z') digit = *p - 'a' + 26;
+		else if (*p >= '0' && *p <= '9') digit = *p - '0' + 52;
+		else if (*p == '+') digit = 62;
+		else if (*p == '/') digit = 63;
+		else return false;
+
+		bits = (bits << 6) | digit;
+		bitCount += 6;
+		if (bitCount >= 8)
+		{
+			bitCount -= 8;
+			bytes.push_back((unsigned char)(bits >> bitCount));
+		}
+	}
+	return true;
+}
+
+struct GltfAsset
+{
+	JsonValue root;
+	std::vector<std::vector<unsigned char>> buffers;
+};
+
+static bool loadGltfBuffers(const char * fileName, const std::vector<unsigned char> & binaryChunk, GltfAsset & asset)
+{
+	string directory(fileName);
+	size_t slash = directory.find_last_of("/\\");
+	directory = slash == string::npos ? string() : directory.substr(0, slash + 1);
+
+	const JsonValue * buffers = asset.root.find("buffers");
+	size_t count = buffers && buffers->type == JsonValue::JSON_ARRAY ? buffers->values.size() : 0;
+	asset.buffers.resize(count);
+	for (size_t b = 0; b < count; b++)
+	{
+		const JsonValue & buffer = buffers->values[b];
+		const JsonValue * uri = buffer.find("uri");
+		std::vector<unsigned char> & bytes = asset.buffers[b];
+
+		if (!uri)
+			bytes = binaryChunk;
+		else if (uri->text.compare(0, 5, "data:") == 0)
+		{
+			size_t comma = uri->text.find(";base64,");
+			if (comma == string::npos || !decodeBase64(uri->text.data() + comma + 8, uri->text.data() + uri->text.size(), bytes))
+			{
+				printf("%s: buffer %u has an unsupported data URI\n", fileName, (unsigned int)b);
+				return false;
+			}
+		}
+		else
+		{
+			string contents;
+			if (!readFile((directory + uri->text).c_str(), contents))
+				return false;
+			bytes.assign(contents.begin(), contents.end());
+		}
+
+		if (bytes.size() < (size_t)buffer.getInt("byteLength", 0))
+		{
+			printf("%s: buffer %u is shorter than its byteLength\n", fileName, (unsigned int)b);
+			return false;
+		}
+	}
+	return true;
+}
+
+enum GltfComponentType
+{
+	GLTF_UNSIGNED_BYTE = 5121,
+	GLTF_UNSIGNED_SHORT = 5123,
+	GLTF_UNSIGNED_INT = 5125,
+	GLTF_FLOAT = 5126
+};
+
+static size_t gltfComponentSize(int componentType)
+{
+	switch (componentType)
+	{
+	case GLTF_UNSIGNED_BYTE: return 1;
+	case GLTF_UNSIGNED_SHORT: return 2;
+	case GLTF_UNSIGNED_INT: case GLTF_FLOAT: return 4;
+	default: return 0;
+	}
+}
+
+// Location of every element of an accessor, after bounds checking
+struct GltfElements
+{
+	const unsigned char * first;
+	size_t stride;
+	size_t count;
+	int componentType;
+	bool normalized;
+};
+
+static bool findAccessor(const GltfAsset & asset, int index, int components, GltfElements & elements)
+{
+	const JsonValue * accessor = asset.root.getElement("accessors", index);
+	if (!accessor || accessor->find("sparse"))
+		return false;
+
+	const JsonValue * type = accessor->find("type");
+	static const char * types[] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+	if (!type || type->text != types[components - 1])
+		return false;
+
+	elements.componentType = accessor->getInt("componentType", 0);
+	elements.count = (size_t)accessor->getInt("count", 0);
+	const JsonValue * normalized = accessor->find("normalized");
+	elements.normalized = normalized && normalized->number != 0.0;
+	size_t elementSize = gltfComponentSize(elements.componentType) * components;
+
+	const JsonValue * view = asset.root.getElement("bufferViews", accessor->getInt("bufferView", -1));
+	if (!view || elementSize == 0)
+		return false;
+
+	int buffer = view->getInt("buffer", -1);
+	if (buffer < 0 || (size_t)buffer >= asset.buffers.size())
+		return false;
+
+	size_t viewOffset = (size_t)view->getInt("byteOffset", 0);
+	size_t viewLength = (size_t)view->getInt("byteLength", 0);
+	size_t offset = (size_t)accessor->getInt("byteOffset", 0);
+	elements.stride = (size_t)view->getInt("byteStride", 0);
+	if (elements.stride == 0)
+		elements.stride = elementSize;
+
+	if (viewOffset + viewLength > asset.buffers[buffer].size() ||
+		(elements.count > 0 && offset + (elements.count - 1) * elements.stride + elementSize > viewLength))
+		return false;
+
+	elements.first = asset.buffers[buffer].data() + viewOffset + offset;
+	return true;
+}
+
+// Float or normalized unsigned accessor of up to 4 components
+static bool readGltfFloats(const GltfAsset & asset, int index, int components, std::vector<float> & values)
+{
+	GltfElements elements;
+	if (!findAccessor(asset, index, components, elements))
+		return false;
+	if (elements.componentType != GLTF_FLOAT && !elements.normalized)
+		return false;
+
+	values.resize(elements.count * components);
+	for (size_t i = 0; i < elements.count; i++)
+	{
+		const unsigned char * element = elements.first + i * elements.stride;
+		for (int c = 0; c < components; c++)
+		{
+			float & value = values[i * components + c];
+			if (elements.componentType == GLTF_FLOAT)
+				memcpy(&value, element + c * 4, 4);
+			else if (elements.componentType == GLTF_UNSIGNED_BYTE)
+				value = element[c] / 255.0f;
+			else
+			{
+				glm::uint16 unorm;
+				memcpy(&unorm, element + c * 2, 2);
+				value = unorm / 65535.0f;
+			}
+		}
+	}
+	return true;
+}
+
+static bool readGltfIndices(const GltfAsset & asset, int index, std::vector<unsigned int> & indices)
+{
+	GltfElements elements;
+	if (!findAccessor(asset, index, 1, elements) || elements.componentType == GLTF_FLOAT)
+		return false;
+
+	indices.resize(elements.count);
+	for (size_t i = 0; i < elements.count; i++)
+	{
+		const unsigned char * element = elements.first + i * elements.stride;
+		if (elements.componentType == GLTF_UNSIGNED_BYTE)
+			indices[i] = *element;
+		else if (elements.componentType == GLTF_UNSIGNED_SHORT)
+		{
+			glm::uint16 value;
+			memcpy(&value, element, 2);
+			indices[i] = value;
+		}
+		else
+			memcpy(&indices[i], element, 4);
+	}
+	return true;
+}
+
+static bool importGltfPrimitive(const char * fileName, const GltfAsset & asset, const JsonValue & primitive, MeshData & mesh)
+{
+	const JsonValue * attributes = primitive.find("attributes");
+	int positionAccessor = attributes ? attributes->getInt("POSITION", -1) : -1;
+	if (primitive.getInt("mode", 4) != 4 || positionAccessor < 0)
+	{
+		printf("%s: skipping a primitive that is not an indexed or plain triangle list\n", fileName);
+		return true;
+	}
+
+	std::vector<float> positions, normals, uvs;
+	std::vector<unsigned int> indices;
+	int normalAccessor = attributes->getInt("NORMAL", -1);
+	int uvAccessor = attributes->getInt("TEXCOORD_0", -1);
+	int indexAccessor = primitive.getInt("indices", -1);
+
+	if (!readGltfFloats(asset, positionAccessor, 3, positions) ||
+		(normalAccessor >= 0 && !readGltfFloats(asset, normalAccessor, 3, normals)) ||
+		(uvAccessor >= 0 && !readGltfFloats(asset, uvAccessor, 2, uvs)) ||
+		(indexAccessor >= 0 && !readGltfIndices(asset, indexAccessor, indices)))
+	{
+		printf("%s: unsupported or out of range accessor\n", fileName);
+		return false;
+	}
+
+	size_t vertexCount = positions.size() / 3;
+	if (indexAccessor < 0)
+		for (size_t i = 0; i < vertexCount; i++)
+			indices.push_back((unsigned int)i);
+
+	if (normals.size() != positions.size() || uvs.size() / 2 != vertexCount)
+	{
+		normals.resize(positions.size(), 0.0f);
+		uvs.resize(vertexCount * 2, 0.0f);
+	}
+
+	size_t firstVertex = mesh.vertices.size(), firstIndex = mesh.indices.size();
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		MeshVertex vertex;
+		vertex.position = glm::vec3(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]);
+		vertex.normal = glm::vec3(normals[v * 3], normals[v * 3 + 1], normals[v * 3 + 2]);
+		vertex.uv = glm::vec2(uvs[v * 2], uvs[v * 2 + 1]);
+		mesh.vertices.push_back(vertex);
+	}
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+		{
+			printf("%s: index out of range\n", fileName);
+			return false;
+		}
+		for (int k = 0; k < 3; k++)
+			mesh.indices.push_back((unsigned int)firstVertex + indices[i + k]);
+	}
+
+	generateNormals(mesh, firstVertex, firstIndex);
+	return true;
+}
+
+bool importGltf(const char * fileName, MeshData & mesh)
+{
+	string contents;
+	if (!readFile(fileName, contents))
+		return false;
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	// A .glb is a 12 byte header followed by a JSON and an optional BIN chunk
+	const char * json = contents.data();
+	const char * jsonEnd = json + contents.size();
+	std::vector<unsigned char> binaryChunk;
+	if (contents.size() >= 20 && contents.compare(0, 4, "glTF") == 0)
+	{
+		glm::uint32 jsonLength, chunkType;
+		memcpy(&jsonLength, &contents[12], 4);
+		memcpy(&chunkType, &contents[16], 4);
+		if (chunkType != 0x4e4f534a || 20 + (size_t)jsonLength > contents.size())
+		{
+			printf("%s: invalid binary glTF\n", fileName);
+			return false;
+		}
+		json = contents.data() + 20;
+		jsonEnd = json + jsonLength;
+
+		size_t binary = 20 + (size_t)jsonLength;
+		if (binary + 8 <= contents.size())
+		{
+			glm::uint32 binaryLength;
+			memcpy(&binaryLength, &contents[binary], 4);
+			if (binary + 8 + binaryLength <= contents.size())
+				binaryChunk.assign(contents.begin() + binary + 8, contents.begin() + binary + 8 + binaryLength);
+		}
+	}
+
+	GltfAsset asset;
+	if (!parseJson(json, jsonEnd, asset.root) || asset.root.type != JsonValue::JSON_OBJECT)
+	{
+		printf("%s: invalid JSON\n", fileName);
+		return false;
+	}
+
+	if (!loadGltfBuffers(fileName, binaryChunk, asset))
+		return false;
+
+	const JsonValue * meshes = asset.root.find("meshes");
+	if (meshes && meshes->type == JsonValue::JSON_ARRAY)
+	{
+		for (const JsonValue & gltfMesh : meshes->values)
+		{
+			const JsonValue * primitives = gltfMesh.find("primitives");
+			if (!primitives)
+				continue;
+			for (const JsonValue & primitive : primitives->values)
+				if (!importGltfPrimitive(fileName, asset, primitive, mesh))
+					return false;
+		}
+	}
+	return true;
+}
+
+bool isImportableMesh(const char * fileName)
+{
+	return hasExtension(fileName, ".obj") || hasExtension(fileName, ".gltf") || hasExtension(fileName, ".glb");
+}
+
+bool importMesh(const char * fileName, MeshData & mesh)
+{
+	if (hasExtension(fileName, ".obj"))
+		return importObj(fileName, mesh);
+	if (hasExtension(fileName, ".gltf") || hasExtension(fileName, ".glb"))
+		return importGltf(fileName, mesh);
+
+	printf("%s: unknown mesh format, expected .obj, .gltf or .glb\n", fileName);
+	return false;
+}
+
+bool convertMesh(const char * inputFileName, const char * outputFileName, unsigned int lodCount)
+{
+	MeshData mesh;
+	if (!importMesh(inputFileName, mesh))
+		return false;
+
+	// Copies the importers keep apart, such as across glTF primitives, are
+	// welded first so simplification sees one connected surface
+	glm::vec3 boundsMin(INFINITY), boundsMax(-INFINITY);
+	for (const MeshVertex & vertex : mesh.vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+	float diagonal = mesh.vertices.empty() ? 0.0f : glm::length(boundsMax - boundsMin);
+	unsigned int welded = weldMesh(mesh, WELD_POSITION_TOLERANCE * diagonal, WELD_NORMAL_TOLERANCE, WELD_UV_TOLERANCE);
+	if (welded)
+		printf("Welded %u duplicate vertices\n", welded);
+
+	buildLodChain(mesh, lodCount);
+	if (!writeMeshFile(outputFileName, mesh))
+		return false;
+
+	printf("Converted %s to %s: %u vertices, %u triangles\n", inputFileName, outputFileName,
+		(unsigned int)mesh.vertices.size(), mesh.lods[0].indexCount / 3);
+	for (size_t level = 1; level < mesh.lods.size(); level++)
+		printf("  LOD %u: %u triangles, error %g\n", (unsigned int)level, mesh.lods[level].indexCount / 3, mesh.lods[level].error);
+	return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "MeshFile.h"
+
+// Text format importers used by the offline mesh conversion. Polygons are
+// triangulated as fans, and smooth normals are generated when the source
+// has none.
+
+// Wavefront OBJ, positions, texture coordinates and normals of every object
+// merged into one mesh
+bool importObj(const char * fileName, MeshData & mesh);
+
+// glTF 2.0 as .gltf with external or data URI buffers, or .glb. Triangle
+// primitives of every mesh are merged in their mesh space, node transforms
+// are not applied.
+bool importGltf(const char * fileName, MeshData & mesh);
+
+// Picks the importer by file extension
+bool importMesh(const char * fileName, MeshData & mesh);
+bool isImportableMesh(const char * fileName);
+
+// Converts an OBJ or glTF file to the binary mesh format with a chain of up
+// to lodCount detail levels, 1 for the full mesh only
+bool convertMesh(const char * inputFileName, const char * outputFileName, unsigned int lodCount);
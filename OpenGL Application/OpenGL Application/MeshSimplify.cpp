@@ -0,0 +1,351 @@
+#include "MeshSimplify.h"
+#include <algorithm>
+#include <cmath>
+#include "ThreadPool.h"
+
+// Border planes weigh this much more than triangle planes of the same area
+static const double BORDER_WEIGHT = 10.0;
+// Collapses may turn a triangle's normal by less than about 75 degrees
+static const double MIN_NORMAL_COSINE = 0.25;
+// A level keeping more of the triangles of the one before ends the chain
+static const double LOD_STALL_RATIO = 0.9;
+
+enum VertexKind
+{
+	VERTEX_MANIFOLD,
+	VERTEX_BORDER, // only moves along its border
+	VERTEX_SEAM    // attributes differ between its copies, or non-manifold; never moves
+};
+
+// Weighted sum of squared plane distances, p.Ap + 2b.p + c
+struct Quadric
+{
+	double a00, a01, a02, a11, a12, a22;
+	double b0, b1, b2;
+	double c;
+	double weight;
+};
+
+struct Collapse
+{
+	unsigned int from; // surface vertex removed
+	unsigned int to;   // copy of the vertex it moves onto, as used next to from
+	double cost;
+};
+
+static void addPlane(Quadric & q, const glm::dvec3 & normal, double distance, double weight)
+{
+	q.a00 += weight * normal.x * normal.x;
+	q.a01 += weight * normal.x * normal.y;
+	q.a02 += weight * normal.x * normal.z;
+	q.a11 += weight * normal.y * normal.y;
+	q.a12 += weight * normal.y * normal.z;
+	q.a22 += weight * normal.z * normal.z;
+	q.b0 += weight * normal.x * distance;
+	q.b1 += weight * normal.y * distance;
+	q.b2 += weight * normal.z * distance;
+	q.c += weight * distance * distance;
+	q.weight += weight;
+}
+
+static void addQuadric(Quadric & q, const Quadric & other)
+{
+	q.a00 += other.a00;
+	q.a01 += other.a01;
+	q.a02 += other.a02;
+	q.a11 += other.a11;
+	q.a12 += other.a12;
+	q.a22 += other.a22;
+	q.b0 += other.b0;
+	q.b1 += other.b1;
+	q.b2 += other.b2;
+	q.c += other.c;
+	q.weight += other.weight;
+}
+
+// Mean squared distance of p from the planes
+static double quadricError(const Quadric & q, const glm::dvec3 & p)
+{
+	if (q.weight <= 0.0)
+		return 0.0;
+
+	double x = q.a00 * p.x + q.a01 * p.y + q.a02 * p.z;
+	double y = q.a01 * p.x + q.a11 * p.y + q.a12 * p.z;
+	double z = q.a02 * p.x + q.a12 * p.y + q.a22 * p.z;
+	double error = p.x * x + p.y * y + p.z * z + 2.0 * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) + q.c;
+	return std::max(error, 0.0) / q.weight;
+}
+
+static glm::uint64 edgeKey(unsigned int a, unsigned int b)
+{
+	return a < b ? (glm::uint64)a << 32 | b : (glm::uint64)b << 32 | a;
+}
+
+// Undirected edges of the triangles with the triangle each came from,
+// sorted so the copies of an edge are neighbours
+static void collectEdges(const std::vector<unsigned int> & indices, const std::vector<unsigned int> & remap, std::vector<std::pair<glm::uint64, unsigned int>> & edges)
+{
+	edges.clear();
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		size_t next = i % 3 == 2 ? i - 2 : i + 1;
+		edges.push_back(std::make_pair(edgeKey(remap[indices[i]], remap[indices[next]]), (unsigned int)(i / 3)));
+	}
+	std::sort(edges.begin(), edges.end());
+}
+
+float simplifyMesh(const MeshData & mesh, unsigned int targetIndexCount, std::vector<unsigned int> & indices)
+{
+	const std::vector<MeshVertex> & vertices = mesh.vertices;
+	unsigned int vertexCount = (unsigned int)vertices.size();
+	size_t firstIndex = mesh.lods.empty() ? 0 : mesh.lods[0].firstIndex;
+	size_t indexCount = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+	indices.assign(mesh.indices.begin() + firstIndex, mesh.indices.begin() + firstIndex + indexCount);
+
+	// Copies of a position are one surface vertex, named by its first copy
+	std::vector<unsigned int> order(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+	{
+		const glm::vec3 & p = vertices[a].position, & q = vertices[b].position;
+		return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+	});
+
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<unsigned char> kind(vertexCount, VERTEX_MANIFOLD);
+	for (unsigned int i = 0; i < vertexCount;)
+	{
+		const MeshVertex & first = vertices[order[i]];
+		unsigned int j = i;
+		for (; j < vertexCount && vertices[order[j]].position == first.position; j++)
+		{
+			remap[order[j]] = order[i];
+			if (vertices[order[j]].normal != first.normal || vertices[order[j]].uv != first.uv)
+				kind[order[i]] = VERTEX_SEAM;
+		}
+		i = j;
+	}
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric());
+	std::vector<glm::dvec3> normals(indices.size() / 3);
+	for (size_t t = 0; t < indices.size() / 3; t++)
+	{
+		glm::dvec3 p0 = vertices[indices[t * 3]].position, p1 = vertices[indices[t * 3 + 1]].position, p2 = vertices[indices[t * 3 + 2]].position;
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double length = glm::length(normal);
+		if (length == 0.0)
+			continue;
+
+		normals[t] = normal / length;
+		for (int k = 0; k < 3; k++)
+			addPlane(quadrics[remap[indices[t * 3 + k]]], normals[t], -glm::dot(normals[t], p0), 0.5 * length);
+	}
+
+	// Edges of one triangle are borders, of more than two non-manifold
+	std::vector<std::pair<glm::uint64, unsigned int>> edges;
+	collectEdges(indices, remap, edges);
+	for (size_t i = 0; i < edges.size();)
+	{
+		size_t j = i;
+		while (j < edges.size() && edges[j].first == edges[i].first)
+			j++;
+
+		unsigned int a = (unsigned int)(edges[i].first >> 32), b = (unsigned int)edges[i].first;
+		if (j - i == 1)
+		{
+			glm::dvec3 pa = vertices[a].position, pb = vertices[b].position;
+			glm::dvec3 normal = glm::cross(pb - pa, normals[edges[i].second]);
+			double length = glm::length(normal);
+			if (length > 0.0)
+			{
+				normal /= length;
+				double weight = glm::dot(pb - pa, pb - pa) * BORDER_WEIGHT;
+				addPlane(quadrics[a], normal, -glm::dot(normal, pa), weight);
+				addPlane(quadrics[b], normal, -glm::dot(normal, pa), weight);
+			}
+			kind[a] = std::max(kind[a], (unsigned char)VERTEX_BORDER);
+			kind[b] = std::max(kind[b], (unsigned char)VERTEX_BORDER);
+		}
+		else if (j - i > 2)
+			kind[a] = kind[b] = VERTEX_SEAM;
+		i = j;
+	}
+
+	std::vector<unsigned int> triangleOffsets(vertexCount + 1), triangles;
+	std::vector<unsigned char> locked(vertexCount), removed(vertexCount);
+	std::vector<unsigned int> collapseTarget(vertexCount);
+	std::vector<glm::uint64> borderEdges;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> marks(vertexCount, 0);
+	unsigned int mark = 0;
+	double maxError = 0.0;
+
+	// Each pass collapses the cheapest edges whose surroundings no earlier
+	// collapse of the pass has touched
+	while (indices.size() > targetIndexCount)
+	{
+		size_t triangleCount = indices.size() / 3;
+
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (unsigned int index : indices)
+			triangleOffsets[remap[index] + 1]++;
+		for (unsigned int v = 0; v < vertexCount; v++)
+			triangleOffsets[v + 1] += triangleOffsets[v];
+		triangles.resize(indices.size());
+		std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			triangles[fill[remap[indices[i]]]++] = (unsigned int)(i / 3);
+
+		collectEdges(indices, remap, edges);
+		borderEdges.clear();
+		for (size_t i = 0; i < edges.size(); i++)
+			if ((i == 0 || edges[i - 1].first != edges[i].first) && (i + 1 == edges.size() || edges[i + 1].first != edges[i].first))
+				borderEdges.push_back(edges[i].first);
+
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			unsigned int a = indices[i], b = indices[i % 3 == 2 ? i - 2 : i + 1];
+			for (int direction = 0; direction < 2; direction++)
+			{
+				unsigned int from = remap[direction == 0 ? a : b], to = direction == 0 ? b : a;
+				if (kind[from] == VERTEX_SEAM)
+					continue;
+				if (kind[from] == VERTEX_BORDER && !std::binary_search(borderEdges.begin(), borderEdges.end(), edgeKey(from, remap[to])))
+					continue;
+
+				Quadric merged = quadrics[from];
+				addQuadric(merged, quadrics[remap[to]]);
+				Collapse collapse = { from, to, quadricError(merged, vertices[to].position) };
+				collapses.push_back(collapse);
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse & a, const Collapse & b) { return a.cost < b.cost; });
+
+		std::fill(locked.begin(), locked.end(), 0);
+		size_t removedTriangles = 0, wantedTriangles = triangleCount - targetIndexCount / 3;
+		for (const Collapse & collapse : collapses)
+		{
+			if (removedTriangles >= wantedTriangles)
+				break;
+			unsigned int from = collapse.from, to = remap[collapse.to];
+			if (locked[from] || locked[to])
+				continue;
+
+			// The triangles that stay must not fold over or degenerate
+			glm::dvec3 target = vertices[to].position;
+			bool flips = false;
+			size_t collapsing = 0;
+			for (unsigned int k = triangleOffsets[from]; k < triangleOffsets[from + 1] && !flips; k++)
+			{
+				const unsigned int * triangle = &indices[triangles[k] * 3];
+				glm::dvec3 p[3], moved[3];
+				bool shared = false;
+				for (int c = 0; c < 3; c++)
+				{
+					p[c] = moved[c] = vertices[triangle[c]].position;
+					if (remap[triangle[c]] == from)
+						moved[c] = target;
+					shared = shared || remap[triangle[c]] == to;
+				}
+				if (shared)
+				{
+					collapsing++;
+					continue;
+				}
+
+				glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]), after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+				flips = glm::dot(before, after) <= MIN_NORMAL_COSINE * glm::length(before) * glm::length(after);
+			}
+			if (flips)
+				continue;
+
+			// Link condition: the only neighbours the two share are the
+			// opposite corners of the collapsing triangles, or the surface
+			// would pinch into non-manifold edges
+			mark++;
+			for (unsigned int k = triangleOffsets[to]; k < triangleOffsets[to + 1]; k++)
+				for (int c = 0; c < 3; c++)
+					marks[remap[indices[triangles[k] * 3 + c]]] = mark;
+			marks[to] = marks[from] = 0;
+			size_t shared = 0;
+			for (unsigned int k = triangleOffsets[from]; k < triangleOffsets[from + 1]; k++)
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned int neighbour = remap[indices[triangles[k] * 3 + c]];
+					if (marks[neighbour] == mark)
+					{
+						marks[neighbour] = 0;
+						shared++;
+					}
+				}
+			if (shared > collapsing)
+				continue;
+
+			removed[from] = 1;
+			collapseTarget[from] = collapse.to;
+			addQuadric(quadrics[to], quadrics[from]);
+			maxError = std::max(maxError, collapse.cost);
+			removedTriangles += collapsing;
+			for (unsigned int k = triangleOffsets[from]; k < triangleOffsets[from + 1]; k++)
+				for (int c = 0; c < 3; c++)
+					locked[remap[indices[triangles[k] * 3 + c]]] = 1;
+		}
+		if (removedTriangles == 0)
+			break;
+
+		size_t kept = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			unsigned int triangle[3];
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int index = indices[t * 3 + c];
+				triangle[c] = removed[remap[index]] ? collapseTarget[remap[index]] : index;
+			}
+			if (remap[triangle[0]] == remap[triangle[1]] || remap[triangle[1]] == remap[triangle[2]] || remap[triangle[0]] == remap[triangle[2]])
+				continue;
+			for (int c = 0; c < 3; c++)
+				indices[kept++] = triangle[c];
+		}
+		indices.resize(kept);
+	}
+
+	return (float)sqrt(maxError);
+}
+
+void buildLodChain(MeshData & mesh, unsigned int maxLods)
+{
+	if (!mesh.lods.empty())
+		mesh.indices.resize(mesh.lods[0].indexCount);
+	mesh.lods.clear();
+
+	unsigned int fullCount = (unsigned int)mesh.indices.size();
+	MeshLod full = { 0, fullCount, 0.0f, 0 };
+	mesh.lods.push_back(full);
+
+	maxLods = std::min(maxLods, MESH_MAX_LODS);
+	if (maxLods <= 1)
+		return;
+
+	// Every level from the full mesh, so its error is measured against it
+	std::vector<std::vector<unsigned int>> levels(maxLods - 1);
+	std::vector<float> errors(maxLods - 1);
+	ThreadPool::instance().parallelFor(maxLods - 1, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t level = begin; level < end; level++)
+			errors[level] = simplifyMesh(mesh, (fullCount / 3 >> (level + 1)) * 3, levels[level]);
+	});
+
+	for (size_t level = 0; level < levels.size(); level++)
+	{
+		MeshLod previous = mesh.lods.back();
+		if (levels[level].empty() || levels[level].size() > previous.indexCount * LOD_STALL_RATIO)
+			break;
+
+		MeshLod lod = { (glm::uint32)mesh.indices.size(), (glm::uint32)levels[level].size(), std::max(errors[level], previous.error), 0 };
+		mesh.indices.insert(mesh.indices.end(), levels[level].begin(), levels[level].end());
+		mesh.lods.push_back(lod);
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "MeshFile.h"
+
+// Quadric error metric simplification (Garland and Heckbert). Edges collapse
+// onto one of their own vertices, so simplified indices draw from the
+// original vertex array and every level of a chain shares it. Vertices on
+// attribute seams are never removed, and open borders are held in place by
+// planes perpendicular to their triangles.
+
+// Collapses edges of the mesh, or of its first LOD, cheapest first, until
+// at most targetIndexCount indices remain or no edge can collapse without
+// flipping a triangle.
+// Returns the error: the largest root mean square distance of a kept vertex
+// from the triangle planes it absorbed, in model units.
+float simplifyMesh(const MeshData & mesh, unsigned int targetIndexCount, std::vector<unsigned int> & indices);
+
+// Appends levels of about half the triangles of the one before to
+// mesh.indices and describes every level, the full mesh first, in
+// mesh.lods. Stops at maxLods or once a level barely simplifies further.
+// Levels are simplified on the thread pool.
+void buildLodChain(MeshData & mesh, unsigned int maxLods);
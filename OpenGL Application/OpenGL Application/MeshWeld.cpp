@@ -0,0 +1,182 @@
+#include "MeshWeld.h"
+#include <cmath>
+#include <functional>
+#include <gtx/hash.hpp>
+#include "ThreadPool.h"
+
+const unsigned int INVALID_VERTEX = 0xffffffffu;
+// Vertices per parallelFor task, and the partition count as a power of two
+const size_t WELD_GRAIN = 16384;
+const unsigned int PARTITION_BITS = 6, PARTITION_COUNT = 1u << PARTITION_BITS;
+
+struct WeldKey
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 uv;
+
+	bool operator==(const WeldKey & other) const
+	{
+		return position == other.position && normal == other.normal && uv == other.uv;
+	}
+};
+
+// Index of the cell, still as floats so std::hash<glm::vec3> applies
+template <typename T>
+static T quantize(const T & value, float tolerance)
+{
+	return tolerance > 0.0f ? glm::floor(value / tolerance + 0.5f) : value;
+}
+
+// As glm's own hash_combine
+static size_t combineHash(size_t seed, size_t hash)
+{
+	return seed ^ (hash + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+// Top bits of a multiplicative mix, the table slots taking the low bits of
+// the hash itself
+static unsigned int partitionOf(size_t hash)
+{
+	glm::uint32 folded = (glm::uint32)hash ^ (glm::uint32)((glm::uint64)hash >> 32);
+	return (folded * 0x9e3779b1u) >> (32 - PARTITION_BITS);
+}
+
+unsigned int weldVertices(const MeshVertex * vertices, unsigned int count, float positionTolerance, float normalTolerance, float uvTolerance,
+	std::vector<unsigned int> & remap)
+{
+	remap.assign(count, INVALID_VERTEX);
+	if (count == 0)
+		return 0;
+
+	// Keys and hashes, and how many vertices of each block fall in each
+	// partition
+	std::vector<WeldKey> keys(count);
+	std::vector<size_t> hashes(count);
+	size_t blockCount = (count + WELD_GRAIN - 1) / WELD_GRAIN;
+	std::vector<unsigned int> blockCounts(blockCount * PARTITION_COUNT, 0);
+	ThreadPool::instance().parallelFor(count, WELD_GRAIN, [&](size_t begin, size_t end)
+	{
+		std::hash<glm::vec3> hashVec3;
+		std::hash<glm::vec2> hashVec2;
+		unsigned int * counts = &blockCounts[begin / WELD_GRAIN * PARTITION_COUNT];
+		for (size_t i = begin; i < end; i++)
+		{
+			WeldKey & key = keys[i];
+			key.position = quantize(vertices[i].position, positionTolerance);
+			key.normal = quantize(vertices[i].normal, normalTolerance);
+			key.uv = quantize(vertices[i].uv, uvTolerance);
+			hashes[i] = combineHash(combineHash(hashVec3(key.position), hashVec3(key.normal)), hashVec2(key.uv));
+			counts[partitionOf(hashes[i])]++;
+		}
+	});
+
+	// Each block's first slot in each partition's list, which then holds
+	// the partition's vertices in their original order
+	std::vector<unsigned int> partitionStarts(PARTITION_COUNT + 1, 0);
+	unsigned int offset = 0;
+	for (unsigned int partition = 0; partition < PARTITION_COUNT; partition++)
+	{
+		partitionStarts[partition] = offset;
+		for (size_t block = 0; block < blockCount; block++)
+		{
+			unsigned int blockTotal = blockCounts[block * PARTITION_COUNT + partition];
+			blockCounts[block * PARTITION_COUNT + partition] = offset;
+			offset += blockTotal;
+		}
+	}
+	partitionStarts[PARTITION_COUNT] = offset;
+
+	std::vector<unsigned int> partitioned(count);
+	ThreadPool::instance().parallelFor(count, WELD_GRAIN, [&](size_t begin, size_t end)
+	{
+		unsigned int * next = &blockCounts[begin / WELD_GRAIN * PARTITION_COUNT];
+		for (size_t i = begin; i < end; i++)
+			partitioned[next[partitionOf(hashes[i])]++] = (unsigned int)i;
+	});
+
+	// Each partition into its own linear probing table of at least twice its
+	// size; every vertex points at the first one with its key
+	ThreadPool::instance().parallelFor(PARTITION_COUNT, 1, [&](size_t begin, size_t end)
+	{
+		std::vector<unsigned int> table;
+		for (size_t partition = begin; partition < end; partition++)
+		{
+			unsigned int first = partitionStarts[partition], last = partitionStarts[partition + 1];
+			size_t capacity = 16;
+			while (capacity < 2 * (size_t)(last - first))
+				capacity *= 2;
+			table.assign(capacity, INVALID_VERTEX);
+
+			for (unsigned int slot = first; slot < last; slot++)
+			{
+				unsigned int vertex = partitioned[slot];
+				size_t probe = hashes[vertex] & (capacity - 1);
+				while (table[probe] != INVALID_VERTEX && !(hashes[table[probe]] == hashes[vertex] && keys[table[probe]] == keys[vertex]))
+					probe = (probe + 1) & (capacity - 1);
+				if (table[probe] == INVALID_VERTEX)
+					table[probe] = vertex;
+				remap[vertex] = table[probe];
+			}
+		}
+	});
+
+	// Kept vertices numbered in order, per block then across blocks
+	std::vector<unsigned int> blockKept(blockCount + 1, 0);
+	ThreadPool::instance().parallelFor(count, WELD_GRAIN, [&](size_t begin, size_t end)
+	{
+		unsigned int kept = 0;
+		for (size_t i = begin; i < end; i++)
+			kept += remap[i] == i ? 1 : 0;
+		blockKept[begin / WELD_GRAIN + 1] = kept;
+	});
+	for (size_t block = 0; block < blockCount; block++)
+		blockKept[block + 1] += blockKept[block];
+
+	std::vector<unsigned int> welded(count);
+	ThreadPool::instance().parallelFor(count, WELD_GRAIN, [&](size_t begin, size_t end)
+	{
+		unsigned int next = blockKept[begin / WELD_GRAIN];
+		for (size_t i = begin; i < end; i++)
+			welded[i] = remap[i] == i ? next++ : INVALID_VERTEX;
+	});
+
+	for (unsigned int i = 0; i < count; i++)
+		remap[i] = welded[remap[i]];
+	return blockKept[blockCount];
+}
+
+unsigned int weldMesh(MeshData & mesh, float positionTolerance, float normalTolerance, float uvTolerance)
+{
+	std::vector<unsigned int> remap;
+	unsigned int count = (unsigned int)mesh.vertices.size();
+	unsigned int weldedCount = weldVertices(mesh.vertices.data(), count, positionTolerance, normalTolerance, uvTolerance, remap);
+
+	// Kept vertices are the ones numbered in order, copies point back
+	std::vector<MeshVertex> vertices(weldedCount);
+	unsigned int next = 0;
+	for (unsigned int i = 0; i < count; i++)
+		if (remap[i] == next)
+			vertices[next++] = mesh.vertices[i];
+
+	if (mesh.indices.empty())
+	{
+		mesh.indices.resize(count - count % 3);
+		for (unsigned int i = 0; i < mesh.indices.size(); i++)
+			mesh.indices[i] = i;
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		unsigned int a = remap[mesh.indices[i]], b = remap[mesh.indices[i + 1]], c = remap[mesh.indices[i + 2]];
+		if (mesh.lods.empty() && (a == b || b == c || c == a))
+			continue;
+		mesh.indices[kept++] = a;
+		mesh.indices[kept++] = b;
+		mesh.indices[kept++] = c;
+	}
+	mesh.indices.resize(kept);
+	mesh.vertices.swap(vertices);
+	return count - weldedCount;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+#include "MeshFile.h"
+
+// Vertex welding. Positions, normals and texture coordinates are quantised
+// to cells of their tolerance and vertices in the same cell of all three
+// merge into the first of them; a tolerance of 0 merges exact copies only.
+// The cells are hashed with std::hash<glm::vec3> from gtx/hash.hpp, split
+// into partitions by hash, and each partition is deduplicated in its own
+// open addressing table on the thread pool. The result does not depend on
+// the thread count: kept vertices stay in their original order.
+
+// remap[i] is the welded index of vertex i; returns the welded vertex count
+unsigned int weldVertices(const MeshVertex * vertices, unsigned int count, float positionTolerance, float normalTolerance, float uvTolerance,
+	std::vector<unsigned int> & remap);
+
+// Welds the mesh and remaps its indices. A mesh without indices is taken as
+// a plain triangle list and comes out indexed. Triangles welding collapsed
+// are dropped unless the mesh already has LODs, whose ranges must not move.
+// Returns the number of vertices removed.
+unsigned int weldMesh(MeshData & mesh, float positionTolerance, float normalTolerance, float uvTolerance);
@@ -0,0 +1,186 @@
+#include "MipChain.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "Simd.h"
+
+static const int KAISER_TAPS = 8;
+
+// Weights of source pixels 2x - 3 .. 2x + 4 for result pixel x. The
+// distances to the result pixel's centre are -3.5 .. 3.5 source pixels.
+struct KaiserKernel
+{
+	float weights[KAISER_TAPS];
+
+	KaiserKernel()
+	{
+		const double ALPHA = 4.0, RADIUS = 4.0;
+		auto besselI0 = [](double x)
+		{
+			double sum = 1.0, term = 1.0;
+			for (int k = 1; k < 20; k++)
+			{
+				term *= (x / (2.0 * k)) * (x / (2.0 * k));
+				sum += term;
+			}
+			return sum;
+		};
+
+		double total = 0.0, values[KAISER_TAPS];
+		for (int t = 0; t < KAISER_TAPS; t++)
+		{
+			double distance = t - 3.5;
+			double x = distance / 2.0 * 3.14159265358979323846; // sinc at half the source frequency
+			double sinc = std::sin(x) / x;
+			double window = besselI0(ALPHA * std::sqrt(1.0 - (distance / RADIUS) * (distance / RADIUS))) / besselI0(ALPHA);
+			values[t] = sinc * window;
+			total += values[t];
+		}
+		for (int t = 0; t < KAISER_TAPS; t++)
+			weights[t] = (float)(values[t] / total);
+	}
+};
+
+static const KaiserKernel & kaiserKernel()
+{
+	static const KaiserKernel kernel;
+	return kernel;
+}
+
+void downsampleBox(const unsigned char * source, unsigned int width, unsigned int height, unsigned char * result)
+{
+	unsigned int resultWidth = std::max(width / 2, 1u), resultHeight = std::max(height / 2, 1u);
+	const __m128i two = _mm_set1_epi16(2);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (unsigned int y = 0; y < resultHeight; y++)
+	{
+		const unsigned char * row0 = source + (size_t)std::min(2 * y, height - 1) * width * 4;
+		const unsigned char * row1 = source + (size_t)std::min(2 * y + 1, height - 1) * width * 4;
+		unsigned char * out = result + (size_t)y * resultWidth * 4;
+
+		// Two result pixels from four source pixels of each row
+		unsigned int x = 0;
+		if (width >= 2)
+		{
+			for (; x + 2 <= resultWidth; x += 2)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+				__m128i b = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+				__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+				__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				_mm_storel_epi64((__m128i *)(out + x * 4), _mm_packus_epi16(sum, sum));
+			}
+		}
+
+		for (; x < resultWidth; x++)
+		{
+			unsigned int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+			for (int c = 0; c < 4; c++)
+				out[x * 4 + c] = (unsigned char)((row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c] + 2) >> 2);
+		}
+	}
+}
+
+// One RGBA pixel (4 floats) per register, taps past the edges clamped
+static inline __m128 kaiserTaps(const float * pixels, int last, int centre, const float * weights)
+{
+	__m128 sum = _mm_setzero_ps();
+	for (int t = 0; t < KAISER_TAPS; t++)
+	{
+		int index = std::min(std::max(centre + t - 3, 0), last);
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pixels + index * 4), _mm_set1_ps(weights[t])));
+	}
+	return sum;
+}
+
+void downsampleKaiser(const unsigned char * source, unsigned int width, unsigned int height, unsigned char * result)
+{
+	unsigned int resultWidth = std::max(width / 2, 1u), resultHeight = std::max(height / 2, 1u);
+	const float * weights = kaiserKernel().weights;
+
+	// A dimension of 1 is copied, not filtered
+	bool filterX = width > 1, filterY = height > 1;
+
+	// Horizontal pass into float rows, then the vertical pass over those
+	std::vector<float> sourceRow((size_t)width * 4);
+	std::vector<float> columns((size_t)resultWidth * height * 4);
+	const __m128i zero = _mm_setzero_si128();
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const unsigned char * row = source + (size_t)y * width * 4;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			int packed;
+			memcpy(&packed, row + x * 4, 4);
+			__m128i pixel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+			_mm_storeu_ps(&sourceRow[x * 4], _mm_cvtepi32_ps(pixel));
+		}
+
+		float * out = &columns[(size_t)y * resultWidth * 4];
+		for (unsigned int x = 0; x < resultWidth; x++)
+		{
+			__m128 value = filterX ? kaiserTaps(sourceRow.data(), width - 1, 2 * x, weights) : _mm_loadu_ps(&sourceRow[x * 4]);
+			_mm_storeu_ps(out + x * 4, value);
+		}
+	}
+
+	// Each result row reads 8 float rows front to back
+	const __m128 maximum = _mm_set1_ps(255.0f);
+	for (unsigned int y = 0; y < resultHeight; y++)
+	{
+		const float * rows[KAISER_TAPS];
+		for (int t = 0; t < KAISER_TAPS; t++)
+		{
+			int row = filterY ? std::min(std::max((int)(2 * y) + t - 3, 0), (int)height - 1) : (int)y;
+			rows[t] = &columns[(size_t)row * resultWidth * 4];
+		}
+
+		for (unsigned int x = 0; x < resultWidth; x++)
+		{
+			__m128 value = _mm_loadu_ps(rows[0] + x * 4);
+			if (filterY)
+			{
+				value = _mm_setzero_ps();
+				for (int t = 0; t < KAISER_TAPS; t++)
+					value = _mm_add_ps(value, _mm_mul_ps(_mm_loadu_ps(rows[t] + x * 4), _mm_set1_ps(weights[t])));
+			}
+
+			value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), maximum);
+			__m128i integer = _mm_cvtps_epi32(value);
+			integer = _mm_packs_epi32(integer, integer);
+			integer = _mm_packus_epi16(integer, integer);
+			int packed = _mm_cvtsi128_si32(integer);
+			memcpy(result + ((size_t)y * resultWidth + x) * 4, &packed, 4);
+		}
+	}
+}
+
+void buildMipChain(const Image & image, MipFilter filter, TextureData & texture)
+{
+	texture.format = TEXTURE_RGBA8;
+	texture.levels.clear();
+
+	TextureLevel base;
+	base.width = image.width;
+	base.height = image.height;
+	base.data = image.pixels;
+	texture.levels.push_back(base);
+
+	while (texture.levels.back().width > 1 || texture.levels.back().height > 1)
+	{
+		const TextureLevel & previous = texture.levels.back();
+		TextureLevel level;
+		level.width = std::max(previous.width / 2, 1u);
+		level.height = std::max(previous.height / 2, 1u);
+		level.data.resize((size_t)level.width * level.height * 4);
+
+		if (filter == MIP_FILTER_KAISER)
+			downsampleKaiser(previous.data.data(), previous.width, previous.height, level.data.data());
+		else
+			downsampleBox(previous.data.data(), previous.width, previous.height, level.data.data());
+		texture.levels.push_back(level);
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Image.h"
+#include "TextureData.h"
+
+// Halves an RGBA8 image, rounding odd sizes down. The box filter averages
+// 2x2 blocks with rounding; the Kaiser filter is separable with 8 taps per
+// axis and edge pixels clamped.
+void downsampleBox(const unsigned char * source, unsigned int width, unsigned int height, unsigned char * result);
+void downsampleKaiser(const unsigned char * source, unsigned int width, unsigned int height, unsigned char * result);
+
+// RGBA8 texture with the image as level 0 and every level down to 1x1
+void buildMipChain(const Image & image, MipFilter filter, TextureData & texture);
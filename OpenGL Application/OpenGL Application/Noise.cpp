@@ -0,0 +1,475 @@
+#include "Noise.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include <noise.hpp>
+
+// Four lanes of the scalar helpers used by gtc/noise. Each one performs the
+// same IEEE operations as its glm counterpart to keep the output bit exact.
+
+static inline __m128 floor4(__m128 x)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	// Truncate, step down for negative non-integers and keep the sign of -0.0
+	__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+	t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), one));
+	t = _mm_or_ps(t, _mm_and_ps(x, signMask));
+
+	// Values past 2^23 are already integral and may not fit in an int
+	__m128 large = _mm_cmpge_ps(_mm_andnot_ps(signMask, x), _mm_set1_ps(8388608.0f));
+	return _mm_or_ps(_mm_and_ps(large, x), _mm_andnot_ps(large, t));
+}
+
+static inline __m128 fract4(__m128 x)
+{
+	return _mm_sub_ps(x, floor4(x));
+}
+
+static inline __m128 abs4(__m128 x)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+
+// step(edge, x): x < edge ? 0 : 1
+static inline __m128 step4(__m128 edge, __m128 x)
+{
+	return _mm_andnot_ps(_mm_cmplt_ps(x, edge), _mm_set1_ps(1.0f));
+}
+
+static inline __m128 mix4(__m128 x, __m128 y, __m128 a)
+{
+	return _mm_add_ps(x, _mm_mul_ps(a, _mm_sub_ps(y, x)));
+}
+
+static inline __m128 mod2894(__m128 x)
+{
+	const __m128 m = _mm_set1_ps(289.0f);
+	return _mm_sub_ps(x, _mm_mul_ps(floor4(_mm_div_ps(_mm_mul_ps(x, _mm_set1_ps(1.0f)), m)), m));
+}
+
+static inline __m128 permute4(__m128 x)
+{
+	return mod2894(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(34.0f)), _mm_set1_ps(1.0f)), x));
+}
+
+static inline __m128 taylorInvSqrt4(__m128 r)
+{
+	return _mm_sub_ps(_mm_set1_ps(1.79284291400159f), _mm_mul_ps(_mm_set1_ps(0.85373472095314f), r));
+}
+
+static inline __m128 fade4(__m128 t)
+{
+	__m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+	return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+// The second operand by reference, MSVC x86 passes at most three aligned
+// vectors by value (C2719)
+static inline __m128 dot2(__m128 ax, __m128 ay, const __m128 & bx, const __m128 & by)
+{
+	return _mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by));
+}
+
+static inline __m128 dot3(__m128 ax, __m128 ay, __m128 az, const __m128 & bx, const __m128 & by, const __m128 & bz)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+}
+
+// glm::perlin(vec2), one corner of the cell per step
+static __m128 perlin4(__m128 x, __m128 y)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 m289 = _mm_set1_ps(289.0f);
+
+	__m128 floorX = floor4(x), floorY = floor4(y);
+	__m128 pi[4] = { _mm_add_ps(floorX, zero), _mm_add_ps(floorY, zero), _mm_add_ps(floorX, one), _mm_add_ps(floorY, one) };
+	__m128 pf[4] = { _mm_sub_ps(fract4(x), zero), _mm_sub_ps(fract4(y), zero), _mm_sub_ps(fract4(x), one), _mm_sub_ps(fract4(y), one) };
+	for (int k = 0; k < 4; k++)
+		pi[k] = _mm_sub_ps(pi[k], _mm_mul_ps(m289, floor4(_mm_div_ps(pi[k], m289))));
+
+	// Corners in glm's order: (x0, y0), (x1, y0), (x0, y1), (x1, y1)
+	__m128 ix[4] = { pi[0], pi[2], pi[0], pi[2] };
+	__m128 iy[4] = { pi[1], pi[1], pi[3], pi[3] };
+	__m128 fx[4] = { pf[0], pf[2], pf[0], pf[2] };
+	__m128 fy[4] = { pf[1], pf[1], pf[3], pf[3] };
+	__m128 n[4];
+
+	for (int c = 0; c < 4; c++)
+	{
+		__m128 i = permute4(_mm_add_ps(permute4(ix[c]), iy[c]));
+		__m128 gx = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.0f), fract4(_mm_div_ps(i, _mm_set1_ps(41.0f)))), one);
+		__m128 gy = _mm_sub_ps(abs4(gx), half);
+		__m128 tx = floor4(_mm_add_ps(gx, half));
+		gx = _mm_sub_ps(gx, tx);
+
+		__m128 norm = taylorInvSqrt4(dot2(gx, gy, gx, gy));
+		gx = _mm_mul_ps(gx, norm);
+		gy = _mm_mul_ps(gy, norm);
+		n[c] = dot2(gx, gy, fx[c], fy[c]);
+	}
+
+	__m128 fadeX = fade4(pf[0]), fadeY = fade4(pf[1]);
+	__m128 nx0 = mix4(n[0], n[1], fadeX);
+	__m128 nx1 = mix4(n[2], n[3], fadeX);
+	return _mm_mul_ps(_mm_set1_ps(2.3f), mix4(nx0, nx1, fadeY));
+}
+
+// glm::perlin(vec3)
+static __m128 perlin4(__m128 x, __m128 y, __m128 z)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 seventh = _mm_set1_ps(float(1.0 / 7.0));
+
+	__m128 pi0[3] = { floor4(x), floor4(y), floor4(z) };
+	__m128 pi1[3];
+	__m128 pf0[3] = { fract4(x), fract4(y), fract4(z) };
+	__m128 pf1[3];
+	for (int a = 0; a < 3; a++)
+	{
+		pi1[a] = mod2894(_mm_add_ps(pi0[a], one));
+		pi0[a] = mod2894(pi0[a]);
+		pf1[a] = _mm_sub_ps(pf0[a], one);
+	}
+
+	// Corners (x0, y0), (x1, y0), (x0, y1), (x1, y1), first on z0 then on z1
+	__m128 ix[4] = { pi0[0], pi1[0], pi0[0], pi1[0] };
+	__m128 iy[4] = { pi0[1], pi0[1], pi1[1], pi1[1] };
+	__m128 fx[4] = { pf0[0], pf1[0], pf0[0], pf1[0] };
+	__m128 fy[4] = { pf0[1], pf0[1], pf1[1], pf1[1] };
+	__m128 n[2][4];
+
+	for (int c = 0; c < 4; c++)
+	{
+		__m128 ixy = permute4(_mm_add_ps(permute4(ix[c]), iy[c]));
+
+		for (int layer = 0; layer < 2; layer++)
+		{
+			__m128 ixyz = permute4(_mm_add_ps(ixy, layer == 0 ? pi0[2] : pi1[2]));
+
+			__m128 gx = _mm_mul_ps(ixyz, seventh);
+			__m128 gy = _mm_sub_ps(fract4(_mm_mul_ps(floor4(gx), seventh)), half);
+			gx = fract4(gx);
+			__m128 gz = _mm_sub_ps(_mm_sub_ps(half, abs4(gx)), abs4(gy));
+			__m128 sz = step4(gz, zero);
+			gx = _mm_sub_ps(gx, _mm_mul_ps(sz, _mm_sub_ps(step4(zero, gx), half)));
+			gy = _mm_sub_ps(gy, _mm_mul_ps(sz, _mm_sub_ps(step4(zero, gy), half)));
+
+			__m128 norm = taylorInvSqrt4(dot3(gx, gy, gz, gx, gy, gz));
+			gx = _mm_mul_ps(gx, norm);
+			gy = _mm_mul_ps(gy, norm);
+			gz = _mm_mul_ps(gz, norm);
+			n[layer][c] = dot3(gx, gy, gz, fx[c], fy[c], layer == 0 ? pf0[2] : pf1[2]);
+		}
+	}
+
+	__m128 fadeX = fade4(pf0[0]), fadeY = fade4(pf0[1]), fadeZ = fade4(pf0[2]);
+	__m128 nz[4];
+	for (int c = 0; c < 4; c++)
+		nz[c] = mix4(n[0][c], n[1][c], fadeZ);
+	__m128 ny0 = mix4(nz[0], nz[2], fadeY);
+	__m128 ny1 = mix4(nz[1], nz[3], fadeY);
+	return _mm_mul_ps(_mm_set1_ps(2.2f), mix4(ny0, ny1, fadeX));
+}
+
+// glm::simplex(vec2)
+static __m128 simplex4(__m128 x, __m128 y)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 m289 = _mm_set1_ps(289.0f);
+	const __m128 cx = _mm_set1_ps(0.211324865405187f);
+	const __m128 cy = _mm_set1_ps(0.366025403784439f);
+	const __m128 cz = _mm_set1_ps(-0.577350269189626f);
+	const __m128 cw = _mm_set1_ps(0.024390243902439f);
+
+	// First corner
+	__m128 skew = dot2(x, y, cy, cy);
+	__m128 ix = floor4(_mm_add_ps(x, skew));
+	__m128 iy = floor4(_mm_add_ps(y, skew));
+	__m128 unskew = dot2(ix, iy, cx, cx);
+	__m128 x0x = _mm_add_ps(_mm_sub_ps(x, ix), unskew);
+	__m128 x0y = _mm_add_ps(_mm_sub_ps(y, iy), unskew);
+
+	// Other corners
+	__m128 i1x = _mm_and_ps(_mm_cmpgt_ps(x0x, x0y), one);
+	__m128 i1y = _mm_sub_ps(one, i1x);
+	__m128 x1x = _mm_sub_ps(_mm_add_ps(x0x, cx), i1x);
+	__m128 x1y = _mm_sub_ps(_mm_add_ps(x0y, cx), i1y);
+	__m128 x2x = _mm_add_ps(x0x, cz);
+	__m128 x2y = _mm_add_ps(x0y, cz);
+
+	// Permutations
+	ix = _mm_sub_ps(ix, _mm_mul_ps(m289, floor4(_mm_div_ps(ix, m289))));
+	iy = _mm_sub_ps(iy, _mm_mul_ps(m289, floor4(_mm_div_ps(iy, m289))));
+	__m128 p[3] = {
+		permute4(_mm_add_ps(_mm_add_ps(permute4(_mm_add_ps(iy, zero)), ix), zero)),
+		permute4(_mm_add_ps(_mm_add_ps(permute4(_mm_add_ps(iy, i1y)), ix), i1x)),
+		permute4(_mm_add_ps(_mm_add_ps(permute4(_mm_add_ps(iy, one)), ix), one))
+	};
+
+	__m128 cornerX[3] = { x0x, x1x, x2x };
+	__m128 cornerY[3] = { x0y, x1y, x2y };
+	__m128 g[3], m[3];
+
+	for (int c = 0; c < 3; c++)
+	{
+		m[c] = _mm_max_ps(_mm_sub_ps(half, dot2(cornerX[c], cornerY[c], cornerX[c], cornerY[c])), zero);
+		m[c] = _mm_mul_ps(m[c], m[c]);
+		m[c] = _mm_mul_ps(m[c], m[c]);
+
+		__m128 gradient = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.0f), fract4(_mm_mul_ps(p[c], cw))), one);
+		__m128 h = _mm_sub_ps(abs4(gradient), half);
+		__m128 ox = floor4(_mm_add_ps(gradient, half));
+		__m128 a0 = _mm_sub_ps(gradient, ox);
+
+		m[c] = _mm_mul_ps(m[c], taylorInvSqrt4(_mm_add_ps(_mm_mul_ps(a0, a0), _mm_mul_ps(h, h))));
+		g[c] = _mm_add_ps(_mm_mul_ps(a0, cornerX[c]), _mm_mul_ps(h, cornerY[c]));
+	}
+
+	return _mm_mul_ps(_mm_set1_ps(130.0f), dot3(m[0], m[1], m[2], g[0], g[1], g[2]));
+}
+
+// glm::simplex(vec3)
+static __m128 simplex4(__m128 x, __m128 y, __m128 z)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 cx = _mm_set1_ps(float(1.0 / 6.0));
+	const __m128 cy = _mm_set1_ps(float(1.0 / 3.0));
+	const float n_ = 0.142857142857f;
+	const __m128 nsx = _mm_set1_ps(n_ * 2.0f - 0.0f);
+	const __m128 nsy = _mm_set1_ps(n_ * 0.5f - 1.0f);
+	const __m128 nsz = _mm_set1_ps(n_ * 1.0f - 0.0f);
+
+	// First corner
+	__m128 skew = dot3(x, y, z, cy, cy, cy);
+	__m128 i[3] = { floor4(_mm_add_ps(x, skew)), floor4(_mm_add_ps(y, skew)), floor4(_mm_add_ps(z, skew)) };
+	__m128 unskew = dot3(i[0], i[1], i[2], cx, cx, cx);
+	__m128 x0[3] = { _mm_add_ps(_mm_sub_ps(x, i[0]), unskew), _mm_add_ps(_mm_sub_ps(y, i[1]), unskew), _mm_add_ps(_mm_sub_ps(z, i[2]), unskew) };
+
+	// Other corners
+	__m128 g[3] = { step4(x0[1], x0[0]), step4(x0[2], x0[1]), step4(x0[0], x0[2]) };
+	__m128 l[3] = { _mm_sub_ps(one, g[0]), _mm_sub_ps(one, g[1]), _mm_sub_ps(one, g[2]) };
+	__m128 lRotated[3] = { l[2], l[0], l[1] };
+	__m128 i1[3], i2[3], x1[3], x2[3], x3[3];
+	for (int a = 0; a < 3; a++)
+	{
+		i1[a] = _mm_min_ps(g[a], lRotated[a]);
+		i2[a] = _mm_max_ps(g[a], lRotated[a]);
+		x1[a] = _mm_add_ps(_mm_sub_ps(x0[a], i1[a]), cx);
+		x2[a] = _mm_add_ps(_mm_sub_ps(x0[a], i2[a]), cy);
+		x3[a] = _mm_sub_ps(x0[a], half);
+		i[a] = mod2894(i[a]);
+	}
+
+	// Permutations, corner offsets (0, i1, i2, 1) on each axis
+	__m128 offset[4][3] = { { zero, zero, zero }, { i1[0], i1[1], i1[2] }, { i2[0], i2[1], i2[2] }, { one, one, one } };
+	__m128 * corner[4] = { x0, x1, x2, x3 };
+	__m128 m[4], pdotx[4];
+
+	for (int c = 0; c < 4; c++)
+	{
+		__m128 p = permute4(_mm_add_ps(i[2], offset[c][2]));
+		p = permute4(_mm_add_ps(_mm_add_ps(p, i[1]), offset[c][1]));
+		p = permute4(_mm_add_ps(_mm_add_ps(p, i[0]), offset[c][0]));
+
+		// Gradients: 7x7 points over a square, mapped onto an octahedron
+		__m128 j = _mm_sub_ps(p, _mm_mul_ps(_mm_set1_ps(49.0f), floor4(_mm_mul_ps(_mm_mul_ps(p, nsz), nsz))));
+		__m128 xf = floor4(_mm_mul_ps(j, nsz));
+		__m128 yf = floor4(_mm_sub_ps(j, _mm_mul_ps(_mm_set1_ps(7.0f), xf)));
+		__m128 gx = _mm_add_ps(_mm_mul_ps(xf, nsx), nsy);
+		__m128 gy = _mm_add_ps(_mm_mul_ps(yf, nsx), nsy);
+		__m128 h = _mm_sub_ps(_mm_sub_ps(one, abs4(gx)), abs4(gy));
+
+		__m128 sh = _mm_xor_ps(step4(h, zero), _mm_set1_ps(-0.0f));
+		__m128 sx = _mm_add_ps(_mm_mul_ps(floor4(gx), _mm_set1_ps(2.0f)), one);
+		__m128 sy = _mm_add_ps(_mm_mul_ps(floor4(gy), _mm_set1_ps(2.0f)), one);
+		__m128 px = _mm_add_ps(gx, _mm_mul_ps(sx, sh));
+		__m128 py = _mm_add_ps(gy, _mm_mul_ps(sy, sh));
+		__m128 pz = h;
+
+		__m128 norm = taylorInvSqrt4(dot3(px, py, pz, px, py, pz));
+		px = _mm_mul_ps(px, norm);
+		py = _mm_mul_ps(py, norm);
+		pz = _mm_mul_ps(pz, norm);
+
+		__m128 * v = corner[c];
+		m[c] = _mm_max_ps(_mm_sub_ps(_mm_set1_ps(0.6f), dot3(v[0], v[1], v[2], v[0], v[1], v[2])), zero);
+		m[c] = _mm_mul_ps(m[c], m[c]);
+		m[c] = _mm_mul_ps(m[c], m[c]);
+		pdotx[c] = dot3(px, py, pz, v[0], v[1], v[2]);
+	}
+
+	__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], pdotx[0]), _mm_mul_ps(m[1], pdotx[1])),
+		_mm_add_ps(_mm_mul_ps(m[2], pdotx[2]), _mm_mul_ps(m[3], pdotx[3])));
+	return _mm_mul_ps(_mm_set1_ps(42.0f), sum);
+}
+
+static inline __m128 evaluate4(NoiseBasis basis, __m128 x, __m128 y)
+{
+	return basis == NOISE_PERLIN ? perlin4(x, y) : simplex4(x, y);
+}
+
+static inline float evaluate(NoiseBasis basis, const glm::vec2 & position)
+{
+	return basis == NOISE_PERLIN ? glm::perlin(position) : glm::simplex(position);
+}
+
+// Loads up to four points, repeating the last one to fill the packet
+template <typename Vector, typename Kernel>
+static void evaluatePoints(const Vector * positions, float * results, size_t count, Kernel kernel)
+{
+	ThreadPool::instance().parallelFor((count + 3) / 4, 1024, [&](size_t begin, size_t end)
+	{
+		for (size_t packet = begin; packet < end; packet++)
+		{
+			size_t first = packet * 4;
+			size_t lanes = count - first < 4 ? count - first : 4;
+			float coordinates[3][4];
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				const Vector & p = positions[first + (lane < lanes ? lane : lanes - 1)];
+				for (int a = 0; a < p.length(); a++)
+					coordinates[a][lane] = p[a];
+			}
+
+			float values[4];
+			_mm_storeu_ps(values, kernel(coordinates));
+			for (size_t lane = 0; lane < lanes; lane++)
+				results[first + lane] = values[lane];
+		}
+	});
+}
+
+void perlinBatch(const glm::vec2 * positions, float * results, size_t count)
+{
+	evaluatePoints(positions, results, count, [](float c[][4]) { return perlin4(_mm_loadu_ps(c[0]), _mm_loadu_ps(c[1])); });
+}
+
+void perlinBatch(const glm::vec3 * positions, float * results, size_t count)
+{
+	evaluatePoints(positions, results, count, [](float c[][4]) { return perlin4(_mm_loadu_ps(c[0]), _mm_loadu_ps(c[1]), _mm_loadu_ps(c[2])); });
+}
+
+void simplexBatch(const glm::vec2 * positions, float * results, size_t count)
+{
+	evaluatePoints(positions, results, count, [](float c[][4]) { return simplex4(_mm_loadu_ps(c[0]), _mm_loadu_ps(c[1])); });
+}
+
+void simplexBatch(const glm::vec3 * positions, float * results, size_t count)
+{
+	evaluatePoints(positions, results, count, [](float c[][4]) { return simplex4(_mm_loadu_ps(c[0]), _mm_loadu_ps(c[1]), _mm_loadu_ps(c[2])); });
+}
+
+enum FractalMode
+{
+	FRACTAL_NONE,
+	FRACTAL_FBM,
+	FRACTAL_RIDGED
+};
+
+static void fractalGrid(float * results, unsigned int width, unsigned int height,
+	const glm::vec2 & origin, const glm::vec2 & step, NoiseBasis basis,
+	FractalMode mode, unsigned int octaves, float lacunarity, float gain)
+{
+	ThreadPool::instance().parallelFor(height, 8, [&](size_t begin, size_t end)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 laneOffset = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+		for (size_t row = begin; row < end; row++)
+		{
+			__m128 y = _mm_add_ps(_mm_set1_ps(origin.y), _mm_mul_ps(_mm_set1_ps(step.y), _mm_set1_ps((float)row)));
+			float * output = results + row * width;
+
+			for (unsigned int column = 0; column < width; column += 4)
+			{
+				__m128 columns = _mm_add_ps(_mm_set1_ps((float)column), laneOffset);
+				__m128 x = _mm_add_ps(_mm_set1_ps(origin.x), _mm_mul_ps(_mm_set1_ps(step.x), columns));
+				__m128 value;
+
+				if (mode == FRACTAL_NONE)
+					value = evaluate4(basis, x, y);
+				else
+				{
+					value = _mm_setzero_ps();
+					float amplitude = 1.0f, frequency = 1.0f;
+					for (unsigned int o = 0; o < octaves; o++)
+					{
+						__m128 n = evaluate4(basis, _mm_mul_ps(x, _mm_set1_ps(frequency)), _mm_mul_ps(y, _mm_set1_ps(frequency)));
+						if (mode == FRACTAL_RIDGED)
+						{
+							n = _mm_sub_ps(one, abs4(n));
+							n = _mm_mul_ps(n, n);
+						}
+						value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(amplitude), n));
+						frequency *= lacunarity;
+						amplitude *= gain;
+					}
+				}
+
+				if (column + 4 <= width)
+					_mm_storeu_ps(output + column, value);
+				else
+				{
+					float values[4];
+					_mm_storeu_ps(values, value);
+					for (unsigned int lane = 0; column + lane < width; lane++)
+						output[column + lane] = values[lane];
+				}
+			}
+		}
+	});
+}
+
+void noiseGrid(float * results, unsigned int width, unsigned int height,
+	const glm::vec2 & origin, const glm::vec2 & step, NoiseBasis basis)
+{
+	fractalGrid(results, width, height, origin, step, basis, FRACTAL_NONE, 1, 1.0f, 1.0f);
+}
+
+void fbmGrid(float * results, unsigned int width, unsigned int height,
+	const glm::vec2 & origin, const glm::vec2 & step, NoiseBasis basis,
+	unsigned int octaves, float lacunarity, float gain)
+{
+	fractalGrid(results, width, height, origin, step, basis, FRACTAL_FBM, octaves, lacunarity, gain);
+}
+
+void ridgedGrid(float * results, unsigned int width, unsigned int height,
+	const glm::vec2 & origin, const glm::vec2 & step, NoiseBasis basis,
+	unsigned int octaves, float lacunarity, float gain)
+{
+	fractalGrid(results, width, height, origin, step, basis, FRACTAL_RIDGED, octaves, lacunarity, gain);
+}
+
+float fbm(const glm::vec2 & position, NoiseBasis basis, unsigned int octaves, float lacunarity, float gain)
+{
+	float value = 0.0f, amplitude = 1.0f, frequency = 1.0f;
+	for (unsigned int o = 0; o < octaves; o++)
+	{
+		value += amplitude * evaluate(basis, position * frequency);
+		frequency *= lacunarity;
+		amplitude *= gain;
+	}
+	return value;
+}
+
+float ridged(const glm::vec2 & position, NoiseBasis basis, unsigned int octaves, float lacunarity, float gain)
+{
+	float value = 0.0f, amplitude = 1.0f, frequency = 1.0f;
+	for (unsigned int o = 0; o < octaves; o++)
+	{
+		float n = 1.0f - glm::abs(evaluate(basis, position * frequency));
+		value += amplitude * (n * n);
+		frequency *= lacunarity;
+		amplitude *= gain;
+	}
+	return value;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <glm.hpp>
+
+// Batch versions of glm::perlin and glm::simplex. Every kernel repeats the
+// operations of the scalar gtc/noise code lane by lane, so the results are
+// identical to calling the glm function on each point.
+
+enum NoiseBasis
+{
+	NOISE_PERLIN,
+	NOISE_SIMPLEX
+};
+
+void perlinBatch(const glm::vec2 * positions, float * results, size_t count);
+void perlinBatch(const glm::vec3 * positions, float * results, size_t count);
+void simplexBatch(const glm::vec2 * positions, float * results, size_t count);
+void simplexBatch(const glm::vec3 * positions, float * results, size_t count);
+
+// Grids are written row major, sample (x, y) is taken at origin + step * vec2(x, y).
+// Rows are spread over the shared ThreadPool.
+void noiseGrid(float * results, unsigned int width, unsigned int height,
+	const glm::vec2 & origin, const glm::vec2 & step, NoiseBasis basis);
+
+// Fractal sums over octaves of the basis, octave o samples at
+// position * lacunarity^o weighted by gain^o. Ridged noise sums (1 - |n|)^2.
+void fbmGrid(float * results, unsigned int width, unsigned int height,
+	const glm::vec2 & origin, const glm::vec2 & step, NoiseBasis basis,
+	unsigned int octaves, float lacunarity = 2.0f, float gain = 0.5f);
+void ridgedGrid(float * results, unsigned int width, unsigned int height,
+	const glm::vec2 & origin, const glm::vec2 & step, NoiseBasis basis,
+	unsigned int octaves, float lacunarity = 2.0f, float gain = 0.5f);
+
+// Scalar references for a single point, matching the grid functions exactly
+float fbm(const glm::vec2 & position, NoiseBasis basis, unsigned int octaves, float lacunarity = 2.0f, float gain = 0.5f);
+float ridged(const glm::vec2 & position, NoiseBasis basis, unsigned int octaves, float lacunarity = 2.0f, float gain = 0.5f);
@@ -0,0 +1,391 @@
+#include "OcclusionCuller.h"
+#include <cstdio>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <simd/common.h>
+#include <simd/matrix.h>
+#include "ThreadPool.h"
+
+const unsigned int OcclusionCuller::TILE_WIDTH;
+const unsigned int OcclusionCuller::TILE_HEIGHT;
+const unsigned int OcclusionCuller::BLOCK_SIZE;
+
+// Boxes this close in front of an occluder still count as visible, so a
+// flat occluder never hides itself through rounding
+static const float DEPTH_BIAS = 1e-6f;
+
+// GLM's SIMD helpers cover the arithmetic; it has none for min, max or
+// comparisons, so those use the SSE intrinsics its glm_vec4 is made of
+static inline float horizontalMin(glm_vec4 v)
+{
+	v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtss_f32(v);
+}
+
+static inline float horizontalMax(glm_vec4 v)
+{
+	v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_cvtss_f32(v);
+}
+
+OcclusionCuller::OcclusionCuller()
+{
+	width = 0;
+	height = 0;
+	tilesX = 0;
+	tilesY = 0;
+}
+
+bool OcclusionCuller::create(unsigned int width, unsigned int height)
+{
+	if (width == 0 || height == 0 || width % TILE_WIDTH != 0 || height % TILE_HEIGHT != 0)
+	{
+		printf("Occlusion buffer size %ux%u is not a multiple of %ux%u tiles\n", width, height, TILE_WIDTH, TILE_HEIGHT);
+		return false;
+	}
+
+	this->width = width;
+	this->height = height;
+	tilesX = width / TILE_WIDTH;
+	tilesY = height / TILE_HEIGHT;
+	depth.assign((size_t)width * height, 1.0f);
+	blockMin.assign((size_t)(width / BLOCK_SIZE) * (height / BLOCK_SIZE), 1.0f);
+	blockMax.assign(blockMin.size(), 1.0f);
+	bins.resize(tilesX * tilesY);
+	return true;
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4 & viewProjection)
+{
+	this->viewProjection = viewProjection;
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	std::fill(blockMin.begin(), blockMin.end(), 1.0f);
+	std::fill(blockMax.begin(), blockMax.end(), 1.0f);
+	triangles.clear();
+}
+
+void OcclusionCuller::addOccluder(const glm::mat4 & model, const glm::vec3 * positions, const unsigned int * triangleIndices, unsigned int triangleCount, bool cullBackFaces)
+{
+	unsigned int vertexCount = triangleCount * 3;
+	if (triangleIndices)
+	{
+		vertexCount = 0;
+		for (unsigned int i = 0; i < triangleCount * 3; i++)
+			vertexCount = std::max(vertexCount, triangleIndices[i] + 1);
+	}
+
+	// Each vertex to clip space once, one column of the matrix per register
+	glm::mat4 modelViewProjection = viewProjection * model;
+	glm_vec4 columns[4];
+	for (int c = 0; c < 4; c++)
+		columns[c] = _mm_loadu_ps(&modelViewProjection[c][0]);
+
+	clip.resize((size_t)vertexCount * 4);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		glm_vec4 position = _mm_setr_ps(positions[v].x, positions[v].y, positions[v].z, 1.0f);
+		_mm_storeu_ps(&clip[v * 4], glm_mat4_mul_vec4(columns, position));
+	}
+
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		unsigned int i0 = triangleIndices ? triangleIndices[t * 3] : t * 3;
+		unsigned int i1 = triangleIndices ? triangleIndices[t * 3 + 1] : t * 3 + 1;
+		unsigned int i2 = triangleIndices ? triangleIndices[t * 3 + 2] : t * 3 + 2;
+		addTriangle(&clip[i0 * 4], &clip[i1 * 4], &clip[i2 * 4], cullBackFaces);
+	}
+}
+
+// Clips a clip space triangle against the near plane and adds the pieces in
+// window coordinates
+void OcclusionCuller::addTriangle(const float * a, const float * b, const float * c, bool cullBackFaces)
+{
+	const float * corners[3] = { a, b, c };
+
+	// Entirely outside one of the side or far planes
+	for (int axis = 0; axis < 3; axis++)
+	{
+		bool below = axis < 2, above = true;
+		for (int v = 0; v < 3; v++)
+		{
+			below = below && corners[v][axis] < -corners[v][3];
+			above = above && corners[v][axis] > corners[v][3];
+		}
+		if (below || above)
+			return;
+	}
+
+	float polygon[4][4];
+	int count = 0;
+	for (int v = 0; v < 3; v++)
+	{
+		const float * p = corners[v], * q = corners[(v + 1) % 3];
+		float dp = p[2] + p[3], dq = q[2] + q[3];
+		if (dp >= 0.0f)
+			std::copy(p, p + 4, polygon[count++]);
+		if ((dp >= 0.0f) != (dq >= 0.0f))
+		{
+			float t = dp / (dp - dq);
+			for (int i = 0; i < 4; i++)
+				polygon[count][i] = p[i] + t * (q[i] - p[i]);
+			count++;
+		}
+	}
+
+	float window[4][3];
+	for (int v = 0; v < count; v++)
+	{
+		float inverseW = 1.0f / polygon[v][3];
+		window[v][0] = (polygon[v][0] * inverseW * 0.5f + 0.5f) * width;
+		window[v][1] = (polygon[v][1] * inverseW * 0.5f + 0.5f) * height;
+		window[v][2] = std::max(polygon[v][2] * inverseW * 0.5f + 0.5f, 0.0f);
+	}
+
+	for (int v = 1; v + 1 < count; v++)
+	{
+		const float * fan[3] = { window[0], window[v], window[v + 1] };
+		float area = (fan[1][0] - fan[0][0]) * (fan[2][1] - fan[0][1]) - (fan[2][0] - fan[0][0]) * (fan[1][1] - fan[0][1]);
+		if (area == 0.0f || (cullBackFaces && area < 0.0f))
+			continue;
+		if (area < 0.0f)
+			std::swap(fan[1], fan[2]);
+
+		ScreenTriangle triangle;
+		float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+		for (int i = 0; i < 3; i++)
+		{
+			triangle.x[i] = fan[i][0];
+			triangle.y[i] = fan[i][1];
+			triangle.z[i] = fan[i][2];
+			minX = std::min(minX, fan[i][0]);
+			minY = std::min(minY, fan[i][1]);
+			maxX = std::max(maxX, fan[i][0]);
+			maxY = std::max(maxY, fan[i][1]);
+		}
+
+		triangle.minX = std::max((int)std::floor(minX), 0);
+		triangle.minY = std::max((int)std::floor(minY), 0);
+		triangle.maxX = std::min((int)std::ceil(maxX), (int)width - 1);
+		triangle.maxY = std::min((int)std::ceil(maxY), (int)height - 1);
+		if (triangle.minX <= triangle.maxX && triangle.minY <= triangle.maxY)
+			triangles.push_back(triangle);
+	}
+}
+
+void OcclusionCuller::rasterize()
+{
+	for (std::vector<unsigned int> & bin : bins)
+		bin.clear();
+
+	for (unsigned int i = 0; i < triangles.size(); i++)
+	{
+		const ScreenTriangle & triangle = triangles[i];
+		for (int ty = triangle.minY / (int)TILE_HEIGHT; ty <= triangle.maxY / (int)TILE_HEIGHT; ty++)
+			for (int tx = triangle.minX / (int)TILE_WIDTH; tx <= triangle.maxX / (int)TILE_WIDTH; tx++)
+				bins[ty * tilesX + tx].push_back(i);
+	}
+
+	// Tiles never share pixels, so they need no synchronisation
+	ThreadPool::instance().parallelFor(bins.size(), 1, [this](size_t begin, size_t end)
+	{
+		for (size_t tile = begin; tile < end; tile++)
+			rasterizeTile((unsigned int)tile);
+	});
+}
+
+void OcclusionCuller::rasterizeTile(unsigned int tile)
+{
+	if (bins[tile].empty())
+		return;
+
+	int tileMinX = (tile % tilesX) * TILE_WIDTH, tileMinY = (tile / tilesX) * TILE_HEIGHT;
+	int tileMaxX = tileMinX + TILE_WIDTH - 1, tileMaxY = tileMinY + TILE_HEIGHT - 1;
+	const glm_vec4 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const glm_vec4 zero = _mm_setzero_ps();
+
+	for (unsigned int index : bins[tile])
+	{
+		const ScreenTriangle & triangle = triangles[index];
+
+		// Groups of 4 pixels start on multiples of 4, which tiles are too
+		int x0 = std::max(triangle.minX, tileMinX) & ~3, x1 = std::min(triangle.maxX, tileMaxX);
+		int y0 = std::max(triangle.minY, tileMinY), y1 = std::min(triangle.maxY, tileMaxY);
+		if (x0 > x1 || y0 > y1)
+			continue;
+
+		// Edge e runs from vertex e to e + 1 and is A x + B y + C, positive
+		// inside. Divided by the area it weights the vertex opposite it.
+		float A[3], B[3], C[3];
+		for (int e = 0; e < 3; e++)
+		{
+			int next = (e + 1) % 3;
+			A[e] = triangle.y[e] - triangle.y[next];
+			B[e] = triangle.x[next] - triangle.x[e];
+			C[e] = -(A[e] * triangle.x[e] + B[e] * triangle.y[e]);
+		}
+		float area = C[0] + C[1] + C[2];
+		float zA = 0.0f, zB = 0.0f, zC = 0.0f;
+		for (int e = 0; e < 3; e++)
+		{
+			float z = triangle.z[(e + 2) % 3] / area;
+			zA += A[e] * z;
+			zB += B[e] * z;
+			zC += C[e] * z;
+		}
+
+		glm_vec4 stepEdges[3], stepDepth = _mm_set1_ps(4.0f * zA);
+		for (int e = 0; e < 3; e++)
+			stepEdges[e] = _mm_set1_ps(4.0f * A[e]);
+
+		for (int y = y0; y <= y1; y++)
+		{
+			float py = y + 0.5f;
+			glm_vec4 px = glm_vec4_add(_mm_set1_ps((float)x0), laneOffsets);
+			glm_vec4 edges[3];
+			for (int e = 0; e < 3; e++)
+				edges[e] = glm_vec4_fma(_mm_set1_ps(A[e]), px, _mm_set1_ps(B[e] * py + C[e]));
+			glm_vec4 z = glm_vec4_fma(_mm_set1_ps(zA), px, _mm_set1_ps(zB * py + zC));
+
+			float * row = &depth[(size_t)y * width];
+			for (int x = x0; x <= x1; x += 4)
+			{
+				glm_vec4 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edges[0], zero), _mm_cmpge_ps(edges[1], zero)), _mm_cmpge_ps(edges[2], zero));
+				if (_mm_movemask_ps(inside))
+				{
+					glm_vec4 stored = _mm_loadu_ps(row + x);
+					glm_vec4 nearer = _mm_min_ps(stored, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+				}
+
+				for (int e = 0; e < 3; e++)
+					edges[e] = glm_vec4_add(edges[e], stepEdges[e]);
+				z = glm_vec4_add(z, stepDepth);
+			}
+		}
+	}
+
+	// Nearest and farthest depth of each block in the tile
+	unsigned int blocksX = width / BLOCK_SIZE;
+	for (int by = tileMinY / (int)BLOCK_SIZE; by <= tileMaxY / (int)BLOCK_SIZE; by++)
+	{
+		for (int bx = tileMinX / (int)BLOCK_SIZE; bx <= tileMaxX / (int)BLOCK_SIZE; bx++)
+		{
+			const float * block = &depth[(size_t)by * BLOCK_SIZE * width + bx * BLOCK_SIZE];
+			glm_vec4 low = _mm_loadu_ps(block), high = low;
+			for (unsigned int y = 0; y < BLOCK_SIZE; y++)
+			{
+				for (unsigned int x = 0; x < BLOCK_SIZE; x += 4)
+				{
+					glm_vec4 values = _mm_loadu_ps(block + y * width + x);
+					low = _mm_min_ps(low, values);
+					high = _mm_max_ps(high, values);
+				}
+			}
+			blockMin[by * blocksX + bx] = horizontalMin(low);
+			blockMax[by * blocksX + bx] = horizontalMax(high);
+		}
+	}
+}
+
+bool OcclusionCuller::isVisible(const glm::mat4 & model, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax) const
+{
+	// The 8 corners as two groups of 4, one coordinate per register
+	glm::mat4 m = viewProjection * model;
+	glm_vec4 xs = _mm_setr_ps(boundsMin.x, boundsMax.x, boundsMin.x, boundsMax.x);
+	glm_vec4 ys = _mm_setr_ps(boundsMin.y, boundsMin.y, boundsMax.y, boundsMax.y);
+	glm_vec4 low = _mm_set1_ps(FLT_MAX), high = _mm_set1_ps(-FLT_MAX);
+	glm_vec4 lowY = low, highY = high, nearest = low;
+	int behind = 0; // corners on the camera side of the near plane, one bit each
+	for (int group = 0; group < 2; group++)
+	{
+		glm_vec4 zs = _mm_set1_ps(group == 0 ? boundsMin.z : boundsMax.z);
+		glm_vec4 clip[4];
+		for (int row = 0; row < 4; row++)
+		{
+			clip[row] = glm_vec4_fma(_mm_set1_ps(m[0][row]), xs, _mm_set1_ps(m[3][row]));
+			clip[row] = glm_vec4_fma(_mm_set1_ps(m[1][row]), ys, clip[row]);
+			clip[row] = glm_vec4_fma(_mm_set1_ps(m[2][row]), zs, clip[row]);
+		}
+
+		behind |= _mm_movemask_ps(_mm_cmplt_ps(glm_vec4_add(clip[2], clip[3]), _mm_setzero_ps())) << (4 * group);
+		glm_vec4 inverseW = glm_vec4_div(_mm_set1_ps(0.5f), clip[3]);
+		glm_vec4 half = _mm_set1_ps(0.5f);
+		glm_vec4 x = glm_vec4_mul(glm_vec4_fma(clip[0], inverseW, half), _mm_set1_ps((float)width));
+		glm_vec4 y = glm_vec4_mul(glm_vec4_fma(clip[1], inverseW, half), _mm_set1_ps((float)height));
+		glm_vec4 z = glm_vec4_fma(clip[2], inverseW, half);
+		low = _mm_min_ps(low, x);
+		high = _mm_max_ps(high, x);
+		lowY = _mm_min_ps(lowY, y);
+		highY = _mm_max_ps(highY, y);
+		nearest = _mm_min_ps(nearest, z);
+	}
+
+	// Wholly before the near plane, or crossing it and so unbounded on screen
+	if (behind == 0xff)
+		return false;
+	if (behind != 0)
+		return true;
+
+	float minX = horizontalMin(low), maxX = horizontalMax(high);
+	float minY = horizontalMin(lowY), maxY = horizontalMax(highY);
+	float minZ = horizontalMin(nearest) - DEPTH_BIAS;
+	if (maxX < 0.0f || maxY < 0.0f || minX >= (float)width || minY >= (float)height || minZ > 1.0f)
+		return false;
+
+	int x0 = std::max((int)minX, 0), x1 = std::min((int)maxX, (int)width - 1);
+	int y0 = std::max((int)minY, 0), y1 = std::min((int)maxY, (int)height - 1);
+	unsigned int blocksX = width / BLOCK_SIZE;
+	glm_vec4 limit = _mm_set1_ps(minZ);
+	for (int by = y0 / (int)BLOCK_SIZE; by <= y1 / (int)BLOCK_SIZE; by++)
+	{
+		for (int bx = x0 / (int)BLOCK_SIZE; bx <= x1 / (int)BLOCK_SIZE; bx++)
+		{
+			// In front of everything in the block, or behind all of it
+			if (minZ <= blockMin[by * blocksX + bx])
+				return true;
+			if (minZ > blockMax[by * blocksX + bx])
+				continue;
+
+			int rowStart = std::max(by * (int)BLOCK_SIZE, y0), rowEnd = std::min((by + 1) * (int)BLOCK_SIZE - 1, y1);
+			int columnStart = std::max(bx * (int)BLOCK_SIZE, x0), columnEnd = std::min((bx + 1) * (int)BLOCK_SIZE - 1, x1);
+			for (int y = rowStart; y <= rowEnd; y++)
+			{
+				for (int x = bx * (int)BLOCK_SIZE; x < (bx + 1) * (int)BLOCK_SIZE; x += 4)
+				{
+					int lanes = 0;
+					for (int lane = 0; lane < 4; lane++)
+						if (x + lane >= columnStart && x + lane <= columnEnd)
+							lanes |= 1 << lane;
+
+					glm_vec4 values = _mm_loadu_ps(&depth[(size_t)y * width + x]);
+					if (_mm_movemask_ps(_mm_cmpge_ps(values, limit)) & lanes)
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+const float * OcclusionCuller::getDepth() const
+{
+	return depth.data();
+}
+
+unsigned int OcclusionCuller::getWidth() const
+{
+	return width;
+}
+
+unsigned int OcclusionCuller::getHeight() const
+{
+	return height;
+}
+
+unsigned int OcclusionCuller::getTriangleCount() const
+{
+	return (unsigned int)triangles.size();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <glm.hpp>
+
+// Software occlusion culling. Occluder triangles are clipped, projected and
+// binned into screen tiles, then each tile rasterizes its triangles into a
+// low resolution depth buffer, four pixels at a time with GLM's SIMD helpers,
+// tiles in parallel. Every 8x8 block of the buffer keeps its nearest and
+// farthest depth, so most bounding box tests finish without touching pixels.
+//
+// Depth is window depth in [0, 1], 1 where nothing was drawn. Results are
+// conservative: boxes crossing the near plane are always visible.
+class OcclusionCuller
+{
+private:
+	struct ScreenTriangle
+	{
+		float x[3], y[3], z[3]; // pixels, counter-clockwise with y up
+		int minX, minY, maxX, maxY;
+	};
+
+	unsigned int width;
+	unsigned int height;
+	unsigned int tilesX;
+	unsigned int tilesY;
+	glm::mat4 viewProjection;
+	std::vector<float> depth;
+	std::vector<float> blockMin;
+	std::vector<float> blockMax;
+	std::vector<ScreenTriangle> triangles;
+	std::vector<std::vector<unsigned int>> bins;
+	std::vector<float> clip; // scratch of addOccluder(), 4 floats per vertex
+
+	void addTriangle(const float * a, const float * b, const float * c, bool cullBackFaces);
+	void rasterizeTile(unsigned int tile);
+public:
+	static const unsigned int TILE_WIDTH = 64;
+	static const unsigned int TILE_HEIGHT = 32;
+	static const unsigned int BLOCK_SIZE = 8;
+
+	OcclusionCuller();
+
+	// Width and height must be multiples of the tile size
+	bool create(unsigned int width, unsigned int height);
+
+	void beginFrame(const glm::mat4 & viewProjection);
+
+	// Same layout as BVH::build(): three indices per triangle, or consecutive
+	// positions without indices
+	void addOccluder(const glm::mat4 & model, const glm::vec3 * positions, const unsigned int * triangleIndices, unsigned int triangleCount, bool cullBackFaces);
+	void rasterize();
+
+	// Whether any part of a model space box may be seen. Thread safe once
+	// rasterize() has returned.
+	bool isVisible(const glm::mat4 & model, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax) const;
+
+	const float * getDepth() const; // bottom row first
+	unsigned int getWidth() const;
+	unsigned int getHeight() const;
+	unsigned int getTriangleCount() const; // rasterized this frame, after clipping
+};
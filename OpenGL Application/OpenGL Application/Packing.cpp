@@ -0,0 +1,395 @@
+#include "Packing.h"
+#include "Simd.h"
+
+// glm::detail::toFloat16 on four lanes. glm rounds half away from zero
+// rather than to even, which the integer path reproduces exactly.
+static inline __m128i packHalf4(__m128 value)
+{
+	__m128i bits = _mm_castps_si128(value);
+	__m128i sign = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000));
+	__m128i magnitude = _mm_and_si128(bits, _mm_set1_epi32(0x7fffffff));
+
+	// Normalized half: add the rounding bit, rebias the exponent, saturate to infinity
+	__m128i rounded = _mm_add_epi32(magnitude, _mm_set1_epi32(0x1000));
+	__m128i normal = _mm_sub_epi32(_mm_srli_epi32(rounded, 13), _mm_set1_epi32((127 - 15) << 10));
+	__m128i overflow = _mm_cmpgt_epi32(rounded, _mm_set1_epi32(0x477fffff));
+	normal = _mm_or_si128(_mm_and_si128(overflow, _mm_set1_epi32(0x7c00)), _mm_andnot_si128(overflow, normal));
+
+	// Denormalized half: scale to units of the smallest denormal, truncate and round the remainder
+	__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(magnitude), _mm_set1_ps(16777216.0f));
+	__m128i truncated = _mm_cvttps_epi32(scaled);
+	__m128 remainder = _mm_sub_ps(scaled, _mm_cvtepi32_ps(truncated));
+	__m128i denormal = _mm_sub_epi32(truncated, _mm_castps_si128(_mm_cmpge_ps(remainder, _mm_set1_ps(0.5f))));
+
+	// Infinity and NaN, NaNs keep their top significand bits and never turn into infinity
+	__m128i significand = _mm_srli_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), 13);
+	__m128i emptyNan = _mm_and_si128(_mm_cmpeq_epi32(significand, _mm_setzero_si128()), _mm_set1_epi32(1));
+	__m128i isNan = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7f800000));
+	__m128i special = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(isNan, _mm_or_si128(significand, emptyNan)));
+
+	__m128i isDenormal = _mm_cmplt_epi32(magnitude, _mm_set1_epi32(0x38800000));
+	__m128i isSpecial = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7f7fffff));
+	__m128i result = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+	result = _mm_or_si128(_mm_and_si128(isSpecial, special), _mm_andnot_si128(isSpecial, result));
+	return _mm_or_si128(result, sign);
+}
+
+// glm::detail::toFloat32 on four lanes
+static inline __m128 unpackHalf4(__m128i half)
+{
+	__m128i sign = _mm_slli_epi32(_mm_and_si128(half, _mm_set1_epi32(0x8000)), 16);
+	__m128i magnitude = _mm_and_si128(half, _mm_set1_epi32(0x7fff));
+
+	__m128i normal = _mm_add_epi32(_mm_slli_epi32(magnitude, 13), _mm_set1_epi32((127 - 15) << 23));
+	__m128i special = _mm_or_si128(_mm_slli_epi32(magnitude, 13), _mm_set1_epi32(0x7f800000));
+	__m128 denormal = _mm_mul_ps(_mm_cvtepi32_ps(magnitude), _mm_set1_ps(1.0f / 16777216.0f));
+
+	__m128i isDenormal = _mm_cmplt_epi32(magnitude, _mm_set1_epi32(0x0400));
+	__m128i isSpecial = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7bff));
+	__m128i result = _mm_or_si128(_mm_and_si128(isDenormal, _mm_castps_si128(denormal)), _mm_andnot_si128(isDenormal, normal));
+	result = _mm_or_si128(_mm_and_si128(isSpecial, special), _mm_andnot_si128(isSpecial, result));
+	return _mm_castsi128_ps(_mm_or_si128(result, sign));
+}
+
+// Narrows eight 32 bit lanes holding 16 bit values without SSE4.1's packus
+static inline __m128i narrow16(__m128i low, __m128i high)
+{
+	low = _mm_srai_epi32(_mm_slli_epi32(low, 16), 16);
+	high = _mm_srai_epi32(_mm_slli_epi32(high, 16), 16);
+	return _mm_packs_epi32(low, high);
+}
+
+// F16C only offers IEEE rounding modes. Convert with truncation and add one
+// where the value is at least halfway to the next half, which gives glm's
+// round-half-up. Out of range values and NaNs are patched afterwards.
+SIMD_TARGET_F16C static void packHalfF16C(const float * source, glm::uint16 * destination, size_t count)
+{
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+	for (size_t i = 0; i + 8 <= count; i += 8)
+	{
+		__m256 value = _mm256_loadu_ps(source + i);
+		__m256 magnitude = _mm256_and_ps(value, absMask);
+		__m128i truncated = _mm256_cvtps_ph(magnitude, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+
+		__m256 lower = _mm256_cvtph_ps(truncated);
+		__m256 upper = _mm256_cvtph_ps(_mm_add_epi16(truncated, _mm_set1_epi16(1)));
+		__m256 roundUp = _mm256_cmp_ps(_mm256_add_ps(magnitude, magnitude), _mm256_add_ps(lower, upper), _CMP_GE_OQ);
+
+		// cmp lanes are all ones, narrow them to 16 bit -1 and subtract to round up
+		__m128i roundUp16 = _mm_packs_epi32(_mm_castps_si128(_mm256_castps256_ps128(roundUp)), _mm_castps_si128(_mm256_extractf128_ps(roundUp, 1)));
+		__m128i result = _mm_sub_epi16(truncated, roundUp16);
+
+		__m128 lowHalf = _mm256_castps256_ps128(value);
+		__m128 highHalf = _mm256_extractf128_ps(value, 1);
+		__m128i sign = narrow16(_mm_srli_epi32(_mm_castps_si128(lowHalf), 16), _mm_srli_epi32(_mm_castps_si128(highHalf), 16));
+		result = _mm_or_si128(result, _mm_and_si128(sign, _mm_set1_epi16((short)0x8000)));
+
+		// From 65520 up the value rounds to infinity, which the truncating conversion cannot see
+		__m128i outOfRange = _mm_packs_epi32(
+			_mm_cmpgt_epi32(_mm_castps_si128(_mm256_castps256_ps128(magnitude)), _mm_set1_epi32(0x477fefff)),
+			_mm_cmpgt_epi32(_mm_castps_si128(_mm256_extractf128_ps(magnitude, 1)), _mm_set1_epi32(0x477fefff)));
+		if (_mm_movemask_epi8(outOfRange))
+		{
+			__m128i exact = narrow16(packHalf4(lowHalf), packHalf4(highHalf));
+			result = _mm_or_si128(_mm_and_si128(outOfRange, exact), _mm_andnot_si128(outOfRange, result));
+		}
+
+		_mm_storeu_si128((__m128i *)(destination + i), result);
+	}
+}
+
+SIMD_TARGET_F16C static void unpackHalfF16C(const glm::uint16 * source, float * destination, size_t count)
+{
+	for (size_t i = 0; i + 8 <= count; i += 8)
+	{
+		__m128i half = _mm_loadu_si128((const __m128i *)(source + i));
+		__m256 result = _mm256_cvtph_ps(half);
+
+		// F16C quiets signalling NaNs, glm keeps the payload untouched
+		__m128i isNan = _mm_cmpgt_epi16(_mm_and_si128(half, _mm_set1_epi16(0x7fff)), _mm_set1_epi16(0x7c00));
+		if (_mm_movemask_epi8(isNan))
+		{
+			__m128 low = unpackHalf4(_mm_unpacklo_epi16(half, _mm_setzero_si128()));
+			__m128 high = unpackHalf4(_mm_unpackhi_epi16(half, _mm_setzero_si128()));
+			result = _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+		}
+
+		_mm256_storeu_ps(destination + i, result);
+	}
+}
+
+void packHalf(const float * source, glm::uint16 * destination, size_t count)
+{
+	size_t i = 0;
+
+	if (cpuHasF16C())
+	{
+		packHalfF16C(source, destination, count);
+		i = count & ~(size_t)7;
+	}
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i packed = narrow16(packHalf4(_mm_loadu_ps(source + i)), packHalf4(_mm_loadu_ps(source + i + 4)));
+		_mm_storeu_si128((__m128i *)(destination + i), packed);
+	}
+
+	for (; i < count; i++)
+		destination[i] = glm::packHalf1x16(source[i]);
+}
+
+void unpackHalf(const glm::uint16 * source, float * destination, size_t count)
+{
+	size_t i = 0;
+
+	if (cpuHasF16C())
+	{
+		unpackHalfF16C(source, destination, count);
+		i = count & ~(size_t)7;
+	}
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i half = _mm_loadu_si128((const __m128i *)(source + i));
+		_mm_storeu_ps(destination + i, unpackHalf4(_mm_unpacklo_epi16(half, _mm_setzero_si128())));
+		_mm_storeu_ps(destination + i + 4, unpackHalf4(_mm_unpackhi_epi16(half, _mm_setzero_si128())));
+	}
+
+	for (; i < count; i++)
+		destination[i] = glm::unpackHalf1x16(source[i]);
+}
+
+// glm::round, rounds halfway cases away from zero unlike cvtps
+static inline __m128i roundToInt4(__m128 x)
+{
+	__m128i truncated = _mm_cvttps_epi32(x);
+	__m128 fraction = _mm_sub_ps(x, _mm_cvtepi32_ps(truncated));
+	__m128i up = _mm_castps_si128(_mm_cmpge_ps(fraction, _mm_set1_ps(0.5f)));
+	__m128i down = _mm_castps_si128(_mm_cmple_ps(fraction, _mm_set1_ps(-0.5f)));
+	return _mm_add_epi32(_mm_sub_epi32(truncated, up), down);
+}
+
+// glm::clamp, operand order keeps glm's handling of NaN and signed zero
+static inline __m128 clamp4(__m128 x, __m128 minVal, __m128 maxVal)
+{
+	return _mm_min_ps(_mm_max_ps(x, minVal), maxVal);
+}
+
+static inline __m128i select4(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+void packUnorm4x8(const glm::vec4 * source, glm::uint32 * destination, size_t count)
+{
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const float * p = &source[i].x;
+		__m128i a = roundToInt4(_mm_mul_ps(clamp4(_mm_loadu_ps(p), zero, one), scale));
+		__m128i b = roundToInt4(_mm_mul_ps(clamp4(_mm_loadu_ps(p + 4), zero, one), scale));
+		__m128i c = roundToInt4(_mm_mul_ps(clamp4(_mm_loadu_ps(p + 8), zero, one), scale));
+		__m128i d = roundToInt4(_mm_mul_ps(clamp4(_mm_loadu_ps(p + 12), zero, one), scale));
+		_mm_storeu_si128((__m128i *)(destination + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+
+	for (; i < count; i++)
+		destination[i] = glm::packUnorm4x8(source[i]);
+}
+
+void unpackUnorm4x8(const glm::uint32 * source, glm::vec4 * destination, size_t count)
+{
+	const __m128 scale = _mm_set1_ps(0.0039215686274509803921568627451f);
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i packed = _mm_loadu_si128((const __m128i *)(source + i));
+		__m128i low = _mm_unpacklo_epi8(packed, zero);
+		__m128i high = _mm_unpackhi_epi8(packed, zero);
+		float * p = &destination[i].x;
+		_mm_storeu_ps(p, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+		_mm_storeu_ps(p + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+		_mm_storeu_ps(p + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+		_mm_storeu_ps(p + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+	}
+
+	for (; i < count; i++)
+		destination[i] = glm::unpackUnorm4x8(source[i]);
+}
+
+void packUnorm2x16(const glm::vec2 * source, glm::uint32 * destination, size_t count)
+{
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(65535.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const float * p = &source[i].x;
+		__m128i a = roundToInt4(_mm_mul_ps(clamp4(_mm_loadu_ps(p), zero, one), scale));
+		__m128i b = roundToInt4(_mm_mul_ps(clamp4(_mm_loadu_ps(p + 4), zero, one), scale));
+		_mm_storeu_si128((__m128i *)(destination + i), narrow16(a, b));
+	}
+
+	for (; i < count; i++)
+		destination[i] = glm::packUnorm2x16(source[i]);
+}
+
+void unpackUnorm2x16(const glm::uint32 * source, glm::vec2 * destination, size_t count)
+{
+	const __m128 scale = _mm_set1_ps(1.5259021896696421759365224689097e-5f);
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i packed = _mm_loadu_si128((const __m128i *)(source + i));
+		float * p = &destination[i].x;
+		_mm_storeu_ps(p, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, zero)), scale));
+		_mm_storeu_ps(p + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(packed, zero)), scale));
+	}
+
+	for (; i < count; i++)
+		destination[i] = glm::unpackUnorm2x16(source[i]);
+}
+
+void packSnorm3x10_1x2(const glm::vec4 * source, glm::uint32 * destination, size_t count)
+{
+	const __m128 minusOne = _mm_set1_ps(-1.0f), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(511.0f);
+	const __m128i mask10 = _mm_set1_epi32(0x3ff);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const float * p = &source[i].x;
+		__m128 x = _mm_loadu_ps(p), y = _mm_loadu_ps(p + 4), z = _mm_loadu_ps(p + 8), w = _mm_loadu_ps(p + 12);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		__m128i ix = roundToInt4(_mm_mul_ps(clamp4(x, minusOne, one), scale));
+		__m128i iy = roundToInt4(_mm_mul_ps(clamp4(y, minusOne, one), scale));
+		__m128i iz = roundToInt4(_mm_mul_ps(clamp4(z, minusOne, one), scale));
+		__m128i iw = roundToInt4(_mm_mul_ps(clamp4(w, minusOne, one), one));
+
+		__m128i packed = _mm_and_si128(ix, mask10);
+		packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_and_si128(iy, mask10), 10));
+		packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_and_si128(iz, mask10), 20));
+		packed = _mm_or_si128(packed, _mm_slli_epi32(iw, 30));
+		_mm_storeu_si128((__m128i *)(destination + i), packed);
+	}
+
+	for (; i < count; i++)
+		destination[i] = glm::packSnorm3x10_1x2(source[i]);
+}
+
+void unpackSnorm3x10_1x2(const glm::uint32 * source, glm::vec4 * destination, size_t count)
+{
+	const __m128 minusOne = _mm_set1_ps(-1.0f), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(511.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i packed = _mm_loadu_si128((const __m128i *)(source + i));
+
+		// Shift each field to the top and back down to sign extend it
+		__m128 x = clamp4(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 22), 22)), scale), minusOne, one);
+		__m128 y = clamp4(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 12), 22)), scale), minusOne, one);
+		__m128 z = clamp4(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 2), 22)), scale), minusOne, one);
+		__m128 w = clamp4(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(packed, 30)), one), minusOne, one);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		float * p = &destination[i].x;
+		_mm_storeu_ps(p, x);
+		_mm_storeu_ps(p + 4, y);
+		_mm_storeu_ps(p + 8, z);
+		_mm_storeu_ps(p + 12, w);
+	}
+
+	for (; i < count; i++)
+		destination[i] = glm::unpackSnorm3x10_1x2(source[i]);
+}
+
+// glm::detail::floatTo11bit / floatTo10bit. glm truncates the significand
+// and maps zero, infinity and NaN to fixed codes.
+static inline __m128i packSmallFloat4(__m128 value, int mantissaBits)
+{
+	__m128i bits = _mm_castps_si128(value);
+	__m128i magnitude = _mm_and_si128(bits, _mm_set1_epi32(0x7fffffff));
+	int shift = 23 - mantissaBits;
+	int exponentMask = 0x1f << mantissaBits;
+
+	__m128i exponent = _mm_and_si128(_mm_srli_epi32(_mm_sub_epi32(_mm_and_si128(bits, _mm_set1_epi32(0x7f800000)), _mm_set1_epi32(0x38000000)), shift), _mm_set1_epi32(exponentMask));
+	__m128i packed = _mm_or_si128(exponent, _mm_and_si128(_mm_srli_epi32(bits, shift), _mm_set1_epi32((1 << mantissaBits) - 1)));
+
+	__m128i isZero = _mm_cmpeq_epi32(magnitude, _mm_setzero_si128());
+	__m128i isInf = _mm_cmpeq_epi32(magnitude, _mm_set1_epi32(0x7f800000));
+	__m128i isNan = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7f800000));
+	packed = _mm_andnot_si128(isZero, packed);
+	packed = select4(isInf, _mm_set1_epi32(exponentMask), packed);
+	packed = select4(isNan, _mm_set1_epi32(-1), packed);
+	return _mm_and_si128(packed, _mm_set1_epi32((1 << (mantissaBits + 5)) - 1));
+}
+
+// glm::detail::packed11bitToFloat / packed10bitToFloat. The special cases are
+// tested on the whole shifted word the same way glm does, and glm returns
+// -1.0f for both the infinity and the NaN code.
+static inline __m128 unpackSmallFloat4(__m128i shifted, int mantissaBits)
+{
+	int shift = 23 - mantissaBits;
+	int exponentMask = 0x1f << mantissaBits;
+
+	__m128i exponent = _mm_and_si128(_mm_add_epi32(_mm_slli_epi32(_mm_and_si128(shifted, _mm_set1_epi32(exponentMask)), shift), _mm_set1_epi32(0x38000000)), _mm_set1_epi32(0x7f800000));
+	__m128i bits = _mm_or_si128(exponent, _mm_slli_epi32(_mm_and_si128(shifted, _mm_set1_epi32((1 << mantissaBits) - 1)), shift));
+
+	__m128i isZero = _mm_cmpeq_epi32(shifted, _mm_setzero_si128());
+	__m128i isSpecial = _mm_or_si128(
+		_mm_cmpeq_epi32(shifted, _mm_set1_epi32((1 << (mantissaBits + 5)) - 1)),
+		_mm_cmpeq_epi32(shifted, _mm_set1_epi32(exponentMask)));
+	bits = _mm_andnot_si128(isZero, bits);
+	bits = select4(isSpecial, _mm_castps_si128(_mm_set1_ps(-1.0f)), bits);
+	return _mm_castsi128_ps(bits);
+}
+
+void packF2x11_1x10(const glm::vec3 * source, glm::uint32 * destination, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const glm::vec3 * p = source + i;
+		__m128 x = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+		__m128 y = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+		__m128 z = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+
+		__m128i packed = packSmallFloat4(x, 6);
+		packed = _mm_or_si128(packed, _mm_slli_epi32(packSmallFloat4(y, 6), 11));
+		packed = _mm_or_si128(packed, _mm_slli_epi32(packSmallFloat4(z, 5), 22));
+		_mm_storeu_si128((__m128i *)(destination + i), packed);
+	}
+
+	for (; i < count; i++)
+		destination[i] = glm::packF2x11_1x10(source[i]);
+}
+
+void unpackF2x11_1x10(const glm::uint32 * source, glm::vec3 * destination, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i packed = _mm_loadu_si128((const __m128i *)(source + i));
+		float x[4], y[4], z[4];
+		_mm_storeu_ps(x, unpackSmallFloat4(packed, 6));
+		_mm_storeu_ps(y, unpackSmallFloat4(_mm_srli_epi32(packed, 11), 6));
+		_mm_storeu_ps(z, unpackSmallFloat4(_mm_srli_epi32(packed, 22), 5));
+
+		for (int lane = 0; lane < 4; lane++)
+			destination[i + lane] = glm::vec3(x[lane], y[lane], z[lane]);
+	}
+
+	for (; i < count; i++)
+		destination[i] = glm::unpackF2x11_1x10(source[i]);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <gtc/packing.hpp>
+
+// Array versions of the gtc/packing functions for converting whole vertex
+// and texture buffers. Results are bit exact against the scalar functions.
+
+// glm::packHalf1x16 / glm::unpackHalf1x16 over count values. Uses F16C when
+// the CPU has it and an SSE2 integer path otherwise.
+void packHalf(const float * source, glm::uint16 * destination, size_t count);
+void unpackHalf(const glm::uint16 * source, float * destination, size_t count);
+
+// Normalized integer and small float formats for vertex attributes and
+// render targets, each matching its gtc/packing namesake element by element
+void packUnorm4x8(const glm::vec4 * source, glm::uint32 * destination, size_t count);
+void unpackUnorm4x8(const glm::uint32 * source, glm::vec4 * destination, size_t count);
+void packUnorm2x16(const glm::vec2 * source, glm::uint32 * destination, size_t count);
+void unpackUnorm2x16(const glm::uint32 * source, glm::vec2 * destination, size_t count);
+void packSnorm3x10_1x2(const glm::vec4 * source, glm::uint32 * destination, size_t count);
+void unpackSnorm3x10_1x2(const glm::uint32 * source, glm::vec4 * destination, size_t count);
+void packF2x11_1x10(const glm::vec3 * source, glm::uint32 * destination, size_t count);
+void unpackF2x11_1x10(const glm::uint32 * source, glm::vec3 * destination, size_t count);
@@ -0,0 +1,257 @@
+#include "PostProcessing.h"
+#include <cstdio>
+#include <algorithm>
+
+const unsigned int PostProcessChain::BLUR_GROUP_SIZE;
+const unsigned int PostProcessChain::TILE_SIZE;
+const unsigned int PostProcessChain::PREFILTER_GROUP_SIZE;
+
+// Bloom keeps no alpha, half the bandwidth of RGBA16F
+const GLenum BLOOM_FORMAT = GL_R11F_G11F_B10F;
+
+static unsigned int groupCount(unsigned int size, unsigned int groupSize)
+{
+	return (size + groupSize - 1) / groupSize;
+}
+
+PostProcessChain::PostProcessChain()
+{
+	prefilterProgram = nullptr;
+	blurProgram = nullptr;
+	std::fill(uberPrograms, uberPrograms + VARIANT_COUNT, nullptr);
+	lutTexture = 0;
+	readFramebuffer = 0;
+	firstUnit = 0;
+	settings.exposure = 1.0f;
+	settings.bloom = true;
+	settings.bloomDownsample = 2;
+	settings.bloomThreshold = 1.0f;
+	settings.bloomStrength = 0.1f;
+	settings.fxaa = true;
+}
+
+PostProcessChain::~PostProcessChain()
+{
+	glDeleteTextures(1, &lutTexture);
+	glDeleteFramebuffers(1, &readFramebuffer);
+	delete prefilterProgram;
+	delete blurProgram;
+	for (GLSLProgram * program : uberPrograms)
+		delete program;
+}
+
+bool PostProcessChain::create(GLuint firstUnit)
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		printf("Post-processing needs OpenGL 4.3\n");
+		return false;
+	}
+
+	prefilterProgram = new GLSLProgram();
+	if (!prefilterProgram->compileShaderFromFile("bloom_prefilter.cs", GL_COMPUTE_SHADER) || !prefilterProgram->link())
+	{
+		printf("Bloom prefilter shader failed to build!\n%s", prefilterProgram->log().c_str());
+		return false;
+	}
+
+	blurProgram = new GLSLProgram();
+	if (!blurProgram->compileShaderFromFile("blur.cs", GL_COMPUTE_SHADER) || !blurProgram->link())
+	{
+		printf("Blur shader failed to build!\n%s", blurProgram->log().c_str());
+		return false;
+	}
+
+	// The uber pass is built now with the default settings so a broken
+	// shader shows up at start rather than on the first frame
+	this->firstUnit = firstUnit;
+	if (!getUberProgram(VARIANT_BLOOM | VARIANT_FXAA))
+		return false;
+
+	glGenFramebuffers(1, &readFramebuffer);
+	return true;
+}
+
+GLSLProgram * PostProcessChain::getUberProgram(unsigned int variant)
+{
+	if (uberPrograms[variant])
+		return uberPrograms[variant]->isLinked() ? uberPrograms[variant] : nullptr;
+
+	string defines;
+	if (variant & VARIANT_BLOOM)
+		defines += "#define BLOOM 1\n";
+	if (variant & VARIANT_LUT)
+		defines += "#define LUT 1\n";
+	if (variant & VARIANT_FXAA)
+		defines += "#define FXAA 1\n";
+
+	// A failed variant is kept so it is not rebuilt every frame
+	uberPrograms[variant] = new GLSLProgram();
+	if (!uberPrograms[variant]->compileShaderFromFile("post_uber.cs", GL_COMPUTE_SHADER, defines) || !uberPrograms[variant]->link())
+	{
+		printf("Post-processing shader failed to build!\n%s%s", defines.c_str(), uberPrograms[variant]->log().c_str());
+		return nullptr;
+	}
+	return uberPrograms[variant];
+}
+
+void PostProcessChain::setSettings(const PostSettings & settings)
+{
+	this->settings = settings;
+	this->settings.bloomDownsample = settings.bloomDownsample >= 4 ? 4 : 2;
+}
+
+const PostSettings & PostProcessChain::getSettings() const
+{
+	return settings;
+}
+
+void PostProcessChain::setLut(const ColorLut & lut)
+{
+	if (lut.size == 0)
+	{
+		glDeleteTextures(1, &lutTexture);
+		lutTexture = 0;
+		return;
+	}
+
+	if (!lutTexture)
+		glGenTextures(1, &lutTexture);
+	glBindTexture(GL_TEXTURE_3D, lutTexture);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, lut.size, lut.size, lut.size, 0, GL_RGB, GL_FLOAT, lut.colors.data());
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void PostProcessChain::prefilter(GLuint hdr, GLuint bloom, unsigned int bloomWidth, unsigned int bloomHeight)
+{
+	prefilterProgram->use();
+	prefilterProgram->setUniform("source", (int)firstUnit);
+	prefilterProgram->setUniform("exposure", settings.exposure);
+	prefilterProgram->setUniform("threshold", settings.bloomThreshold);
+	prefilterProgram->setUniform("tap_offset", settings.bloomDownsample / 4.0f);
+	glActiveTexture(GL_TEXTURE0 + firstUnit);
+	glBindTexture(GL_TEXTURE_2D, hdr);
+	glBindImageTexture(0, bloom, 0, GL_FALSE, 0, GL_WRITE_ONLY, BLOOM_FORMAT);
+	glDispatchCompute(groupCount(bloomWidth, PREFILTER_GROUP_SIZE), groupCount(bloomHeight, PREFILTER_GROUP_SIZE), 1);
+}
+
+void PostProcessChain::blur(GLuint source, GLuint destination, unsigned int width, unsigned int height, bool horizontal)
+{
+	blurProgram->use();
+	blurProgram->setUniform("source", (int)firstUnit);
+	blurProgram->setUniform("horizontal", horizontal);
+	glActiveTexture(GL_TEXTURE0 + firstUnit);
+	glBindTexture(GL_TEXTURE_2D, source);
+	glBindImageTexture(0, destination, 0, GL_FALSE, 0, GL_WRITE_ONLY, BLOOM_FORMAT);
+
+	// A workgroup per run of BLUR_GROUP_SIZE texels along the blurred axis
+	unsigned int length = horizontal ? width : height;
+	glDispatchCompute(groupCount(length, BLUR_GROUP_SIZE), horizontal ? height : width, 1);
+}
+
+void PostProcessChain::uber(GLuint hdr, GLuint bloom, GLuint ldr, unsigned int width, unsigned int height)
+{
+	unsigned int variant = (bloom ? VARIANT_BLOOM : 0) | (lutTexture ? VARIANT_LUT : 0) | (settings.fxaa ? VARIANT_FXAA : 0);
+	GLSLProgram * program = getUberProgram(variant);
+	if (!program)
+	{
+		glUseProgram(0);
+		return;
+	}
+
+	program->use();
+	program->setUniform("hdr_texture", (int)firstUnit);
+	program->setUniform("exposure", settings.exposure);
+	glActiveTexture(GL_TEXTURE0 + firstUnit);
+	glBindTexture(GL_TEXTURE_2D, hdr);
+	if (bloom)
+	{
+		program->setUniform("bloom_texture", (int)firstUnit + 1);
+		program->setUniform("bloom_strength", settings.bloomStrength);
+		glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+		glBindTexture(GL_TEXTURE_2D, bloom);
+	}
+	if (lutTexture)
+	{
+		program->setUniform("lut_texture", (int)firstUnit + 2);
+		glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+		glBindTexture(GL_TEXTURE_3D, lutTexture);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glBindImageTexture(0, ldr, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	glDispatchCompute(groupCount(width, TILE_SIZE), groupCount(height, TILE_SIZE), 1);
+	glUseProgram(0);
+}
+
+void PostProcessChain::present(GLuint ldr, unsigned int width, unsigned int height, const RenderPassTarget & target)
+{
+	// Upscaled bilinearly when rendered at a lower resolution
+	GLenum filter = width == target.width && height == target.height ? GL_NEAREST : GL_LINEAR;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ldr, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target.framebuffer);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, target.width, target.height, GL_COLOR_BUFFER_BIT, filter);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+}
+
+void PostProcessChain::addPasses(RenderGraph & graph, RenderGraph::Resource hdr, RenderGraph::Resource output)
+{
+	unsigned int width = graph.getDescription(hdr).width, height = graph.getDescription(hdr).height;
+
+	// The blurs ping-pong between two textures, the last one being a resource
+	// of its own so no pass reads and writes the same one; it shares the
+	// first one's memory
+	RenderGraph::Resource bloom = 0;
+	if (settings.bloom)
+	{
+		unsigned int bloomWidth = groupCount(width, settings.bloomDownsample), bloomHeight = groupCount(height, settings.bloomDownsample);
+		RenderGraph::Resource prefiltered = graph.createTexture("bloom prefiltered", bloomWidth, bloomHeight, BLOOM_FORMAT);
+		RenderGraph::Resource blurredX = graph.createTexture("bloom blurred x", bloomWidth, bloomHeight, BLOOM_FORMAT);
+		bloom = graph.createTexture("bloom", bloomWidth, bloomHeight, BLOOM_FORMAT);
+
+		unsigned int pass = graph.addPass("bloom prefilter", [this, &graph, hdr, prefiltered, bloomWidth, bloomHeight](const RenderPassTarget &)
+		{
+			prefilter(graph.getHandle(hdr), graph.getHandle(prefiltered), bloomWidth, bloomHeight);
+		});
+		graph.read(pass, hdr, ACCESS_SAMPLED);
+		graph.write(pass, prefiltered, ACCESS_IMAGE);
+
+		pass = graph.addPass("bloom blur x", [this, &graph, prefiltered, blurredX, bloomWidth, bloomHeight](const RenderPassTarget &)
+		{
+			blur(graph.getHandle(prefiltered), graph.getHandle(blurredX), bloomWidth, bloomHeight, true);
+		});
+		graph.read(pass, prefiltered, ACCESS_SAMPLED);
+		graph.write(pass, blurredX, ACCESS_IMAGE);
+
+		pass = graph.addPass("bloom blur y", [this, &graph, blurredX, bloom, bloomWidth, bloomHeight](const RenderPassTarget &)
+		{
+			blur(graph.getHandle(blurredX), graph.getHandle(bloom), bloomWidth, bloomHeight, false);
+		});
+		graph.read(pass, blurredX, ACCESS_SAMPLED);
+		graph.write(pass, bloom, ACCESS_IMAGE);
+	}
+
+	RenderGraph::Resource ldr = graph.createTexture("post ldr", width, height, GL_RGBA8);
+	bool bloomEnabled = settings.bloom;
+	unsigned int pass = graph.addPass("post uber", [this, &graph, hdr, bloom, ldr, bloomEnabled, width, height](const RenderPassTarget &)
+	{
+		uber(graph.getHandle(hdr), bloomEnabled ? graph.getHandle(bloom) : 0, graph.getHandle(ldr), width, height);
+	});
+	graph.read(pass, hdr, ACCESS_SAMPLED);
+	if (bloomEnabled)
+		graph.read(pass, bloom, ACCESS_SAMPLED);
+	graph.write(pass, ldr, ACCESS_IMAGE);
+
+	// Blits read through a framebuffer, the image stores need its barrier
+	pass = graph.addPass("present", [this, &graph, ldr, width, height](const RenderPassTarget & target)
+	{
+		present(graph.getHandle(ldr), width, height, target);
+	});
+	graph.read(pass, ldr, ACCESS_ATTACHMENT);
+	graph.write(pass, output, ACCESS_ATTACHMENT);
+}
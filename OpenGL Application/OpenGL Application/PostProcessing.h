@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glew.h>
+#include <glm.hpp>
+#include "GLSLProgram.h"
+#include "RenderGraph.h"
+#include "ColorLut.h"
+
+struct PostSettings
+{
+	float exposure;
+	bool bloom;
+	unsigned int bloomDownsample; // 2 for half resolution, 4 for quarter
+	float bloomThreshold;         // exposed brightness where bloom starts
+	float bloomStrength;
+	bool fxaa;
+};
+
+// HDR to display post-processing in compute shaders, added to a render graph
+// as passes between the rendered HDR colour and the backbuffer:
+// - bloom prefilter: thresholds and downsamples the exposed colour to half
+//   or quarter resolution in one pass, with four bilinear taps,
+// - bloom blur x and y: a separable Gaussian, each workgroup blurring a run
+//   of a row or column staged in shared memory with its apron,
+// - post uber: bloom upsample, exposure, ACES tonemapping, gamma, the colour
+//   grading LUT and FXAA in a single pass, each workgroup grading its tile
+//   and apron into shared memory so FXAA filters graded colour without
+//   another pass over the image,
+// - present: a blit into the output, which compute cannot write when it is
+//   the default framebuffer, upscaling when the frame was rendered at a
+//   lower resolution.
+//
+// Each combination of bloom, LUT and FXAA is its own program, compiled when
+// first used, so a disabled stage costs nothing. Needs OpenGL 4.3.
+class PostProcessChain
+{
+private:
+	enum Variant
+	{
+		VARIANT_BLOOM = 1,
+		VARIANT_LUT = 2,
+		VARIANT_FXAA = 4,
+		VARIANT_COUNT = 8
+	};
+
+	GLSLProgram * prefilterProgram;
+	GLSLProgram * blurProgram;
+	GLSLProgram * uberPrograms[VARIANT_COUNT];
+	GLuint lutTexture;
+	GLuint readFramebuffer; // present blit source
+	GLuint firstUnit;
+	PostSettings settings;
+
+	GLSLProgram * getUberProgram(unsigned int variant);
+	void prefilter(GLuint hdr, GLuint bloom, unsigned int bloomWidth, unsigned int bloomHeight);
+	void blur(GLuint source, GLuint destination, unsigned int width, unsigned int height, bool horizontal);
+	void uber(GLuint hdr, GLuint bloom, GLuint ldr, unsigned int width, unsigned int height);
+	void present(GLuint ldr, unsigned int width, unsigned int height, const RenderPassTarget & target);
+public:
+	static const unsigned int BLUR_GROUP_SIZE = 128;
+	static const unsigned int TILE_SIZE = 16;
+	static const unsigned int PREFILTER_GROUP_SIZE = 8;
+
+	PostProcessChain();
+	~PostProcessChain();
+
+	// Uses three texture units from firstUnit and image unit 0
+	bool create(GLuint firstUnit);
+
+	void setSettings(const PostSettings & settings);
+	const PostSettings & getSettings() const;
+
+	// An empty table turns grading off
+	void setLut(const ColorLut & lut);
+
+	// Passes reading the RGBA16F hdr texture and writing output, which is
+	// the same size or larger. Leaves no program in use.
+	void addPasses(RenderGraph & graph, RenderGraph::Resource hdr, RenderGraph::Resource output);
+};
@@ -0,0 +1,568 @@
+#include "QuatBatch.h"
+#include <cmath>
+#include <limits>
+#include "Simd.h"
+#include "ThreadPool.h"
+
+// acos on [0, 1] (Abramowitz and Stegun 4.4.46, error below 2e-8) and sin on
+// [0, pi/2] (Taylor series to x^11, error below 6e-8). The SIMD kernels
+// evaluate the same polynomials in the same order.
+static const float ACOS_COEFFICIENTS[8] = { 1.5707963050f, -0.2145988016f, 0.0889789874f, -0.0501743046f,
+	0.0308918810f, -0.0170881256f, 0.0066700901f, -0.0012624911f };
+static const float SIN_COEFFICIENTS[5] = { -1.0f / 6.0f, 1.0f / 120.0f, -1.0f / 5040.0f, 1.0f / 362880.0f, -1.0f / 39916800.0f };
+
+// Fitted correction of t for slerpFast, from "Approximating slerp" (Kapoulkine)
+static const float FAST_A[4] = { 1.0904f, -3.2452f, 3.55645f, -1.43519f };
+static const float FAST_B[3] = { 0.848013f, -1.06021f, 0.215638f };
+
+static float acosPolynomial(float c)
+{
+	const float * a = ACOS_COEFFICIENTS;
+	float p = a[0] + c * (a[1] + c * (a[2] + c * (a[3] + c * (a[4] + c * (a[5] + c * (a[6] + c * a[7]))))));
+	return std::sqrt(1.0f - c) * p;
+}
+
+static float sinPolynomial(float x)
+{
+	const float * s = SIN_COEFFICIENTS;
+	float x2 = x * x;
+	return x + x * x2 * (s[0] + x2 * (s[1] + x2 * (s[2] + x2 * (s[3] + x2 * s[4]))));
+}
+
+glm::quat quatNlerp(const glm::quat & a, const glm::quat & b, float t)
+{
+	glm::quat z = glm::dot(a, b) < 0.0f ? -b : b;
+	return glm::normalize(a * (1.0f - t) + z * t);
+}
+
+glm::quat quatSlerp(const glm::quat & a, const glm::quat & b, float t)
+{
+	glm::quat z = b;
+	float cosTheta = glm::dot(a, b);
+	if (cosTheta < 0.0f)
+	{
+		z = -b;
+		cosTheta = -cosTheta;
+	}
+
+	// Same linear fallback as glm::slerp
+	if (cosTheta > 1.0f - std::numeric_limits<float>::epsilon())
+		return glm::quat(glm::mix(a.w, z.w, t), glm::mix(a.x, z.x, t), glm::mix(a.y, z.y, t), glm::mix(a.z, z.z, t));
+
+	float angle = acosPolynomial(cosTheta);
+	float s0 = sinPolynomial((1.0f - t) * angle);
+	float s1 = sinPolynomial(t * angle);
+	float s = sinPolynomial(angle);
+	return glm::quat((s0 * a.w + s1 * z.w) / s, (s0 * a.x + s1 * z.x) / s, (s0 * a.y + s1 * z.y) / s, (s0 * a.z + s1 * z.z) / s);
+}
+
+glm::quat quatSlerpFast(const glm::quat & a, const glm::quat & b, float t)
+{
+	glm::quat z = b;
+	float d = glm::dot(a, b);
+	if (d < 0.0f)
+	{
+		z = -b;
+		d = -d;
+	}
+
+	float h = t - 0.5f;
+	float c = t * h * (t - 1.0f);
+	float k = (FAST_A[0] + d * (FAST_A[1] + d * (FAST_A[2] + d * FAST_A[3]))) * h * h + (FAST_B[0] + d * (FAST_B[1] + d * FAST_B[2]));
+	float u = t + c * k;
+	return glm::normalize(a * (1.0f - u) + z * u);
+}
+
+glm::mat3x4 quatToMat3x4(const glm::quat & q, const glm::vec3 & translation)
+{
+	glm::mat3 m = glm::mat3_cast(q);
+	return glm::mat3x4(
+		glm::vec4(m[0][0], m[1][0], m[2][0], translation.x),
+		glm::vec4(m[0][1], m[1][1], m[2][1], translation.y),
+		glm::vec4(m[0][2], m[1][2], m[2][2], translation.z));
+}
+
+// -- SSE2, four quaternions per iteration --
+
+struct Quat4
+{
+	__m128 x, y, z, w;
+};
+
+static inline Quat4 load4(const QuatArray & q, size_t i)
+{
+	Quat4 r = { _mm_loadu_ps(&q.x[i]), _mm_loadu_ps(&q.y[i]), _mm_loadu_ps(&q.z[i]), _mm_loadu_ps(&q.w[i]) };
+	return r;
+}
+
+static inline void store4(QuatArray & q, size_t i, const Quat4 & v)
+{
+	_mm_storeu_ps(&q.x[i], v.x);
+	_mm_storeu_ps(&q.y[i], v.y);
+	_mm_storeu_ps(&q.z[i], v.z);
+	_mm_storeu_ps(&q.w[i], v.w);
+}
+
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 dot4(const Quat4 & a, const Quat4 & b)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_add_ps(_mm_mul_ps(a.z, b.z), _mm_mul_ps(a.w, b.w)));
+}
+
+// Negates the lanes of q where mask is set
+static inline Quat4 negate4(const Quat4 & q, __m128 mask)
+{
+	__m128 sign = _mm_and_ps(mask, _mm_set1_ps(-0.0f));
+	Quat4 r = { _mm_xor_ps(q.x, sign), _mm_xor_ps(q.y, sign), _mm_xor_ps(q.z, sign), _mm_xor_ps(q.w, sign) };
+	return r;
+}
+
+static inline Quat4 normalize4(const Quat4 & q)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	__m128 len = _mm_sqrt_ps(dot4(q, q));
+	__m128 degenerate = _mm_cmple_ps(len, zero);
+	__m128 oneOverLen = _mm_div_ps(one, len);
+
+	Quat4 r;
+	r.x = _mm_andnot_ps(degenerate, _mm_mul_ps(q.x, oneOverLen));
+	r.y = _mm_andnot_ps(degenerate, _mm_mul_ps(q.y, oneOverLen));
+	r.z = _mm_andnot_ps(degenerate, _mm_mul_ps(q.z, oneOverLen));
+	r.w = select4(degenerate, one, _mm_mul_ps(q.w, oneOverLen));
+	return r;
+}
+
+static inline Quat4 multiply4(const Quat4 & p, const Quat4 & q)
+{
+	Quat4 r;
+	r.w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(p.w, q.w), _mm_mul_ps(p.x, q.x)), _mm_mul_ps(p.y, q.y)), _mm_mul_ps(p.z, q.z));
+	r.x = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p.w, q.x), _mm_mul_ps(p.x, q.w)), _mm_mul_ps(p.y, q.z)), _mm_mul_ps(p.z, q.y));
+	r.y = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p.w, q.y), _mm_mul_ps(p.y, q.w)), _mm_mul_ps(p.z, q.x)), _mm_mul_ps(p.x, q.z));
+	r.z = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p.w, q.z), _mm_mul_ps(p.z, q.w)), _mm_mul_ps(p.x, q.y)), _mm_mul_ps(p.y, q.x));
+	return r;
+}
+
+// normalize(a * (1 - t) + b * t)
+static inline Quat4 lerpNormalize4(const Quat4 & a, const Quat4 & b, __m128 t)
+{
+	__m128 s = _mm_sub_ps(_mm_set1_ps(1.0f), t);
+	Quat4 r;
+	r.x = _mm_add_ps(_mm_mul_ps(a.x, s), _mm_mul_ps(b.x, t));
+	r.y = _mm_add_ps(_mm_mul_ps(a.y, s), _mm_mul_ps(b.y, t));
+	r.z = _mm_add_ps(_mm_mul_ps(a.z, s), _mm_mul_ps(b.z, t));
+	r.w = _mm_add_ps(_mm_mul_ps(a.w, s), _mm_mul_ps(b.w, t));
+	return normalize4(r);
+}
+
+static inline __m128 acos4(__m128 c)
+{
+	const float * a = ACOS_COEFFICIENTS;
+	__m128 p = _mm_set1_ps(a[7]);
+	for (int i = 6; i >= 0; i--)
+		p = _mm_add_ps(_mm_set1_ps(a[i]), _mm_mul_ps(c, p));
+	return _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), c)), p);
+}
+
+static inline __m128 sin4(__m128 x)
+{
+	const float * s = SIN_COEFFICIENTS;
+	__m128 x2 = _mm_mul_ps(x, x);
+	__m128 p = _mm_set1_ps(s[4]);
+	for (int i = 3; i >= 0; i--)
+		p = _mm_add_ps(_mm_set1_ps(s[i]), _mm_mul_ps(x2, p));
+	return _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, x2), p));
+}
+
+static inline Quat4 slerp4(const Quat4 & a, const Quat4 & b, float t)
+{
+	__m128 cosTheta = dot4(a, b);
+	__m128 flip = _mm_cmplt_ps(cosTheta, _mm_setzero_ps());
+	Quat4 z = negate4(b, flip);
+	cosTheta = _mm_xor_ps(cosTheta, _mm_and_ps(flip, _mm_set1_ps(-0.0f)));
+
+	__m128 vt = _mm_set1_ps(t);
+	__m128 linear = _mm_cmpgt_ps(cosTheta, _mm_set1_ps(1.0f - std::numeric_limits<float>::epsilon()));
+
+	__m128 angle = acos4(cosTheta);
+	__m128 s0 = sin4(_mm_mul_ps(_mm_set1_ps(1.0f - t), angle));
+	__m128 s1 = sin4(_mm_mul_ps(vt, angle));
+	__m128 s = sin4(angle);
+
+	Quat4 r;
+	r.x = select4(linear, _mm_add_ps(a.x, _mm_mul_ps(vt, _mm_sub_ps(z.x, a.x))), _mm_div_ps(_mm_add_ps(_mm_mul_ps(s0, a.x), _mm_mul_ps(s1, z.x)), s));
+	r.y = select4(linear, _mm_add_ps(a.y, _mm_mul_ps(vt, _mm_sub_ps(z.y, a.y))), _mm_div_ps(_mm_add_ps(_mm_mul_ps(s0, a.y), _mm_mul_ps(s1, z.y)), s));
+	r.z = select4(linear, _mm_add_ps(a.z, _mm_mul_ps(vt, _mm_sub_ps(z.z, a.z))), _mm_div_ps(_mm_add_ps(_mm_mul_ps(s0, a.z), _mm_mul_ps(s1, z.z)), s));
+	r.w = select4(linear, _mm_add_ps(a.w, _mm_mul_ps(vt, _mm_sub_ps(z.w, a.w))), _mm_div_ps(_mm_add_ps(_mm_mul_ps(s0, a.w), _mm_mul_ps(s1, z.w)), s));
+	return r;
+}
+
+static inline Quat4 slerpFast4(const Quat4 & a, const Quat4 & b, float t)
+{
+	__m128 d = dot4(a, b);
+	__m128 flip = _mm_cmplt_ps(d, _mm_setzero_ps());
+	Quat4 z = negate4(b, flip);
+	d = _mm_xor_ps(d, _mm_and_ps(flip, _mm_set1_ps(-0.0f)));
+
+	float h = t - 0.5f;
+	float c = t * h * (t - 1.0f);
+	__m128 vh = _mm_set1_ps(h);
+
+	__m128 A = _mm_add_ps(_mm_set1_ps(FAST_A[0]), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(FAST_A[1]),
+		_mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(FAST_A[2]), _mm_mul_ps(d, _mm_set1_ps(FAST_A[3])))))));
+	__m128 B = _mm_add_ps(_mm_set1_ps(FAST_B[0]), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(FAST_B[1]), _mm_mul_ps(d, _mm_set1_ps(FAST_B[2])))));
+	__m128 k = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(A, vh), vh), B);
+	__m128 u = _mm_add_ps(_mm_set1_ps(t), _mm_mul_ps(_mm_set1_ps(c), k));
+	return lerpNormalize4(a, z, u);
+}
+
+// -- AVX, eight quaternions per iteration --
+
+struct Quat8
+{
+	__m256 x, y, z, w;
+};
+
+SIMD_TARGET_AVX static inline Quat8 load8(const QuatArray & q, size_t i)
+{
+	Quat8 r = { _mm256_loadu_ps(&q.x[i]), _mm256_loadu_ps(&q.y[i]), _mm256_loadu_ps(&q.z[i]), _mm256_loadu_ps(&q.w[i]) };
+	return r;
+}
+
+SIMD_TARGET_AVX static inline void store8(QuatArray & q, size_t i, const Quat8 & v)
+{
+	_mm256_storeu_ps(&q.x[i], v.x);
+	_mm256_storeu_ps(&q.y[i], v.y);
+	_mm256_storeu_ps(&q.z[i], v.z);
+	_mm256_storeu_ps(&q.w[i], v.w);
+}
+
+SIMD_TARGET_AVX static inline __m256 dot8(const Quat8 & a, const Quat8 & b)
+{
+	return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a.x, b.x), _mm256_mul_ps(a.y, b.y)), _mm256_add_ps(_mm256_mul_ps(a.z, b.z), _mm256_mul_ps(a.w, b.w)));
+}
+
+SIMD_TARGET_AVX static inline Quat8 negate8(const Quat8 & q, __m256 mask)
+{
+	__m256 sign = _mm256_and_ps(mask, _mm256_set1_ps(-0.0f));
+	Quat8 r = { _mm256_xor_ps(q.x, sign), _mm256_xor_ps(q.y, sign), _mm256_xor_ps(q.z, sign), _mm256_xor_ps(q.w, sign) };
+	return r;
+}
+
+SIMD_TARGET_AVX static inline Quat8 normalize8(const Quat8 & q)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	__m256 len = _mm256_sqrt_ps(dot8(q, q));
+	__m256 degenerate = _mm256_cmp_ps(len, _mm256_setzero_ps(), _CMP_LE_OQ);
+	__m256 oneOverLen = _mm256_div_ps(one, len);
+
+	Quat8 r;
+	r.x = _mm256_andnot_ps(degenerate, _mm256_mul_ps(q.x, oneOverLen));
+	r.y = _mm256_andnot_ps(degenerate, _mm256_mul_ps(q.y, oneOverLen));
+	r.z = _mm256_andnot_ps(degenerate, _mm256_mul_ps(q.z, oneOverLen));
+	r.w = _mm256_blendv_ps(_mm256_mul_ps(q.w, oneOverLen), one, degenerate);
+	return r;
+}
+
+SIMD_TARGET_AVX static inline Quat8 multiply8(const Quat8 & p, const Quat8 & q)
+{
+	Quat8 r;
+	r.w = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(p.w, q.w), _mm256_mul_ps(p.x, q.x)), _mm256_mul_ps(p.y, q.y)), _mm256_mul_ps(p.z, q.z));
+	r.x = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p.w, q.x), _mm256_mul_ps(p.x, q.w)), _mm256_mul_ps(p.y, q.z)), _mm256_mul_ps(p.z, q.y));
+	r.y = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p.w, q.y), _mm256_mul_ps(p.y, q.w)), _mm256_mul_ps(p.z, q.x)), _mm256_mul_ps(p.x, q.z));
+	r.z = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p.w, q.z), _mm256_mul_ps(p.z, q.w)), _mm256_mul_ps(p.x, q.y)), _mm256_mul_ps(p.y, q.x));
+	return r;
+}
+
+SIMD_TARGET_AVX static inline Quat8 lerpNormalize8(const Quat8 & a, const Quat8 & b, __m256 t)
+{
+	__m256 s = _mm256_sub_ps(_mm256_set1_ps(1.0f), t);
+	Quat8 r;
+	r.x = _mm256_add_ps(_mm256_mul_ps(a.x, s), _mm256_mul_ps(b.x, t));
+	r.y = _mm256_add_ps(_mm256_mul_ps(a.y, s), _mm256_mul_ps(b.y, t));
+	r.z = _mm256_add_ps(_mm256_mul_ps(a.z, s), _mm256_mul_ps(b.z, t));
+	r.w = _mm256_add_ps(_mm256_mul_ps(a.w, s), _mm256_mul_ps(b.w, t));
+	return normalize8(r);
+}
+
+SIMD_TARGET_AVX static inline __m256 acos8(__m256 c)
+{
+	const float * a = ACOS_COEFFICIENTS;
+	__m256 p = _mm256_set1_ps(a[7]);
+	for (int i = 6; i >= 0; i--)
+		p = _mm256_add_ps(_mm256_set1_ps(a[i]), _mm256_mul_ps(c, p));
+	return _mm256_mul_ps(_mm256_sqrt_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), c)), p);
+}
+
+SIMD_TARGET_AVX static inline __m256 sin8(__m256 x)
+{
+	const float * s = SIN_COEFFICIENTS;
+	__m256 x2 = _mm256_mul_ps(x, x);
+	__m256 p = _mm256_set1_ps(s[4]);
+	for (int i = 3; i >= 0; i--)
+		p = _mm256_add_ps(_mm256_set1_ps(s[i]), _mm256_mul_ps(x2, p));
+	return _mm256_add_ps(x, _mm256_mul_ps(_mm256_mul_ps(x, x2), p));
+}
+
+SIMD_TARGET_AVX static inline Quat8 slerp8(const Quat8 & a, const Quat8 & b, float t)
+{
+	__m256 cosTheta = dot8(a, b);
+	__m256 flip = _mm256_cmp_ps(cosTheta, _mm256_setzero_ps(), _CMP_LT_OQ);
+	Quat8 z = negate8(b, flip);
+	cosTheta = _mm256_xor_ps(cosTheta, _mm256_and_ps(flip, _mm256_set1_ps(-0.0f)));
+
+	__m256 vt = _mm256_set1_ps(t);
+	__m256 linear = _mm256_cmp_ps(cosTheta, _mm256_set1_ps(1.0f - std::numeric_limits<float>::epsilon()), _CMP_GT_OQ);
+
+	__m256 angle = acos8(cosTheta);
+	__m256 s0 = sin8(_mm256_mul_ps(_mm256_set1_ps(1.0f - t), angle));
+	__m256 s1 = sin8(_mm256_mul_ps(vt, angle));
+	__m256 s = sin8(angle);
+
+	Quat8 r;
+	r.x = _mm256_blendv_ps(_mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(s0, a.x), _mm256_mul_ps(s1, z.x)), s), _mm256_add_ps(a.x, _mm256_mul_ps(vt, _mm256_sub_ps(z.x, a.x))), linear);
+	r.y = _mm256_blendv_ps(_mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(s0, a.y), _mm256_mul_ps(s1, z.y)), s), _mm256_add_ps(a.y, _mm256_mul_ps(vt, _mm256_sub_ps(z.y, a.y))), linear);
+	r.z = _mm256_blendv_ps(_mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(s0, a.z), _mm256_mul_ps(s1, z.z)), s), _mm256_add_ps(a.z, _mm256_mul_ps(vt, _mm256_sub_ps(z.z, a.z))), linear);
+	r.w = _mm256_blendv_ps(_mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(s0, a.w), _mm256_mul_ps(s1, z.w)), s), _mm256_add_ps(a.w, _mm256_mul_ps(vt, _mm256_sub_ps(z.w, a.w))), linear);
+	return r;
+}
+
+SIMD_TARGET_AVX static inline Quat8 slerpFast8(const Quat8 & a, const Quat8 & b, float t)
+{
+	__m256 d = dot8(a, b);
+	__m256 flip = _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_LT_OQ);
+	Quat8 z = negate8(b, flip);
+	d = _mm256_xor_ps(d, _mm256_and_ps(flip, _mm256_set1_ps(-0.0f)));
+
+	float h = t - 0.5f;
+	float c = t * h * (t - 1.0f);
+	__m256 vh = _mm256_set1_ps(h);
+
+	__m256 A = _mm256_add_ps(_mm256_set1_ps(FAST_A[0]), _mm256_mul_ps(d, _mm256_add_ps(_mm256_set1_ps(FAST_A[1]),
+		_mm256_mul_ps(d, _mm256_add_ps(_mm256_set1_ps(FAST_A[2]), _mm256_mul_ps(d, _mm256_set1_ps(FAST_A[3])))))));
+	__m256 B = _mm256_add_ps(_mm256_set1_ps(FAST_B[0]), _mm256_mul_ps(d, _mm256_add_ps(_mm256_set1_ps(FAST_B[1]), _mm256_mul_ps(d, _mm256_set1_ps(FAST_B[2])))));
+	__m256 k = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(A, vh), vh), B);
+	__m256 u = _mm256_add_ps(_mm256_set1_ps(t), _mm256_mul_ps(_mm256_set1_ps(c), k));
+	return lerpNormalize8(a, z, u);
+}
+
+// Each AVX loop returns the index it stopped at, the SSE loop and then the
+// scalar code finish the remaining elements
+
+SIMD_TARGET_AVX static size_t normalizeAVX(const QuatArray & q, QuatArray & result, size_t i, size_t end)
+{
+	for (; i + 8 <= end; i += 8)
+		store8(result, i, normalize8(load8(q, i)));
+	return i;
+}
+
+SIMD_TARGET_AVX static size_t multiplyAVX(const QuatArray & a, const QuatArray & b, QuatArray & result, size_t i, size_t end)
+{
+	for (; i + 8 <= end; i += 8)
+		store8(result, i, multiply8(load8(a, i), load8(b, i)));
+	return i;
+}
+
+SIMD_TARGET_AVX static size_t nlerpAVX(const QuatArray & a, const QuatArray & b, float t, QuatArray & result, size_t i, size_t end)
+{
+	__m256 vt = _mm256_set1_ps(t);
+	for (; i + 8 <= end; i += 8)
+	{
+		Quat8 qa = load8(a, i), qb = load8(b, i);
+		Quat8 z = negate8(qb, _mm256_cmp_ps(dot8(qa, qb), _mm256_setzero_ps(), _CMP_LT_OQ));
+		store8(result, i, lerpNormalize8(qa, z, vt));
+	}
+	return i;
+}
+
+SIMD_TARGET_AVX static size_t slerpAVX(const QuatArray & a, const QuatArray & b, float t, QuatArray & result, size_t i, size_t end)
+{
+	for (; i + 8 <= end; i += 8)
+		store8(result, i, slerp8(load8(a, i), load8(b, i), t));
+	return i;
+}
+
+SIMD_TARGET_AVX static size_t slerpFastAVX(const QuatArray & a, const QuatArray & b, float t, QuatArray & result, size_t i, size_t end)
+{
+	for (; i + 8 <= end; i += 8)
+		store8(result, i, slerpFast8(load8(a, i), load8(b, i), t));
+	return i;
+}
+
+SIMD_TARGET_AVX static size_t toMat3x4AVX(const QuatArray & q, const glm::vec3 * translations, glm::mat3x4 * result, size_t i, size_t end)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+
+	for (; i + 8 <= end; i += 8)
+	{
+		Quat8 v = load8(q, i);
+		__m256 qxx = _mm256_mul_ps(v.x, v.x), qyy = _mm256_mul_ps(v.y, v.y), qzz = _mm256_mul_ps(v.z, v.z);
+		__m256 qxz = _mm256_mul_ps(v.x, v.z), qxy = _mm256_mul_ps(v.x, v.y), qyz = _mm256_mul_ps(v.y, v.z);
+		__m256 qwx = _mm256_mul_ps(v.w, v.x), qwy = _mm256_mul_ps(v.w, v.y), qwz = _mm256_mul_ps(v.w, v.z);
+
+		__m256 rows[3][4];
+		rows[0][0] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(qyy, qzz)));
+		rows[1][0] = _mm256_mul_ps(two, _mm256_add_ps(qxy, qwz));
+		rows[2][0] = _mm256_mul_ps(two, _mm256_sub_ps(qxz, qwy));
+		rows[0][1] = _mm256_mul_ps(two, _mm256_sub_ps(qxy, qwz));
+		rows[1][1] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(qxx, qzz)));
+		rows[2][1] = _mm256_mul_ps(two, _mm256_add_ps(qyz, qwx));
+		rows[0][2] = _mm256_mul_ps(two, _mm256_add_ps(qxz, qwy));
+		rows[1][2] = _mm256_mul_ps(two, _mm256_sub_ps(qyz, qwx));
+		rows[2][2] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(qxx, qyy)));
+
+		if (translations)
+		{
+			const glm::vec3 * t = translations + i;
+			rows[0][3] = _mm256_set_ps(t[7].x, t[6].x, t[5].x, t[4].x, t[3].x, t[2].x, t[1].x, t[0].x);
+			rows[1][3] = _mm256_set_ps(t[7].y, t[6].y, t[5].y, t[4].y, t[3].y, t[2].y, t[1].y, t[0].y);
+			rows[2][3] = _mm256_set_ps(t[7].z, t[6].z, t[5].z, t[4].z, t[3].z, t[2].z, t[1].z, t[0].z);
+		}
+		else
+			rows[0][3] = rows[1][3] = rows[2][3] = _mm256_setzero_ps();
+
+		// 4x4 transpose within each 128 bit half, the low half holds
+		// quaternions i..i+3 and the high half i+4..i+7
+		for (int r = 0; r < 3; r++)
+		{
+			__m256 t0 = _mm256_unpacklo_ps(rows[r][0], rows[r][1]);
+			__m256 t1 = _mm256_unpackhi_ps(rows[r][0], rows[r][1]);
+			__m256 t2 = _mm256_unpacklo_ps(rows[r][2], rows[r][3]);
+			__m256 t3 = _mm256_unpackhi_ps(rows[r][2], rows[r][3]);
+			__m256 lanes[4] = {
+				_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+				_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+				_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+				_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)) };
+
+			for (int k = 0; k < 4; k++)
+			{
+				_mm_storeu_ps(&result[i + k][r][0], _mm256_castps256_ps128(lanes[k]));
+				_mm_storeu_ps(&result[i + 4 + k][r][0], _mm256_extractf128_ps(lanes[k], 1));
+			}
+		}
+	}
+	return i;
+}
+
+// -- Public entry points --
+
+void quatNormalize(const QuatArray & q, QuatArray & result, size_t begin, size_t end)
+{
+	size_t i = cpuHasAVX() ? normalizeAVX(q, result, begin, end) : begin;
+	for (; i + 4 <= end; i += 4)
+		store4(result, i, normalize4(load4(q, i)));
+	for (; i < end; i++)
+		result.set(i, glm::normalize(q.get(i)));
+}
+
+void quatMultiply(const QuatArray & a, const QuatArray & b, QuatArray & result, size_t begin, size_t end)
+{
+	size_t i = cpuHasAVX() ? multiplyAVX(a, b, result, begin, end) : begin;
+	for (; i + 4 <= end; i += 4)
+		store4(result, i, multiply4(load4(a, i), load4(b, i)));
+	for (; i < end; i++)
+		result.set(i, a.get(i) * b.get(i));
+}
+
+void quatNlerp(const QuatArray & a, const QuatArray & b, float t, QuatArray & result, size_t begin, size_t end)
+{
+	size_t i = cpuHasAVX() ? nlerpAVX(a, b, t, result, begin, end) : begin;
+	__m128 vt = _mm_set1_ps(t);
+	for (; i + 4 <= end; i += 4)
+	{
+		Quat4 qa = load4(a, i), qb = load4(b, i);
+		Quat4 z = negate4(qb, _mm_cmplt_ps(dot4(qa, qb), _mm_setzero_ps()));
+		store4(result, i, lerpNormalize4(qa, z, vt));
+	}
+	for (; i < end; i++)
+		result.set(i, quatNlerp(a.get(i), b.get(i), t));
+}
+
+void quatSlerp(const QuatArray & a, const QuatArray & b, float t, QuatArray & result, size_t begin, size_t end)
+{
+	size_t i = cpuHasAVX() ? slerpAVX(a, b, t, result, begin, end) : begin;
+	for (; i + 4 <= end; i += 4)
+		store4(result, i, slerp4(load4(a, i), load4(b, i), t));
+	for (; i < end; i++)
+		result.set(i, quatSlerp(a.get(i), b.get(i), t));
+}
+
+void quatSlerpFast(const QuatArray & a, const QuatArray & b, float t, QuatArray & result, size_t begin, size_t end)
+{
+	size_t i = cpuHasAVX() ? slerpFastAVX(a, b, t, result, begin, end) : begin;
+	for (; i + 4 <= end; i += 4)
+		store4(result, i, slerpFast4(load4(a, i), load4(b, i), t));
+	for (; i < end; i++)
+		result.set(i, quatSlerpFast(a.get(i), b.get(i), t));
+}
+
+void quatToMat3x4(const QuatArray & q, const glm::vec3 * translations, glm::mat3x4 * result, size_t begin, size_t end)
+{
+	size_t i = cpuHasAVX() ? toMat3x4AVX(q, translations, result, begin, end) : begin;
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	for (; i + 4 <= end; i += 4)
+	{
+		Quat4 v = load4(q, i);
+		__m128 qxx = _mm_mul_ps(v.x, v.x), qyy = _mm_mul_ps(v.y, v.y), qzz = _mm_mul_ps(v.z, v.z);
+		__m128 qxz = _mm_mul_ps(v.x, v.z), qxy = _mm_mul_ps(v.x, v.y), qyz = _mm_mul_ps(v.y, v.z);
+		__m128 qwx = _mm_mul_ps(v.w, v.x), qwy = _mm_mul_ps(v.w, v.y), qwz = _mm_mul_ps(v.w, v.z);
+
+		__m128 rows[3][4];
+		rows[0][0] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qyy, qzz)));
+		rows[1][0] = _mm_mul_ps(two, _mm_add_ps(qxy, qwz));
+		rows[2][0] = _mm_mul_ps(two, _mm_sub_ps(qxz, qwy));
+		rows[0][1] = _mm_mul_ps(two, _mm_sub_ps(qxy, qwz));
+		rows[1][1] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qxx, qzz)));
+		rows[2][1] = _mm_mul_ps(two, _mm_add_ps(qyz, qwx));
+		rows[0][2] = _mm_mul_ps(two, _mm_add_ps(qxz, qwy));
+		rows[1][2] = _mm_mul_ps(two, _mm_sub_ps(qyz, qwx));
+		rows[2][2] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(qxx, qyy)));
+
+		if (translations)
+		{
+			const glm::vec3 * t = translations + i;
+			rows[0][3] = _mm_set_ps(t[3].x, t[2].x, t[1].x, t[0].x);
+			rows[1][3] = _mm_set_ps(t[3].y, t[2].y, t[1].y, t[0].y);
+			rows[2][3] = _mm_set_ps(t[3].z, t[2].z, t[1].z, t[0].z);
+		}
+		else
+			rows[0][3] = rows[1][3] = rows[2][3] = _mm_setzero_ps();
+
+		for (int r = 0; r < 3; r++)
+		{
+			_MM_TRANSPOSE4_PS(rows[r][0], rows[r][1], rows[r][2], rows[r][3]);
+			for (int k = 0; k < 4; k++)
+				_mm_storeu_ps(&result[i + k][r][0], rows[r][k]);
+		}
+	}
+	for (; i < end; i++)
+		result[i] = quatToMat3x4(q.get(i), translations ? translations[i] : glm::vec3(0.0f));
+}
+
+void blendPoses(const QuatArray & a, const QuatArray & b, const float * weights, QuatArray & result,
+	unsigned int boneCount, unsigned int characterCount, QuatBlendMode mode)
+{
+	ThreadPool::instance().parallelFor(characterCount, 16, [&](size_t begin, size_t end)
+	{
+		for (size_t c = begin; c < end; c++)
+		{
+			size_t first = c * boneCount, last = first + boneCount;
+			if (mode == QUAT_BLEND_NLERP)
+				quatNlerp(a, b, weights[c], result, first, last);
+			else if (mode == QUAT_BLEND_SLERP)
+				quatSlerp(a, b, weights[c], result, first, last);
+			else
+				quatSlerpFast(a, b, weights[c], result, first, last);
+		}
+	});
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <glm.hpp>
+#include <gtc/quaternion.hpp>
+
+// Quaternions in structure-of-arrays layout, one array per component, so
+// four (SSE) or eight (AVX) bones are processed per instruction.
+struct QuatArray
+{
+	std::vector<float> x, y, z, w;
+
+	void resize(size_t count)
+	{
+		x.resize(count); y.resize(count); z.resize(count); w.resize(count);
+	}
+
+	size_t size() const
+	{
+		return w.size();
+	}
+
+	void set(size_t i, const glm::quat & q)
+	{
+		x[i] = q.x; y[i] = q.y; z[i] = q.z; w[i] = q.w;
+	}
+
+	glm::quat get(size_t i) const
+	{
+		return glm::quat(w[i], x[i], y[i], z[i]);
+	}
+};
+
+enum QuatBlendMode
+{
+	QUAT_BLEND_NLERP,
+	QUAT_BLEND_SLERP,
+	QUAT_BLEND_SLERP_FAST
+};
+
+// Batch kernels over the elements [begin, end). The result may be one of the
+// inputs. Normalize, multiply and quatToMat3x4 give the same results as
+// glm::normalize, operator* and glm::mat3_cast.
+void quatNormalize(const QuatArray & q, QuatArray & result, size_t begin, size_t end);
+void quatMultiply(const QuatArray & a, const QuatArray & b, QuatArray & result, size_t begin, size_t end);
+
+// Interpolations take the shortest path and expect t in [0, 1].
+// nlerp: normalize(mix) like glm::fastMix, with b negated when needed.
+// slerp: glm::slerp with polynomial acos and sin, within about 1e-6 of it.
+// slerpFast: nlerp with t corrected by a fitted polynomial, within about
+// 1e-4 of glm::slerp at close to the cost of nlerp.
+void quatNlerp(const QuatArray & a, const QuatArray & b, float t, QuatArray & result, size_t begin, size_t end);
+void quatSlerp(const QuatArray & a, const QuatArray & b, float t, QuatArray & result, size_t begin, size_t end);
+void quatSlerpFast(const QuatArray & a, const QuatArray & b, float t, QuatArray & result, size_t begin, size_t end);
+
+// Scalar versions of the interpolations, identical to one lane of the batch kernels
+glm::quat quatNlerp(const glm::quat & a, const glm::quat & b, float t);
+glm::quat quatSlerp(const glm::quat & a, const glm::quat & b, float t);
+glm::quat quatSlerpFast(const glm::quat & a, const glm::quat & b, float t);
+
+// Rotation and translation as the rows of a 3x4 matrix (the transpose of the
+// affine transform), so a shader computes vec4(p, 1.0) * m. translations may
+// be null for pure rotations.
+void quatToMat3x4(const QuatArray & q, const glm::vec3 * translations, glm::mat3x4 * result, size_t begin, size_t end);
+glm::mat3x4 quatToMat3x4(const glm::quat & q, const glm::vec3 & translation);
+
+// Blends two poses of boneCount bones for each character, character c using
+// weights[c]. Characters are spread over the shared ThreadPool.
+void blendPoses(const QuatArray & a, const QuatArray & b, const float * weights, QuatArray & result,
+	unsigned int boneCount, unsigned int characterCount, QuatBlendMode mode);
@@ -0,0 +1,226 @@
+#include "RayPacket.h"
+#include <limits>
+
+// Moller-Trumbore on four lanes, mirroring the order of operations of
+// glm::intersectRayTriangle so both give the same results. Vectors are
+// passed by reference: MSVC x86 cannot pass more than three aligned
+// vectors by value (C2719).
+static inline int mollerTrumbore4(
+	const __m128 & ox, const __m128 & oy, const __m128 & oz, const __m128 & dx, const __m128 & dy, const __m128 & dz,
+	const __m128 & v0x, const __m128 & v0y, const __m128 & v0z, const __m128 & e1x, const __m128 & e1y, const __m128 & e1z, const __m128 & e2x, const __m128 & e2y, const __m128 & e2z,
+	float * t, float * u, float * v)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 epsilon = _mm_set1_ps(std::numeric_limits<float>::epsilon());
+	const __m128 negEpsilon = _mm_set1_ps(-std::numeric_limits<float>::epsilon());
+
+	// p = cross(dir, e2)
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(e2y, dz));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(e2z, dx));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(e2x, dy));
+
+	__m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	__m128 mask = _mm_or_ps(_mm_cmpge_ps(a, epsilon), _mm_cmple_ps(a, negEpsilon));
+
+	__m128 f = _mm_div_ps(one, a);
+
+	__m128 sx = _mm_sub_ps(ox, v0x);
+	__m128 sy = _mm_sub_ps(oy, v0y);
+	__m128 sz = _mm_sub_ps(oz, v0z);
+
+	__m128 bu = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)));
+	mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(bu, zero), _mm_cmple_ps(bu, one)));
+
+	// q = cross(s, e1)
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(e1y, sz));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(e1z, sx));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(e1x, sy));
+
+	__m128 bv = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+	mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(bv, zero), _mm_cmple_ps(_mm_add_ps(bv, bu), one)));
+
+	__m128 bt = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(bt, zero));
+
+	_mm_storeu_ps(t, bt);
+	_mm_storeu_ps(u, bu);
+	_mm_storeu_ps(v, bv);
+	return _mm_movemask_ps(mask);
+}
+
+SIMD_TARGET_AVX static inline int mollerTrumbore8(
+	const __m256 & ox, const __m256 & oy, const __m256 & oz, const __m256 & dx, const __m256 & dy, const __m256 & dz,
+	const __m256 & v0x, const __m256 & v0y, const __m256 & v0z, const __m256 & e1x, const __m256 & e1y, const __m256 & e1z, const __m256 & e2x, const __m256 & e2y, const __m256 & e2z,
+	float * t, float * u, float * v)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 epsilon = _mm256_set1_ps(std::numeric_limits<float>::epsilon());
+	const __m256 negEpsilon = _mm256_set1_ps(-std::numeric_limits<float>::epsilon());
+
+	__m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(e2y, dz));
+	__m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(e2z, dx));
+	__m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(e2x, dy));
+
+	__m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+	__m256 mask = _mm256_or_ps(_mm256_cmp_ps(a, epsilon, _CMP_GE_OQ), _mm256_cmp_ps(a, negEpsilon, _CMP_LE_OQ));
+
+	__m256 f = _mm256_div_ps(one, a);
+
+	__m256 sx = _mm256_sub_ps(ox, v0x);
+	__m256 sy = _mm256_sub_ps(oy, v0y);
+	__m256 sz = _mm256_sub_ps(oz, v0z);
+
+	__m256 bu = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)));
+	mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(bu, zero, _CMP_GE_OQ), _mm256_cmp_ps(bu, one, _CMP_LE_OQ)));
+
+	__m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(e1y, sz));
+	__m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(e1z, sx));
+	__m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(e1x, sy));
+
+	__m256 bv = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)));
+	mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(bv, zero, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(bv, bu), one, _CMP_LE_OQ)));
+
+	__m256 bt = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)));
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(bt, zero, _CMP_GE_OQ));
+
+	_mm256_storeu_ps(t, bt);
+	_mm256_storeu_ps(u, bu);
+	_mm256_storeu_ps(v, bv);
+	return _mm256_movemask_ps(mask);
+}
+
+int intersectRayTriangle4(const glm::vec3 & orig, const glm::vec3 & dir, const TrianglePacket4 & triangles, float * t, float * u, float * v)
+{
+	return mollerTrumbore4(
+		_mm_set1_ps(orig.x), _mm_set1_ps(orig.y), _mm_set1_ps(orig.z),
+		_mm_set1_ps(dir.x), _mm_set1_ps(dir.y), _mm_set1_ps(dir.z),
+		_mm_loadu_ps(triangles.v0x), _mm_loadu_ps(triangles.v0y), _mm_loadu_ps(triangles.v0z),
+		_mm_loadu_ps(triangles.e1x), _mm_loadu_ps(triangles.e1y), _mm_loadu_ps(triangles.e1z),
+		_mm_loadu_ps(triangles.e2x), _mm_loadu_ps(triangles.e2y), _mm_loadu_ps(triangles.e2z),
+		t, u, v);
+}
+
+SIMD_TARGET_AVX static int intersectRayTriangle8AVX(const glm::vec3 & orig, const glm::vec3 & dir, const TrianglePacket8 & triangles, float * t, float * u, float * v)
+{
+	return mollerTrumbore8(
+		_mm256_set1_ps(orig.x), _mm256_set1_ps(orig.y), _mm256_set1_ps(orig.z),
+		_mm256_set1_ps(dir.x), _mm256_set1_ps(dir.y), _mm256_set1_ps(dir.z),
+		_mm256_loadu_ps(triangles.v0x), _mm256_loadu_ps(triangles.v0y), _mm256_loadu_ps(triangles.v0z),
+		_mm256_loadu_ps(triangles.e1x), _mm256_loadu_ps(triangles.e1y), _mm256_loadu_ps(triangles.e1z),
+		_mm256_loadu_ps(triangles.e2x), _mm256_loadu_ps(triangles.e2y), _mm256_loadu_ps(triangles.e2z),
+		t, u, v);
+}
+
+int intersectRayTriangle8(const glm::vec3 & orig, const glm::vec3 & dir, const TrianglePacket8 & triangles, float * t, float * u, float * v)
+{
+	if (cpuHasAVX())
+		return intersectRayTriangle8AVX(orig, dir, triangles, t, u, v);
+
+	int mask = 0;
+	for (int half = 0; half < 8; half += 4)
+	{
+		mask |= mollerTrumbore4(
+			_mm_set1_ps(orig.x), _mm_set1_ps(orig.y), _mm_set1_ps(orig.z),
+			_mm_set1_ps(dir.x), _mm_set1_ps(dir.y), _mm_set1_ps(dir.z),
+			_mm_loadu_ps(triangles.v0x + half), _mm_loadu_ps(triangles.v0y + half), _mm_loadu_ps(triangles.v0z + half),
+			_mm_loadu_ps(triangles.e1x + half), _mm_loadu_ps(triangles.e1y + half), _mm_loadu_ps(triangles.e1z + half),
+			_mm_loadu_ps(triangles.e2x + half), _mm_loadu_ps(triangles.e2y + half), _mm_loadu_ps(triangles.e2z + half),
+			t + half, u + half, v + half) << half;
+	}
+	return mask;
+}
+
+int intersectRayPacketTriangle4(const RayPacket4 & rays, const glm::vec3 & v0, const glm::vec3 & v1, const glm::vec3 & v2, float * t, float * u, float * v)
+{
+	glm::vec3 e1 = v1 - v0, e2 = v2 - v0;
+	return mollerTrumbore4(
+		_mm_loadu_ps(rays.ox), _mm_loadu_ps(rays.oy), _mm_loadu_ps(rays.oz),
+		_mm_loadu_ps(rays.dx), _mm_loadu_ps(rays.dy), _mm_loadu_ps(rays.dz),
+		_mm_set1_ps(v0.x), _mm_set1_ps(v0.y), _mm_set1_ps(v0.z),
+		_mm_set1_ps(e1.x), _mm_set1_ps(e1.y), _mm_set1_ps(e1.z),
+		_mm_set1_ps(e2.x), _mm_set1_ps(e2.y), _mm_set1_ps(e2.z),
+		t, u, v);
+}
+
+SIMD_TARGET_AVX static int intersectRayPacketTriangle8AVX(const RayPacket8 & rays, const glm::vec3 & v0, const glm::vec3 & e1, const glm::vec3 & e2, float * t, float * u, float * v)
+{
+	return mollerTrumbore8(
+		_mm256_loadu_ps(rays.ox), _mm256_loadu_ps(rays.oy), _mm256_loadu_ps(rays.oz),
+		_mm256_loadu_ps(rays.dx), _mm256_loadu_ps(rays.dy), _mm256_loadu_ps(rays.dz),
+		_mm256_set1_ps(v0.x), _mm256_set1_ps(v0.y), _mm256_set1_ps(v0.z),
+		_mm256_set1_ps(e1.x), _mm256_set1_ps(e1.y), _mm256_set1_ps(e1.z),
+		_mm256_set1_ps(e2.x), _mm256_set1_ps(e2.y), _mm256_set1_ps(e2.z),
+		t, u, v);
+}
+
+int intersectRayPacketTriangle8(const RayPacket8 & rays, const glm::vec3 & v0, const glm::vec3 & v1, const glm::vec3 & v2, float * t, float * u, float * v)
+{
+	glm::vec3 e1 = v1 - v0, e2 = v2 - v0;
+
+	if (cpuHasAVX())
+		return intersectRayPacketTriangle8AVX(rays, v0, e1, e2, t, u, v);
+
+	int mask = 0;
+	for (int half = 0; half < 8; half += 4)
+	{
+		mask |= mollerTrumbore4(
+			_mm_loadu_ps(rays.ox + half), _mm_loadu_ps(rays.oy + half), _mm_loadu_ps(rays.oz + half),
+			_mm_loadu_ps(rays.dx + half), _mm_loadu_ps(rays.dy + half), _mm_loadu_ps(rays.dz + half),
+			_mm_set1_ps(v0.x), _mm_set1_ps(v0.y), _mm_set1_ps(v0.z),
+			_mm_set1_ps(e1.x), _mm_set1_ps(e1.y), _mm_set1_ps(e1.z),
+			_mm_set1_ps(e2.x), _mm_set1_ps(e2.y), _mm_set1_ps(e2.z),
+			t + half, u + half, v + half) << half;
+	}
+	return mask;
+}
+
+static inline int slabTest4(const float * ox, const float * oy, const float * oz, const float * idx, const float * idy, const float * idz,
+	const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, const float * tMax)
+{
+	__m128 orgX = _mm_loadu_ps(ox), orgY = _mm_loadu_ps(oy), orgZ = _mm_loadu_ps(oz);
+	__m128 invX = _mm_loadu_ps(idx), invY = _mm_loadu_ps(idy), invZ = _mm_loadu_ps(idz);
+
+	__m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.x), orgX), invX);
+	__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.x), orgX), invX);
+	__m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.y), orgY), invY);
+	__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.y), orgY), invY);
+	__m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMin.z), orgZ), invZ);
+	__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(boundsMax.z), orgZ), invZ);
+
+	__m128 tEnter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_setzero_ps()));
+	__m128 tExit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_loadu_ps(tMax)));
+	return _mm_movemask_ps(_mm_cmple_ps(tEnter, tExit));
+}
+
+int intersectRayPacketBox4(const RayPacket4 & rays, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, const float * tMax)
+{
+	return slabTest4(rays.ox, rays.oy, rays.oz, rays.idx, rays.idy, rays.idz, boundsMin, boundsMax, tMax);
+}
+
+SIMD_TARGET_AVX static int intersectRayPacketBox8AVX(const RayPacket8 & rays, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, const float * tMax)
+{
+	__m256 orgX = _mm256_loadu_ps(rays.ox), orgY = _mm256_loadu_ps(rays.oy), orgZ = _mm256_loadu_ps(rays.oz);
+	__m256 invX = _mm256_loadu_ps(rays.idx), invY = _mm256_loadu_ps(rays.idy), invZ = _mm256_loadu_ps(rays.idz);
+
+	__m256 t0x = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boundsMin.x), orgX), invX);
+	__m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boundsMax.x), orgX), invX);
+	__m256 t0y = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boundsMin.y), orgY), invY);
+	__m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boundsMax.y), orgY), invY);
+	__m256 t0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boundsMin.z), orgZ), invZ);
+	__m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(boundsMax.z), orgZ), invZ);
+
+	__m256 tEnter = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t0x, t1x), _mm256_min_ps(t0y, t1y)), _mm256_max_ps(_mm256_min_ps(t0z, t1z), _mm256_setzero_ps()));
+	__m256 tExit = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t0x, t1x), _mm256_max_ps(t0y, t1y)), _mm256_min_ps(_mm256_max_ps(t0z, t1z), _mm256_loadu_ps(tMax)));
+	return _mm256_movemask_ps(_mm256_cmp_ps(tEnter, tExit, _CMP_LE_OQ));
+}
+
+int intersectRayPacketBox8(const RayPacket8 & rays, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, const float * tMax)
+{
+	if (cpuHasAVX())
+		return intersectRayPacketBox8AVX(rays, boundsMin, boundsMax, tMax);
+
+	return slabTest4(rays.ox, rays.oy, rays.oz, rays.idx, rays.idy, rays.idz, boundsMin, boundsMax, tMax)
+		| slabTest4(rays.ox + 4, rays.oy + 4, rays.oz + 4, rays.idx + 4, rays.idy + 4, rays.idz + 4, boundsMin, boundsMax, tMax + 4) << 4;
+}
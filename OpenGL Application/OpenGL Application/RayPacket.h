@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glm.hpp>
+#include "Simd.h"
+
+// Triangles in structure-of-arrays layout, stored as (v0, e1 = v1 - v0,
+// e2 = v2 - v0) which is the form the Moller-Trumbore test consumes.
+template <int N>
+struct TrianglePacket
+{
+	float v0x[N], v0y[N], v0z[N];
+	float e1x[N], e1y[N], e1z[N];
+	float e2x[N], e2y[N], e2z[N];
+
+	void set(int lane, const glm::vec3 & v0, const glm::vec3 & v1, const glm::vec3 & v2)
+	{
+		glm::vec3 e1 = v1 - v0, e2 = v2 - v0;
+		v0x[lane] = v0.x; v0y[lane] = v0.y; v0z[lane] = v0.z;
+		e1x[lane] = e1.x; e1y[lane] = e1.y; e1z[lane] = e1.z;
+		e2x[lane] = e2.x; e2y[lane] = e2.y; e2z[lane] = e2.z;
+	}
+
+	// Unused lanes are filled with a degenerate triangle that never hits
+	void clear(int lane)
+	{
+		set(lane, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f));
+	}
+};
+
+// Coherent rays in structure-of-arrays layout. The inverse direction is
+// cached for the slab test.
+template <int N>
+struct RayPacket
+{
+	float ox[N], oy[N], oz[N];
+	float dx[N], dy[N], dz[N];
+	float idx[N], idy[N], idz[N];
+
+	void set(int lane, const glm::vec3 & orig, const glm::vec3 & dir)
+	{
+		ox[lane] = orig.x; oy[lane] = orig.y; oz[lane] = orig.z;
+		dx[lane] = dir.x; dy[lane] = dir.y; dz[lane] = dir.z;
+		idx[lane] = 1.0f / dir.x; idy[lane] = 1.0f / dir.y; idz[lane] = 1.0f / dir.z;
+	}
+};
+
+typedef TrianglePacket<4> TrianglePacket4;
+typedef TrianglePacket<8> TrianglePacket8;
+typedef RayPacket<4> RayPacket4;
+typedef RayPacket<8> RayPacket8;
+
+// All kernels return a bit mask with bit i set when lane i hits. For hit
+// lanes t, u and v receive the same values glm::intersectRayTriangle writes
+// into baryPosition (z, x and y), miss lanes are left undefined.
+
+// One ray against 4/8 triangles
+int intersectRayTriangle4(const glm::vec3 & orig, const glm::vec3 & dir, const TrianglePacket4 & triangles, float * t, float * u, float * v);
+int intersectRayTriangle8(const glm::vec3 & orig, const glm::vec3 & dir, const TrianglePacket8 & triangles, float * t, float * u, float * v);
+
+// 4/8 rays against one triangle
+int intersectRayPacketTriangle4(const RayPacket4 & rays, const glm::vec3 & v0, const glm::vec3 & v1, const glm::vec3 & v2, float * t, float * u, float * v);
+int intersectRayPacketTriangle8(const RayPacket8 & rays, const glm::vec3 & v0, const glm::vec3 & v1, const glm::vec3 & v2, float * t, float * u, float * v);
+
+// 4/8 rays against one box, a lane hits when it enters the box before its tMax
+int intersectRayPacketBox4(const RayPacket4 & rays, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, const float * tMax);
+int intersectRayPacketBox8(const RayPacket8 & rays, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, const float * tMax);
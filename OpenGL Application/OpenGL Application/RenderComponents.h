@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glm.hpp>
+#include <gtx/type_aligned.hpp>
+#include "MeshFile.h"
+
+// Components of drawable scene objects, stored in EntityStore chunks
+
+// Node of the object in the TransformHierarchy
+struct TransformNode
+{
+	unsigned int node;
+};
+
+// World matrix copied out of the hierarchy so the renderer streams over the chunk
+struct WorldMatrix
+{
+	glm::aligned_mat4 value;
+};
+
+// World space bounding sphere for culling, centre in xyz and radius in w
+struct WorldBounds
+{
+	glm::aligned_vec4 sphere;
+};
+
+// Model space bounding box, tested against the occlusion buffer
+struct LocalBounds
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// Triangles drawn into the occlusion buffer, laid out as for BVH::build().
+// The positions are owned elsewhere.
+struct Occluder
+{
+	const glm::vec3 * positions;
+	const unsigned int * triangleIndices;
+	unsigned int triangleCount;
+	bool cullBackFaces;
+};
+
+// Written by the occlusion pass, hidden entities are not drawn
+struct Visibility
+{
+	bool visible;
+};
+
+// Drawn into the shadow maps. Static casters never move, so their shadow
+// depth is cached between frames.
+struct ShadowCaster
+{
+	bool isStatic;
+};
+
+// Draw of a vertex array object, indexed when indexType is set
+struct MeshDraw
+{
+	unsigned int vertexArray;
+	int first; // first vertex, or first index when indexed
+	int count;
+	unsigned int indexType; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, 0 for glDrawArrays
+};
+
+// Detail levels of the mesh and the one drawn, picked by selectLod()
+struct MeshLods
+{
+	MeshLod levels[MESH_MAX_LODS];
+	unsigned int count;
+	unsigned int current;
+};
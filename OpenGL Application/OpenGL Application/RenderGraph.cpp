@@ -0,0 +1,476 @@
+#include "RenderGraph.h"
+#include <cstdio>
+#include <queue>
+#include <algorithm>
+
+const unsigned int ACCESS_KINDS = 8;
+
+// Incoherent writes, made visible by glMemoryBarrier
+const unsigned int ACCESS_INCOHERENT = ACCESS_IMAGE | ACCESS_STORAGE;
+
+// glMemoryBarrier bits ordering incoherent writes before each kind of access
+const GLbitfield ACCESS_BARRIERS[ACCESS_KINDS] = {
+	GL_FRAMEBUFFER_BARRIER_BIT,
+	GL_TEXTURE_FETCH_BARRIER_BIT,
+	GL_SHADER_IMAGE_ACCESS_BARRIER_BIT,
+	GL_SHADER_STORAGE_BARRIER_BIT,
+	GL_UNIFORM_BARRIER_BIT,
+	GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT,
+	GL_COMMAND_BARRIER_BIT,
+	GL_TEXTURE_UPDATE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT
+};
+
+static size_t texelBytes(GLenum format)
+{
+	switch (format)
+	{
+	case GL_R8:
+		return 1;
+	case GL_RG8:
+	case GL_R16F:
+		return 2;
+	case GL_RGBA16F:
+	case GL_RG32F:
+		return 8;
+	case GL_RGBA32F:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+RenderGraph::RenderGraph()
+{
+	compiled = false;
+}
+
+void RenderGraph::clear()
+{
+	passes.clear();
+	resources.clear();
+	order.clear();
+	physicals.clear();
+	compiled = false;
+}
+
+RenderGraph::Resource RenderGraph::addResource(const char * name, bool imported, bool isBuffer)
+{
+	ResourceEntry entry = {};
+	entry.name = name;
+	entry.imported = imported;
+	entry.description.isBuffer = isBuffer;
+	entry.physical = -1;
+	resources.push_back(entry);
+	compiled = false;
+	return (Resource)resources.size() - 1;
+}
+
+RenderGraph::Resource RenderGraph::createTexture(const char * name, unsigned int width, unsigned int height, GLenum format)
+{
+	Resource resource = addResource(name, false, false);
+	RenderPhysical & description = resources[resource].description;
+	description.width = width;
+	description.height = height;
+	description.format = format;
+	description.bytes = (size_t)width * height * texelBytes(format);
+	return resource;
+}
+
+RenderGraph::Resource RenderGraph::createBuffer(const char * name, size_t bytes)
+{
+	Resource resource = addResource(name, false, true);
+	resources[resource].description.bytes = bytes;
+	return resource;
+}
+
+RenderGraph::Resource RenderGraph::importTexture(const char * name, GLuint texture, unsigned int width, unsigned int height, GLenum format)
+{
+	Resource resource = createTexture(name, width, height, format);
+	resources[resource].imported = true;
+	resources[resource].handle = texture;
+	return resource;
+}
+
+RenderGraph::Resource RenderGraph::importBuffer(const char * name, GLuint buffer, size_t bytes)
+{
+	Resource resource = createBuffer(name, bytes);
+	resources[resource].imported = true;
+	resources[resource].handle = buffer;
+	return resource;
+}
+
+RenderGraph::Resource RenderGraph::importBackbuffer(const char * name, unsigned int width, unsigned int height, GLuint framebuffer)
+{
+	Resource resource = importTexture(name, framebuffer, width, height, GL_RGBA8);
+	resources[resource].backbuffer = true;
+	return resource;
+}
+
+void RenderGraph::markOutput(Resource resource)
+{
+	resources[resource].output = true;
+	compiled = false;
+}
+
+unsigned int RenderGraph::addPass(const char * name, const RenderPassFunction & execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.sideEffects = false;
+	pass.culled = true;
+	pass.barriers = 0;
+	passes.push_back(pass);
+	compiled = false;
+	return (unsigned int)passes.size() - 1;
+}
+
+bool RenderGraph::addAccess(unsigned int pass, Resource resource, unsigned int access, bool write)
+{
+	if (pass >= passes.size() || resource >= resources.size() || access == 0 || access >= 1u << ACCESS_KINDS)
+	{
+		printf("Render graph access of an unknown pass, resource or kind\n");
+		return false;
+	}
+
+	Access entry = { resource, access };
+	(write ? passes[pass].writes : passes[pass].reads).push_back(entry);
+	std::vector<unsigned int> & writers = resources[resource].writers;
+	if (write && (writers.empty() || writers.back() != pass))
+		writers.push_back(pass);
+	compiled = false;
+	return true;
+}
+
+bool RenderGraph::read(unsigned int pass, Resource resource, unsigned int access)
+{
+	return addAccess(pass, resource, access, false);
+}
+
+bool RenderGraph::write(unsigned int pass, Resource resource, unsigned int access)
+{
+	return addAccess(pass, resource, access, true);
+}
+
+void RenderGraph::setSideEffects(unsigned int pass)
+{
+	passes[pass].sideEffects = true;
+	compiled = false;
+}
+
+// Kahn's algorithm over the kept passes, the earliest declared ready pass first
+bool RenderGraph::sortPasses(std::vector<std::vector<unsigned int>> & dependents, std::vector<unsigned int> & dependencyCounts)
+{
+	std::priority_queue<unsigned int, std::vector<unsigned int>, std::greater<unsigned int>> ready;
+	unsigned int kept = 0;
+	for (unsigned int pass = 0; pass < passes.size(); pass++)
+	{
+		if (passes[pass].culled)
+			continue;
+		kept++;
+		if (dependencyCounts[pass] == 0)
+			ready.push(pass);
+	}
+
+	order.clear();
+	while (!ready.empty())
+	{
+		unsigned int pass = ready.top();
+		ready.pop();
+		order.push_back(pass);
+		for (unsigned int dependent : dependents[pass])
+			if (!passes[dependent].culled && --dependencyCounts[dependent] == 0)
+				ready.push(dependent);
+	}
+
+	if (order.size() != kept)
+	{
+		printf("Render graph has a dependency cycle through %u passes\n", kept - (unsigned int)order.size());
+		return false;
+	}
+	return true;
+}
+
+// Greedy interval packing: resources in order of first use take the best
+// fitting pool memory whose last user ran before them
+void RenderGraph::aliasResources()
+{
+	std::vector<int> firstUse(resources.size(), -1), lastUse(resources.size(), -1);
+	for (unsigned int position = 0; position < order.size(); position++)
+	{
+		const Pass & pass = passes[order[position]];
+		for (int list = 0; list < 2; list++)
+		{
+			for (const Access & access : list == 0 ? pass.reads : pass.writes)
+			{
+				if (firstUse[access.resource] < 0)
+					firstUse[access.resource] = position;
+				lastUse[access.resource] = position;
+			}
+		}
+	}
+
+	std::vector<Resource> transients;
+	for (Resource resource = 0; resource < resources.size(); resource++)
+	{
+		resources[resource].physical = -1;
+		if (!resources[resource].imported && firstUse[resource] >= 0)
+			transients.push_back(resource);
+	}
+	std::stable_sort(transients.begin(), transients.end(), [&firstUse](Resource a, Resource b)
+	{
+		return firstUse[a] < firstUse[b];
+	});
+
+	physicals.clear();
+	std::vector<int> physicalLastUse;
+	for (Resource resource : transients)
+	{
+		const RenderPhysical & description = resources[resource].description;
+		int best = -1;
+		for (int i = 0; i < (int)physicals.size(); i++)
+		{
+			const RenderPhysical & physical = physicals[i];
+			if (physicalLastUse[i] >= firstUse[resource] || physical.isBuffer != description.isBuffer)
+				continue;
+			if (!description.isBuffer && (physical.width != description.width || physical.height != description.height || physical.format != description.format))
+				continue;
+
+			// Smallest buffer big enough, else the biggest to grow
+			bool fits = physical.bytes >= description.bytes;
+			bool bestFits = best >= 0 && physicals[best].bytes >= description.bytes;
+			if (best < 0 || (fits != bestFits ? fits : fits ? physical.bytes < physicals[best].bytes : physical.bytes > physicals[best].bytes))
+				best = i;
+		}
+
+		if (best < 0)
+		{
+			best = (int)physicals.size();
+			physicals.push_back(description);
+			physicalLastUse.push_back(-1);
+		}
+		physicals[best].bytes = std::max(physicals[best].bytes, description.bytes);
+		physicalLastUse[best] = lastUse[resource];
+		resources[resource].physical = best;
+	}
+}
+
+void RenderGraph::placeBarriers()
+{
+	// Position of the pass with the last incoherent write to each resource,
+	// and of the last barrier issued for each kind of access
+	std::vector<int> incoherentWrite(resources.size(), -1);
+	int lastBarrier[ACCESS_KINDS];
+	std::fill(lastBarrier, lastBarrier + ACCESS_KINDS, -1);
+
+	for (int position = 0; position < (int)order.size(); position++)
+	{
+		Pass & pass = passes[order[position]];
+		unsigned int kinds = 0;
+		for (int list = 0; list < 2; list++)
+		{
+			for (const Access & access : list == 0 ? pass.reads : pass.writes)
+			{
+				int written = incoherentWrite[access.resource];
+				if (written < 0 || written == position)
+					continue;
+				for (unsigned int kind = 0; kind < ACCESS_KINDS; kind++)
+					if ((access.access >> kind & 1) && lastBarrier[kind] <= written)
+						kinds |= 1u << kind;
+			}
+		}
+
+		pass.barriers = 0;
+		for (unsigned int kind = 0; kind < ACCESS_KINDS; kind++)
+		{
+			if (kinds >> kind & 1)
+			{
+				pass.barriers |= ACCESS_BARRIERS[kind];
+				lastBarrier[kind] = position;
+			}
+		}
+
+		for (const Access & access : pass.writes)
+			incoherentWrite[access.resource] = access.access & ACCESS_INCOHERENT ? position : -1;
+	}
+}
+
+bool RenderGraph::compile()
+{
+	compiled = false;
+	for (Pass & pass : passes)
+	{
+		pass.culled = true;
+		pass.barriers = 0;
+	}
+
+	// A read depends on the last writer, every writer on the one before it
+	std::vector<std::vector<unsigned int>> dependents(passes.size()), dependencies(passes.size());
+	for (unsigned int pass = 0; pass < passes.size(); pass++)
+	{
+		for (const Access & access : passes[pass].reads)
+		{
+			const ResourceEntry & resource = resources[access.resource];
+			if (resource.writers.empty() && !resource.imported)
+			{
+				printf("Render graph pass %s reads %s, which no pass writes\n", passes[pass].name.c_str(), resource.name.c_str());
+				return false;
+			}
+			if (!resource.writers.empty() && std::find(resource.writers.begin(), resource.writers.end(), pass) == resource.writers.end())
+				dependencies[pass].push_back(resource.writers.back());
+		}
+	}
+	for (const ResourceEntry & resource : resources)
+		for (size_t i = 1; i < resource.writers.size(); i++)
+			dependencies[resource.writers[i]].push_back(resource.writers[i - 1]);
+
+	// Keep whatever the roots depend on
+	std::vector<unsigned int> stack;
+	for (unsigned int pass = 0; pass < passes.size(); pass++)
+	{
+		bool root = passes[pass].sideEffects;
+		for (const Access & access : passes[pass].writes)
+			root = root || resources[access.resource].output;
+		if (root)
+		{
+			passes[pass].culled = false;
+			stack.push_back(pass);
+		}
+	}
+	while (!stack.empty())
+	{
+		unsigned int pass = stack.back();
+		stack.pop_back();
+		for (unsigned int dependency : dependencies[pass])
+		{
+			if (passes[dependency].culled)
+			{
+				passes[dependency].culled = false;
+				stack.push_back(dependency);
+			}
+		}
+	}
+
+	std::vector<unsigned int> dependencyCounts(passes.size(), 0);
+	for (unsigned int pass = 0; pass < passes.size(); pass++)
+	{
+		std::sort(dependencies[pass].begin(), dependencies[pass].end());
+		dependencies[pass].erase(std::unique(dependencies[pass].begin(), dependencies[pass].end()), dependencies[pass].end());
+		for (unsigned int dependency : dependencies[pass])
+			dependents[dependency].push_back(pass);
+		dependencyCounts[pass] = (unsigned int)dependencies[pass].size();
+	}
+	if (!sortPasses(dependents, dependencyCounts))
+		return false;
+
+	aliasResources();
+	placeBarriers();
+	compiled = true;
+	return true;
+}
+
+bool RenderGraph::isCompiled() const
+{
+	return compiled;
+}
+
+const std::vector<unsigned int> & RenderGraph::getOrder() const
+{
+	return order;
+}
+
+unsigned int RenderGraph::getPassCount() const
+{
+	return (unsigned int)passes.size();
+}
+
+const char * RenderGraph::getPassName(unsigned int pass) const
+{
+	return passes[pass].name.c_str();
+}
+
+bool RenderGraph::isCulled(unsigned int pass) const
+{
+	return passes[pass].culled;
+}
+
+GLbitfield RenderGraph::getBarriers(unsigned int pass) const
+{
+	return passes[pass].barriers;
+}
+
+void RenderGraph::getAttachments(unsigned int pass, std::vector<Resource> & attachments) const
+{
+	attachments.clear();
+	for (const Access & access : passes[pass].writes)
+		if ((access.access & ACCESS_ATTACHMENT) && std::find(attachments.begin(), attachments.end(), access.resource) == attachments.end())
+			attachments.push_back(access.resource);
+}
+
+void RenderGraph::execute(unsigned int pass, const RenderPassTarget & target) const
+{
+	if (passes[pass].execute)
+		passes[pass].execute(target);
+}
+
+unsigned int RenderGraph::getResourceCount() const
+{
+	return (unsigned int)resources.size();
+}
+
+const char * RenderGraph::getResourceName(Resource resource) const
+{
+	return resources[resource].name.c_str();
+}
+
+bool RenderGraph::isImported(Resource resource) const
+{
+	return resources[resource].imported;
+}
+
+bool RenderGraph::isBackbuffer(Resource resource) const
+{
+	return resources[resource].backbuffer;
+}
+
+const RenderPhysical & RenderGraph::getDescription(Resource resource) const
+{
+	return resources[resource].description;
+}
+
+int RenderGraph::getPhysicalIndex(Resource resource) const
+{
+	return resources[resource].physical;
+}
+
+const std::vector<RenderPhysical> & RenderGraph::getPhysicals() const
+{
+	return physicals;
+}
+
+void RenderGraph::setHandle(Resource resource, GLuint handle)
+{
+	resources[resource].handle = handle;
+}
+
+GLuint RenderGraph::getHandle(Resource resource) const
+{
+	return resources[resource].handle;
+}
+
+size_t RenderGraph::getTransientBytes() const
+{
+	size_t bytes = 0;
+	for (const ResourceEntry & resource : resources)
+		if (resource.physical >= 0)
+			bytes += resource.description.bytes;
+	return bytes;
+}
+
+size_t RenderGraph::getPhysicalBytes() const
+{
+	size_t bytes = 0;
+	for (const RenderPhysical & physical : physicals)
+		bytes += physical.bytes;
+	return bytes;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <glew.h>
+
+// How a pass touches a resource, combined as bits
+enum RenderAccess
+{
+	ACCESS_ATTACHMENT = 1, // framebuffer colour or depth
+	ACCESS_SAMPLED = 2,    // texture fetches
+	ACCESS_IMAGE = 4,      // image load and store
+	ACCESS_STORAGE = 8,    // shader storage buffer
+	ACCESS_UNIFORM = 16,   // uniform buffer
+	ACCESS_VERTEX = 32,    // vertex attributes or indices
+	ACCESS_INDIRECT = 64,  // draw or dispatch arguments
+	ACCESS_TRANSFER = 128  // copies, blits, uploads and readbacks
+};
+
+// Framebuffer bound for a pass that writes attachments, the backbuffer's
+// and its size otherwise
+struct RenderPassTarget
+{
+	GLuint framebuffer;
+	unsigned int width;
+	unsigned int height;
+};
+
+typedef std::function<void(const RenderPassTarget & target)> RenderPassFunction;
+
+// Pool memory a set of transient resources is given, see getPhysicals()
+struct RenderPhysical
+{
+	bool isBuffer;
+	unsigned int width;
+	unsigned int height;
+	GLenum format; // sized internal format
+	size_t bytes;
+};
+
+// Declarative frame description. Passes declare the textures and buffers
+// they read and write; compile() then
+// - culls passes nothing needs: only passes with side effects, those
+//   writing an output and those writing what a kept pass reads are kept,
+// - orders the rest by their dependencies, declaration order breaking ties,
+// - gives transient resources whose lifetimes do not overlap the same pool
+//   memory: textures of the same size and format, buffers of any size,
+// - and places glMemoryBarrier bits only before passes reading what an
+//   earlier pass wrote through image stores or storage buffers, the writes
+//   OpenGL does not order by itself, and only once per write.
+//
+// A read sees a resource after every other pass writing it, so a pass
+// reading and writing a resource updates it in place after the writers
+// declared before it. The graph makes no GL calls; RenderGraphExecutor
+// allocates the pool and runs the passes.
+class RenderGraph
+{
+public:
+	typedef unsigned int Resource;
+
+private:
+	struct Access
+	{
+		Resource resource;
+		unsigned int access;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		RenderPassFunction execute;
+		std::vector<Access> reads;
+		std::vector<Access> writes;
+		bool sideEffects;
+		bool culled;
+		GLbitfield barriers;
+	};
+
+	struct ResourceEntry
+	{
+		std::string name;
+		bool imported;
+		bool backbuffer;
+		bool output;
+		RenderPhysical description;
+		GLuint handle;
+		int physical;
+		std::vector<unsigned int> writers; // in declaration order
+	};
+
+	std::vector<Pass> passes;
+	std::vector<ResourceEntry> resources;
+	std::vector<unsigned int> order;
+	std::vector<RenderPhysical> physicals;
+	bool compiled;
+
+	Resource addResource(const char * name, bool imported, bool isBuffer);
+	bool addAccess(unsigned int pass, Resource resource, unsigned int access, bool write);
+	bool sortPasses(std::vector<std::vector<unsigned int>> & dependents, std::vector<unsigned int> & dependencyCounts);
+	void aliasResources();
+	void placeBarriers();
+public:
+	RenderGraph();
+	void clear();
+
+	// Transient resources live only during the frame, in pool memory
+	Resource createTexture(const char * name, unsigned int width, unsigned int height, GLenum format);
+	Resource createBuffer(const char * name, size_t bytes);
+
+	// Resources owned elsewhere, kept across frames
+	Resource importTexture(const char * name, GLuint texture, unsigned int width, unsigned int height, GLenum format);
+	Resource importBuffer(const char * name, GLuint buffer, size_t bytes);
+	// framebuffer is 0 for the window, or an offscreen one standing in for it
+	Resource importBackbuffer(const char * name, unsigned int width, unsigned int height, GLuint framebuffer = 0);
+
+	// Passes writing an output are never culled
+	void markOutput(Resource resource);
+
+	unsigned int addPass(const char * name, const RenderPassFunction & execute);
+	bool read(unsigned int pass, Resource resource, unsigned int access);
+	bool write(unsigned int pass, Resource resource, unsigned int access);
+
+	// Passes with effects outside the graph, like readbacks, are never culled
+	void setSideEffects(unsigned int pass);
+
+	// False on a dependency cycle or a transient read that nothing writes
+	bool compile();
+	bool isCompiled() const;
+
+	// Kept passes in execution order
+	const std::vector<unsigned int> & getOrder() const;
+	unsigned int getPassCount() const;
+	const char * getPassName(unsigned int pass) const;
+	bool isCulled(unsigned int pass) const;
+	GLbitfield getBarriers(unsigned int pass) const;
+
+	// Resources the pass writes as attachments, in declaration order
+	void getAttachments(unsigned int pass, std::vector<Resource> & attachments) const;
+	void execute(unsigned int pass, const RenderPassTarget & target) const;
+
+	unsigned int getResourceCount() const;
+	const char * getResourceName(Resource resource) const;
+	bool isImported(Resource resource) const;
+	bool isBackbuffer(Resource resource) const;
+	const RenderPhysical & getDescription(Resource resource) const;
+
+	// Pool memory of a transient resource, -1 for imported or unused ones
+	int getPhysicalIndex(Resource resource) const;
+	const std::vector<RenderPhysical> & getPhysicals() const;
+
+	// Set by the executor for transients, read by passes
+	void setHandle(Resource resource, GLuint handle);
+	GLuint getHandle(Resource resource) const;
+
+	// Bytes of the used transient resources, each on its own and as aliased
+	size_t getTransientBytes() const;
+	size_t getPhysicalBytes() const;
+};
@@ -0,0 +1,237 @@
+#include "RenderGraphExecutor.h"
+#include <cstdio>
+#include <algorithm>
+
+static bool isDepthFormat(GLenum format)
+{
+	return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F ||
+		format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static bool hasStencil(GLenum format)
+{
+	return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+// Pixel format and type glTexImage2D accepts along with the internal format
+static void transferFormat(GLenum internalFormat, GLenum & format, GLenum & type)
+{
+	type = GL_FLOAT;
+	switch (internalFormat)
+	{
+	case GL_DEPTH_COMPONENT16:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32F:
+		format = GL_DEPTH_COMPONENT;
+		break;
+	case GL_DEPTH24_STENCIL8:
+		format = GL_DEPTH_STENCIL;
+		type = GL_UNSIGNED_INT_24_8;
+		break;
+	case GL_DEPTH32F_STENCIL8:
+		format = GL_DEPTH_STENCIL;
+		type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+		break;
+	case GL_R8:
+	case GL_R16F:
+	case GL_R32F:
+		format = GL_RED;
+		break;
+	case GL_RG8:
+	case GL_RG16F:
+	case GL_RG32F:
+		format = GL_RG;
+		break;
+	case GL_R11F_G11F_B10F:
+		format = GL_RGB;
+		break;
+	default:
+		format = GL_RGBA;
+	}
+}
+
+RenderGraphExecutor::~RenderGraphExecutor()
+{
+	for (PooledObject & object : objects)
+		object.used = false;
+	for (PooledFramebuffer & framebuffer : framebuffers)
+		framebuffer.used = false;
+	releaseUnused();
+}
+
+GLuint RenderGraphExecutor::acquireObject(const RenderPhysical & description)
+{
+	// Textures must match, the smallest big enough buffer does
+	int best = -1;
+	for (int i = 0; i < (int)objects.size(); i++)
+	{
+		const RenderPhysical & pooled = objects[i].description;
+		if (objects[i].used || pooled.isBuffer != description.isBuffer)
+			continue;
+		if (description.isBuffer ? pooled.bytes >= description.bytes && (best < 0 || pooled.bytes < objects[best].description.bytes) :
+			pooled.width == description.width && pooled.height == description.height && pooled.format == description.format)
+			best = i;
+	}
+	if (best >= 0)
+	{
+		objects[best].used = true;
+		return objects[best].handle;
+	}
+
+	PooledObject object = { description, 0, true };
+	if (description.isBuffer)
+	{
+		glGenBuffers(1, &object.handle);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, object.handle);
+		glBufferData(GL_COPY_WRITE_BUFFER, description.bytes, nullptr, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	else
+	{
+		GLenum format, type;
+		transferFormat(description.format, format, type);
+		glGenTextures(1, &object.handle);
+		glBindTexture(GL_TEXTURE_2D, object.handle);
+		glTexImage2D(GL_TEXTURE_2D, 0, description.format, description.width, description.height, 0, format, type, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	objects.push_back(object);
+	return object.handle;
+}
+
+GLuint RenderGraphExecutor::acquireFramebuffer(const RenderGraph & graph, const std::vector<RenderGraph::Resource> & attachments)
+{
+	std::vector<GLuint> handles;
+	for (RenderGraph::Resource attachment : attachments)
+	{
+		if (graph.isBackbuffer(attachment))
+			return graph.getHandle(attachment);
+		if (!isDepthFormat(graph.getDescription(attachment).format))
+			handles.push_back(graph.getHandle(attachment));
+	}
+	for (RenderGraph::Resource attachment : attachments)
+		if (isDepthFormat(graph.getDescription(attachment).format))
+			handles.push_back(graph.getHandle(attachment));
+
+	for (PooledFramebuffer & framebuffer : framebuffers)
+	{
+		if (framebuffer.attachments == handles)
+		{
+			framebuffer.used = true;
+			return framebuffer.handle;
+		}
+	}
+
+	PooledFramebuffer framebuffer = { handles, 0, true };
+	glGenFramebuffers(1, &framebuffer.handle);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.handle);
+	std::vector<GLenum> drawBuffers;
+	for (RenderGraph::Resource attachment : attachments)
+	{
+		GLenum format = graph.getDescription(attachment).format;
+		GLenum point = hasStencil(format) ? GL_DEPTH_STENCIL_ATTACHMENT : isDepthFormat(format) ? GL_DEPTH_ATTACHMENT : GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+		glFramebufferTexture2D(GL_FRAMEBUFFER, point, GL_TEXTURE_2D, graph.getHandle(attachment), 0);
+		if (!isDepthFormat(format))
+			drawBuffers.push_back(point);
+	}
+	if (drawBuffers.empty())
+		glDrawBuffer(GL_NONE);
+	else
+		glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		printf("Render graph framebuffer of %u attachments is incomplete\n", (unsigned int)handles.size());
+
+	framebuffers.push_back(framebuffer);
+	return framebuffer.handle;
+}
+
+void RenderGraphExecutor::releaseUnused()
+{
+	for (size_t i = 0; i < framebuffers.size();)
+	{
+		if (framebuffers[i].used)
+		{
+			i++;
+			continue;
+		}
+		glDeleteFramebuffers(1, &framebuffers[i].handle);
+		framebuffers.erase(framebuffers.begin() + i);
+	}
+
+	for (size_t i = 0; i < objects.size();)
+	{
+		if (objects[i].used)
+		{
+			i++;
+			continue;
+		}
+		if (objects[i].description.isBuffer)
+			glDeleteBuffers(1, &objects[i].handle);
+		else
+			glDeleteTextures(1, &objects[i].handle);
+		objects.erase(objects.begin() + i);
+	}
+}
+
+bool RenderGraphExecutor::execute(RenderGraph & graph)
+{
+	if (!graph.isCompiled() && !graph.compile())
+		return false;
+
+	for (PooledObject & object : objects)
+		object.used = false;
+	for (PooledFramebuffer & framebuffer : framebuffers)
+		framebuffer.used = false;
+
+	std::vector<GLuint> physicalHandles;
+	for (const RenderPhysical & physical : graph.getPhysicals())
+		physicalHandles.push_back(acquireObject(physical));
+
+	RenderPassTarget backbuffer = { 0, 0, 0 };
+	for (RenderGraph::Resource resource = 0; resource < graph.getResourceCount(); resource++)
+	{
+		if (graph.getPhysicalIndex(resource) >= 0)
+			graph.setHandle(resource, physicalHandles[graph.getPhysicalIndex(resource)]);
+		if (graph.isBackbuffer(resource))
+		{
+			backbuffer.framebuffer = graph.getHandle(resource);
+			backbuffer.width = graph.getDescription(resource).width;
+			backbuffer.height = graph.getDescription(resource).height;
+		}
+	}
+
+	std::vector<RenderGraph::Resource> attachments;
+	for (unsigned int pass : graph.getOrder())
+	{
+		if (graph.getBarriers(pass))
+			glMemoryBarrier(graph.getBarriers(pass));
+
+		RenderPassTarget target = backbuffer;
+		graph.getAttachments(pass, attachments);
+		if (!attachments.empty())
+		{
+			target.framebuffer = acquireFramebuffer(graph, attachments);
+			target.width = graph.getDescription(attachments[0]).width;
+			target.height = graph.getDescription(attachments[0]).height;
+			glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+			glViewport(0, 0, target.width, target.height);
+		}
+		graph.execute(pass, target);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	releaseUnused();
+	return true;
+}
+
+size_t RenderGraphExecutor::getPooledBytes() const
+{
+	size_t bytes = 0;
+	for (const PooledObject & object : objects)
+		bytes += object.description.bytes;
+	return bytes;
+}
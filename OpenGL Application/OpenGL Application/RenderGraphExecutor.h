@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <glew.h>
+#include "RenderGraph.h"
+
+// Runs compiled render graphs. The pool memory of a graph becomes textures
+// and buffers kept from frame to frame, matched by size and format, and
+// the framebuffers of passes writing attachments are kept the same way.
+// Whatever a frame no longer uses is deleted after it.
+class RenderGraphExecutor
+{
+private:
+	struct PooledObject
+	{
+		RenderPhysical description;
+		GLuint handle;
+		bool used;
+	};
+
+	struct PooledFramebuffer
+	{
+		std::vector<GLuint> attachments; // textures, depth last
+		GLuint handle;
+		bool used;
+	};
+
+	std::vector<PooledObject> objects;
+	std::vector<PooledFramebuffer> framebuffers;
+
+	GLuint acquireObject(const RenderPhysical & description);
+	GLuint acquireFramebuffer(const RenderGraph & graph, const std::vector<RenderGraph::Resource> & attachments);
+	void releaseUnused();
+public:
+	~RenderGraphExecutor();
+
+	// Compiles the graph first when needed
+	bool execute(RenderGraph & graph);
+
+	size_t getPooledBytes() const;
+};
@@ -0,0 +1,107 @@
+#include "ResolutionController.h"
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+ResolutionController::ResolutionController()
+{
+	gains.proportional = 0.25f;
+	gains.integral = 0.15f;
+	gains.derivative = 0.05f;
+	targetMilliseconds = 0.0f;
+	minScale = 1.0f;
+	maxScale = 1.0f;
+	step = 0.0f;
+	latency = 0;
+	integral = 1.0f;
+	previousError = 0.0f;
+	area = 1.0f;
+	scale = 1.0f;
+	settling = 0;
+	hasPrevious = false;
+}
+
+bool ResolutionController::create(float targetMilliseconds, float minScale, float maxScale, float step, unsigned int latency)
+{
+	if (targetMilliseconds <= 0.0f || minScale <= 0.0f || minScale > maxScale || step < 0.0f)
+	{
+		printf("Dynamic resolution needs a positive target and 0 < minimum scale <= maximum scale\n");
+		return false;
+	}
+
+	this->targetMilliseconds = targetMilliseconds;
+	this->minScale = minScale;
+	this->maxScale = maxScale;
+	this->step = step;
+	this->latency = latency;
+	integral = maxScale * maxScale;
+	area = integral;
+	scale = maxScale;
+	settling = 0;
+	hasPrevious = false;
+	return true;
+}
+
+void ResolutionController::setGains(const PidGains & gains)
+{
+	this->gains = gains;
+}
+
+void ResolutionController::setTarget(float targetMilliseconds)
+{
+	if (targetMilliseconds > 0.0f)
+		this->targetMilliseconds = targetMilliseconds;
+}
+
+float ResolutionController::update(float gpuMilliseconds)
+{
+	if (settling > 0)
+	{
+		settling--;
+		return scale;
+	}
+
+	// Relative to the area the frame was rendered at, so the same headroom
+	// asks for the same relative change whatever the scale
+	float error = (targetMilliseconds - gpuMilliseconds) / targetMilliseconds;
+	float derivative = hasPrevious ? error - previousError : 0.0f;
+	previousError = error;
+	hasPrevious = true;
+
+	float minArea = minScale * minScale, maxArea = maxScale * maxScale;
+	float renderedArea = scale * scale;
+	float nextIntegral = integral + gains.integral * error * renderedArea;
+	float output = nextIntegral + (gains.proportional * error + gains.derivative * derivative) * renderedArea;
+	if ((output < maxArea || error < 0.0f) && (output > minArea || error > 0.0f))
+		integral = std::min(std::max(nextIntegral, minArea), maxArea);
+	area = std::min(std::max(output, minArea), maxArea);
+
+	float wanted = sqrtf(area);
+	if (step > 0.0f && fabsf(wanted - scale) < 0.75f * step)
+		return scale;
+
+	float stepped = step > 0.0f ? floorf(wanted / step + 0.5f) * step : wanted;
+	stepped = std::min(std::max(stepped, minScale), maxScale);
+	if (stepped != scale)
+	{
+		scale = stepped;
+		settling = latency;
+		hasPrevious = false;
+	}
+	return scale;
+}
+
+float ResolutionController::getScale() const
+{
+	return scale;
+}
+
+float ResolutionController::getTarget() const
+{
+	return targetMilliseconds;
+}
+
+float ResolutionController::getArea() const
+{
+	return area;
+}
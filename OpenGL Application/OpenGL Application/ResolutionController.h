@@ -0,0 +1,50 @@
+#pragma once
+
+struct PidGains
+{
+	float proportional;
+	float integral;
+	float derivative;
+};
+
+// Dynamic resolution scale held by a PID controller so the GPU frame time
+// stays at a target under a changing load. The controlled value is the
+// render area, as a fraction of the output's, which GPU time follows
+// roughly linearly; the scale applied to width and height is its root.
+//
+// The error is the headroom left, as a fraction of the target. Integration
+// stops while the area is at a limit, so a long spell there does not wind
+// the controller up. The scale moves in fixed steps, and only once the
+// controller is most of a step away, so the render target is not
+// reallocated every frame; timings arriving before a change can have shown
+// up (the timer query latency) are ignored.
+class ResolutionController
+{
+private:
+	PidGains gains;
+	float targetMilliseconds;
+	float minScale;
+	float maxScale;
+	float step;
+	unsigned int latency;
+	float integral;      // area the controller settles at for no error
+	float previousError;
+	float area;
+	float scale;
+	unsigned int settling;
+	bool hasPrevious;
+public:
+	ResolutionController();
+
+	// Starts at maxScale
+	bool create(float targetMilliseconds, float minScale, float maxScale, float step, unsigned int latency);
+	void setGains(const PidGains & gains);
+	void setTarget(float targetMilliseconds);
+
+	// Takes the GPU time of a frame and returns the scale for the next one
+	float update(float gpuMilliseconds);
+
+	float getScale() const;
+	float getTarget() const;
+	float getArea() const; // before stepping
+};
@@ -0,0 +1,112 @@
+#include "ShadowCascades.h"
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <matrix_transform.hpp>
+
+const unsigned int ShadowCascades::MAX_CASCADES;
+
+ShadowCascades::ShadowCascades()
+{
+	resolution = 0;
+	splitBlend = 0.0f;
+	casterDistance = 0.0f;
+}
+
+bool ShadowCascades::create(unsigned int cascadeCount, unsigned int resolution, float splitBlend, float casterDistance)
+{
+	if (cascadeCount == 0 || cascadeCount > MAX_CASCADES || resolution < 4)
+	{
+		printf("Shadow cascades need 1 to %u cascades and a resolution of at least 4\n", MAX_CASCADES);
+		return false;
+	}
+
+	this->resolution = resolution;
+	this->splitBlend = glm::clamp(splitBlend, 0.0f, 1.0f);
+	this->casterDistance = std::max(casterDistance, 0.0f);
+	cascades.assign(cascadeCount, ShadowCascade());
+	changed.assign(cascadeCount, true);
+	return true;
+}
+
+void ShadowCascades::update(const glm::mat4 & view, const glm::mat4 & projection, float nearDepth, float farDepth, const glm::vec3 & lightDirection)
+{
+	// Squared tangent of the angle between the view axis and a frustum edge
+	float tanX = 1.0f / projection[0][0], tanY = 1.0f / projection[1][1];
+	float edgeSlope = tanX * tanX + tanY * tanY;
+
+	glm::mat4 inverseView = glm::inverse(view);
+	glm::vec3 up = fabsf(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+
+	unsigned int count = (unsigned int)cascades.size();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ShadowCascade & cascade = cascades[i];
+		float splits[2];
+		for (unsigned int side = 0; side < 2; side++)
+		{
+			float fraction = (float)(i + side) / count;
+			float logarithmic = nearDepth * powf(farDepth / nearDepth, fraction);
+			float uniform = nearDepth + (farDepth - nearDepth) * fraction;
+			splits[side] = splitBlend * logarithmic + (1.0f - splitBlend) * uniform;
+		}
+		cascade.splitNear = splits[0];
+		cascade.splitFar = splits[1];
+
+		// Smallest sphere around the slice, centred on the view axis where it
+		// is as far from the near corners as from the far ones. It depends only
+		// on the depths and the field of view, not on where the camera looks.
+		float centerDepth = std::min(0.5f * (splits[0] + splits[1]) * (1.0f + edgeSlope), splits[1]);
+		float nearDistance = (centerDepth - splits[0]) * (centerDepth - splits[0]) + splits[0] * splits[0] * edgeSlope;
+		float farDistance = (splits[1] - centerDepth) * (splits[1] - centerDepth) + splits[1] * splits[1] * edgeSlope;
+
+		// Snapping the centre to whole texels keeps every world point on the
+		// same spot within its texel as the camera moves. It shifts the map by
+		// up to half a texel, so the sphere is padded by one.
+		float radius = sqrtf(std::max(nearDistance, farDistance)) * resolution / (resolution - 2.0f);
+		cascade.texelSize = 2.0f * radius / resolution;
+		glm::vec3 center = glm::vec3(lightView * inverseView * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+		center = glm::floor(center / cascade.texelSize + 0.5f) * cascade.texelSize;
+
+		glm::mat4 lightProjection = glm::ortho(center.x - radius, center.x + radius, center.y - radius, center.y + radius,
+			-center.z - radius - casterDistance, -center.z + radius);
+		glm::mat4 viewProjection = lightProjection * lightView;
+		changed[i] = viewProjection != cascade.viewProjection;
+		cascade.viewProjection = viewProjection;
+	}
+}
+
+unsigned int ShadowCascades::getCascadeCount() const
+{
+	return (unsigned int)cascades.size();
+}
+
+unsigned int ShadowCascades::getResolution() const
+{
+	return resolution;
+}
+
+const ShadowCascade & ShadowCascades::getCascade(unsigned int cascade) const
+{
+	return cascades[cascade];
+}
+
+bool ShadowCascades::hasChanged(unsigned int cascade) const
+{
+	return changed[cascade];
+}
+
+bool ShadowCascades::overlaps(unsigned int cascade, const glm::mat4 & model, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax) const
+{
+	glm::mat4 modelViewProjection = cascades[cascade].viewProjection * model;
+	glm::vec3 clipMin(INFINITY), clipMax(-INFINITY);
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 position = glm::mix(boundsMin, boundsMax, glm::vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1));
+		glm::vec3 clip = glm::vec3(modelViewProjection * glm::vec4(position, 1.0f)); // orthographic, w is 1
+		clipMin = glm::min(clipMin, clip);
+		clipMax = glm::max(clipMax, clip);
+	}
+	return clipMin.x <= 1.0f && clipMax.x >= -1.0f && clipMin.y <= 1.0f && clipMax.y >= -1.0f && clipMin.z <= 1.0f;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <glm.hpp>
+
+struct ShadowCascade
+{
+	glm::mat4 viewProjection; // world to light clip space
+	float splitNear;          // view depth range of the camera it covers
+	float splitFar;
+	float texelSize;          // world units per shadow map texel
+};
+
+// Cascade placement for directional shadow maps. The camera frustum between
+// nearDepth and farDepth is split into slices, blending logarithmic and
+// uniform splits, and each slice gets an orthographic light projection.
+//
+// The projections are stable: each covers the bounding sphere of its slice,
+// whose size does not change as the camera turns, and its centre is snapped
+// to whole texels in light space, so shadow edges do not shimmer as the
+// camera moves. Snapping also means a cascade keeps exactly the same matrix
+// until the camera has moved a texel, which hasChanged() reports so cached
+// shadow maps are only redrawn when needed.
+class ShadowCascades
+{
+private:
+	unsigned int resolution;
+	float splitBlend;
+	float casterDistance;
+	std::vector<ShadowCascade> cascades;
+	std::vector<bool> changed;
+public:
+	static const unsigned int MAX_CASCADES = 4;
+
+	ShadowCascades();
+
+	// splitBlend 1 splits logarithmically, 0 uniformly. Casters up to
+	// casterDistance beyond a cascade towards the light are kept in its depth
+	// range; farther ones need depth clamping.
+	bool create(unsigned int cascadeCount, unsigned int resolution, float splitBlend, float casterDistance);
+
+	// lightDirection points from the light into the scene. The field of view
+	// is read from the perspective projection.
+	void update(const glm::mat4 & view, const glm::mat4 & projection, float nearDepth, float farDepth, const glm::vec3 & lightDirection);
+
+	unsigned int getCascadeCount() const;
+	unsigned int getResolution() const;
+	const ShadowCascade & getCascade(unsigned int cascade) const;
+
+	// Whether the last update() moved the cascade
+	bool hasChanged(unsigned int cascade) const;
+
+	// Whether a model space box can cast a shadow into the cascade, that is
+	// overlaps it across the light in any depth up to the cascade's far side
+	bool overlaps(unsigned int cascade, const glm::mat4 & model, const glm::vec3 & boundsMin, const glm::vec3 & boundsMax) const;
+};
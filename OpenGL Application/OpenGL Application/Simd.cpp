@@ -0,0 +1,80 @@
+#include "Simd.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+struct CpuFeatures
+{
+	bool avx;
+	bool avx2;
+	bool f16c;
+
+	CpuFeatures()
+	{
+		int info[4] = { 0, 0, 0, 0 };
+		cpuid(info, 0);
+		int maxLeaf = info[0];
+
+		cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool ymmEnabled = osxsave && (xgetbv() & 6) == 6; // OS saves XMM and YMM state
+		avx = ymmEnabled && (info[2] & (1 << 28)) != 0;
+		f16c = avx && (info[2] & (1 << 29)) != 0;
+
+		avx2 = false;
+		if (maxLeaf >= 7)
+		{
+			cpuid(info, 7);
+			avx2 = avx && (info[1] & (1 << 5)) != 0;
+		}
+	}
+
+	static void cpuid(int info[4], int leaf)
+	{
+#if defined(_MSC_VER)
+		__cpuidex(info, leaf, 0);
+#else
+		unsigned int a, b, c, d;
+		__cpuid_count(leaf, 0, a, b, c, d);
+		info[0] = (int)a;
+		info[1] = (int)b;
+		info[2] = (int)c;
+		info[3] = (int)d;
+#endif
+	}
+
+	static unsigned long long xgetbv()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return ((unsigned long long)edx << 32) | eax;
+#endif
+	}
+};
+
+static const CpuFeatures & cpuFeatures()
+{
+	static CpuFeatures features;
+	return features;
+}
+
+bool cpuHasAVX()
+{
+	return cpuFeatures().avx;
+}
+
+bool cpuHasAVX2()
+{
+	return cpuFeatures().avx2;
+}
+
+bool cpuHasF16C()
+{
+	return cpuFeatures().f16c;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+// SSE2 is the baseline for every build. Wider kernels are compiled alongside
+// it and picked at runtime, so functions using AVX/AVX2/F16C intrinsics must
+// be tagged with the matching target macro for GCC and Clang.
+#if defined(_MSC_VER)
+#define SIMD_TARGET_AVX
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_F16C
+#else
+#define SIMD_TARGET_AVX __attribute__((target("avx")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_TARGET_F16C __attribute__((target("avx,f16c")))
+#endif
+
+bool cpuHasAVX();
+bool cpuHasAVX2();
+bool cpuHasF16C();
@@ -0,0 +1,73 @@
+#include "SkinningPalette.h"
+#include <cstdio>
+#include <cstddef>
+#include "DualQuatSkinning.h"
+
+SkinningPalette::SkinningPalette()
+{
+	buffer = 0;
+	bindingPoint = 0;
+	jointCount = 0;
+}
+
+SkinningPalette::~SkinningPalette()
+{
+	if (buffer)
+		glDeleteBuffers(1, &buffer);
+}
+
+bool SkinningPalette::create(unsigned int jointCount, GLuint bindingPoint)
+{
+	GLint maxBlockSize = 0;
+	glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize);
+
+	GLsizeiptr size = MAX_JOINTS * sizeof(glm::mat2x4);
+	if (jointCount > MAX_JOINTS || size > maxBlockSize)
+	{
+		printf("Skinning palette of %u joints is not supported (%u max, %d byte uniform blocks)\n", jointCount, MAX_JOINTS, maxBlockSize);
+		return false;
+	}
+
+	if (!buffer)
+		glGenBuffers(1, &buffer);
+
+	// Always sized for MAX_JOINTS so the buffer matches the declared block size
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	this->jointCount = jointCount;
+	this->bindingPoint = bindingPoint;
+	return true;
+}
+
+void SkinningPalette::upload(const glm::mat2x4 * joints, unsigned int count)
+{
+	if (count > jointCount)
+		count = jointCount;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(glm::mat2x4), joints);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void SkinningPalette::bind()
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+}
+
+unsigned int SkinningPalette::getJointCount()
+{
+	return jointCount;
+}
+
+void SkinningPalette::setVertexAttributes()
+{
+	GLsizei stride = sizeof(SkinnedVertex);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(SkinnedVertex, position));
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(SkinnedVertex, normal));
+	glVertexAttribIPointer(2, 4, GL_UNSIGNED_BYTE, stride, (const void*)offsetof(SkinnedVertex, joints));
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (const void*)offsetof(SkinnedVertex, weights));
+	for (GLuint location = 0; location < 4; location++)
+		glEnableVertexAttribArray(location);
+}
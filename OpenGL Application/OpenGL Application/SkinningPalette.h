@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glew.h>
+#include <glm.hpp>
+
+// Uniform buffer holding a dual quaternion joint palette (see
+// DualQuatSkinning.h) for the JointPalette block of skinned.vs. Under std140
+// a mat2x4 array has a 32 byte stride, so glm::mat2x4 arrays upload as is.
+class SkinningPalette
+{
+private:
+	GLuint buffer;
+	GLuint bindingPoint;
+	unsigned int jointCount;
+public:
+	static const unsigned int MAX_JOINTS = 256; // must match MAX_JOINTS in skinned.vs
+
+	SkinningPalette();
+	~SkinningPalette();
+	bool create(unsigned int jointCount, GLuint bindingPoint);
+	void upload(const glm::mat2x4 * joints, unsigned int count);
+	void bind();
+	unsigned int getJointCount();
+
+	// Attribute pointers for an array of SkinnedVertex in the bound GL_ARRAY_BUFFER,
+	// at the locations skinned.vs declares
+	static void setVertexAttributes();
+};
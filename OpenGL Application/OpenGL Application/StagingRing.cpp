@@ -0,0 +1,137 @@
+#include "StagingRing.h"
+#include <cstdio>
+
+const size_t StagingRing::ALIGNMENT;
+
+StagingRing::StagingRing()
+{
+	buffer = 0;
+	persistent = nullptr;
+	size = 0;
+	head = 0;
+	used = 0;
+	frameBytes = 0;
+}
+
+StagingRing::~StagingRing()
+{
+	for (FrameFence & frame : frames)
+		glDeleteSync(frame.fence);
+
+	if (buffer)
+	{
+		if (persistent)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+		glDeleteBuffers(1, &buffer);
+	}
+}
+
+bool StagingRing::create(size_t size)
+{
+	if (buffer || size == 0)
+		return false;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (GLEW_ARB_buffer_storage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+		persistent = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+	}
+	else
+		glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (GLEW_ARB_buffer_storage && !persistent)
+	{
+		printf("Could not map a %zu byte staging buffer\n", size);
+		return false;
+	}
+
+	this->size = size;
+	return true;
+}
+
+// Frees the space of every frame the GPU has finished with
+void StagingRing::retire()
+{
+	while (!frames.empty())
+	{
+		GLenum status = glClientWaitSync(frames.front().fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+
+		glDeleteSync(frames.front().fence);
+		used -= frames.front().bytes;
+		frames.pop_front();
+	}
+}
+
+bool StagingRing::allocate(size_t bytes, size_t & offset)
+{
+	retire();
+
+	size_t start = (head + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	if (start + bytes > size)
+		start = 0;
+
+	// Padding, or the whole tail of the buffer when wrapping
+	size_t consumed = (start >= head ? start - head : size - head) + bytes;
+	if (bytes > size || used + consumed > size)
+		return false;
+
+	offset = start;
+	head = start + bytes;
+	used += consumed;
+	frameBytes += consumed;
+	return true;
+}
+
+void * StagingRing::map(size_t offset, size_t bytes)
+{
+	if (persistent)
+		return persistent + offset;
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	return glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+void StagingRing::unmap()
+{
+	if (persistent)
+		return;
+
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StagingRing::endFrame()
+{
+	if (frameBytes == 0)
+		return;
+
+	FrameFence frame = { glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), frameBytes };
+	frames.push_back(frame);
+	frameBytes = 0;
+}
+
+GLuint StagingRing::getBuffer()
+{
+	return buffer;
+}
+
+size_t StagingRing::getSize()
+{
+	return size;
+}
+
+size_t StagingRing::getFreeBytes()
+{
+	retire();
+	return size - used;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <deque>
+#include <glew.h>
+
+// Ring of upload memory in one buffer object, used as the source of buffer
+// copies and as a pixel unpack buffer. Space written in a frame is fenced at
+// endFrame() and only reused once the GPU has consumed it. The buffer stays
+// mapped when ARB_buffer_storage is available, otherwise each allocation is
+// mapped unsynchronized, which is safe for the same reason.
+class StagingRing
+{
+private:
+	struct FrameFence
+	{
+		GLsync fence;
+		size_t bytes; // consumed by the frame, including padding and wrap
+	};
+
+	GLuint buffer;
+	unsigned char * persistent;
+	size_t size;
+	size_t head;
+	size_t used;
+	size_t frameBytes;
+	std::deque<FrameFence> frames;
+
+	void retire();
+public:
+	static const size_t ALIGNMENT = 64;
+
+	StagingRing();
+	~StagingRing();
+	bool create(size_t size);
+
+	// Reserves bytes and returns the offset into the buffer, false when the
+	// GPU still reads the space
+	bool allocate(size_t bytes, size_t & offset);
+	void * map(size_t offset, size_t bytes);
+	void unmap();
+	void endFrame();
+
+	GLuint getBuffer();
+	size_t getSize();
+	size_t getFreeBytes();
+};
@@ -0,0 +1,272 @@
+#include "TextureData.h"
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include "MappedFile.h"
+#include "MipChain.h"
+
+bool isCompressedFormat(TextureFormat format)
+{
+	return format != TEXTURE_RGBA8;
+}
+
+unsigned int formatUnitBytes(TextureFormat format)
+{
+	switch (format)
+	{
+	case TEXTURE_BC1: case TEXTURE_BC4: return 8;
+	case TEXTURE_BC3: case TEXTURE_BC5: case TEXTURE_BC7: return 16;
+	default: return 4;
+	}
+}
+
+unsigned int levelRowCount(TextureFormat format, unsigned int height)
+{
+	return isCompressedFormat(format) ? (height + 3) / 4 : height;
+}
+
+size_t levelRowPitch(TextureFormat format, unsigned int width)
+{
+	return (size_t)(isCompressedFormat(format) ? (width + 3) / 4 : width) * formatUnitBytes(format);
+}
+
+size_t levelBytes(TextureFormat format, unsigned int width, unsigned int height)
+{
+	return levelRowPitch(format, width) * levelRowCount(format, height);
+}
+
+size_t textureBytes(const TextureData & texture, unsigned int firstLevel)
+{
+	size_t bytes = 0;
+	for (size_t l = firstLevel; l < texture.levels.size(); l++)
+		bytes += levelBytes(texture.format, texture.levels[l].width, texture.levels[l].height);
+	return bytes;
+}
+
+static unsigned int readUint(const unsigned char * p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned int fourCC(const char * code)
+{
+	return readUint((const unsigned char *)code);
+}
+
+bool decodeDds(const unsigned char * data, size_t size, TextureData & texture)
+{
+	const size_t HEADER_BYTES = 4 + 124, DX10_BYTES = 20;
+	if (size < HEADER_BYTES || readUint(data) != fourCC("DDS ") || readUint(data + 4) != 124)
+	{
+		printf("Not a DDS file\n");
+		return false;
+	}
+
+	const unsigned char * header = data + 4;
+	unsigned int height = readUint(header + 8);
+	unsigned int width = readUint(header + 12);
+	unsigned int depth = readUint(header + 20);
+	unsigned int mipCount = readUint(header + 24);
+	const unsigned char * pixelFormat = header + 72;
+	unsigned int pixelFlags = readUint(pixelFormat + 4);
+	unsigned int code = readUint(pixelFormat + 8);
+	unsigned int caps2 = readUint(header + 108);
+
+	const unsigned int DDPF_FOURCC = 0x4, DDPF_RGB = 0x40, DDSCAPS2_CUBEMAP = 0x200, DDSCAPS2_VOLUME = 0x200000;
+	if ((caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)) || depth > 1 || width == 0 || height == 0)
+	{
+		printf("Only 2D DDS textures are supported\n");
+		return false;
+	}
+
+	size_t offset = HEADER_BYTES;
+	bool known = true;
+	if (pixelFlags & DDPF_FOURCC)
+	{
+		if (code == fourCC("DXT1"))
+			texture.format = TEXTURE_BC1;
+		else if (code == fourCC("DXT5"))
+			texture.format = TEXTURE_BC3;
+		else if (code == fourCC("ATI1") || code == fourCC("BC4U"))
+			texture.format = TEXTURE_BC4;
+		else if (code == fourCC("ATI2") || code == fourCC("BC5U"))
+			texture.format = TEXTURE_BC5;
+		else if (code == fourCC("DX10") && size >= HEADER_BYTES + DX10_BYTES)
+		{
+			unsigned int dxgiFormat = readUint(data + HEADER_BYTES);
+			unsigned int arraySize = readUint(data + HEADER_BYTES + 12);
+			offset += DX10_BYTES;
+			known = arraySize <= 1;
+			switch (dxgiFormat)
+			{
+			case 28: texture.format = TEXTURE_RGBA8; break; // R8G8B8A8_UNORM
+			case 71: texture.format = TEXTURE_BC1; break;
+			case 77: texture.format = TEXTURE_BC3; break;
+			case 80: texture.format = TEXTURE_BC4; break;
+			case 83: texture.format = TEXTURE_BC5; break;
+			case 98: texture.format = TEXTURE_BC7; break;
+			default: known = false; break;
+			}
+		}
+		else
+			known = false;
+	}
+	else
+	{
+		// Only 32 bit RGBA in memory order
+		known = (pixelFlags & DDPF_RGB) && readUint(pixelFormat + 12) == 32 &&
+			readUint(pixelFormat + 16) == 0xff && readUint(pixelFormat + 20) == 0xff00 && readUint(pixelFormat + 24) == 0xff0000;
+		texture.format = TEXTURE_RGBA8;
+	}
+
+	if (!known)
+	{
+		printf("Unsupported DDS pixel format\n");
+		return false;
+	}
+
+	texture.levels.clear();
+	unsigned int levelCount = mipCount > 0 ? mipCount : 1;
+	for (unsigned int l = 0; l < levelCount && (width >> l || height >> l); l++)
+	{
+		TextureLevel level;
+		level.width = width >> l ? width >> l : 1;
+		level.height = height >> l ? height >> l : 1;
+		size_t bytes = levelBytes(texture.format, level.width, level.height);
+		if (offset + bytes > size)
+		{
+			printf("DDS mip level %u is truncated\n", l);
+			return false;
+		}
+
+		level.data.assign(data + offset, data + offset + bytes);
+		texture.levels.push_back(level);
+		offset += bytes;
+	}
+	return true;
+}
+
+static void writeUint(std::vector<unsigned char> & data, size_t offset, unsigned int value)
+{
+	for (int i = 0; i < 4; i++)
+		data[offset + i] = (unsigned char)(value >> (8 * i));
+}
+
+void encodeDds(const TextureData & texture, std::vector<unsigned char> & data)
+{
+	const size_t HEADER_BYTES = 4 + 124, DX10_BYTES = 20;
+	const unsigned int DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000, DDSD_MIPMAPCOUNT = 0x20000;
+	const unsigned int DDSD_PITCH = 0x8, DDSD_LINEARSIZE = 0x80000, DDPF_FOURCC = 0x4, DDPF_RGB = 0x40, DDPF_ALPHAPIXELS = 0x1;
+	const unsigned int DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+
+	bool dx10 = texture.format == TEXTURE_BC7;
+	size_t offset = HEADER_BYTES + (dx10 ? DX10_BYTES : 0);
+	data.assign(offset, 0);
+	if (texture.levels.empty())
+		return;
+
+	const TextureLevel & base = texture.levels[0];
+	bool compressed = isCompressedFormat(texture.format);
+	bool mipmapped = texture.levels.size() > 1;
+	writeUint(data, 0, fourCC("DDS "));
+	writeUint(data, 4, 124);
+	writeUint(data, 8, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | (mipmapped ? DDSD_MIPMAPCOUNT : 0) | (compressed ? DDSD_LINEARSIZE : DDSD_PITCH));
+	writeUint(data, 12, base.height);
+	writeUint(data, 16, base.width);
+	writeUint(data, 20, (unsigned int)(compressed ? levelBytes(texture.format, base.width, base.height) : levelRowPitch(texture.format, base.width)));
+	writeUint(data, 28, (unsigned int)texture.levels.size());
+
+	const size_t PIXEL_FORMAT = 4 + 72;
+	writeUint(data, PIXEL_FORMAT, 32);
+	if (compressed)
+	{
+		const char * codes[] = { "", "DXT1", "DXT5", "ATI1", "ATI2", "DX10" };
+		writeUint(data, PIXEL_FORMAT + 4, DDPF_FOURCC);
+		writeUint(data, PIXEL_FORMAT + 8, fourCC(codes[texture.format]));
+	}
+	else
+	{
+		writeUint(data, PIXEL_FORMAT + 4, DDPF_RGB | DDPF_ALPHAPIXELS);
+		writeUint(data, PIXEL_FORMAT + 12, 32);
+		writeUint(data, PIXEL_FORMAT + 16, 0xff);
+		writeUint(data, PIXEL_FORMAT + 20, 0xff00);
+		writeUint(data, PIXEL_FORMAT + 24, 0xff0000);
+		writeUint(data, PIXEL_FORMAT + 28, 0xff000000);
+	}
+	writeUint(data, 4 + 104, DDSCAPS_TEXTURE | (mipmapped ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+
+	if (dx10)
+	{
+		const unsigned int DXGI_FORMAT_BC7_UNORM = 98, D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+		writeUint(data, HEADER_BYTES, DXGI_FORMAT_BC7_UNORM);
+		writeUint(data, HEADER_BYTES + 4, D3D10_RESOURCE_DIMENSION_TEXTURE2D);
+		writeUint(data, HEADER_BYTES + 12, 1);
+	}
+
+	data.resize(offset + textureBytes(texture));
+	for (const TextureLevel & level : texture.levels)
+	{
+		memcpy(&data[offset], level.data.data(), level.data.size());
+		offset += level.data.size();
+	}
+}
+
+bool writeDds(const char * fileName, const TextureData & texture)
+{
+	std::vector<unsigned char> data;
+	encodeDds(texture, data);
+
+	FILE * file = fopen(fileName, "wb");
+	if (!file)
+	{
+		printf("Could not create %s\n", fileName);
+		return false;
+	}
+
+	bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+	fclose(file);
+	if (!written)
+		printf("Could not write %s\n", fileName);
+	return written;
+}
+
+static bool hasExtension(const char * fileName, const char * extension)
+{
+	size_t length = strlen(fileName), extensionLength = strlen(extension);
+	if (length < extensionLength)
+		return false;
+
+	for (size_t i = 0; i < extensionLength; i++)
+		if (tolower((unsigned char)fileName[length - extensionLength + i]) != extension[i])
+			return false;
+	return true;
+}
+
+bool loadTextureData(const char * fileName, MipFilter filter, TextureData & texture)
+{
+	if (hasExtension(fileName, ".tga"))
+	{
+		Image image;
+		if (!loadTga(fileName, image))
+			return false;
+		buildMipChain(image, filter, texture);
+		return true;
+	}
+
+	if (!hasExtension(fileName, ".dds"))
+	{
+		printf("%s: unknown texture format, expected .dds or .tga\n", fileName);
+		return false;
+	}
+
+	MappedFile file;
+	if (!file.open(fileName))
+		return false;
+
+	if (!decodeDds(file.getData(), file.getSize(), texture))
+	{
+		printf("Could not decode %s\n", fileName);
+		return false;
+	}
+	return true;
+}
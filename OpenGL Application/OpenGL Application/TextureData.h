@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+enum TextureFormat
+{
+	TEXTURE_RGBA8,
+	TEXTURE_BC1, // RGB with 1 bit alpha, 8 bytes per 4x4 block
+	TEXTURE_BC3, // RGBA, 16 bytes per block
+	TEXTURE_BC4, // R, 8 bytes per block
+	TEXTURE_BC5, // RG, 16 bytes per block
+	TEXTURE_BC7  // RGBA, 16 bytes per block
+};
+
+// Downsampling filter of generated mip chains
+enum MipFilter
+{
+	MIP_FILTER_BOX,   // 2x2 average
+	MIP_FILTER_KAISER // 8 tap Kaiser windowed sinc, sharper
+};
+
+struct TextureLevel
+{
+	unsigned int width;
+	unsigned int height;
+	std::vector<unsigned char> data;
+};
+
+// CPU side texture, every mip level from the largest down, tightly packed
+// rows of pixels or 4x4 blocks
+struct TextureData
+{
+	TextureFormat format;
+	std::vector<TextureLevel> levels;
+
+	TextureData()
+	{
+		format = TEXTURE_RGBA8;
+	}
+};
+
+bool isCompressedFormat(TextureFormat format);
+
+// Bytes per pixel for RGBA8, per 4x4 block for the block formats
+unsigned int formatUnitBytes(TextureFormat format);
+
+// Rows as stored: pixel rows, or block rows for the block formats
+unsigned int levelRowCount(TextureFormat format, unsigned int height);
+size_t levelRowPitch(TextureFormat format, unsigned int width);
+size_t levelBytes(TextureFormat format, unsigned int width, unsigned int height);
+size_t textureBytes(const TextureData & texture, unsigned int firstLevel = 0);
+
+// 2D textures from a DDS file in any of the formats above, with the DX10
+// header extension for BC7
+bool decodeDds(const unsigned char * data, size_t size, TextureData & texture);
+
+// DDS file of the texture, legacy fourCC headers for BC1-BC5 and the DX10
+// extension for BC7
+void encodeDds(const TextureData & texture, std::vector<unsigned char> & data);
+bool writeDds(const char * fileName, const TextureData & texture);
+
+// .dds files as stored, .tga files with a mip chain built by buildMipChain()
+// (see MipChain.h) using the given filter
+bool loadTextureData(const char * fileName, MipFilter filter, TextureData & texture);
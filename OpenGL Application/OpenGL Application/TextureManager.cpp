@@ -0,0 +1,363 @@
+#include "TextureManager.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+const unsigned int TextureManager::PLACEHOLDER;
+const unsigned int TextureManager::GROW_FRAMES;
+const unsigned int TextureManager::IDLE_FRAMES;
+
+TextureManager::TextureManager()
+{
+	uploadBudget = 0;
+	memoryBudget = 0;
+	usage = 0;
+	uploadedBytes = 0;
+	frame = 0;
+	placeholder = 0;
+}
+
+TextureManager::~TextureManager()
+{
+	for (Texture & texture : textures)
+		if (texture.handle)
+			glDeleteTextures(1, &texture.handle);
+	if (placeholder)
+		glDeleteTextures(1, &placeholder);
+}
+
+bool TextureManager::create(size_t stagingBytes, size_t uploadBudget, size_t memoryBudget)
+{
+	if (!staging.create(stagingBytes))
+	{
+		printf("Could not create the %zu byte texture staging ring\n", stagingBytes);
+		return false;
+	}
+	this->uploadBudget = uploadBudget;
+	this->memoryBudget = memoryBudget;
+
+	const unsigned char checker[16] = { 255, 0, 255, 255, 0, 0, 0, 255, 0, 0, 0, 255, 255, 0, 255, 255 };
+	glGenTextures(1, &placeholder);
+	glBindTexture(GL_TEXTURE_2D, placeholder);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Id 0 is the placeholder
+	Texture none;
+	none.handle = 0;
+	none.allocatedLevel = none.uploadedLevel = none.uploadedRows = 0;
+	none.lastUsed = 0;
+	none.alive = false;
+	textures.push_back(none);
+	return true;
+}
+
+bool TextureManager::isFormatSupported(TextureFormat format)
+{
+	switch (format)
+	{
+	case TEXTURE_BC1: case TEXTURE_BC3: return GLEW_EXT_texture_compression_s3tc != 0;
+	case TEXTURE_BC4: case TEXTURE_BC5: return GLEW_ARB_texture_compression_rgtc || GLEW_VERSION_3_0;
+	case TEXTURE_BC7: return GLEW_ARB_texture_compression_bptc || GLEW_VERSION_4_2;
+	default: return true;
+	}
+}
+
+GLenum TextureManager::getInternalFormat(TextureFormat format)
+{
+	switch (format)
+	{
+	case TEXTURE_BC1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case TEXTURE_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case TEXTURE_BC4: return GL_COMPRESSED_RED_RGTC1;
+	case TEXTURE_BC5: return GL_COMPRESSED_RG_RGTC2;
+	case TEXTURE_BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	default: return GL_RGBA8;
+	}
+}
+
+unsigned int TextureManager::levelCount(const Texture & texture) const
+{
+	return (unsigned int)texture.source.levels.size();
+}
+
+unsigned int TextureManager::add(TextureData & data)
+{
+	if (data.levels.empty() || !isFormatSupported(data.format))
+	{
+		printf("Texture format %d is not supported by the driver\n", (int)data.format);
+		return PLACEHOLDER;
+	}
+
+	// Levels upload a whole row at least, which must fit in the staging ring
+	if (levelRowPitch(data.format, data.levels[0].width) > staging.getSize())
+	{
+		printf("Texture rows of %u texels do not fit in the %zu byte staging ring\n", data.levels[0].width, staging.getSize());
+		return PLACEHOLDER;
+	}
+
+	unsigned int id;
+	if (!freeIds.empty())
+	{
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else
+	{
+		id = (unsigned int)textures.size();
+		textures.push_back(Texture());
+	}
+
+	Texture & texture = textures[id];
+	texture.source = TextureData();
+	std::swap(texture.source, data);
+	texture.handle = 0;
+	texture.allocatedLevel = texture.uploadedLevel = levelCount(texture);
+	texture.uploadedRows = 0;
+	texture.lastUsed = frame;
+	texture.alive = true;
+	return id;
+}
+
+void TextureManager::remove(unsigned int id)
+{
+	if (id == PLACEHOLDER || id >= textures.size() || !textures[id].alive)
+		return;
+
+	Texture & texture = textures[id];
+	if (texture.handle)
+		glDeleteTextures(1, &texture.handle);
+	usage -= textureBytes(texture.source, texture.allocatedLevel);
+	texture.source = TextureData();
+	texture.handle = 0;
+	texture.alive = false;
+	freeIds.push_back(id);
+}
+
+void TextureManager::bind(unsigned int id, GLuint unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	if (id < textures.size() && textures[id].alive)
+	{
+		Texture & texture = textures[id];
+		texture.lastUsed = frame;
+		if (texture.uploadedLevel < levelCount(texture))
+		{
+			glBindTexture(GL_TEXTURE_2D, texture.handle);
+			return;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, placeholder);
+}
+
+// Moves the texture to new storage holding levels from level down. Levels
+// both storages have are copied on the GPU when ARB_copy_image is
+// available, otherwise uploaded again from the CPU copy.
+void TextureManager::reallocate(Texture & texture, unsigned int level)
+{
+	unsigned int count = levelCount(texture);
+	GLenum internalFormat = getInternalFormat(texture.source.format);
+	GLuint handle = 0;
+
+	if (level < count)
+	{
+		const TextureLevel & top = texture.source.levels[level];
+		glGenTextures(1, &handle);
+		glBindTexture(GL_TEXTURE_2D, handle);
+		if (GLEW_ARB_texture_storage)
+			glTexStorage2D(GL_TEXTURE_2D, count - level, internalFormat, top.width, top.height);
+		else
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, count - level - 1);
+			for (unsigned int l = level; l < count; l++)
+			{
+				const TextureLevel & storage = texture.source.levels[l];
+				if (isCompressedFormat(texture.source.format))
+					glCompressedTexImage2D(GL_TEXTURE_2D, l - level, internalFormat, storage.width, storage.height, 0,
+						(GLsizei)storage.data.size(), nullptr);
+				else
+					glTexImage2D(GL_TEXTURE_2D, l - level, internalFormat, storage.width, storage.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			}
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// Complete levels of the old storage carry over, a partly uploaded one starts again
+		unsigned int keep = std::max(texture.uploadedLevel, level);
+		for (unsigned int l = keep; l < count && texture.handle; l++)
+		{
+			const TextureLevel & copy = texture.source.levels[l];
+			if (GLEW_ARB_copy_image)
+				glCopyImageSubData(texture.handle, GL_TEXTURE_2D, l - texture.allocatedLevel, 0, 0, 0,
+					handle, GL_TEXTURE_2D, l - level, 0, 0, 0, copy.width, copy.height, 1);
+			else if (isCompressedFormat(texture.source.format))
+				glCompressedTexSubImage2D(GL_TEXTURE_2D, l - level, 0, 0, copy.width, copy.height, internalFormat,
+					(GLsizei)copy.data.size(), copy.data.data());
+			else
+				glTexSubImage2D(GL_TEXTURE_2D, l - level, 0, 0, copy.width, copy.height, GL_RGBA, GL_UNSIGNED_BYTE, copy.data.data());
+		}
+		texture.uploadedLevel = texture.handle ? keep : count;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, std::min(texture.uploadedLevel, count - 1) - level);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	else
+		texture.uploadedLevel = count;
+
+	if (texture.handle)
+		glDeleteTextures(1, &texture.handle);
+
+	usage -= textureBytes(texture.source, texture.allocatedLevel);
+	usage += textureBytes(texture.source, level);
+	texture.handle = handle;
+	texture.allocatedLevel = level;
+	texture.uploadedRows = 0;
+}
+
+// Drops the largest level of idle textures, least recently bound first,
+// until bytes more fit in the budget. Every texture keeps its 1x1 level.
+bool TextureManager::evictFor(size_t bytes, unsigned long long olderThan)
+{
+	while (usage + bytes > memoryBudget)
+	{
+		Texture * victim = nullptr;
+		for (Texture & texture : textures)
+			if (texture.alive && texture.lastUsed < olderThan && texture.allocatedLevel + 1 < levelCount(texture) &&
+				(!victim || texture.lastUsed < victim->lastUsed))
+				victim = &texture;
+
+		if (!victim)
+			return false;
+		reallocate(*victim, victim->allocatedLevel + 1);
+	}
+	return true;
+}
+
+// Uploads rows of the next missing level and returns the bytes written. The
+// first upload of a frame may exceed the budget by one row.
+size_t TextureManager::uploadSome(Texture & texture, size_t budget)
+{
+	unsigned int l = texture.uploadedLevel - 1;
+	const TextureLevel & level = texture.source.levels[l];
+	TextureFormat format = texture.source.format;
+	size_t rowPitch = levelRowPitch(format, level.width);
+	unsigned int rowCount = levelRowCount(format, level.height);
+
+	size_t rows = std::min<size_t>(rowCount - texture.uploadedRows, std::min(budget, staging.getSize() / 4) / rowPitch);
+	if (rows == 0 && budget == uploadBudget)
+		rows = 1;
+
+	size_t bytes = rows * rowPitch, offset;
+	if (bytes == 0 || !staging.allocate(bytes, offset))
+		return 0;
+
+	void * mapped = staging.map(offset, bytes);
+	memcpy(mapped, &level.data[texture.uploadedRows * rowPitch], bytes);
+	staging.unmap();
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.getBuffer());
+	glBindTexture(GL_TEXTURE_2D, texture.handle);
+	GLint target = l - texture.allocatedLevel;
+	if (isCompressedFormat(format))
+	{
+		GLint y = texture.uploadedRows * 4;
+		GLsizei height = std::min((GLsizei)rows * 4, (GLsizei)level.height - y);
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, target, 0, y, level.width, height, getInternalFormat(format), (GLsizei)bytes, (const void *)offset);
+	}
+	else
+	{
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexSubImage2D(GL_TEXTURE_2D, target, 0, texture.uploadedRows, level.width, (GLsizei)rows, GL_RGBA, GL_UNSIGNED_BYTE, (const void *)offset);
+	}
+
+	texture.uploadedRows += (unsigned int)rows;
+	if (texture.uploadedRows == rowCount)
+	{
+		texture.uploadedLevel = l;
+		texture.uploadedRows = 0;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, l - texture.allocatedLevel);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return bytes;
+}
+
+void TextureManager::update()
+{
+	// Most recently bound first
+	std::vector<Texture *> order;
+	for (Texture & texture : textures)
+		if (texture.alive)
+			order.push_back(&texture);
+	std::stable_sort(order.begin(), order.end(), [](const Texture * a, const Texture * b) { return a->lastUsed > b->lastUsed; });
+
+	// A lowered budget, or textures added without room
+	evictFor(0, frame + 1);
+
+	// Recently bound textures grow one level per frame. Levels are only
+	// taken from textures that have been idle for IDLE_FRAMES and were bound
+	// before the growing one, so two textures in use never trade levels.
+	unsigned long long idleBefore = frame + 1 >= IDLE_FRAMES ? frame + 1 - IDLE_FRAMES : 0;
+	for (Texture * texture : order)
+	{
+		if (texture->allocatedLevel == 0 || texture->lastUsed + GROW_FRAMES < frame)
+			continue;
+
+		size_t growth = textureBytes(texture->source, texture->allocatedLevel - 1) - textureBytes(texture->source, texture->allocatedLevel);
+		unsigned long long boundBefore = texture->lastUsed + 1 >= IDLE_FRAMES ? texture->lastUsed + 1 - IDLE_FRAMES : 0;
+		if (usage + growth <= memoryBudget || evictFor(growth, std::min(idleBefore, boundBefore)))
+			reallocate(*texture, texture->allocatedLevel - 1);
+	}
+
+	size_t budget = uploadBudget;
+	uploadedBytes = 0;
+	for (Texture * texture : order)
+	{
+		while (budget > 0 && texture->uploadedLevel > texture->allocatedLevel)
+		{
+			size_t bytes = uploadSome(*texture, budget);
+			if (bytes == 0)
+				break;
+			uploadedBytes += bytes;
+			budget -= std::min(bytes, budget);
+		}
+		if (budget == 0)
+			break;
+	}
+
+	staging.endFrame();
+	frame++;
+}
+
+void TextureManager::setMemoryBudget(size_t bytes)
+{
+	memoryBudget = bytes;
+}
+
+size_t TextureManager::getMemoryBudget() const
+{
+	return memoryBudget;
+}
+
+size_t TextureManager::getMemoryUsage() const
+{
+	return usage;
+}
+
+size_t TextureManager::getUploadedBytes() const
+{
+	return uploadedBytes;
+}
+
+unsigned int TextureManager::getResidentLevel(unsigned int id) const
+{
+	if (id >= textures.size() || !textures[id].alive)
+		return 0;
+	return textures[id].uploadedLevel;
+}
+
+bool TextureManager::isComplete(unsigned int id) const
+{
+	return id < textures.size() && textures[id].alive && textures[id].uploadedLevel == 0;
+}
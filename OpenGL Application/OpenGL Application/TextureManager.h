@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <glew.h>
+#include "TextureData.h"
+#include "StagingRing.h"
+
+// Owns every texture and keeps their GPU memory within a budget. Textures
+// keep their CPU side levels; on the GPU each one holds storage for its
+// levels from allocatedLevel down to 1x1, filled smallest level first
+// through a StagingRing with at most uploadBudget bytes per frame.
+// GL_TEXTURE_BASE_LEVEL hides the levels still missing, so a texture
+// sharpens as it streams in.
+//
+// When a recently bound texture could use more levels than fit, the largest
+// levels of the least recently bound textures are evicted to make room. A
+// lowered budget is met the same way. Ids stay valid across the
+// reallocations this needs, the GL names do not, so textures are always
+// bound through bind().
+class TextureManager
+{
+private:
+	struct Texture
+	{
+		TextureData source;
+		GLuint handle;
+		unsigned int allocatedLevel; // levelCount while nothing is allocated
+		unsigned int uploadedLevel; // largest complete level, levelCount while none are
+		unsigned int uploadedRows; // of level uploadedLevel - 1
+		unsigned long long lastUsed;
+		bool alive;
+	};
+
+	std::vector<Texture> textures;
+	std::vector<unsigned int> freeIds;
+	StagingRing staging;
+	size_t uploadBudget;
+	size_t memoryBudget;
+	size_t usage;
+	size_t uploadedBytes;
+	unsigned long long frame;
+	GLuint placeholder;
+
+	unsigned int levelCount(const Texture & texture) const;
+	void reallocate(Texture & texture, unsigned int level);
+	bool evictFor(size_t bytes, unsigned long long olderThan);
+	size_t uploadSome(Texture & texture, size_t budget);
+public:
+	static const unsigned int PLACEHOLDER = 0; // magenta and black checkerboard
+	static const unsigned int GROW_FRAMES = 60; // textures bound this recently get more levels
+	static const unsigned int IDLE_FRAMES = 2; // textures unbound this long may lose levels
+
+	TextureManager();
+	~TextureManager();
+	bool create(size_t stagingBytes, size_t uploadBudget, size_t memoryBudget);
+
+	// Takes the levels out of data, returns PLACEHOLDER if the format is not
+	// supported by the driver or a row does not fit in the staging ring
+	unsigned int add(TextureData & data);
+	void remove(unsigned int id);
+	void bind(unsigned int id, GLuint unit);
+
+	// Once per frame: evicts, allocates and uploads
+	void update();
+
+	void setMemoryBudget(size_t bytes);
+	size_t getMemoryBudget() const;
+	size_t getMemoryUsage() const;
+	size_t getUploadedBytes() const; // by the last update()
+	unsigned int getResidentLevel(unsigned int id) const; // largest level that can be sampled
+	bool isComplete(unsigned int id) const;
+
+	static bool isFormatSupported(TextureFormat format);
+	static GLenum getInternalFormat(TextureFormat format);
+};
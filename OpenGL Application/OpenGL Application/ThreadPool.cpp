@@ -0,0 +1,129 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+struct ParallelForState
+{
+	std::atomic<size_t> nextChunk;
+	std::atomic<size_t> chunksDone;
+	size_t chunkCount;
+	size_t count;
+	size_t grain;
+	const std::function<void(size_t, size_t)> * body;
+	std::mutex mutex;
+	std::condition_variable finished;
+
+	// Runs chunks until none are left, returns once the last chunk this thread took is done
+	void work()
+	{
+		size_t chunk;
+		while ((chunk = nextChunk++) < chunkCount)
+		{
+			size_t begin = chunk * grain;
+			(*body)(begin, std::min(begin + grain, count));
+
+			if (++chunksDone == chunkCount)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				finished.notify_all();
+			}
+		}
+	}
+};
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	stopping = false;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+
+	for (std::thread & worker : workers)
+		worker.join();
+}
+
+// Shared pool sized to leave one core for the calling (render) thread
+ThreadPool & ThreadPool::instance()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::workerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	condition.notify_one();
+}
+
+// Splits [0, count) into chunks of at most grain items. The calling thread
+// works on chunks too, so nested calls from inside a task cannot deadlock.
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> & body)
+{
+	if (count == 0)
+		return;
+
+	grain = std::max<size_t>(grain, 1);
+	size_t chunkCount = (count + grain - 1) / grain;
+
+	if (chunkCount == 1 || workers.empty())
+	{
+		for (size_t begin = 0; begin < count; begin += grain)
+			body(begin, std::min(begin + grain, count));
+		return;
+	}
+
+	std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+	state->nextChunk = 0;
+	state->chunksDone = 0;
+	state->chunkCount = chunkCount;
+	state->count = count;
+	state->grain = grain;
+	state->body = &body;
+
+	size_t helpers = std::min(workers.size(), chunkCount - 1);
+	for (size_t i = 0; i < helpers; i++)
+		submit([state] { state->work(); });
+
+	state->work();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state] { return state->chunksDone == state->chunkCount; });
+}
+
+unsigned int ThreadPool::getThreadCount() const
+{
+	return (unsigned int)workers.size() + 1;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool
+{
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping;
+
+	void workerLoop();
+public:
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+	static ThreadPool & instance();
+	void submit(std::function<void()> task);
+	void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> & body);
+	unsigned int getThreadCount() const;
+};
@@ -0,0 +1,207 @@
+#include "TransformHierarchy.h"
+#include <cstring>
+#include "ThreadPool.h"
+
+// Nodes per parallelFor chunk, and the largest run of dirty nodes composed at once
+static const size_t PARALLEL_GRAIN = 4096;
+static const size_t BATCH_SIZE = 64;
+
+const unsigned int TransformHierarchy::NO_PARENT;
+
+TransformHierarchy::TransformHierarchy()
+{
+	levelStarts.push_back(0);
+	needsSort = false;
+}
+
+unsigned int TransformHierarchy::createNode(unsigned int parent)
+{
+	unsigned int handle = (unsigned int)slots.size();
+	unsigned int slot = (unsigned int)handles.size();
+	unsigned int depth = parent == NO_PARENT ? 0 : depths[parent] + 1;
+
+	translations.resize(slot + 1);
+	rotations.resize(slot + 1);
+	scales.resize(slot + 1);
+	translations.set(slot, glm::vec3(0.0f));
+	rotations.set(slot, glm::quat());
+	scales.set(slot, glm::vec3(1.0f));
+	worlds.push_back(glm::mat4(1.0f));
+	parents.push_back(parent == NO_PARENT ? NO_PARENT : slots[parent]);
+	dirty.push_back(1);
+	handles.push_back(handle);
+	slots.push_back(slot);
+	depths.push_back(depth);
+
+	// Appending at the deepest level, or starting the next one, keeps the
+	// arrays in depth order. Anything else waits for a sort in update().
+	unsigned int levelCount = (unsigned int)levelStarts.size() - 1;
+	if (!needsSort && levelCount > 0 && depth == levelCount - 1)
+		levelStarts.back()++;
+	else if (!needsSort && depth == levelCount)
+		levelStarts.push_back(slot + 1);
+	else
+		needsSort = true;
+
+	return handle;
+}
+
+void TransformHierarchy::setTranslation(unsigned int node, const glm::vec3 & translation)
+{
+	translations.set(slots[node], translation);
+	dirty[slots[node]] = 1;
+}
+
+void TransformHierarchy::setRotation(unsigned int node, const glm::quat & rotation)
+{
+	rotations.set(slots[node], rotation);
+	dirty[slots[node]] = 1;
+}
+
+void TransformHierarchy::setScale(unsigned int node, const glm::vec3 & scale)
+{
+	scales.set(slots[node], scale);
+	dirty[slots[node]] = 1;
+}
+
+glm::vec3 TransformHierarchy::getTranslation(unsigned int node) const
+{
+	return translations.get(slots[node]);
+}
+
+glm::quat TransformHierarchy::getRotation(unsigned int node) const
+{
+	return rotations.get(slots[node]);
+}
+
+glm::vec3 TransformHierarchy::getScale(unsigned int node) const
+{
+	return scales.get(slots[node]);
+}
+
+const glm::mat4 & TransformHierarchy::getWorldMatrix(unsigned int node) const
+{
+	return worlds[slots[node]];
+}
+
+unsigned int TransformHierarchy::getNodeCount() const
+{
+	return (unsigned int)handles.size();
+}
+
+unsigned int TransformHierarchy::getLevelCount() const
+{
+	return (unsigned int)levelStarts.size() - 1;
+}
+
+template <typename T>
+static void permute(std::vector<T> & values, const std::vector<unsigned int> & newSlots)
+{
+	std::vector<T> sorted(values.size());
+	for (size_t i = 0; i < values.size(); i++)
+		sorted[newSlots[i]] = values[i];
+	values.swap(sorted);
+}
+
+// Stable counting sort of the slots by depth
+void TransformHierarchy::sort()
+{
+	size_t count = handles.size();
+
+	unsigned int levelCount = 0;
+	for (size_t h = 0; h < count; h++)
+		levelCount = glm::max(levelCount, depths[h] + 1);
+
+	levelStarts.assign(levelCount + 1, 0);
+	for (size_t h = 0; h < count; h++)
+		levelStarts[depths[h] + 1]++;
+	for (unsigned int l = 0; l < levelCount; l++)
+		levelStarts[l + 1] += levelStarts[l];
+
+	std::vector<unsigned int> cursors(levelStarts.begin(), levelStarts.end() - 1);
+	std::vector<unsigned int> newSlots(count);
+	for (size_t i = 0; i < count; i++)
+		newSlots[i] = cursors[depths[handles[i]]]++;
+
+	for (size_t i = 0; i < count; i++)
+		if (parents[i] != NO_PARENT)
+			parents[i] = newSlots[parents[i]];
+
+	permute(translations.x, newSlots); permute(translations.y, newSlots); permute(translations.z, newSlots);
+	permute(rotations.x, newSlots); permute(rotations.y, newSlots); permute(rotations.z, newSlots); permute(rotations.w, newSlots);
+	permute(scales.x, newSlots); permute(scales.y, newSlots); permute(scales.z, newSlots);
+	permute(worlds, newSlots);
+	permute(parents, newSlots);
+	permute(dirty, newSlots);
+	permute(handles, newSlots);
+
+	for (size_t i = 0; i < count; i++)
+		slots[handles[i]] = (unsigned int)i;
+
+	needsSort = false;
+}
+
+// Nodes of one level. Parents were finished with the previous level, so a
+// node is dirty if it was changed or its parent was recomputed.
+void TransformHierarchy::updateRange(size_t begin, size_t end)
+{
+	glm::mat4 locals[BATCH_SIZE];
+
+	auto propagate = [&](size_t i)
+	{
+		if (!dirty[i] && parents[i] != NO_PARENT && dirty[parents[i]])
+			dirty[i] = 1;
+		return dirty[i] != 0;
+	};
+
+	size_t i = begin;
+	while (i < end)
+	{
+		if (!propagate(i))
+		{
+			i++;
+			continue;
+		}
+
+		size_t runEnd = i + 1;
+		while (runEnd < end && runEnd - i < BATCH_SIZE && propagate(runEnd))
+			runEnd++;
+
+		if (parents[i] == NO_PARENT)
+			composeMatrices(translations, rotations, scales, &worlds[i], i, runEnd);
+		else
+		{
+			composeMatrices(translations, rotations, scales, locals, i, runEnd);
+			multiplyMatrices(worlds.data(), &parents[i], locals, &worlds[i], runEnd - i);
+		}
+		i = runEnd;
+	}
+}
+
+void TransformHierarchy::update(bool parallel)
+{
+	if (needsSort)
+		sort();
+
+	unsigned int levelCount = getLevelCount();
+	for (unsigned int l = 0; l < levelCount; l++)
+	{
+		size_t begin = levelStarts[l], end = levelStarts[l + 1];
+		if (parallel && end - begin > PARALLEL_GRAIN)
+		{
+			ThreadPool::instance().parallelFor(end - begin, PARALLEL_GRAIN, [&](size_t first, size_t last)
+			{
+				updateRange(begin + first, begin + last);
+			});
+		}
+		else
+			updateRange(begin, end);
+
+		// The flags of a level are only read by the next one
+		if (l > 0)
+			memset(&dirty[levelStarts[l - 1]], 0, begin - levelStarts[l - 1]);
+	}
+
+	if (levelCount > 0)
+		memset(&dirty[levelStarts[levelCount - 1]], 0, levelStarts[levelCount] - levelStarts[levelCount - 1]);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <glm.hpp>
+#include <gtc/quaternion.hpp>
+#include "MatrixBatch.h"
+
+// Scene graph transforms. Local translation, rotation and scale and the
+// world matrices live in contiguous arrays sorted by depth, so every parent
+// is stored before its children and update() is one linear pass, level by
+// level, that only recomputes nodes which were changed or have a changed
+// ancestor. Nodes are addressed by handles that stay valid when the arrays
+// are re-sorted.
+class TransformHierarchy
+{
+private:
+	// Indexed by slot (position in depth order)
+	Vec3Array translations;
+	QuatArray rotations;
+	Vec3Array scales;
+	std::vector<glm::mat4> worlds;
+	std::vector<unsigned int> parents; // slot of the parent, NO_PARENT for roots
+	std::vector<unsigned char> dirty;
+	std::vector<unsigned int> handles; // slot -> handle
+
+	// Indexed by handle
+	std::vector<unsigned int> slots;
+	std::vector<unsigned int> depths;
+
+	std::vector<unsigned int> levelStarts; // first slot of each depth, plus the node count
+	bool needsSort;
+
+	void sort();
+	void updateRange(size_t begin, size_t end);
+public:
+	static const unsigned int NO_PARENT = 0xffffffff;
+
+	TransformHierarchy();
+	unsigned int createNode(unsigned int parent = NO_PARENT);
+	void setTranslation(unsigned int node, const glm::vec3 & translation);
+	void setRotation(unsigned int node, const glm::quat & rotation);
+	void setScale(unsigned int node, const glm::vec3 & scale);
+	glm::vec3 getTranslation(unsigned int node) const;
+	glm::quat getRotation(unsigned int node) const;
+	glm::vec3 getScale(unsigned int node) const;
+
+	// Valid after update()
+	const glm::mat4 & getWorldMatrix(unsigned int node) const;
+
+	// Recomputes the world matrices of dirty subtrees. With parallel set,
+	// the nodes of each level are spread over the shared ThreadPool.
+	void update(bool parallel = false);
+	unsigned int getNodeCount() const;
+	unsigned int getLevelCount() const;
+};
@@ -0,0 +1,92 @@
+#include "Y4mWriter.h"
+#include <algorithm>
+
+Y4mWriter::Y4mWriter()
+{
+	file = nullptr;
+	width = 0;
+	height = 0;
+	frameCount = 0;
+}
+
+Y4mWriter::~Y4mWriter()
+{
+	close();
+}
+
+bool Y4mWriter::open(const char * fileName, unsigned int width, unsigned int height, unsigned int framesPerSecond)
+{
+	close();
+
+	file = fopen(fileName, "wb");
+	if (!file)
+	{
+		printf("Could not create %s\n", fileName);
+		return false;
+	}
+
+	this->width = width;
+	this->height = height;
+	frameCount = 0;
+	planes.resize((size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2));
+	fprintf(file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, framesPerSecond);
+	return true;
+}
+
+void Y4mWriter::close()
+{
+	if (file)
+		fclose(file);
+	file = nullptr;
+}
+
+bool Y4mWriter::writeFrame(const Image & frame)
+{
+	if (!file || frame.width != width || frame.height != height)
+		return false;
+
+	// Luma per pixel, chroma from the average of each 2x2 block
+	unsigned int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+	unsigned char * luma = planes.data();
+	unsigned char * blue = luma + (size_t)width * height;
+	unsigned char * red = blue + (size_t)chromaWidth * chromaHeight;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const unsigned char * rgba = &frame.pixels[(size_t)y * width * 4];
+		for (unsigned int x = 0; x < width; x++, rgba += 4)
+			luma[(size_t)y * width + x] = (unsigned char)(((66 * rgba[0] + 129 * rgba[1] + 25 * rgba[2] + 128) >> 8) + 16);
+	}
+
+	for (unsigned int y = 0; y < chromaHeight; y++)
+	{
+		const unsigned char * row0 = &frame.pixels[(size_t)(2 * y) * width * 4];
+		const unsigned char * row1 = &frame.pixels[(size_t)std::min(2 * y + 1, height - 1) * width * 4];
+		for (unsigned int x = 0; x < chromaWidth; x++)
+		{
+			unsigned int x0 = 2 * x * 4, x1 = std::min(2 * x + 1, width - 1) * 4;
+			int r = (row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2;
+			int g = (row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1] + 2) >> 2;
+			int b = (row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2] + 2) >> 2;
+			blue[(size_t)y * chromaWidth + x] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			red[(size_t)y * chromaWidth + x] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+
+	if (fputs("FRAME\n", file) < 0 || fwrite(planes.data(), 1, planes.size(), file) != planes.size())
+	{
+		printf("Could not write video frame %u\n", frameCount);
+		return false;
+	}
+	frameCount++;
+	return true;
+}
+
+bool Y4mWriter::isOpen() const
+{
+	return file != nullptr;
+}
+
+unsigned int Y4mWriter::getFrameCount() const
+{
+	return frameCount;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+#include "Image.h"
+
+// YUV4MPEG2 video, which most encoders and players read directly. RGBA
+// frames are converted to 4:2:0 with BT.601 studio range coefficients.
+class Y4mWriter
+{
+private:
+	FILE * file;
+	unsigned int width;
+	unsigned int height;
+	unsigned int frameCount;
+	std::vector<unsigned char> planes;
+public:
+	Y4mWriter();
+	~Y4mWriter();
+	bool open(const char * fileName, unsigned int width, unsigned int height, unsigned int framesPerSecond);
+	void close();
+
+	// Frames must match the size given to open(), rows top to bottom
+	bool writeFrame(const Image & frame);
+
+	bool isOpen() const;
+	unsigned int getFrameCount() const;
+};
@@ -0,0 +1,42 @@
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (binding = 0) uniform sampler2D source;
+layout (r11f_g11f_b10f, binding = 0) writeonly uniform image2D destination;
+
+uniform float exposure;
+uniform float threshold;
+uniform float tap_offset; // source texels, a quarter of the downsampling
+
+// Brightness above the threshold, easing in over a knee below it
+vec3 bright_part(vec3 color) {
+	float knee = 0.5 * threshold;
+	float brightness = max(color.r, max(color.g, color.b));
+	float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+	soft = soft * soft / (4.0 * knee + 1e-4);
+	return color * max(soft, brightness - threshold) / max(brightness, 1e-4);
+}
+
+void main() {
+	ivec2 position = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(destination);
+	if (any(greaterThanEqual(position, size)))
+		return;
+
+	// Four bilinear taps average the 2x2 or 4x4 source texels under the
+	// destination texel. Each tap is weighted down by its brightness so a
+	// single very bright texel does not flicker as it moves.
+	vec2 texel = 1.0 / vec2(textureSize(source, 0));
+	vec2 center = (vec2(position) + 0.5) / vec2(size);
+	vec3 sum = vec3(0.0);
+	float weights = 0.0;
+	for (int i = 0; i < 4; i++) {
+		vec2 offset = vec2(i & 1, i >> 1) * 2.0 - 1.0;
+		vec3 color = bright_part(exposure * texture(source, center + offset * tap_offset * texel).rgb);
+		float weight = 1.0 / (1.0 + max(color.r, max(color.g, color.b)));
+		sum += color * weight;
+		weights += weight;
+	}
+	imageStore(destination, position, vec4(sum / weights, 1.0));
+}
@@ -0,0 +1,41 @@
+#version 430 core
+
+// One workgroup blurs a run of 128 texels of a row or column
+layout (local_size_x = 128) in;
+
+const int RADIUS = 8;
+const int LINE_SIZE = 128 + 2 * RADIUS;
+
+// Gaussian of sigma 4, normalized over the 17 taps
+const float WEIGHTS[RADIUS + 1] = float[](0.103153, 0.099979, 0.091032, 0.077864, 0.062565, 0.047227, 0.033489, 0.022308, 0.013960);
+
+layout (binding = 0) uniform sampler2D source;
+layout (r11f_g11f_b10f, binding = 0) writeonly uniform image2D destination;
+
+uniform bool horizontal;
+
+// The run and its apron, each texel fetched once rather than once per tap
+shared vec3 line[LINE_SIZE];
+
+void main() {
+	ivec2 size = textureSize(source, 0);
+	int length = horizontal ? size.x : size.y;
+	int across = int(gl_WorkGroupID.y);
+	int first = int(gl_WorkGroupID.x) * 128 - RADIUS;
+
+	for (int i = int(gl_LocalInvocationID.x); i < LINE_SIZE; i += 128) {
+		int along = clamp(first + i, 0, length - 1);
+		line[i] = texelFetch(source, horizontal ? ivec2(along, across) : ivec2(across, along), 0).rgb;
+	}
+	barrier();
+
+	int along = first + RADIUS + int(gl_LocalInvocationID.x);
+	if (along >= length)
+		return;
+
+	int center = int(gl_LocalInvocationID.x) + RADIUS;
+	vec3 sum = line[center] * WEIGHTS[0];
+	for (int i = 1; i <= RADIUS; i++)
+		sum += (line[center - i] + line[center + i]) * WEIGHTS[i];
+	imageStore(destination, horizontal ? ivec2(along, across) : ivec2(across, along), vec4(sum, 1.0));
+}
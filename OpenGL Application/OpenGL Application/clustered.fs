@@ -0,0 +1,80 @@
+#version 330 core
+
+in vec3 view_position;
+in vec2 texture_coordinate;
+
+out vec4 frag_color;
+
+// Written by ClusteredLighting: two texels per light, view space position
+// and radius then color; first index and count per cluster; light indices
+uniform samplerBuffer light_data;
+uniform usamplerBuffer cluster_data;
+uniform usamplerBuffer light_indices;
+
+uniform vec3 cluster_count; // tiles across, tiles up, depth slices
+uniform vec3 cluster_scale; // tiles per pixel across and up, slices per log depth
+uniform float cluster_bias;
+
+#ifdef SHADOWS
+// Written by CascadedShadowMaps, as in shadowed.fs
+uniform sampler2DArrayShadow shadow_maps;
+uniform mat4 shadow_matrices[4];
+uniform vec4 cascade_splits;
+uniform vec3 light_direction; // view space, towards the light
+
+const vec3 SUN_COLOR = vec3(0.8);
+
+// 3x3 taps of bilinear filtered comparisons
+float shadow(int cascade) {
+	vec4 coord = shadow_matrices[cascade] * vec4(view_position, 1.0);
+	vec2 texel = 1.0 / vec2(textureSize(shadow_maps, 0).xy);
+	float lit = 0.0;
+	for (int y = -1; y <= 1; y++)
+		for (int x = -1; x <= 1; x++)
+			lit += texture(shadow_maps, vec4(coord.xy + vec2(x, y) * texel, float(cascade), coord.z));
+	return lit / 9.0;
+}
+#endif
+
+// The --texture texture, ALBEDO when there is none
+uniform sampler2D albedo_texture;
+uniform bool textured;
+
+const vec3 ALBEDO = vec3(1.0, 0.0, 1.0);
+const vec3 AMBIENT = vec3(0.05);
+
+void main() {
+	// Facing the camera from either side
+	vec3 normal = normalize(cross(dFdx(view_position), dFdy(view_position)));
+	if (dot(normal, view_position) > 0.0)
+		normal = -normal;
+
+	vec3 cluster = vec3(gl_FragCoord.xy * cluster_scale.xy, log(-view_position.z) * cluster_scale.z - cluster_bias);
+	ivec3 cell = ivec3(clamp(floor(cluster), vec3(0.0), cluster_count - 1.0));
+	int index = (cell.z * int(cluster_count.y) + cell.y) * int(cluster_count.x) + cell.x;
+	uvec2 range = texelFetch(cluster_data, index).xy;
+
+	vec3 light = AMBIENT;
+#ifdef SHADOWS
+	// The sun, beyond the last cascade unshadowed
+	int cascade = int(dot(vec4(greaterThan(vec4(-view_position.z), cascade_splits)), vec4(1.0)));
+	float lit = cascade < 4 ? shadow(cascade) : 1.0;
+	light += SUN_COLOR * max(dot(normal, light_direction), 0.0) * lit;
+#endif
+	for (uint i = 0u; i < range.y; i++) {
+		int light_index = int(texelFetch(light_indices, int(range.x + i)).r);
+		vec4 position_radius = texelFetch(light_data, 2 * light_index);
+		vec3 color = texelFetch(light_data, 2 * light_index + 1).rgb;
+
+		// Inverse square falloff windowed to reach zero at the radius
+		vec3 to_light = position_radius.xyz - view_position;
+		float distance_squared = dot(to_light, to_light);
+		float ratio = distance_squared / (position_radius.w * position_radius.w);
+		float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+		float attenuation = window * window / (distance_squared + 1.0);
+		light += color * attenuation * max(dot(normal, to_light * inversesqrt(distance_squared)), 0.0);
+	}
+
+	vec3 albedo = textured ? texture(albedo_texture, texture_coordinate).rgb : ALBEDO;
+	frag_color = vec4(albedo * light, 1.0);
+}
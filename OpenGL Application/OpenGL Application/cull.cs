@@ -0,0 +1,103 @@
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+struct Object {
+	mat4 model;
+	vec4 bounds_min;
+	vec4 bounds_max;
+	uint index_count;
+	uint first_index;
+	int base_vertex;
+	uint padding;
+};
+
+struct DrawCommand {
+	uint count;
+	uint instance_count;
+	uint first_index;
+	int base_vertex;
+	uint base_instance;
+};
+
+layout (std430, binding = 0) readonly buffer Objects {
+	Object objects[];
+};
+
+layout (std430, binding = 1) writeonly buffer Commands {
+	DrawCommand commands[];
+};
+
+layout (std430, binding = 2) buffer DrawCount {
+	uint draw_count;
+};
+
+// Farthest window depth, level 0 the size of the depth buffer
+layout (binding = 0) uniform sampler2D hiz;
+
+// Boxes whose nearest point is the rendered depth, such as the faces of the
+// occluders themselves, are kept despite depth buffer rounding
+const float DEPTH_BIAS = 1e-6;
+
+uniform int object_count;
+uniform mat4 view_projection;
+uniform mat4 hiz_view_projection;
+uniform bool hiz_enabled;
+
+bool insideFrustum(mat4 model_view_projection, vec3 bounds_min, vec3 bounds_max) {
+	// Outside when all 8 corners are beyond the same clip plane
+	vec3 below = vec3(0.0), above = vec3(0.0);
+	for (int i = 0; i < 8; i++) {
+		vec3 corner = mix(bounds_min, bounds_max, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+		vec4 clip = model_view_projection * vec4(corner, 1.0);
+		below += vec3(lessThan(clip.xyz, vec3(-clip.w)));
+		above += vec3(greaterThan(clip.xyz, vec3(clip.w)));
+	}
+	return all(lessThan(below, vec3(8.0))) && all(lessThan(above, vec3(8.0)));
+}
+
+bool passesHiZ(mat4 model_view_projection, vec3 bounds_min, vec3 bounds_max) {
+	vec3 window_min = vec3(1.0), window_max = vec3(0.0);
+	for (int i = 0; i < 8; i++) {
+		vec3 corner = mix(bounds_min, bounds_max, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+		vec4 clip = model_view_projection * vec4(corner, 1.0);
+		// Crossing the near plane, the projected rectangle is unbounded
+		if (clip.w <= 0.0)
+			return true;
+		vec3 window = clip.xyz / clip.w * 0.5 + 0.5;
+		window_min = min(window_min, window);
+		window_max = max(window_max, window);
+	}
+	window_min = clamp(window_min, 0.0, 1.0);
+	window_max = clamp(window_max, 0.0, 1.0);
+
+	// The level where the rectangle spans at most 2x2 texels
+	ivec2 size = textureSize(hiz, 0);
+	vec2 extent = (window_max.xy - window_min.xy) * vec2(size);
+	int level = int(ceil(log2(max(max(extent.x, extent.y), 1.0))));
+	level = min(level, textureQueryLevels(hiz) - 1);
+
+	ivec2 level_size = textureSize(hiz, level);
+	ivec2 texel_min = clamp(ivec2(window_min.xy * vec2(level_size)), ivec2(0), level_size - 1);
+	ivec2 texel_max = clamp(ivec2(window_max.xy * vec2(level_size)), ivec2(0), level_size - 1);
+	float farthest = max(
+		max(texelFetch(hiz, texel_min, level).r, texelFetch(hiz, ivec2(texel_max.x, texel_min.y), level).r),
+		max(texelFetch(hiz, ivec2(texel_min.x, texel_max.y), level).r, texelFetch(hiz, texel_max, level).r));
+	return window_min.z <= farthest + DEPTH_BIAS;
+}
+
+void main() {
+	int index = int(gl_GlobalInvocationID.x);
+	if (index >= object_count)
+		return;
+
+	Object object = objects[index];
+	vec3 bounds_min = object.bounds_min.xyz, bounds_max = object.bounds_max.xyz;
+	if (!insideFrustum(view_projection * object.model, bounds_min, bounds_max))
+		return;
+	if (hiz_enabled && !passesHiZ(hiz_view_projection * object.model, bounds_min, bounds_max))
+		return;
+
+	uint slot = atomicAdd(draw_count, 1u);
+	commands[slot] = DrawCommand(object.index_count, 1u, object.first_index, object.base_vertex, uint(index));
+}
@@ -0,0 +1,30 @@
+#version 430 core
+
+layout (location = 0) in vec3 vertex_position;
+// Base instance of the draw command, the index of its object
+layout (location = 3) in uint object_id;
+
+struct Object {
+	mat4 model;
+	vec4 bounds_min;
+	vec4 bounds_max;
+	uint index_count;
+	uint first_index;
+	int base_vertex;
+	uint padding;
+};
+
+layout (std430, binding = 0) readonly buffer Objects {
+	Object objects[];
+};
+
+uniform mat4 view_matrix;
+uniform mat4 projection_matrix;
+
+// Planar across the unit cube, for the fragment shader it shares
+out vec2 texture_coordinate;
+
+void main() {
+	texture_coordinate = vertex_position.xy + 0.5;
+	gl_Position = projection_matrix * view_matrix * objects[object_id].model * vec4(vertex_position, 1);
+}
@@ -0,0 +1,28 @@
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// The depth copy for level 0, the previous level of the pyramid after that
+layout (binding = 0) uniform sampler2D source;
+layout (r32f, binding = 0) writeonly uniform image2D destination;
+
+uniform int source_level;
+
+void main() {
+	ivec2 position = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(destination);
+	if (any(greaterThanEqual(position, size)))
+		return;
+
+	// Every source texel the destination texel covers, three wide along an
+	// odd sized axis so no row or column is dropped
+	ivec2 source_size = textureSize(source, source_level);
+	ivec2 first = position * source_size / size;
+	ivec2 last = min(((position + 1) * source_size + size - 1) / size, source_size) - 1;
+
+	float farthest = 0.0;
+	for (int y = first.y; y <= last.y; y++)
+		for (int x = first.x; x <= last.x; x++)
+			farthest = max(farthest, texelFetch(source, ivec2(x, y), source_level).r);
+	imageStore(destination, position, vec4(farthest));
+}
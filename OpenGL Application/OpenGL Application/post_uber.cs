@@ -0,0 +1,101 @@
+#version 430 core
+
+// BLOOM, LUT and FXAA are defined by PostProcessChain for the enabled stages
+
+layout (local_size_x = 16, local_size_y = 16) in;
+
+layout (binding = 0) uniform sampler2D hdr_texture;
+layout (binding = 1) uniform sampler2D bloom_texture;
+layout (binding = 2) uniform sampler3D lut_texture;
+layout (rgba8, binding = 0) writeonly uniform image2D destination;
+
+uniform float exposure;
+uniform float bloom_strength;
+
+const vec3 LUMA = vec3(0.299, 0.587, 0.114);
+
+// Narkowicz's fit of the ACES filmic curve
+vec3 tonemap(vec3 x) {
+	return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+// Graded display colour of a texel, its luma in alpha
+vec4 grade(ivec2 position, vec2 size) {
+	vec3 color = exposure * texelFetch(hdr_texture, position, 0).rgb;
+#ifdef BLOOM
+	// Already exposed by the prefilter, upsampled bilinearly
+	color += bloom_strength * texture(bloom_texture, (vec2(position) + 0.5) / size).rgb;
+#endif
+	color = pow(tonemap(color), vec3(1.0 / 2.2));
+#ifdef LUT
+	// Onto the centres of the first and last texels
+	float lut_size = float(textureSize(lut_texture, 0).x);
+	color = texture(lut_texture, color * ((lut_size - 1.0) / lut_size) + 0.5 / lut_size).rgb;
+#endif
+	return vec4(color, dot(color, LUMA));
+}
+
+#ifdef FXAA
+// FXAA reaches SPAN_MAX / 2 texels along the edge, plus one for the
+// bilinear taps, so the tile is graded with an apron that wide
+const float SPAN_MAX = 4.0, REDUCE_MUL = 1.0 / 8.0, REDUCE_MIN = 1.0 / 128.0;
+const int APRON = 3;
+const int TILE = 16 + 2 * APRON;
+
+shared vec4 tile[TILE * TILE];
+
+vec4 tile_texel(ivec2 texel) {
+	texel = clamp(texel, ivec2(0), ivec2(TILE - 1));
+	return tile[texel.y * TILE + texel.x];
+}
+
+// Bilinear lookup, position in texels from the tile corner
+vec4 sample_tile(vec2 position) {
+	vec2 base = position - 0.5;
+	ivec2 texel = ivec2(floor(base));
+	vec2 f = base - vec2(texel);
+	return mix(mix(tile_texel(texel), tile_texel(texel + ivec2(1, 0)), f.x),
+		mix(tile_texel(texel + ivec2(0, 1)), tile_texel(texel + ivec2(1, 1)), f.x), f.y);
+}
+#endif
+
+void main() {
+	ivec2 size = imageSize(destination);
+	ivec2 position = ivec2(gl_GlobalInvocationID.xy);
+
+#ifdef FXAA
+	ivec2 origin = ivec2(gl_WorkGroupID.xy) * 16 - APRON;
+	for (int i = int(gl_LocalInvocationIndex); i < TILE * TILE; i += 256)
+		tile[i] = grade(clamp(origin + ivec2(i % TILE, i / TILE), ivec2(0), size - 1), vec2(size));
+	barrier();
+	if (any(greaterThanEqual(position, size)))
+		return;
+
+	// Edge direction from the diagonal neighbours' luma
+	ivec2 texel = ivec2(gl_LocalInvocationID.xy) + APRON;
+	float luma_nw = tile_texel(texel + ivec2(-1, -1)).a;
+	float luma_ne = tile_texel(texel + ivec2(1, -1)).a;
+	float luma_sw = tile_texel(texel + ivec2(-1, 1)).a;
+	float luma_se = tile_texel(texel + ivec2(1, 1)).a;
+	float luma_m = tile_texel(texel).a;
+	float luma_min = min(luma_m, min(min(luma_nw, luma_ne), min(luma_sw, luma_se)));
+	float luma_max = max(luma_m, max(max(luma_nw, luma_ne), max(luma_sw, luma_se)));
+
+	vec2 direction = vec2(-((luma_nw + luma_ne) - (luma_sw + luma_se)), (luma_nw + luma_sw) - (luma_ne + luma_se));
+	float reduce = max((luma_nw + luma_ne + luma_sw + luma_se) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+	direction = clamp(direction / (min(abs(direction.x), abs(direction.y)) + reduce), -SPAN_MAX, SPAN_MAX);
+
+	// Two taps along the edge, or four when that stays within the local
+	// luma range
+	vec2 center = vec2(texel) + 0.5;
+	vec3 inner = 0.5 * (sample_tile(center + direction * (1.0 / 3.0 - 0.5)).rgb + sample_tile(center + direction * (2.0 / 3.0 - 0.5)).rgb);
+	vec3 outer = 0.5 * inner + 0.25 * (sample_tile(center - direction * 0.5).rgb + sample_tile(center + direction * 0.5).rgb);
+	float luma_outer = dot(outer, LUMA);
+	vec3 color = luma_outer < luma_min || luma_outer > luma_max ? inner : outer;
+	imageStore(destination, position, vec4(color, 1.0));
+#else
+	if (any(greaterThanEqual(position, size)))
+		return;
+	imageStore(destination, position, vec4(grade(position, vec2(size)).rgb, 1.0));
+#endif
+}
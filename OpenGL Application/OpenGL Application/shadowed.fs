@@ -0,0 +1,47 @@
+#version 330 core
+
+in vec3 view_position;
+in vec2 texture_coordinate;
+
+out vec4 frag_color;
+
+// Written by CascadedShadowMaps: one layer and matrix per cascade, from view
+// space to shadow map coordinates and depth, and the view depth each
+// cascade ends at, the last one repeated for missing cascades
+uniform sampler2DArrayShadow shadow_maps;
+uniform mat4 shadow_matrices[4];
+uniform vec4 cascade_splits;
+uniform vec3 light_direction; // view space, towards the light
+
+// The --texture texture, ALBEDO when there is none
+uniform sampler2D albedo_texture;
+uniform bool textured;
+
+const vec3 ALBEDO = vec3(1.0, 0.0, 1.0);
+const float AMBIENT = 0.2;
+
+// 3x3 taps of bilinear filtered comparisons
+float shadow(int cascade) {
+	vec4 coord = shadow_matrices[cascade] * vec4(view_position, 1.0);
+	vec2 texel = 1.0 / vec2(textureSize(shadow_maps, 0).xy);
+	float lit = 0.0;
+	for (int y = -1; y <= 1; y++)
+		for (int x = -1; x <= 1; x++)
+			lit += texture(shadow_maps, vec4(coord.xy + vec2(x, y) * texel, float(cascade), coord.z));
+	return lit / 9.0;
+}
+
+void main() {
+	// Facing the camera from either side
+	vec3 normal = normalize(cross(dFdx(view_position), dFdy(view_position)));
+	if (dot(normal, view_position) > 0.0)
+		normal = -normal;
+
+	// Beyond the last cascade is unshadowed
+	int cascade = int(dot(vec4(greaterThan(vec4(-view_position.z), cascade_splits)), vec4(1.0)));
+	float lit = cascade < 4 ? shadow(cascade) : 1.0;
+
+	float diffuse = max(dot(normal, light_direction), 0.0) * lit;
+	vec3 albedo = textured ? texture(albedo_texture, texture_coordinate).rgb : ALBEDO;
+	frag_color = vec4(albedo * (AMBIENT + (1.0 - AMBIENT) * diffuse), 1.0);
+}
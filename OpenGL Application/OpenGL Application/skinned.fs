@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec3 normal;
+
+out vec4 frag_color;
+
+const vec3 ALBEDO = vec3(1.0, 0.0, 1.0);
+const vec3 LIGHT_DIRECTION = vec3(0.29, 0.86, 0.43); // world space, towards the light
+const float AMBIENT = 0.2;
+
+void main() {
+	float diffuse = max(dot(normalize(normal), LIGHT_DIRECTION), 0.0);
+	frag_color = vec4(ALBEDO * (AMBIENT + (1.0 - AMBIENT) * diffuse), 1.0);
+}
@@ -0,0 +1,44 @@
+#version 330 core
+
+layout (location = 0) in vec3 vertex_position;
+layout (location = 1) in vec3 vertex_normal;
+layout (location = 2) in uvec4 joint_indices;
+layout (location = 3) in vec4 joint_weights;
+
+// Dual quaternion per joint, column 0 the real part and column 1 the dual
+// part, each with the scalar in w (glm::mat2x4_cast layout)
+const int MAX_JOINTS = 256;
+layout (std140) uniform JointPalette {
+	mat2x4 joints[MAX_JOINTS];
+};
+
+uniform mat4 model_matrix;
+uniform mat4 view_matrix;
+uniform mat4 projection_matrix;
+
+out vec3 normal;
+
+void main() {
+	mat2x4 first = joints[joint_indices.x];
+	vec4 real = first[0] * joint_weights.x;
+	vec4 dual = first[1] * joint_weights.x;
+
+	// Keep every joint in the hemisphere of the first so the blend takes the short way round
+	for (int k = 1; k < 4; k++) {
+		mat2x4 joint = joints[joint_indices[k]];
+		float weight = dot(first[0], joint[0]) < 0.0 ? -joint_weights[k] : joint_weights[k];
+		real += joint[0] * weight;
+		dual += joint[1] * weight;
+	}
+
+	float one_over_length = 1.0 / length(real);
+	real *= one_over_length;
+	dual *= one_over_length;
+
+	vec3 translation = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+	vec3 position = vertex_position + 2.0 * cross(real.xyz, cross(real.xyz, vertex_position) + real.w * vertex_position) + translation;
+	vec3 skinned_normal = vertex_normal + 2.0 * cross(real.xyz, cross(real.xyz, vertex_normal) + real.w * vertex_normal);
+
+	normal = mat3(model_matrix) * skinned_normal;
+	gl_Position = projection_matrix * view_matrix * model_matrix * vec4(position, 1);
+}
@@ -1,7 +1,13 @@
 #version 330 core
 
+in vec2 texture_coordinate;
+
 out vec4 frag_color;
 
+// The --texture texture, magenta when there is none
+uniform sampler2D albedo_texture;
+uniform bool textured;
+
 void main() {
-	frag_color = vec4(1.0f, 0.0f, 1.0f, 1.0f);
+	frag_color = textured ? vec4(texture(albedo_texture, texture_coordinate).rgb, 1.0f) : vec4(1.0f, 0.0f, 1.0f, 1.0f);
 }
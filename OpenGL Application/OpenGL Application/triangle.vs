@@ -1,11 +1,18 @@
 #version 330 core
 
 layout (location = 0) in vec3 vertex_position;
+layout (location = 2) in vec2 vertex_uv;
 
 uniform mat4 model_matrix;
 uniform mat4 view_matrix;
 uniform mat4 projection_matrix;
 
+out vec3 view_position;
+out vec2 texture_coordinate;
+
 void main() {
-	gl_Position = projection_matrix * view_matrix * model_matrix * vec4(vertex_position, 1);
+	vec4 position = view_matrix * model_matrix * vec4(vertex_position, 1);
+	view_position = position.xyz;
+	texture_coordinate = vertex_uv;
+	gl_Position = projection_matrix * position;
 }